@@ -1,4 +1,4 @@
-gcc.exe -Wall -o .\builds\win32\genAWGpattern.exe src\defOptions\defOptions.c src\genBinary\genBinary.c src\driver.c -static-libgcc -static-libstdc++
+gcc.exe -Wall -o .\builds\win32\genAWGpattern.exe src\autotune\autotune.c src\checkpoint\checkpoint.c src\checksum\checksum.c src\clockSearch\clockSearch.c src\compressStream\compressStream.c src\defOptions\defOptions.c src\fft\fft.c src\genBinary\genBinary.c src\logging\logging.c src\multitone\multitone.c src\prng\prng.c src\pipeline\pipeline.c src\platform\platform.c src\pointsFile\pointsFile.c src\serialLink\serialLink.c src\shard\shard.c src\shmRing\shmRing.c src\shmRing\shmStream.c src\specStream\specStream.c src\spectrum\spectrum.c src\summary\summary.c src\driver.c -lpthread -static-libgcc -static-libstdc++
 @echo OFF
 if %errorlevel% neq 0 pause && exit /b %errorlevel%
 pause
@@ -0,0 +1,399 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "autotune.h"
+#include "../platform/platform.h"
+#include "../compressStream/compressStream.h"
+#include "../logging/logging.h"
+
+#define PROFILE_LINE_MAX 256	     // Longest line of a profile that is read
+
+/* Names of the shapes, in the order of their values */
+static const char  *const shapeNames[TUNE_SHAPE_COUNT] = {
+    "short-unique", "short-repeated", "medium-unique", "medium-repeated", "long-unique",
+    "long-repeated"
+};
+
+/* Samples per tooth of the calibration spec for each length class */
+static const uint64_t benchToothPoints[TUNE_LENGTH_CLASSES] = { 16, 512, 32768 };
+
+/* Chunk sizes tried for the pipeline */
+static const uint64_t benchChunkPoints[] = { 1ul << 16, 1ul << 18, 1ul << 20 };
+
+int specShape(
+    const wavePlan_type * plan
+) {
+    const uint64_t      meanTooth =
+	(plan->toothCount > 0) ? plan->basePoints / plan->toothCount : 0;
+    const uint64_t      copies = ((uint64_t) (plan->flipCopy ? 2 : 1)) << plan->numShifts;
+    int                 lengthClass = TUNE_LENGTH_LONG;
+
+    if (meanTooth <= AUTOTUNE_SHORT_TOOTH)
+	lengthClass = TUNE_LENGTH_SHORT;
+    else if (meanTooth <= AUTOTUNE_LONG_TOOTH)
+	lengthClass = TUNE_LENGTH_MEDIUM;
+    return lengthClass * TUNE_REPEAT_CLASSES
+	+ ((copies >= AUTOTUNE_REPEATED_COPIES) ? TUNE_REPEAT_REPEATED : TUNE_REPEAT_UNIQUE);
+}
+
+const char         *specShapeName(
+    int shape
+) {
+    if ((shape < 0) || (shape >= TUNE_SHAPE_COUNT))
+	return "unknown";
+    return shapeNames[shape];
+}
+
+/* Releases what benchSpec() made. */
+static void freeBenchSpec(
+    freqList_ptr * freqList,
+    uint64_t **counts,
+    wavePlan_type * plan
+) {
+    if (NULL != *freqList)
+	freeFreqList(*freqList);
+    if (NULL != *counts)
+	free(*counts);
+    *freqList = NULL;
+    *counts = NULL;
+    freeWavePlan(plan);
+}
+
+/* Makes a swept spec of the given shape, of about AUTOTUNE_BENCH_POINTS samples in all, with
+ * its inverted copy.  Whether the train is repeated follows from its length, so teeth are
+ * added until it is the shape asked for. */
+static int benchSpec(
+    int shape,
+    const double clockFreq,
+    int sampleFormat,
+    freqList_ptr * freqList,
+    uint64_t **counts,
+    wavePlan_type * plan
+) {
+    const double        pointInterval = 1000.0 / clockFreq;
+    const uint64_t      toothPoints = benchToothPoints[shape / TUNE_REPEAT_CLASSES];
+    const int           repeated = (TUNE_REPEAT_REPEATED == shape % TUNE_REPEAT_CLASSES);
+    const uint64_t      basePoints = AUTOTUNE_BENCH_POINTS / (repeated ? 16 : 2);
+    pulseSweep_type     sweep = PULSE_SWEEP_INIT_VAL;
+    unsigned int        tries = 0;
+
+    // Frequencies with no simple ratio to the clock, so no tooth is a tiled period
+    sweep.kind = PULSE_SRC_LINEAR;
+    sweep.startFreq = 0.0613 * clockFreq;
+    sweep.stopFreq = 0.2371 * clockFreq;
+    sweep.duration = pointInterval * (double) toothPoints;
+    sweep.amplitude = 0.9;
+    sweep.toothCount = (unsigned int) ((basePoints + toothPoints - 1) / toothPoints);
+    for (tries = 0; tries < 64; tries++, sweep.toothCount++) {
+	*freqList = sweepFreqList(&sweep);
+	if (NULL == *freqList)
+	    return -1;
+	*counts = pointCounts(*freqList, pointInterval);
+	if ((NULL == *counts)
+	    || planWaveform(*freqList, *counts, pointInterval, sampleFormat, plan)) {
+	    freeBenchSpec(freqList, counts, plan);
+	    return -1;
+	}
+	if (specShape(plan) == shape)
+	    return 0;
+	freeBenchSpec(freqList, counts, plan);
+    }
+    return -1;
+}
+
+/* Writes the spec's points file once with the given engine, returning the seconds taken. */
+static double timeEngine(
+    const char *scratchRoot,
+    const freqList_ptr freqList,
+    const uint64_t *counts,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    const tuneChoice_type * choice
+) {
+    const double        start = monotonicSeconds();
+    int                 retVal = 0;
+
+    if (TUNE_ENGINE_PIPELINE == choice->engine) {
+	pipelineConfig_type config = PIPELINE_INIT_VAL;
+
+	config.genThreads = choice->genThreads;
+	config.slotCount = choice->slotCount;
+	config.chunkPoints = choice->chunkPoints;
+	retVal = writeToFilePipelined(scratchRoot, freqList, plan, clockFreq, &config,
+				      COMPRESS_NONE, COMPRESS_LEVEL_DEFAULT, NULL, NULL);
+    } else {
+	uint64_t            finalCount = 0;
+	unsigned char      *pointsList = genPointList(freqList, counts, plan->pointInterval,
+						      plan->sampleFormat, MARKER_NONE,
+						      &finalCount, NULL);
+
+	if (NULL == pointsList)
+	    return -1.0;
+	retVal = writeToFile(scratchRoot, pointsList, NULL, finalCount, plan->sampleFormat,
+			     clockFreq, COMPRESS_NONE, COMPRESS_LEVEL_DEFAULT, NULL);
+	free(pointsList);
+    }
+    return retVal ? -1.0 : monotonicSeconds() - start;
+}
+
+/* Times one engine AUTOTUNE_REPEATS times and keeps its best rate in choice->rate. */
+static int rateEngine(
+    const char *scratchRoot,
+    const freqList_ptr freqList,
+    const uint64_t *counts,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    tuneChoice_type * choice
+) {
+    double              best = -1.0;
+    int                 i = 0;
+
+    for (i = 0; i < AUTOTUNE_REPEATS; i++) {
+	const double        seconds =
+	    timeEngine(scratchRoot, freqList, counts, plan, clockFreq, choice);
+
+	if (seconds < 0.0)
+	    return -1;
+	if ((best < 0.0) || (seconds < best))
+	    best = seconds;
+    }
+    choice->rate = ((double) plan->finalCount) / ((best > 1.0e-9) ? best : 1.0e-9) / 1.0e6;
+    logMessage(LOG_DEBUG, "\t%s engine, %u threads, %u buffers of %" PRIu64 ": %.1f Msamples/s\n",
+	       (TUNE_ENGINE_PIPELINE == choice->engine) ? "pipeline" : "memory", choice->genThreads,
+	       choice->slotCount, choice->chunkPoints, choice->rate);
+    return 0;
+}
+
+/* Finds the fastest engine for one shape.  memoryRate gets the in-memory engine's rate, for
+ * comparison. */
+static int tuneShape(
+    int shape,
+    const char *scratchRoot,
+    const double clockFreq,
+    int sampleFormat,
+    unsigned int maxThreads,
+    tuneChoice_type * best,
+    double *memoryRate
+) {
+    freqList_ptr        freqList = NULL;
+    uint64_t           *counts = NULL;
+    wavePlan_type       plan = WAVE_PLAN_INIT_VAL;
+    tuneChoice_type     candidate = TUNE_CHOICE_INIT_VAL;
+    unsigned int        threads = 1;
+    size_t              i = 0;
+
+    if (benchSpec(shape, clockFreq, sampleFormat, &freqList, &counts, &plan)) {
+	logMessage(LOG_ERROR, "Problem making a %s calibration spec.\n", specShapeName(shape));
+	return -1;
+    }
+    logMessage(LOG_DEBUG, "%s: %u teeth, %" PRIu64 " samples\n", specShapeName(shape),
+	       plan.toothCount, plan.finalCount);
+
+    candidate.engine = TUNE_ENGINE_MEMORY;
+    if (rateEngine(scratchRoot, freqList, counts, &plan, clockFreq, &candidate)) {
+	freeBenchSpec(&freqList, &counts, &plan);
+	return -1;
+    }
+    *best = candidate;
+    *memoryRate = candidate.rate;
+
+    // Powers of two up to the processor count, and the count itself
+    candidate.engine = TUNE_ENGINE_PIPELINE;
+    while (threads <= maxThreads) {
+	for (i = 0; i < sizeof (benchChunkPoints) / sizeof (benchChunkPoints[0]); i++) {
+	    candidate.genThreads = threads;
+	    candidate.slotCount =
+		(2 * threads > PIPELINE_DEFAULT_SLOTS) ? 2 * threads : PIPELINE_DEFAULT_SLOTS;
+	    candidate.chunkPoints = benchChunkPoints[i];
+	    if (rateEngine(scratchRoot, freqList, counts, &plan, clockFreq, &candidate)) {
+		freeBenchSpec(&freqList, &counts, &plan);
+		return -1;
+	    }
+	    if (candidate.rate > best->rate)
+		*best = candidate;
+	}
+	if ((threads < maxThreads) && (2 * threads > maxThreads))
+	    threads = maxThreads;
+	else
+	    threads *= 2;
+    }
+    freeBenchSpec(&freqList, &counts, &plan);
+    return 0;
+}
+
+static int writeProfile(
+    const char *profilePath,
+    unsigned int processors,
+    const tuneChoice_type * best
+) {
+    FILE               *outFile = fopen(profilePath, "w");
+    int                 shape = 0;
+    int                 retVal = 0;
+
+    if (NULL == outFile) {
+	logMessage(LOG_ERROR, "Could not open the profile \"%s\": %s\n", profilePath,
+		   strerror(errno));
+	return -1;
+    }
+    fprintf(outFile, "# Engine profile written by --autotune, one line per spec shape:\n");
+    fprintf(outFile, "# <shape> <memory|pipeline> <threads> <buffers> <chunk samples> "
+	    "<Msamples/s>\n");
+    fprintf(outFile, "cpus %u\n", processors);
+    for (shape = 0; shape < TUNE_SHAPE_COUNT; shape++) {
+	fprintf(outFile, "%s %s %u %u %" PRIu64 " %.1f\n", specShapeName(shape),
+		(TUNE_ENGINE_PIPELINE == (best + shape)->engine) ? "pipeline" : "memory",
+		(best + shape)->genThreads, (best + shape)->slotCount, (best + shape)->chunkPoints,
+		(best + shape)->rate);
+    }
+    if (ferror(outFile))
+	retVal = -1;
+    if (fclose(outFile))
+	retVal = -1;
+    if (retVal)
+	logMessage(LOG_ERROR, "Could not write the profile \"%s\": %s\n", profilePath,
+		   strerror(errno));
+    return retVal;
+}
+
+int runAutotune(
+    const char *profilePath,
+    const char *rootName,
+    const double clockFreq,
+    int sampleFormat
+) {
+    const char          scratchSuf[] = "_autotune";
+    const char          pointsSuf[] = "_points";
+    const unsigned int  processors = onlineProcessors();
+    const int           infoShown = LOG_ENABLED(LOG_INFO);
+    unsigned int        maxThreads = processors;
+    tuneChoice_type     best[TUNE_SHAPE_COUNT];
+    double              memoryRate = 0.0;
+    char               *scratchRoot = NULL;
+    char               *scratchFile = NULL;
+    int                 shape = 0;
+    int                 retVal = 0;
+
+    if (maxThreads > AUTOTUNE_MAX_THREADS)
+	maxThreads = AUTOTUNE_MAX_THREADS;
+    if (maxThreads > PIPELINE_MAX_THREADS)
+	maxThreads = PIPELINE_MAX_THREADS;
+    scratchRoot = malloc(strlen(rootName) + strlen(scratchSuf) + 1);
+    scratchFile = malloc(strlen(rootName) + strlen(scratchSuf) + strlen(pointsSuf) + 1);
+    if ((NULL == scratchRoot) || (NULL == scratchFile)) {
+	if (NULL != scratchRoot)
+	    free(scratchRoot);
+	if (NULL != scratchFile)
+	    free(scratchFile);
+	return -1;
+    }
+    sprintf(scratchRoot, "%s%s", rootName, scratchSuf);
+    sprintf(scratchFile, "%s%s", scratchRoot, pointsSuf);
+
+    logMessage(LOG_INFO, "Calibrating on %u processors, %" PRIu64 " samples per run.\n",
+	       processors, (uint64_t) AUTOTUNE_BENCH_POINTS);
+    for (shape = 0; shape < TUNE_SHAPE_COUNT; shape++) {
+	// The engines' own messages would repeat for every run
+	logSetEnabled(LOG_INFO, 0);
+	retVal = tuneShape(shape, scratchRoot, clockFreq, sampleFormat, maxThreads,
+			   best + shape, &memoryRate);
+	logSetEnabled(LOG_INFO, infoShown);
+	if (retVal)
+	    break;
+	if (TUNE_ENGINE_PIPELINE == best[shape].engine)
+	    logMessage(LOG_INFO, "%-16s pipeline, %u thread(s), %" PRIu64 "-sample chunks: "
+		       "%.1f Msamples/s (in memory %.1f)\n", specShapeName(shape),
+		       best[shape].genThreads, best[shape].chunkPoints, best[shape].rate,
+		       memoryRate);
+	else
+	    logMessage(LOG_INFO, "%-16s in memory: %.1f Msamples/s\n", specShapeName(shape),
+		       best[shape].rate);
+    }
+    remove(scratchFile);
+    free(scratchFile);
+    free(scratchRoot);
+    if (retVal) {
+	logMessage(LOG_ERROR, "Problem calibrating the engines.\n");
+	return -1;
+    }
+    if (writeProfile(profilePath, processors, best))
+	return -1;
+    logMessage(LOG_INFO, "Profile written to \"%s\".\n", profilePath);
+    return 0;
+}
+
+int loadTuneChoice(
+    const char *profilePath,
+    const wavePlan_type * plan,
+    tuneChoice_type * choice
+) {
+    const int           shape = specShape(plan);
+    char                line[PROFILE_LINE_MAX];
+    unsigned int        processors = 0;
+    int                 found = 0;
+    int                 badLine = 0;
+    FILE               *inFile = fopen(profilePath, "r");
+
+    if (NULL == inFile) {
+	logMessage(LOG_DEBUG, "No engine profile at \"%s\".\n", profilePath);
+	return -1;
+    }
+    while (!found && !badLine && (NULL != fgets(line, sizeof (line), inFile))) {
+	char                name[32];
+	char                engine[16];
+	tuneChoice_type     entry = TUNE_CHOICE_INIT_VAL;
+
+	if (('#' == line[0]) || ('\n' == line[0]))
+	    continue;
+	if (1 == sscanf(line, "cpus %u", &processors))
+	    continue;
+	if ((6 != sscanf(line, "%31s %15s %u %u %" SCNu64 " %lf", name, engine, &entry.genThreads,
+			 &entry.slotCount, &entry.chunkPoints, &entry.rate))
+	    || (0 == entry.genThreads) || (entry.genThreads > PIPELINE_MAX_THREADS)
+	    || (entry.slotCount < 2) || (0 == entry.chunkPoints)) {
+	    badLine = 1;
+	} else if (0 == strcmp(name, specShapeName(shape))) {
+	    if (0 == strcmp(engine, "pipeline"))
+		entry.engine = TUNE_ENGINE_PIPELINE;
+	    else if (0 == strcmp(engine, "memory"))
+		entry.engine = TUNE_ENGINE_MEMORY;
+	    else
+		badLine = 1;
+	    *choice = entry;
+	    found = !badLine;
+	}
+    }
+    fclose(inFile);
+    if (badLine) {
+	logMessage(LOG_WARN, "Warning: ignoring the engine profile \"%s\", which can't be read.  "
+		   "Run --autotune again.\n", profilePath);
+	return -1;
+    }
+    if (!found) {
+	logMessage(LOG_DEBUG, "No %s entry in the engine profile.\n", specShapeName(shape));
+	return -1;
+    }
+    if ((0 != processors) && (processors != onlineProcessors()))
+	logMessage(LOG_WARN, "Warning: the engine profile was measured on %u processors, not %u.  "
+		   "Run --autotune again.\n", processors, onlineProcessors());
+    return 0;
+}
+
+void printTuneChoice(
+    const tuneChoice_type * choice,
+    const char *profilePath,
+    int shape
+) {
+    if (TUNE_ENGINE_PIPELINE == choice->engine)
+	logMessage(LOG_INFO, "Engine: pipeline, %u thread(s), %u buffers of %" PRIu64 " samples",
+		   choice->genThreads, choice->slotCount, choice->chunkPoints);
+    else
+	logMessage(LOG_INFO, "Engine: in memory");
+    if (NULL == profilePath)
+	logMessage(LOG_INFO, ", as given\n");
+    else
+	logMessage(LOG_INFO, ", from \"%s\" for %s specs (%.1f Msamples/s when measured)\n",
+		   profilePath, specShapeName(shape), choice->rate);
+    return;
+}
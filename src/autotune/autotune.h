@@ -0,0 +1,138 @@
+
+/*! @file autotune.h
+ * @brief Measures how best to generate and write the points file on this host, and recalls it.
+ *
+ * The points file can be made whole in memory and then written, or through the pipeline with
+ * any number of generator threads and any chunk size.  Which is fastest depends on the host
+ * and on the shape of the spec: many short teeth cost more per sample than a few long ones,
+ * and a waveform that is mostly copies of its base train is limited by the writer, not the
+ * generators.  Specs are sorted into a few shapes by their mean tooth length and by how many
+ * copies of the base train the final waveform holds.  See @ref SpecShapes.
+ *
+ * runAutotune() times every engine on a synthetic spec of each shape, writing a scratch points
+ * file, and saves the fastest for each shape to a profile.  loadTuneChoice() looks up the
+ * entry for a planned waveform, so normal runs can use it.
+ */
+
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include "../genBinary/genBinary.h"
+#include "../pipeline/pipeline.h"
+
+#define AUTOTUNE_BENCH_POINTS (1ul << 22)	//!< Samples in each calibration waveform.
+#define AUTOTUNE_REPEATS 3	//!< Each engine is timed this many times per shape, keeping the fastest.
+#define AUTOTUNE_MAX_THREADS 16	//!< Most generator threads tried.
+#define AUTOTUNE_SHORT_TOOTH 64	//!< Teeth averaging at most this many samples are short.
+#define AUTOTUNE_LONG_TOOTH 4096	//!< Teeth averaging more than this many samples are long.
+#define AUTOTUNE_REPEATED_COPIES 4	//!< A final waveform holding at least this many copies of its base train is repeated.
+
+/*!
+ * @defgroup TuneEngines Engines
+ * @brief The ways of making the points file a profile chooses between.
+ * @{
+ */
+#define TUNE_ENGINE_MEMORY   0	//!< genPointList() then writeToFile(), as without --pipeline.
+#define TUNE_ENGINE_PIPELINE 1	//!< writeToFilePipelined().
+
+/*! @} */
+
+/*!
+ * @defgroup SpecShapes Spec shapes
+ * @brief A shape is a tooth length class times #TUNE_REPEAT_CLASSES plus a repetition class.
+ * @{
+ */
+#define TUNE_LENGTH_SHORT  0	//!< Mean tooth up to #AUTOTUNE_SHORT_TOOTH samples.
+#define TUNE_LENGTH_MEDIUM 1	//!< Mean tooth up to #AUTOTUNE_LONG_TOOTH samples.
+#define TUNE_LENGTH_LONG   2	//!< Longer mean tooth.
+#define TUNE_LENGTH_CLASSES 3	//!< Number of tooth length classes.
+#define TUNE_REPEAT_UNIQUE   0	//!< Fewer than #AUTOTUNE_REPEATED_COPIES copies of the base train.
+#define TUNE_REPEAT_REPEATED 1	//!< At least #AUTOTUNE_REPEATED_COPIES copies of the base train.
+#define TUNE_REPEAT_CLASSES 2	//!< Number of repetition classes.
+#define TUNE_SHAPE_COUNT (TUNE_LENGTH_CLASSES * TUNE_REPEAT_CLASSES)	//!< Number of shapes.
+
+/*! @} */
+
+/*! @brief How to make the points file, as chosen by a profile or given on the command line.
+ *
+ * Expected initialization found in #TUNE_CHOICE_INIT_VAL
+ */
+typedef struct tuneChoice {
+    int                 engine;	//!< One of the @ref TuneEngines.
+    unsigned int        genThreads;	//!< Generator threads, for #TUNE_ENGINE_PIPELINE.
+    unsigned int        slotCount;	//!< Buffers in the ring, for #TUNE_ENGINE_PIPELINE.
+    uint64_t            chunkPoints;	//!< Samples per buffer, for #TUNE_ENGINE_PIPELINE.
+    double              rate;	//!< Millions of samples per second when measured, 0 if not measured.
+} tuneChoice_type;
+
+#define TUNE_CHOICE_INIT_VAL {TUNE_ENGINE_MEMORY, 1, PIPELINE_DEFAULT_SLOTS, PIPELINE_DEFAULT_CHUNK, 0.0}	//!< Initialization data for a #tuneChoice instantiation.
+
+/*!	@brief Sorts a planned waveform into one of the @ref SpecShapes.
+ *
+ * @param[in] plan The plan from planWaveform().
+ * @return The shape, from 0 to #TUNE_SHAPE_COUNT - 1.
+ */
+int                 specShape(
+    const wavePlan_type * plan
+);
+
+/*!	@brief Names a shape, as written in the profile.
+ *
+ * @param[in] shape One of the @ref SpecShapes.
+ * @return A name such as "short-repeated", or "unknown".
+ */
+const char         *specShapeName(
+    int shape
+);
+
+/*!	@brief Times every engine on each shape and writes the fastest to a profile.
+ *
+ * The calibration waveforms are written to "\<rootName\>_autotune_points", which is removed
+ * afterwards, so the times include the writer.  They are uncompressed, so a profile reflects
+ * generation and writing but not --compress.
+ *
+ * @param[in] profilePath The profile to write.
+ * @param[in] rootName The base of the scratch filename.
+ * @param[in] clockFreq The output sample frequency, in MHz.
+ * @param[in] sampleFormat One of the @ref SampleFormats.
+ * @return 0 on success
+ * @return -1 on failure
+ */
+int                 runAutotune(
+    const char *profilePath,
+    const char *rootName,
+    const double clockFreq,
+    int sampleFormat
+);
+
+/*!	@brief Looks up the profile entry for a planned waveform.
+ *
+ * A missing profile is not an error; one that can't be read is warned about.
+ *
+ * @param[in] profilePath The profile written by runAutotune().
+ * @param[in] plan The plan from planWaveform().
+ * @param[out] choice The entry for the plan's shape.
+ * @return 0 on success
+ * @return -1 if there is no profile, or no entry for the shape.
+ */
+int                 loadTuneChoice(
+    const char *profilePath,
+    const wavePlan_type * plan,
+    tuneChoice_type * choice
+);
+
+/*!	@brief Logs which engine makes the points file, when it comes from a profile or for --stats.
+ *
+ * Logged at #LOG_INFO, so -q hides it.
+ *
+ * @param[in] choice The engine used.
+ * @param[in] profilePath The profile it came from, or NULL if it was given on the command line.
+ * @param[in] shape The shape it was chosen for, one of the @ref SpecShapes.
+ */
+void                printTuneChoice(
+    const tuneChoice_type * choice,
+    const char *profilePath,
+    int shape
+);
+
+#endif
@@ -0,0 +1,404 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <sys/types.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "checkpoint.h"
+#include "../platform/platform.h"
+#include "../summary/summary.h"
+#include "../logging/logging.h"
+
+/* State carried between calls of checkpointSink() */
+typedef struct checkpointSink {
+    FILE               *outFile;
+    const char         *rootName;
+    const wavePlan_type *plan;
+    uint64_t            headerBytes;
+    uint64_t            chunkBytes;
+    uint64_t            curveBytes;
+    unsigned int        width;
+    double              intervalSeconds;
+    double              lastSeconds;	     // When the last checkpoint was taken
+    checkpoint_type     progress;	     // progress.output digests every byte written
+} checkpointSink_type;
+
+/* Makes "<rootName><suffix>", to be freed by the caller. */
+static char        *rootFileName(
+    const char *rootName,
+    const char *suffix
+) {
+    char               *fileName = malloc(strlen(rootName) + strlen(suffix) + 1);
+
+    if (NULL != fileName)
+	sprintf(fileName, "%s%s", rootName, suffix);
+    return fileName;
+}
+
+/* Pushes what has been written to the file out to the disk. */
+static int syncFile(
+    FILE * outFile
+) {
+    if (fflush(outFile))
+	return -1;
+#ifdef HAVE_FSYNC
+    if (fsync(fileno(outFile)))
+	return -1;
+#endif
+    return 0;
+}
+
+/* The pulse that sample number samples of the final waveform belongs to, and its sign. */
+static void progressAt(
+    const wavePlan_type * plan,
+    uint64_t samples,
+    unsigned int *tooth,
+    int *sign
+) {
+    uint64_t            unit = 0;
+    uint64_t            basePos = 0;
+    unsigned int        lo = 0;
+    unsigned int        hi = plan->toothCount;
+
+    if ((samples >= plan->finalCount) || (0 == plan->basePoints) || (0 == plan->toothCount)) {
+	*tooth = plan->toothCount;
+	*sign = 1;
+	return;
+    }
+    unit = samples / plan->basePoints;
+    basePos = samples % plan->basePoints;
+    // The last pulse starting at or before basePos
+    while (hi - lo > 1) {
+	const unsigned int  mid = lo + (hi - lo) / 2;
+
+	if (*(plan->toothStart + mid) <= basePos)
+	    lo = mid;
+	else
+	    hi = mid;
+    }
+    *tooth = lo;
+    *sign = *(plan->toothSign + lo);
+    // Odd units past the base train are the inverted copy
+    if (plan->flipCopy && (unit & 1))
+	*sign = -*sign;
+    return;
+}
+
+/* Replaces the journal with one describing progress, so there is never a partial journal. */
+static int writeJournal(
+    const char *rootName,
+    const checkpoint_type * progress
+) {
+    char               *fileName = rootFileName(rootName, "_checkpoint.txt");
+    char               *tempName = rootFileName(rootName, "_checkpoint.part");
+    FILE               *outFile = NULL;
+    int                 retVal = 0;
+
+    if ((NULL == fileName) || (NULL == tempName)) {
+	retVal = -1;
+    } else if (NULL == (outFile = fopen(tempName, "w"))) {
+	perror("Opening checkpoint journal");
+	retVal = -1;
+    } else {
+	fprintf(outFile, "# Progress of the points file, for --resume\n");
+	fprintf(outFile, "spec_crc32c %08" PRIx32 "\n", progress->spec.crc);
+	fprintf(outFile, "spec_bytes %" PRIu64 "\n", progress->spec.bytes);
+	fprintf(outFile, "clock_mhz %f\n", progress->clockFreq);
+	fprintf(outFile, "sample_format %s\n", sampleFormatInfo(progress->sampleFormat)->name);
+	fprintf(outFile, "points %" PRIu64 "\n", progress->finalCount);
+	fprintf(outFile, "chunk_points %" PRIu64 "\n", progress->chunkPoints);
+	fprintf(outFile, "samples %" PRIu64 "\n", progress->samples);
+	fprintf(outFile, "tooth %u\n", progress->tooth);
+	fprintf(outFile, "sign %d\n", progress->sign);
+	fprintf(outFile, "bytes %" PRIu64 "\n", progress->output.bytes);
+	fprintf(outFile, "crc32c %08" PRIx32 "\n", progress->output.crc);
+	if (ferror(outFile) || syncFile(outFile))
+	    retVal = -1;
+	if (fclose(outFile))
+	    retVal = -1;
+	if (!retVal) {
+	    remove(fileName);	     // rename() won't replace a file everywhere
+	    if (rename(tempName, fileName)) {
+		perror("Renaming checkpoint journal");
+		retVal = -1;
+	    }
+	}
+	if (retVal)
+	    remove(tempName);
+    }
+    if (NULL != fileName)
+	free(fileName);
+    if (NULL != tempName)
+	free(tempName);
+    return retVal;
+}
+
+/* Reads the journal into saved.  Every key must be there. */
+static int readJournal(
+    const char *rootName,
+    checkpoint_type * saved
+) {
+    char               *fileName = rootFileName(rootName, "_checkpoint.txt");
+    char                line[CHECKPOINT_LINE_MAX];
+    FILE               *inFile = NULL;
+    unsigned int        found = 0;
+    int                 badLine = 0;
+
+    if (NULL == fileName)
+	return -1;
+    inFile = fopen(fileName, "r");
+    free(fileName);
+    if (NULL == inFile)
+	return -1;
+    while (!badLine && (NULL != fgets(line, sizeof (line), inFile))) {
+	char                key[32];
+	char                value[64];
+
+	if ('#' == line[0])
+	    continue;
+	if (2 != sscanf(line, "%31s %63s", key, value)) {
+	    badLine = 1;
+	} else if (0 == strcmp(key, "spec_crc32c")) {
+	    badLine = (1 != sscanf(value, "%" SCNx32, &saved->spec.crc));
+	    found |= 1u << 0;
+	} else if (0 == strcmp(key, "spec_bytes")) {
+	    badLine = (1 != sscanf(value, "%" SCNu64, &saved->spec.bytes));
+	    found |= 1u << 1;
+	} else if (0 == strcmp(key, "clock_mhz")) {
+	    badLine = (1 != sscanf(value, "%lf", &saved->clockFreq));
+	    found |= 1u << 2;
+	} else if (0 == strcmp(key, "sample_format")) {
+	    saved->sampleFormat = parseSampleFormatName(value);
+	    badLine = (saved->sampleFormat < 0);
+	    found |= 1u << 3;
+	} else if (0 == strcmp(key, "points")) {
+	    badLine = (1 != sscanf(value, "%" SCNu64, &saved->finalCount));
+	    found |= 1u << 4;
+	} else if (0 == strcmp(key, "chunk_points")) {
+	    badLine = (1 != sscanf(value, "%" SCNu64, &saved->chunkPoints));
+	    found |= 1u << 5;
+	} else if (0 == strcmp(key, "samples")) {
+	    badLine = (1 != sscanf(value, "%" SCNu64, &saved->samples));
+	    found |= 1u << 6;
+	} else if (0 == strcmp(key, "tooth")) {
+	    badLine = (1 != sscanf(value, "%u", &saved->tooth));
+	    found |= 1u << 7;
+	} else if (0 == strcmp(key, "sign")) {
+	    badLine = (1 != sscanf(value, "%d", &saved->sign));
+	    found |= 1u << 8;
+	} else if (0 == strcmp(key, "bytes")) {
+	    badLine = (1 != sscanf(value, "%" SCNu64, &saved->output.bytes));
+	    found |= 1u << 9;
+	} else if (0 == strcmp(key, "crc32c")) {
+	    badLine = (1 != sscanf(value, "%" SCNx32, &saved->output.crc));
+	    found |= 1u << 10;
+	}
+    }
+    fclose(inFile);
+    return (badLine || (found != (1u << 11) - 1)) ? -1 : 0;
+}
+
+/* Checks that the journal describes this run, and how far its file got. */
+static int checkJournal(
+    const checkpointSink_type * state,
+    const checkpoint_type * saved
+) {
+    const checkpoint_type *now = &state->progress;
+    unsigned int        tooth = 0;
+    int                 sign = 0;
+
+    if ((saved->spec.crc != now->spec.crc) || (saved->spec.bytes != now->spec.bytes)) {
+	logMessage(LOG_ERROR, "The checkpoint was made from a different spec.\n");
+	return -1;
+    }
+    // The journal has the clock to 6 decimals, as the points file does
+    if ((fabs(saved->clockFreq - now->clockFreq) > 5.0e-7)
+	|| (saved->sampleFormat != now->sampleFormat) || (saved->finalCount != now->finalCount)) {
+	logMessage(LOG_ERROR, "The checkpoint was made with a different clock or sample format.\n");
+	return -1;
+    }
+    if ((0 == saved->chunkPoints) || (saved->samples > saved->finalCount)
+	|| ((0 != saved->samples % saved->chunkPoints) && (saved->samples != saved->finalCount))
+	|| (saved->output.bytes != state->headerBytes + saved->samples * state->width)) {
+	logMessage(LOG_ERROR, "The checkpoint is not at a chunk boundary of the curve.\n");
+	return -1;
+    }
+    progressAt(state->plan, saved->samples, &tooth, &sign);
+    if ((tooth != saved->tooth) || (sign != saved->sign)) {
+	logMessage(LOG_ERROR, "The checkpoint's pulse and sign don't match the plan.\n");
+	return -1;
+    }
+    return 0;
+}
+
+/* Records progress, once what the journal will describe is on the disk. */
+static int takeCheckpoint(
+    checkpointSink_type * state,
+    uint64_t samples
+) {
+    if (syncFile(state->outFile))
+	return -1;
+    state->progress.samples = samples;
+    progressAt(state->plan, samples, &state->progress.tooth, &state->progress.sign);
+    if (writeJournal(state->rootName, &state->progress))
+	return -1;
+    state->lastSeconds = monotonicSeconds();
+    logMessage(LOG_DEBUG, "Checkpoint at sample %" PRIu64 ", pulse %u.\n", samples,
+	       state->progress.tooth);
+    return 0;
+}
+
+static int checkpointSink(
+    void *sinkCtx,
+    const unsigned char *bytes,
+    size_t len
+) {
+    checkpointSink_type *state = sinkCtx;
+    uint64_t            curvePos = 0;
+
+    digestBytes(&state->progress.output, bytes, len);
+    if (fwrite(bytes, sizeof (unsigned char), len, state->outFile) != len)
+	return -1;
+    // Checkpoints fall only at the ends of chunks of the curve
+    if (state->progress.output.bytes <= state->headerBytes)
+	return 0;
+    curvePos = state->progress.output.bytes - state->headerBytes;
+    if ((curvePos > state->curveBytes)
+	|| ((0 != curvePos % state->chunkBytes) && (curvePos != state->curveBytes))
+	|| (monotonicSeconds() - state->lastSeconds < state->intervalSeconds))
+	return 0;
+    return takeCheckpoint(state, curvePos / state->width);
+}
+
+/* Opens the points file and cuts it back to the checkpoint. */
+static FILE        *reopenAtCheckpoint(
+    const char *fileName,
+    uint64_t offset
+) {
+    FILE               *outFile = fopen(fileName, "r+b");
+    uint64_t            end = 0;
+
+    if (NULL == outFile) {
+	perror("Opening points file to resume");
+	return NULL;
+    }
+    if (fileLength(outFile, &end) || (end < offset)) {
+	logMessage(LOG_ERROR, "The points file is shorter than its checkpoint.\n");
+	fclose(outFile);
+	return NULL;
+    }
+    fflush(outFile);
+#ifdef HAVE_UNISTD_H
+    // Whatever came after the checkpoint may not have reached the disk whole
+    if (ftruncate(fileno(outFile), (off_t) offset)) {
+	perror("Truncating points file");
+	fclose(outFile);
+	return NULL;
+    }
+#endif
+    if (seekTo(outFile, offset)) {
+	fclose(outFile);
+	return NULL;
+    }
+    return outFile;
+}
+
+int writeToFileCheckpointed(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    const pipelineConfig_type * config,
+    double intervalSeconds,
+    int resume,
+    pipelineStats_type * stats,
+    outputDigest_type * digest
+) {
+    const checkpoint_type blankProgress = CHECKPOINT_INIT_VAL;
+    checkpointSink_type state;
+    pipelineConfig_type resumeConfig = *config;
+    char                headerBuf[128];
+    char               *fileName = NULL;
+    int                 headerLen = 0;
+    int                 retVal = 0;
+
+    memset(&state, 0, sizeof (checkpointSink_type));
+    if (NULL != stats)
+	memset(stats, 0, sizeof (pipelineStats_type));
+    headerLen = formatPointsHeader(headerBuf, sizeof (headerBuf), plan->finalCount,
+				   plan->sampleFormat);
+    fileName = rootFileName(rootName, "_points");
+    if ((headerLen < 0) || (NULL == fileName)) {
+	if (NULL != fileName)
+	    free(fileName);
+	return -1;
+    }
+    if (resumeConfig.chunkPoints < 1)
+	resumeConfig.chunkPoints = PIPELINE_DEFAULT_CHUNK;
+    state.rootName = rootName;
+    state.plan = plan;
+    state.width = sampleFormatInfo(plan->sampleFormat)->width;
+    state.headerBytes = (uint64_t) headerLen;
+    state.curveBytes = plan->finalCount * state.width;
+    state.intervalSeconds = intervalSeconds;
+    state.progress = blankProgress;
+    digestFreqList(&state.progress.spec, freqList);
+    state.progress.clockFreq = clockFreq;
+    state.progress.sampleFormat = plan->sampleFormat;
+    state.progress.finalCount = plan->finalCount;
+    state.progress.chunkPoints = resumeConfig.chunkPoints;
+
+    if (resume) {
+	checkpoint_type     saved = CHECKPOINT_INIT_VAL;
+
+	if (readJournal(rootName, &saved)) {
+	    logMessage(LOG_ERROR, "No checkpoint journal to resume from.\n");
+	    retVal = -1;
+	} else if (checkJournal(&state, &saved)) {
+	    retVal = -1;
+	} else if (NULL == (state.outFile = reopenAtCheckpoint(fileName, saved.output.bytes))) {
+	    retVal = -1;
+	} else {
+	    // Chunks line up with the checkpoints only at the size they were made with
+	    if (saved.chunkPoints != resumeConfig.chunkPoints)
+		logMessage(LOG_INFO, "Using the checkpoint's %" PRIu64 "-sample chunks.\n",
+			   saved.chunkPoints);
+	    state.progress = saved;
+	    resumeConfig.chunkPoints = saved.chunkPoints;
+	    resumeConfig.firstChunk = (saved.samples + saved.chunkPoints - 1) / saved.chunkPoints;
+	    logMessage(LOG_INFO, "Resuming at sample %" PRIu64 " of %" PRIu64 ", pulse %u.\n",
+		       saved.samples, saved.finalCount, saved.tooth);
+	}
+    } else if (NULL == (state.outFile = fopen(fileName, "wb"))) {
+	perror("Opening points file");
+	retVal = -1;
+    }
+    free(fileName);
+    if (retVal)
+	return -1;
+
+    state.chunkBytes = resumeConfig.chunkPoints * state.width;
+    state.lastSeconds = monotonicSeconds();
+    retVal = runPipeline(freqList, plan, clockFreq, &resumeConfig, checkpointSink, &state, stats);
+    if (ferror(state.outFile))
+	retVal = -1;
+    if (fclose(state.outFile))
+	retVal = -1;
+    if (retVal) {
+	logMessage(LOG_ERROR, "Stopped; the points file can be finished from sample %" PRIu64
+		   " with --resume.\n", state.progress.samples);
+	return -1;
+    }
+    // The file is whole, so there is nothing left to resume
+    fileName = rootFileName(rootName, "_checkpoint.txt");
+    if (NULL != fileName) {
+	remove(fileName);
+	free(fileName);
+    }
+    if (NULL != digest)
+	*digest = state.progress.output;
+    return 0;
+}
@@ -0,0 +1,94 @@
+
+/*! @file checkpoint.h
+ * @brief Writes the points file so that an interrupted run can pick up where it stopped.
+ *
+ * The file is written through runPipeline().  At chunk boundaries, no more often than the
+ * interval given, the file is flushed to the disk and a journal, "\<rootName\>_checkpoint.txt",
+ * records how much of it is there.  The journal itself is written to a temporary name, flushed
+ * and renamed over the old one, so there is always one complete journal that no more than
+ * describes the file.
+ *
+ * A resumed run checks the journal against its own spec, clock, sample format and plan, cuts
+ * the points file back to the checkpoint and sends the rest, continuing the digest from the
+ * one recorded.  Nothing before the checkpoint is generated again, except the part of the
+ * base train the remaining copies are made from.  See @ref PipelineResume.
+ *
+ * The journal is removed once the points file is complete.
+ *
+ * @section CheckpointJournal Journal contents
+ *
+ * A comment line starting with '#', then one "\<key\> \<value\>" line each of:
+ * Key | Value
+ * --- | -----
+ * spec_crc32c | CRC32C of the pulse list, see digestPulse(), as 8 hex digits
+ * spec_bytes | Number of bytes that CRC covers
+ * clock_mhz | Sample clock, in MHz
+ * sample_format | Name of the sample format, from sampleFormatInfo()
+ * points | Total points in the final waveform
+ * chunk_points | Samples per pipeline chunk, which a resumed run uses as well
+ * samples | Samples of the curve in the file at the checkpoint
+ * tooth | Index of the pulse the next sample belongs to, the pulse count once the curve is done
+ * sign | The sign that pulse is played with, 1 or -1, including the inverted copy
+ * bytes | Bytes in the file at the checkpoint
+ * crc32c | CRC32C of those bytes, as 8 hex digits
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "../genBinary/genBinary.h"
+#include "../pipeline/pipeline.h"
+#include "../checksum/checksum.h"
+
+#define CHECKPOINT_DEFAULT_SECONDS 10.0	//!< Interval between checkpoints when --resume is given without --checkpoint.
+#define CHECKPOINT_LINE_MAX 128	//!< Longest journal line that is read.
+
+/*! @brief How far the points file got, as recorded in the journal.
+ *
+ * Expected initialization found in #CHECKPOINT_INIT_VAL
+ */
+typedef struct checkpoint {
+    outputDigest_type   spec;	//!< Digest of the pulse list, from digestFreqList().
+    double              clockFreq;	//!< The output sample frequency, in MHz.
+    int                 sampleFormat;	//!< One of the @ref SampleFormats.
+    uint64_t            finalCount;	//!< Total points in the final waveform.
+    uint64_t            chunkPoints;	//!< Samples per pipeline chunk.
+    uint64_t            samples;	//!< Samples of the curve in the file, a whole number of chunks or all of them.
+    unsigned int        tooth;	//!< The pulse the next sample belongs to, #wavePlan::toothCount once the curve is done.
+    int                 sign;	//!< The sign that pulse is played with, +1 or -1.
+    outputDigest_type   output;	//!< Digest of the bytes in the file, header included.
+} checkpoint_type;
+
+#define CHECKPOINT_INIT_VAL {OUTPUT_DIGEST_INIT_VAL, 0.0, SAMPLE_FORMAT_U8, 0, 0, 0, 0, 1, OUTPUT_DIGEST_INIT_VAL}	//!< Initialization data for a #checkpoint instantiation.
+
+/*!	@brief Writes the points file through runPipeline(), keeping a journal to resume from.
+ *
+ * Produces the same file as writeToFilePipelined(), uncompressed.
+ *
+ * @param[in] rootName The base of the filename we're saving to.
+ * @param[in] freqList A pointer to the the freqList describing the pulse train.
+ * @param[in] plan The plan from planWaveform() for the same freqList.
+ * @param[in] clockFreq The output sample frequency
+ * @param[in] config Ring and thread settings.  A resumed run takes the chunk size from the
+ * journal instead.
+ * @param[in] intervalSeconds Least time between checkpoints.
+ * @param[in] resume Non-zero to continue from the journal left by an earlier run.
+ * @param[out] stats If not NULL, filled with timing information for this run.
+ * @param[out] digest If not NULL, set to the digest of the whole file, including the bytes
+ * written before the checkpoint.
+ * @return 0 on success
+ * @return -1 on failure, including a journal that doesn't match on resume.
+ */
+int                 writeToFileCheckpointed(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    const pipelineConfig_type * config,
+    double intervalSeconds,
+    int resume,
+    pipelineStats_type * stats,
+    outputDigest_type * digest
+);
+
+#endif
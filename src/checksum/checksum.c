@@ -0,0 +1,192 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "checksum.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CRC32C_WITH_SSE42
+#include <nmmintrin.h>
+#define CRC32C_HW_TARGET __attribute__ ((target("sse4.2")))
+#define CRC32C_HW_U8(crc, b) _mm_crc32_u8((crc), (b))
+#define CRC32C_HW_U64(crc, w) ((uint32_t) _mm_crc32_u64((crc), (w)))
+#elif defined(__ARM_FEATURE_CRC32) && defined(__aarch64__) && !defined(__ARM_BIG_ENDIAN)
+#define CRC32C_WITH_ARMV8
+#include <arm_acle.h>
+#define CRC32C_HW_TARGET
+#define CRC32C_HW_U8(crc, b) __crc32cb((crc), (b))
+#define CRC32C_HW_U64(crc, w) __crc32cd((crc), (w))
+#endif
+
+#define CRC32C_POLY 0x82F63B78u	     // Castagnoli polynomial, bit-reflected
+#define CRC32C_LANE_BYTES 4096	     // Bytes per lane in each pass of the hardware loop
+
+/* Tables for eight bytes at a time, the n'th advancing the CRC past n more zero bytes */
+static uint32_t     crcTable[8][256];
+
+#if defined(CRC32C_WITH_SSE42) || defined(CRC32C_WITH_ARMV8)
+static uint32_t     laneShift1;	     // x^(8 * CRC32C_LANE_BYTES) mod P
+static uint32_t     laneShift2;	     // x^(16 * CRC32C_LANE_BYTES) mod P
+#endif
+
+static uint32_t     (*crcRaw) (uint32_t reg, const unsigned char *bytes, size_t len);
+static const char  *crcMethodName;
+static pthread_once_t crcOnce = PTHREAD_ONCE_INIT;
+
+static uint32_t loadLe32(
+    const unsigned char *bytes
+) {
+    return ((uint32_t) bytes[0]) | (((uint32_t) bytes[1]) << 8) | (((uint32_t) bytes[2]) << 16)
+	| (((uint32_t) bytes[3]) << 24);
+}
+
+/* Works on the raw register, without the inversions, so the hardware paths can share it. */
+static uint32_t crcByTable(
+    uint32_t reg,
+    const unsigned char *bytes,
+    size_t len
+) {
+    while (len >= 8) {
+	const uint32_t      lo = reg ^ loadLe32(bytes);
+	const uint32_t      hi = loadLe32(bytes + 4);
+
+	reg = crcTable[7][lo & 0xff] ^ crcTable[6][(lo >> 8) & 0xff]
+	    ^ crcTable[5][(lo >> 16) & 0xff] ^ crcTable[4][lo >> 24]
+	    ^ crcTable[3][hi & 0xff] ^ crcTable[2][(hi >> 8) & 0xff]
+	    ^ crcTable[1][(hi >> 16) & 0xff] ^ crcTable[0][hi >> 24];
+	bytes += 8;
+	len -= 8;
+    }
+    while (len-- > 0)
+	reg = (reg >> 8) ^ crcTable[0][(reg ^ *bytes++) & 0xff];
+    return reg;
+}
+
+#if defined(CRC32C_WITH_SSE42) || defined(CRC32C_WITH_ARMV8)
+/* a * b modulo the polynomial, in the bit-reflected representation. */
+static uint32_t multModPoly(
+    uint32_t a,
+    uint32_t b
+) {
+    uint32_t            bit = 1u << 31;
+    uint32_t            product = 0;
+
+    while (0 != a) {
+	if (a & bit) {
+	    product ^= b;
+	    a ^= bit;
+	}
+	bit >>= 1;
+	b = (b & 1) ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+    }
+    return product;
+}
+
+/* The instruction has a latency of a few cycles but starts one every cycle, so three
+ * lanes of CRC32C_LANE_BYTES are run side by side and then shifted into one. */
+CRC32C_HW_TARGET static uint32_t crcByHardware(
+    uint32_t reg,
+    const unsigned char *bytes,
+    size_t len
+) {
+    uint64_t            word0 = 0;
+    uint64_t            word1 = 0;
+    uint64_t            word2 = 0;
+
+    while ((len > 0) && (0 != (((uintptr_t) bytes) & 7))) {
+	reg = CRC32C_HW_U8(reg, *bytes++);
+	len--;
+    }
+    while (len >= 3 * CRC32C_LANE_BYTES) {
+	uint32_t            reg1 = 0;
+	uint32_t            reg2 = 0;
+	size_t              i = 0;
+
+	for (i = 0; i < CRC32C_LANE_BYTES; i += 8) {
+	    memcpy(&word0, bytes + i, 8);
+	    memcpy(&word1, bytes + CRC32C_LANE_BYTES + i, 8);
+	    memcpy(&word2, bytes + 2 * CRC32C_LANE_BYTES + i, 8);
+	    reg = CRC32C_HW_U64(reg, word0);
+	    reg1 = CRC32C_HW_U64(reg1, word1);
+	    reg2 = CRC32C_HW_U64(reg2, word2);
+	}
+	reg = multModPoly(reg, laneShift2) ^ multModPoly(reg1, laneShift1) ^ reg2;
+	bytes += 3 * CRC32C_LANE_BYTES;
+	len -= 3 * CRC32C_LANE_BYTES;
+    }
+    while (len >= 8) {
+	memcpy(&word0, bytes, 8);
+	reg = CRC32C_HW_U64(reg, word0);
+	bytes += 8;
+	len -= 8;
+    }
+    while (len-- > 0)
+	reg = CRC32C_HW_U8(reg, *bytes++);
+    return reg;
+}
+#endif
+
+static void initCrc(
+) {
+    unsigned int        n = 0;
+    unsigned int        k = 0;
+
+    for (n = 0; n < 256; n++) {
+	uint32_t            reg = n;
+
+	for (k = 0; k < 8; k++)
+	    reg = (reg & 1) ? (reg >> 1) ^ CRC32C_POLY : reg >> 1;
+	crcTable[0][n] = reg;
+    }
+    for (n = 0; n < 256; n++) {
+	for (k = 1; k < 8; k++)
+	    crcTable[k][n] = (crcTable[k - 1][n] >> 8) ^ crcTable[0][crcTable[k - 1][n] & 0xff];
+    }
+    crcRaw = crcByTable;
+    crcMethodName = "table";
+
+#if defined(CRC32C_WITH_SSE42) || defined(CRC32C_WITH_ARMV8)
+    // x^0 is the top bit, and each step multiplies by x^8
+    laneShift1 = 1u << 31;
+    for (n = 0; n < CRC32C_LANE_BYTES; n++)
+	laneShift1 = multModPoly(laneShift1, 1u << 23);
+    laneShift2 = multModPoly(laneShift1, laneShift1);
+#endif
+#if defined(CRC32C_WITH_SSE42)
+    if (__builtin_cpu_supports("sse4.2")) {
+	crcRaw = crcByHardware;
+	crcMethodName = "sse4.2";
+    }
+#elif defined(CRC32C_WITH_ARMV8)
+    crcRaw = crcByHardware;
+    crcMethodName = "armv8";
+#endif
+    return;
+}
+
+uint32_t crc32cUpdate(
+    uint32_t crc,
+    const void *bytes,
+    size_t len
+) {
+    pthread_once(&crcOnce, initCrc);
+    return ~crcRaw(~crc, bytes, len);
+}
+
+void digestBytes(
+    outputDigest_type * digest,
+    const void *bytes,
+    size_t len
+) {
+    if (NULL == digest)
+	return;
+    digest->crc = crc32cUpdate(digest->crc, bytes, len);
+    digest->bytes += len;
+    return;
+}
+
+const char         *crc32cMethod(
+) {
+    pthread_once(&crcOnce, initCrc);
+    return crcMethodName;
+}
@@ -0,0 +1,64 @@
+
+/*! @file checksum.h
+ * @brief CRC32C of the bytes written, computed as they go out.
+ *
+ * The writers hash each run of bytes just before handing it on, while it is still in cache,
+ * so the digest in the manifest costs no second read of the points file.  CRC32C (the
+ * Castagnoli polynomial of iSCSI, ext4 and SSE 4.2) is used because most processors compute
+ * it in hardware: the SSE 4.2 crc32 instruction on x86, chosen at run time, or the ARMv8 CRC
+ * instructions where the compiler targets them.  Elsewhere a table is used, eight bytes at a time.
+ */
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <inttypes.h>
+
+/*! @brief A running digest of a byte stream.
+ *
+ * Expected initialization found in #OUTPUT_DIGEST_INIT_VAL
+ */
+typedef struct outputDigest {
+    uint64_t            bytes;	//!< Bytes seen so far.
+    uint32_t            crc;	//!< CRC32C of those bytes.
+} outputDigest_type;
+
+#define OUTPUT_DIGEST_INIT_VAL {0, 0}	//!< Initialization data for an #outputDigest instantiation.
+
+/*!	@brief Continues a CRC32C over more bytes.
+ *
+ * Standard CRC32C, with the pre- and post-inversion done here, so a CRC can be continued
+ * from the value returned for the bytes before.  The CRC of "123456789" is 0xE3069283.
+ *
+ * @param[in] crc The CRC of everything before bytes, 0 to start.
+ * @param[in] bytes The next bytes.
+ * @param[in] len Number of bytes.
+ * @return The CRC of everything so far.
+ */
+uint32_t            crc32cUpdate(
+    uint32_t crc,
+    const void *bytes,
+    size_t len
+);
+
+/*!	@brief Adds bytes to a digest.
+ *
+ * @param[inout] digest The digest to extend.  Nothing is done if it is NULL.
+ * @param[in] bytes The next bytes of the stream.
+ * @param[in] len Number of bytes.
+ */
+void                digestBytes(
+    outputDigest_type * digest,
+    const void *bytes,
+    size_t len
+);
+
+/*!	@brief Says how crc32cUpdate() is being computed on this machine.
+ *
+ * @return "sse4.2", "armv8", or "table".
+ */
+const char         *crc32cMethod(
+);
+
+#endif
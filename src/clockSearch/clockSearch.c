@@ -0,0 +1,203 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "clockSearch.h"
+#include "../platform/platform.h"
+
+/* The search, shared by its workers.  Nothing before lock changes while they run. */
+typedef struct clockSearchState {
+    freqList_ptr        freqList;
+    int                 goal;
+    int                 sampleFormat;
+    double              lowClock;	     // First candidate, already rounded to CLOCK_SEARCH_RESOLUTION
+    double              stepClock;
+    unsigned long       candidateCount;
+
+    pthread_mutex_t     lock;
+    unsigned long       nextCandidate;	     // Next candidate for a worker to claim
+    clockCandidate_type best[CLOCK_SEARCH_KEEP];
+    unsigned int        bestCount;
+} clockSearchState_type;
+
+int parseClockGoalName(
+    const char *name
+) {
+    if (0 == strcmp(name, "length"))
+	return CLOCK_GOAL_LENGTH;
+    if (0 == strcmp(name, "error"))
+	return CLOCK_GOAL_ERROR;
+    return -1;
+}
+
+/* Non-zero if a ranks ahead of b.  The other figure, then the slower clock, break ties. */
+static int betterCandidate(
+    int goal,
+    const clockCandidate_type * a,
+    const clockCandidate_type * b
+) {
+    if (CLOCK_GOAL_ERROR == goal) {
+	if (a->durError != b->durError)
+	    return a->durError < b->durError;
+	if (a->finalCount != b->finalCount)
+	    return a->finalCount < b->finalCount;
+    } else {
+	if (a->finalCount != b->finalCount)
+	    return a->finalCount < b->finalCount;
+	if (a->durError != b->durError)
+	    return a->durError < b->durError;
+    }
+    return a->clockFreq < b->clockFreq;
+}
+
+/* Inserts cand into the sorted list best of *count entries, if it ranks high enough. */
+static void keepCandidate(
+    int goal,
+    clockCandidate_type * best,
+    unsigned int *count,
+    const clockCandidate_type * cand
+) {
+    unsigned int        pos = *count;
+
+    while ((pos > 0) && betterCandidate(goal, cand, best + pos - 1))
+	pos--;
+    if (pos >= CLOCK_SEARCH_KEEP)
+	return;
+    if (*count < CLOCK_SEARCH_KEEP)
+	(*count)++;
+    memmove(best + pos + 1, best + pos, sizeof (clockCandidate_type) * (*count - 1 - pos));
+    *(best + pos) = *cand;
+    return;
+}
+
+static void        *clockSearchWorker(
+    void *arg
+) {
+    clockSearchState_type *state = arg;
+    clockCandidate_type best[CLOCK_SEARCH_KEEP];
+    unsigned int        bestCount = 0;
+    unsigned int        i = 0;
+
+    for (;;) {
+	unsigned long       first = 0;
+	unsigned long       last = 0;
+	unsigned long       k = 0;
+
+	pthread_mutex_lock(&state->lock);
+	first = state->nextCandidate;
+	state->nextCandidate += CLOCK_SEARCH_BATCH;
+	pthread_mutex_unlock(&state->lock);
+	if (first >= state->candidateCount)
+	    break;
+	last = first + CLOCK_SEARCH_BATCH;
+	if (last > state->candidateCount)
+	    last = state->candidateCount;
+
+	for (k = first; k < last; k++) {
+	    clockCandidate_type cand;
+
+	    cand.clockFreq = round((state->lowClock + ((double) k) * state->stepClock)
+				   / CLOCK_SEARCH_RESOLUTION) * CLOCK_SEARCH_RESOLUTION;
+	    // A clock that makes the waveform too long to count is no candidate at all
+	    if (measureWaveform(state->freqList, 1000.0 / cand.clockFreq, state->sampleFormat,
+				&cand.finalCount, &cand.durError))
+		continue;
+	    keepCandidate(state->goal, best, &bestCount, &cand);
+	}
+    }
+
+    // Only the best few of each worker can be among the overall best
+    pthread_mutex_lock(&state->lock);
+    for (i = 0; i < bestCount; i++)
+	keepCandidate(state->goal, state->best, &state->bestCount, best + i);
+    pthread_mutex_unlock(&state->lock);
+    return NULL;
+}
+
+int searchClock(
+    const freqList_ptr freqList,
+    const clockSearch_type * search,
+    clockSearchReport_type * report
+) {
+    clockSearchState_type state;
+    const double        startTime = monotonicSeconds();
+    double              lowClock = search->minClock;
+    double              highClock = search->maxClock;
+    double              maxFreq = 0.0;
+    unsigned int        threads = search->threads;
+    unsigned int        i = 0;
+
+    memset(report, 0, sizeof (clockSearchReport_type));
+    if ((NULL == freqList) || (0 == freqList->freqCount))
+	return -1;
+
+    // The resolution limit only ever raises the bottom of the range
+    for (i = 0; i < freqList->freqCount; i++) {
+	if (pulseFreq(freqList, i) > maxFreq)
+	    maxFreq = pulseFreq(freqList, i);
+	if (pulseStopFreq(freqList, i) > maxFreq)
+	    maxFreq = pulseStopFreq(freqList, i);
+    }
+    if (lowClock < search->minCycleSamples * maxFreq)
+	lowClock = search->minCycleSamples * maxFreq;
+    if (lowClock < AWG_MIN_CLOCK)
+	lowClock = AWG_MIN_CLOCK;
+    if (highClock > AWG_MAX_CLOCK)
+	highClock = AWG_MAX_CLOCK;
+    lowClock = ceil(lowClock / CLOCK_SEARCH_RESOLUTION) * CLOCK_SEARCH_RESOLUTION;
+    highClock = floor(highClock / CLOCK_SEARCH_RESOLUTION) * CLOCK_SEARCH_RESOLUTION;
+    if (lowClock > highClock) {
+	logMessage(LOG_ERROR, "No clock up to %f MHz gives %g samples per cycle of %f MHz.\n",
+		   highClock, search->minCycleSamples, maxFreq);
+	return -1;
+    }
+
+    memset(&state, 0, sizeof (clockSearchState_type));
+    state.freqList = freqList;
+    state.goal = search->goal;
+    state.sampleFormat = search->sampleFormat;
+    state.lowClock = lowClock;
+    state.stepClock = search->stepClock;
+    if (state.stepClock <= 0.0)
+	state.stepClock = (highClock - lowClock) / (CLOCK_SEARCH_DEFAULT_STEPS - 1);
+    if (state.stepClock < CLOCK_SEARCH_RESOLUTION)
+	state.stepClock = CLOCK_SEARCH_RESOLUTION;
+    state.candidateCount =
+	1 + (unsigned long) floor((highClock - lowClock) / state.stepClock + 1.0e-9);
+
+    if (0 == threads)
+	threads = onlineProcessors();
+    if (threads > CLOCK_SEARCH_MAX_THREADS)
+	threads = CLOCK_SEARCH_MAX_THREADS;
+    if (threads > state.candidateCount / CLOCK_SEARCH_BATCH + 1)
+	threads = state.candidateCount / CLOCK_SEARCH_BATCH + 1;
+
+    pthread_mutex_init(&state.lock, NULL);
+    runWorkers(clockSearchWorker, &state, threads);
+    pthread_mutex_destroy(&state.lock);
+
+    memcpy(report->best, state.best, sizeof (state.best));
+    report->bestCount = state.bestCount;
+    report->tried = state.candidateCount;
+    report->lowClock = lowClock;
+    report->highClock = lowClock + ((double) (state.candidateCount - 1)) * state.stepClock;
+    report->seconds = monotonicSeconds() - startTime;
+    return 0;
+}
+
+void printClockSearchReport(
+    const clockSearchReport_type * report
+) {
+    unsigned int        i = 0;
+
+    logMessage(LOG_INFO, "Clock search: %lu clocks from %f to %f MHz in %.3f s\n", report->tried,
+	       report->lowClock, report->highClock, report->seconds);
+    logMessage(LOG_INFO, "\t%16s %14s %22s\n", "clock (MHz)", "final points",
+	       "rms dur. error (ns)");
+    for (i = 0; i < report->bestCount; i++)
+	logMessage(LOG_INFO, "\t%16f %14" PRIu64 " %22.4g\n", report->best[i].clockFreq,
+		   report->best[i].finalCount, report->best[i].durError);
+    return;
+}
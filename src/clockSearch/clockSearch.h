@@ -0,0 +1,104 @@
+
+/*! @file clockSearch.h
+ * @brief Picks the sample clock that gives the shortest waveform, or the most accurate pulses.
+ *
+ * Rounding each pulse to whole half cycles, then the inverted copy and the multiple-of-32
+ * repeats, can make the final length of the same pulse train vary several-fold between
+ * nearby sample clocks.  Each candidate clock is scored with measureWaveform(), which only
+ * evaluates the last sample of each pulse, so a wide range can be scanned before anything
+ * is generated.
+ *
+ * Candidates are handed out to worker threads in batches.  Each worker keeps its own best
+ * few, and these are merged when it finishes.
+ */
+
+#ifndef CLOCKSEARCH_H
+#define CLOCKSEARCH_H
+
+#include "../genBinary/genBinary.h"
+
+#define CLOCK_SEARCH_KEEP 8	//!< Number of best candidates kept and reported.
+#define CLOCK_SEARCH_DEFAULT_STEPS 4096	//!< Candidates tried across the range when no step is given.
+#define CLOCK_SEARCH_RESOLUTION 1.0e-6	//!< Candidate clocks are rounded to this, in MHz, as the points file gives the clock to 6 decimals.
+#define CLOCK_SEARCH_BATCH 64	//!< Candidates claimed by a worker thread at a time.
+#define CLOCK_SEARCH_MAX_THREADS 64	//!< Upper limit on worker threads.
+
+/*!
+ * @defgroup ClockGoals Clock search goals
+ * @brief What --clock-search minimizes.  The other figure breaks ties.
+ * @{
+ */
+#define CLOCK_GOAL_LENGTH 0	//!< Fewest samples in the final waveform.
+#define CLOCK_GOAL_ERROR  1	//!< Smallest RMS difference between actual and requested pulse durations.
+
+/*! @} */
+
+/*! @brief What to search for.
+ *
+ * Expected initialization found in #CLOCK_SEARCH_INIT_VAL
+ */
+typedef struct clockSearch {
+    double              minClock;	//!< Lowest clock to try, in MHz.
+    double              maxClock;	//!< Highest clock to try, in MHz.
+    double              stepClock;	//!< Spacing of the clocks tried, in MHz, or 0 for #CLOCK_SEARCH_DEFAULT_STEPS across the range.
+    int                 goal;	//!< What to minimize, one of the @ref ClockGoals.
+    double              minCycleSamples;	//!< Clocks giving fewer samples per cycle of the highest pulse frequency are not considered.
+    int                 sampleFormat;	//!< One of the @ref SampleFormats, which decides the signs of the pulses.
+    unsigned int        threads;	//!< Number of worker threads, or 0 for one per online processor.
+} clockSearch_type;
+
+#define CLOCK_SEARCH_INIT_VAL {AWG_MIN_CLOCK, AWG_MAX_CLOCK, 0.0, CLOCK_GOAL_LENGTH, 4.0, SAMPLE_FORMAT_U8, 0}	//!< Initialization data for a #clockSearch instantiation.
+
+/*! @brief One sample clock and how the pulse train comes out at it. */
+typedef struct clockCandidate {
+    double              clockFreq;	//!< Sample clock, in MHz.
+    uint64_t            finalCount;	//!< Total number of samples in the final waveform.
+    double              durError;	//!< RMS difference between actual and requested pulse durations, in ns.
+} clockCandidate_type;
+
+/*! @brief Results of a searchClock() run. */
+typedef struct clockSearchReport {
+    clockCandidate_type best[CLOCK_SEARCH_KEEP];	//!< The best candidates found, best first.
+    unsigned int        bestCount;	//!< Number of entries of best filled in.
+    unsigned long       tried;	//!< Number of clocks scored.
+    double              lowClock;	//!< Lowest clock tried, after the resolution limit, in MHz.
+    double              highClock;	//!< Highest clock tried, in MHz.
+    double              seconds;	//!< Time taken.
+} clockSearchReport_type;
+
+/*!	@brief Looks up a search goal by the name used on the command line.
+ *
+ * @param[in] name "length" or "error".
+ * @return One of the @ref ClockGoals
+ * @return -1 if the name is not known.
+ */
+int                 parseClockGoalName(
+    const char *name
+);
+
+/*!	@brief Scores every clock in the search range, keeping the best #CLOCK_SEARCH_KEEP.
+ *
+ * The range is clipped to the AWG's #AWG_MIN_CLOCK to #AWG_MAX_CLOCK, and raised to give
+ * at least search->minCycleSamples samples per cycle of the highest pulse frequency.
+ *
+ * @param[in] freqList A pointer to the the freqList describing the pulse train.
+ * @param[in] search The range and goal.
+ * @param[out] report Filled with the results.
+ * @return 0 on success
+ * @return -1 if no clock in the range meets the resolution limit, or on failure.
+ */
+int                 searchClock(
+    const freqList_ptr freqList,
+    const clockSearch_type * search,
+    clockSearchReport_type * report
+);
+
+/*!	@brief Prints the contents of a #clockSearchReport as informational messages.
+ *
+ * @param[in] report The results to print.
+ */
+void                printClockSearchReport(
+    const clockSearchReport_type * report
+);
+
+#endif
@@ -0,0 +1,527 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef ON_MINGW_HOST
+#include <io.h>
+#include <fcntl.h>
+#endif
+#if defined(HAVE_ZLIB_H) && defined(HAVE_LIBZ)
+#define COMPRESS_WITH_GZIP
+#include <zlib.h>
+#endif
+#if defined(HAVE_ZSTD_H) && defined(HAVE_LIBZSTD)
+#define COMPRESS_WITH_ZSTD
+#include <zstd.h>
+#endif
+#include "compressStream.h"
+#include "../platform/platform.h"
+#include "../logging/logging.h"
+
+struct compressStream {
+    FILE               *file;	     // What the caller reads or writes
+    FILE               *raw;	     // The file on disk
+    int                 kind;
+    int                 level;
+    int                 writing;
+    int                 pipeFd;	     // Codec thread's end of the pipe, or -1 without one
+    pthread_t           thread;
+    int                 failed;	     // Set by the codec thread
+    unsigned char      *inBuf;
+    unsigned char      *outBuf;
+};
+
+int parseCompressName(
+    const char *text,
+    int *kind,
+    int *level
+) {
+    const char         *colon = strchr(text, ':');
+    const size_t        nameLen = (NULL == colon) ? strlen(text) : (size_t) (colon - text);
+    char               *end = NULL;
+    long                value = COMPRESS_LEVEL_DEFAULT;
+
+    if ((4 == nameLen) && (0 == strncmp(text, "none", nameLen)))
+	*kind = COMPRESS_NONE;
+    else if ((4 == nameLen) && (0 == strncmp(text, "gzip", nameLen)))
+	*kind = COMPRESS_GZIP;
+    else if ((4 == nameLen) && (0 == strncmp(text, "zstd", nameLen)))
+	*kind = COMPRESS_ZSTD;
+    else
+	return -1;
+#ifndef COMPRESS_WITH_GZIP
+    if (COMPRESS_GZIP == *kind)
+	return -1;
+#endif
+#ifndef COMPRESS_WITH_ZSTD
+    if (COMPRESS_ZSTD == *kind)
+	return -1;
+#endif
+
+    if (NULL != colon) {
+	value = strtol(colon + 1, &end, 10);
+	if ((end == colon + 1) || ('\0' != *end) || (COMPRESS_NONE == *kind))
+	    return -1;
+	if ((COMPRESS_GZIP == *kind) && ((value < 1) || (value > 9)))
+	    return -1;
+#ifdef COMPRESS_WITH_ZSTD
+	if ((COMPRESS_ZSTD == *kind) && ((value < 1) || (value > ZSTD_maxCLevel())))
+	    return -1;
+#endif
+    }
+    *level = (int) value;
+    return 0;
+}
+
+const char         *compressSuffix(
+    int kind
+) {
+    if (COMPRESS_GZIP == kind)
+	return ".gz";
+    if (COMPRESS_ZSTD == kind)
+	return ".zst";
+    return "";
+}
+
+/* A broken pipe shows up as EPIPE from write() on this thread rather than killing the
+ * program, which is what happens when the reader stops early. */
+static void blockPipeSignal(
+) {
+#ifdef SIGPIPE
+    sigset_t            pipeSet;
+
+    sigemptyset(&pipeSet);
+    sigaddset(&pipeSet, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSet, NULL);
+#endif
+    return;
+}
+
+/* Writes all len bytes into the pipe. */
+static int writePipe(
+    int fd,
+    const unsigned char *buf,
+    size_t len
+) {
+    while (len > 0) {
+	ssize_t             done = write(fd, buf, len);
+
+	if (done < 0) {
+	    if (EINTR == errno)
+		continue;
+	    return -1;
+	}
+	buf += done;
+	len -= (size_t) done;
+    }
+    return 0;
+}
+
+/* Reads whatever the writer has sent so far, up to len bytes.  0 once it closes its end. */
+static ssize_t readPipe(
+    int fd,
+    unsigned char *buf,
+    size_t len
+) {
+    ssize_t             got = 0;
+
+    do {
+	got = read(fd, buf, len);
+    } while ((got < 0) && (EINTR == errno));
+    return got;
+}
+
+#ifdef COMPRESS_WITH_GZIP
+/* Inflates gzip members from the raw file into the pipe.  have bytes are already in inBuf. */
+static int decodeGzip(
+    compressStream_type * stream,
+    size_t have
+) {
+    z_stream            zs;
+    int                 ended = 0;
+    int                 outFull = 0;
+    int                 readerGone = 0;
+    int                 retVal = 0;
+
+    memset(&zs, 0, sizeof (z_stream));
+    if (Z_OK != inflateInit2(&zs, 15 + 16))
+	return -1;
+    zs.next_in = stream->inBuf;
+    zs.avail_in = (uInt) have;
+    while (!retVal) {
+	int                 ret = Z_OK;
+
+	// Read more only once the last of the output from what we have is out
+	if ((0 == zs.avail_in) && !outFull) {
+	    have = fread(stream->inBuf, 1, COMPRESS_CHUNK, stream->raw);
+	    if (0 == have)
+		break;
+	    zs.next_in = stream->inBuf;
+	    zs.avail_in = (uInt) have;
+	}
+	if (ended && (zs.avail_in > 0)) {
+	    // Another member follows, as from pigz or concatenated files
+	    inflateReset(&zs);
+	    ended = 0;
+	}
+	zs.next_out = stream->outBuf;
+	zs.avail_out = COMPRESS_CHUNK;
+	ret = inflate(&zs, Z_NO_FLUSH);
+	if (Z_STREAM_END == ret)
+	    ended = 1;
+	else if ((Z_OK != ret) && (Z_BUF_ERROR != ret))
+	    retVal = -1;
+	outFull = (0 == zs.avail_out);
+	if (!retVal && writePipe(stream->pipeFd, stream->outBuf, COMPRESS_CHUNK - zs.avail_out))
+	    readerGone = 1;
+	if (readerGone)
+	    break;
+    }
+    inflateEnd(&zs);
+    if (!ended && !readerGone)
+	retVal = -1;		     // Cut short
+    return retVal;
+}
+
+/* Deflates everything written into the pipe into the raw file. */
+static int encodeGzip(
+    compressStream_type * stream
+) {
+    z_stream            zs;
+    ssize_t             got = 0;
+    int                 ret = Z_OK;
+    const int           level =
+	(COMPRESS_LEVEL_DEFAULT == stream->level) ? Z_DEFAULT_COMPRESSION : stream->level;
+
+    memset(&zs, 0, sizeof (z_stream));
+    if (Z_OK != deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY))
+	return -1;
+    do {
+	int                 flush = Z_NO_FLUSH;
+
+	got = readPipe(stream->pipeFd, stream->inBuf, COMPRESS_CHUNK);
+	if (got < 0)
+	    break;
+	if (0 == got)
+	    flush = Z_FINISH;
+	zs.next_in = stream->inBuf;
+	zs.avail_in = (uInt) got;
+	do {
+	    size_t              outLen = 0;
+
+	    zs.next_out = stream->outBuf;
+	    zs.avail_out = COMPRESS_CHUNK;
+	    ret = deflate(&zs, flush);
+	    outLen = COMPRESS_CHUNK - zs.avail_out;
+	    if ((Z_STREAM_ERROR == ret)
+		|| (fwrite(stream->outBuf, 1, outLen, stream->raw) != outLen))
+		got = -1;
+	} while ((got >= 0) && (0 == zs.avail_out));
+    } while (got > 0);
+    deflateEnd(&zs);
+    return ((got < 0) || (Z_STREAM_END != ret)) ? -1 : 0;
+}
+#endif
+
+#ifdef COMPRESS_WITH_ZSTD
+/* Decompresses zstd frames from the raw file into the pipe.  have bytes are already in inBuf. */
+static int decodeZstd(
+    compressStream_type * stream,
+    size_t have
+) {
+    ZSTD_DStream       *dstream = ZSTD_createDStream();
+    ZSTD_inBuffer       in = { stream->inBuf, have, 0 };
+    size_t              ret = 0;
+    int                 outFull = 0;
+    int                 readerGone = 0;
+    int                 retVal = 0;
+
+    if (NULL == dstream)
+	return -1;
+    ZSTD_initDStream(dstream);
+    while (!retVal) {
+	ZSTD_outBuffer      out = { stream->outBuf, COMPRESS_CHUNK, 0 };
+
+	if ((in.pos == in.size) && !outFull) {
+	    in.size = fread(stream->inBuf, 1, COMPRESS_CHUNK, stream->raw);
+	    in.pos = 0;
+	    if (0 == in.size)
+		break;
+	}
+	ret = ZSTD_decompressStream(dstream, &out, &in);
+	if (ZSTD_isError(ret)) {
+	    retVal = -1;
+	    break;
+	}
+	outFull = (out.pos == out.size);
+	if (writePipe(stream->pipeFd, stream->outBuf, out.pos)) {
+	    readerGone = 1;
+	    break;
+	}
+    }
+    ZSTD_freeDStream(dstream);
+    if ((0 != ret) && !readerGone)
+	retVal = -1;		     // Cut short inside a frame
+    return retVal;
+}
+
+/* Compresses everything written into the pipe into the raw file. */
+static int encodeZstd(
+    compressStream_type * stream
+) {
+    ZSTD_CCtx          *cctx = ZSTD_createCCtx();
+    ssize_t             got = 0;
+    size_t              ret = 0;
+
+    if (NULL == cctx)
+	return -1;
+    if (COMPRESS_LEVEL_DEFAULT != stream->level)
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, stream->level);
+    // Fails harmlessly on a libzstd built without threads
+    if (onlineProcessors() > 1)
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, (int) onlineProcessors());
+    do {
+	ZSTD_inBuffer       in = { stream->inBuf, 0, 0 };
+	ZSTD_EndDirective   mode = ZSTD_e_continue;
+
+	got = readPipe(stream->pipeFd, stream->inBuf, COMPRESS_CHUNK);
+	if (got < 0)
+	    break;
+	if (0 == got)
+	    mode = ZSTD_e_end;
+	in.size = (size_t) got;
+	// With workers the input is handed over a piece at a time, so go until it's all taken
+	do {
+	    ZSTD_outBuffer      out = { stream->outBuf, COMPRESS_CHUNK, 0 };
+
+	    ret = ZSTD_compressStream2(cctx, &out, &in, mode);
+	    if (ZSTD_isError(ret) || (fwrite(stream->outBuf, 1, out.pos, stream->raw) != out.pos))
+		got = -1;
+	} while ((got >= 0) && ((ZSTD_e_end == mode) ? (0 != ret) : (in.pos < in.size)));
+    } while (got > 0);
+    ZSTD_freeCCtx(cctx);
+    return (got < 0) ? -1 : 0;
+}
+#endif
+
+static void        *decodeThread(
+    void *arg
+) {
+    compressStream_type *stream = arg;
+    size_t              have = 0;
+    int                 retVal = 0;
+
+    blockPipeSignal();
+    have = fread(stream->inBuf, 1, 4, stream->raw);
+#ifdef COMPRESS_WITH_GZIP
+    if ((have >= 2) && (0x1F == stream->inBuf[0]) && (0x8B == stream->inBuf[1])) {
+	retVal = decodeGzip(stream, have);
+    } else
+#endif
+#ifdef COMPRESS_WITH_ZSTD
+    if ((have >= 4) && (0x28 == stream->inBuf[0]) && (0xB5 == stream->inBuf[1])
+	    && (0x2F == stream->inBuf[2]) && (0xFD == stream->inBuf[3])) {
+	retVal = decodeZstd(stream, have);
+    } else
+#endif
+    {
+	// Just looked like it might be compressed
+	while ((have > 0) && !writePipe(stream->pipeFd, stream->inBuf, have))
+	    have = fread(stream->inBuf, 1, COMPRESS_CHUNK, stream->raw);
+    }
+
+    if (retVal || ferror(stream->raw)) {
+	logMessage(LOG_ERROR, "Compressed input is corrupt or cut short.\n");
+	stream->failed = 1;
+    }
+    // The reader sees the end of the file once this end closes
+    close(stream->pipeFd);
+    fclose(stream->raw);
+    logFlush();
+    return NULL;
+}
+
+static void        *encodeThread(
+    void *arg
+) {
+    compressStream_type *stream = arg;
+    int                 retVal = -1;
+
+    blockPipeSignal();
+#ifdef COMPRESS_WITH_GZIP
+    if (COMPRESS_GZIP == stream->kind)
+	retVal = encodeGzip(stream);
+#endif
+#ifdef COMPRESS_WITH_ZSTD
+    if (COMPRESS_ZSTD == stream->kind)
+	retVal = encodeZstd(stream);
+#endif
+    // Keep taking whatever is written after a failure, so the writer can't block on us
+    if (retVal) {
+	while (readPipe(stream->pipeFd, stream->inBuf, COMPRESS_CHUNK) > 0)
+	    continue;
+    }
+    if (ferror(stream->raw))
+	retVal = -1;
+    if (fclose(stream->raw))
+	retVal = -1;
+    close(stream->pipeFd);
+    if (retVal) {
+	logMessage(LOG_ERROR, "Problem compressing the output.\n");
+	stream->failed = 1;
+    }
+    logFlush();
+    return NULL;
+}
+
+/* Connects stream->file to a new codec thread through a pipe. */
+static int startCodec(
+    compressStream_type * stream
+) {
+    int                 fds[2];
+    const int           callerEnd = stream->writing ? 1 : 0;
+
+    stream->inBuf = malloc(COMPRESS_CHUNK);
+    stream->outBuf = malloc(COMPRESS_CHUNK);
+    if ((NULL == stream->inBuf) || (NULL == stream->outBuf))
+	return -1;
+#ifdef ON_MINGW_HOST
+    if (_pipe(fds, COMPRESS_CHUNK, _O_BINARY))
+	return -1;
+#else
+    if (pipe(fds))
+	return -1;
+#endif
+    stream->file = fdopen(fds[callerEnd], stream->writing ? "wb" : "rb");
+    if (NULL == stream->file) {
+	close(fds[0]);
+	close(fds[1]);
+	return -1;
+    }
+    stream->pipeFd = fds[1 - callerEnd];
+    if (pthread_create(&stream->thread, NULL, stream->writing ? encodeThread : decodeThread,
+		       stream)) {
+	fclose(stream->file);
+	stream->file = NULL;
+	close(stream->pipeFd);
+	stream->pipeFd = -1;
+	return -1;
+    }
+    return 0;
+}
+
+/* Frees a stream whose codec thread never started, closing the raw file. */
+static void freeStream(
+    compressStream_type * stream
+) {
+    if (NULL != stream->raw)
+	fclose(stream->raw);
+    if (NULL != stream->inBuf)
+	free(stream->inBuf);
+    if (NULL != stream->outBuf)
+	free(stream->outBuf);
+    free(stream);
+    return;
+}
+
+compressStream_type *openCompressedOutput(
+    const char *path,
+    int kind,
+    int level
+) {
+    compressStream_type *stream = calloc(1, sizeof (compressStream_type));
+    const char         *suffix = compressSuffix(kind);
+    char               *fileName = NULL;
+
+    if (NULL == stream)
+	return NULL;
+    stream->kind = kind;
+    stream->level = level;
+    stream->writing = 1;
+    stream->pipeFd = -1;
+
+    fileName = malloc(strlen(path) + strlen(suffix) + 1);
+    if (NULL == fileName) {
+	free(stream);
+	return NULL;
+    }
+    strcpy(fileName, path);
+    strcat(fileName, suffix);
+    stream->raw = fopen(fileName, (COMPRESS_NONE == kind) ? "w" : "wb");
+    free(fileName);
+    if (NULL == stream->raw) {
+	free(stream);
+	return NULL;
+    }
+
+    if (COMPRESS_NONE == kind) {
+	stream->file = stream->raw;
+    } else if (startCodec(stream)) {
+	freeStream(stream);
+	return NULL;
+    }
+    return stream;
+}
+
+compressStream_type *openCompressedInput(
+    FILE * raw
+) {
+    compressStream_type *stream = calloc(1, sizeof (compressStream_type));
+    int                 first = EOF;
+
+    if (NULL == stream) {
+	fclose(raw);
+	return NULL;
+    }
+    stream->kind = COMPRESS_NONE;
+    stream->raw = raw;
+    stream->pipeFd = -1;
+
+    // Plain text is read directly; only a gzip or zstd first byte needs a closer look
+    first = getc(raw);
+    if (EOF != first)
+	ungetc(first, raw);
+    if ((0x1F != first) && (0x28 != first)) {
+	stream->file = raw;
+    } else if (startCodec(stream)) {
+	freeStream(stream);
+	return NULL;
+    }
+    return stream;
+}
+
+FILE               *compressStreamFile(
+    compressStream_type * stream
+) {
+    return stream->file;
+}
+
+int closeCompressStream(
+    compressStream_type * stream
+) {
+    int                 retVal = 0;
+
+    if (-1 == stream->pipeFd) {
+	if (stream->writing && ferror(stream->raw))
+	    retVal = -1;
+	if (fclose(stream->raw) && stream->writing)
+	    retVal = -1;
+    } else {
+	// Closing our end ends the thread's input, or tells it nobody is reading any more
+	if (fclose(stream->file) && stream->writing)
+	    retVal = -1;
+	pthread_join(stream->thread, NULL);
+	if (stream->failed)
+	    retVal = -1;
+	free(stream->inBuf);
+	free(stream->outBuf);
+    }
+    free(stream);
+    return retVal;
+}
@@ -0,0 +1,115 @@
+
+/*! @file compressStream.h
+ * @brief Reads and writes gzip or zstd files through a plain FILE.
+ *
+ * Spec files and points files repeat the same few lines and pulses over and over, so they
+ * compress very well.  A compressed stream hands back an ordinary FILE connected by a pipe
+ * to a codec thread, so the parsers and writers stream through it unchanged and no
+ * uncompressed copy is ever made on disk.  The codec runs alongside generation; zstd also
+ * spreads its compression over one worker per online processor when built with threads.
+ *
+ * gzip support needs zlib and zstd support needs libzstd, each found by configure.
+ */
+
+#ifndef COMPRESSSTREAM_H
+#define COMPRESSSTREAM_H
+
+#include <stdio.h>
+
+/*!
+ * @defgroup CompressKinds Compression formats
+ * @brief How an output file is compressed.  Input files are recognized by their first bytes.
+ * @{
+ */
+#define COMPRESS_NONE 0	//!< Plain file.
+#define COMPRESS_GZIP 1	//!< gzip, with a ".gz" suffix.  Needs zlib.
+#define COMPRESS_ZSTD 2	//!< Zstandard, with a ".zst" suffix.  Needs libzstd.
+
+/*! @} */
+
+#define COMPRESS_LEVEL_DEFAULT 0	//!< Compression level meaning the library's own default.
+#define COMPRESS_CHUNK 65536	//!< Bytes the codec thread handles at a time.
+
+/*! @brief A file being read or written through a codec.
+ *
+ * The contents are private to compressStream.c.
+ */
+typedef struct compressStream compressStream_type;
+
+/*!	@brief Parses a --compress argument.
+ *
+ * @param[in] text "none", "gzip" or "zstd", optionally followed by ":<level>".
+ * @param[out] kind One of the @ref CompressKinds
+ * @param[out] level The level given, or #COMPRESS_LEVEL_DEFAULT.
+ * @return 0 on success
+ * @return -1 if the format is unknown, not built in, or the level is out of range.
+ */
+int                 parseCompressName(
+    const char *text,
+    int *kind,
+    int *level
+);
+
+/*!	@brief The suffix added to the names of files written in a format.
+ *
+ * @param[in] kind One of the @ref CompressKinds
+ * @return ".gz", ".zst", or "" for #COMPRESS_NONE.
+ */
+const char         *compressSuffix(
+    int kind
+);
+
+/*!	@brief Opens a file for writing, compressed.
+ *
+ * The file is named path with the format's suffix added.  With #COMPRESS_NONE this is a
+ * plain fopen() and no thread is started.
+ *
+ * @param[in] path Name of the file to write, before the suffix.
+ * @param[in] kind One of the @ref CompressKinds
+ * @param[in] level Compression level, or #COMPRESS_LEVEL_DEFAULT.
+ * @return The stream, to write to through compressStreamFile() and finish with
+ * closeCompressStream()
+ * @return NULL on failure.
+ */
+compressStream_type *openCompressedOutput(
+    const char *path,
+    int kind,
+    int level
+);
+
+/*!	@brief Reads a file that may be compressed.
+ *
+ * gzip (including several members in a row) and zstd are recognized by their first bytes;
+ * anything else is read as it is, with no thread in between.
+ *
+ * @param[in] raw The open file, positioned at its start.  Owned by the stream from now on,
+ * and closed by closeCompressStream(), even on failure.
+ * @return The stream, to read from through compressStreamFile()
+ * @return NULL on failure.
+ */
+compressStream_type *openCompressedInput(
+    FILE * raw
+);
+
+/*!	@brief The FILE to read or write the uncompressed contents through.
+ *
+ * @param[in] stream The stream from openCompressedOutput() or openCompressedInput().
+ * @return The FILE, which must only be closed by closeCompressStream().
+ */
+FILE               *compressStreamFile(
+    compressStream_type * stream
+);
+
+/*!	@brief Finishes the stream, closes its files and frees it.
+ *
+ * When writing, this waits for the last of the data to be compressed and written out.
+ *
+ * @param[in] stream The stream from openCompressedOutput() or openCompressedInput().
+ * @return 0 on success
+ * @return -1 if a write failed, or the input was corrupt or cut short.
+ */
+int                 closeCompressStream(
+    compressStream_type * stream
+);
+
+#endif
@@ -5,7 +5,17 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <ctype.h>
+#include <errno.h>
 #include "templateContents.h"
+#include "../serialLink/serialLink.h"
+#include "../summary/summary.h"
+#include "../genBinary/genBinary.h"
+#include "../clockSearch/clockSearch.h"
+#include "../compressStream/compressStream.h"
+#include "../shard/shard.h"
+#include "../multitone/multitone.h"
+#include "../logging/logging.h"
 
 int parseOptions(
     int argc,
@@ -30,6 +40,37 @@ int parseOptions(
 	    {"random-amp", no_argument, 0, 'r'},
 	    {"start-freq", required_argument, 0, 's'},
 	    {"template", no_argument, 0, 't'},
+	    {"device", required_argument, 0, OPT_LONG_DEVICE},
+	    {"baud", required_argument, 0, OPT_LONG_BAUD},
+	    {"flow", required_argument, 0, OPT_LONG_FLOW},
+	    {"pipeline", no_argument, 0, OPT_LONG_PIPELINE},
+	    {"threads", required_argument, 0, OPT_LONG_THREADS},
+	    {"buffers", required_argument, 0, OPT_LONG_BUFFERS},
+	    {"chunk-size", required_argument, 0, OPT_LONG_CHUNK},
+	    {"stats", no_argument, 0, OPT_LONG_STATS},
+	    {"summary-format", required_argument, 0, OPT_LONG_SUMMARY},
+	    {"seed", required_argument, 0, OPT_LONG_SEED},
+	    {"sweep", required_argument, 0, OPT_LONG_SWEEP},
+	    {"steps", required_argument, 0, OPT_LONG_STEPS},
+	    {"marker", required_argument, 0, OPT_LONG_MARKER},
+	    {"verify-spectrum", no_argument, 0, OPT_LONG_VERIFY},
+	    {"append", no_argument, 0, OPT_LONG_APPEND},
+	    {"envelope", required_argument, 0, OPT_LONG_ENVELOPE},
+	    {"sample-format", required_argument, 0, OPT_LONG_FORMAT},
+	    {"clock-search", required_argument, 0, OPT_LONG_CLKSEARCH},
+	    {"clock-goal", required_argument, 0, OPT_LONG_CLKGOAL},
+	    {"min-cycle-samples", required_argument, 0, OPT_LONG_CYCLESAMPLES},
+	    {"compress", required_argument, 0, OPT_LONG_COMPRESS},
+	    {"shm", required_argument, 0, OPT_LONG_SHM},
+	    {"shard", required_argument, 0, OPT_LONG_SHARD},
+	    {"merge", required_argument, 0, OPT_LONG_MERGE},
+	    {"realtime", no_argument, 0, OPT_LONG_REALTIME},
+	    {"multitone", required_argument, 0, OPT_LONG_MULTITONE},
+	    {"phases", required_argument, 0, OPT_LONG_PHASES},
+	    {"autotune", no_argument, 0, OPT_LONG_AUTOTUNE},
+	    {"profile", required_argument, 0, OPT_LONG_PROFILE},
+	    {"checkpoint", required_argument, 0, OPT_LONG_CHECKPOINT},
+	    {"resume", no_argument, 0, OPT_LONG_RESUME},
 	    {0, 0, 0, 0}     // Mark the end of the options list
 	};
 	// END OPTIONS TABLE
@@ -49,7 +90,7 @@ int parseOptions(
 	    options->flags &= ~OPT_RANDAMP_MASK;
 	    break;
 	case 'd':
-	    g_opt_debug = 1;
+	    logSetEnabled(LOG_DEBUG, 1);
 	    break;
 	case 'e':
 	    options->stop_f = strtod(optarg, NULL);
@@ -79,7 +120,7 @@ int parseOptions(
 	    options->flags |= (OPT_FROMCMD_MASK | OPT_PERIODSET_MASK);
 	    break;
 	case 'q':
-	    g_opt_quiet = 1;
+	    logSetEnabled(LOG_INFO, 0);
 	    break;
 	case 'r':
 	    options->flags |= (OPT_FROMCMD_MASK | OPT_AMPSET_MASK | OPT_RANDAMP_MASK);
@@ -91,6 +132,228 @@ int parseOptions(
 	case 't':
 	    options->flags |= OPT_TEMPLATE_MASK;
 	    break;
+	case OPT_LONG_DEVICE:
+	    if (NULL != options->devicePath)
+		free(options->devicePath);
+	    options->devicePath = malloc(strlen(optarg) + 1);
+	    if (NULL == options->devicePath)
+		return OPT_RET_ERR;
+	    strcpy(options->devicePath, optarg);
+	    break;
+	case OPT_LONG_BAUD:
+	    options->baudRate = strtol(optarg, NULL, 0);
+	    break;
+	case OPT_LONG_FLOW:
+	    if (0 == strcmp(optarg, "none")) {
+		options->flowControl = SERIAL_FLOW_NONE;
+	    } else if (0 == strcmp(optarg, "rtscts")) {
+		options->flowControl = SERIAL_FLOW_RTSCTS;
+	    } else if (0 == strcmp(optarg, "xonxoff")) {
+		options->flowControl = SERIAL_FLOW_XONXOFF;
+	    } else {
+		logMessage(LOG_ERROR, "Unknown flow control \"%s\".\n", optarg);
+		errCount++;
+	    }
+	    break;
+	case OPT_LONG_PIPELINE:
+	    options->flags |= OPT_PIPELINE_MASK;
+	    break;
+	case OPT_LONG_THREADS:
+	    options->genThreads = strtoul(optarg, NULL, 0);
+	    options->flags |= OPT_PIPELINE_MASK;
+	    break;
+	case OPT_LONG_BUFFERS:
+	    options->ringSlots = strtoul(optarg, NULL, 0);
+	    options->flags |= OPT_PIPELINE_MASK;
+	    break;
+	case OPT_LONG_CHUNK:
+	    options->chunkPoints = strtoul(optarg, NULL, 0);
+	    options->flags |= OPT_PIPELINE_MASK;
+	    break;
+	case OPT_LONG_STATS:
+	    options->flags |= OPT_STATS_MASK;
+	    break;
+	case OPT_LONG_REALTIME:
+	    options->flags |= (OPT_REALTIME_MASK | OPT_PIPELINE_MASK);
+	    break;
+	case OPT_LONG_SUMMARY:
+	    if (0 == strcmp(optarg, "text")) {
+		options->summaryFormat = SUMMARY_TABLE_NONE;
+	    } else if (0 == strcmp(optarg, "csv")) {
+		options->summaryFormat = SUMMARY_TABLE_CSV;
+	    } else if (0 == strcmp(optarg, "bin")) {
+		options->summaryFormat = SUMMARY_TABLE_BIN;
+	    } else {
+		logMessage(LOG_ERROR, "Unknown summary format \"%s\".\n", optarg);
+		errCount++;
+	    }
+	    break;
+	case OPT_LONG_SEED:
+	    {
+		char               *seedEnd = NULL;
+
+		// strtoull() would take "-1" as 2^64-1 and "abc" as 0, a different seed either way
+		errno = 0;
+		options->seed = strtoull(optarg, &seedEnd, 0);
+		if (!isdigit((unsigned char) optarg[0]) || ('\0' != *seedEnd) || (0 != errno)) {
+		    logMessage(LOG_ERROR, "Seed \"%s\" is not a number from 0 to %" PRIu64 ".\n",
+			       optarg, UINT64_MAX);
+		    errCount++;
+		}
+	    }
+	    options->flags |= OPT_SEEDSET_MASK;
+	    break;
+	case OPT_LONG_SWEEP:
+	    if (0 == strcmp(optarg, "linear")) {
+		options->sweepKind = PULSE_SRC_LINEAR;
+	    } else if (0 == strcmp(optarg, "log")) {
+		options->sweepKind = PULSE_SRC_LOG;
+	    } else if (0 == strcmp(optarg, "stepped")) {
+		options->sweepKind = PULSE_SRC_STEPPED;
+	    } else {
+		logMessage(LOG_ERROR, "Unknown sweep \"%s\".\n", optarg);
+		errCount++;
+	    }
+	    break;
+	case OPT_LONG_STEPS:
+	    options->sweepSteps = strtoul(optarg, NULL, 0);
+	    options->sweepKind = PULSE_SRC_STEPPED;
+	    break;
+	case OPT_LONG_MARKER:
+	    if (0 == strcmp(optarg, "none")) {
+		options->markerMode = MARKER_NONE;
+	    } else if (0 == strcmp(optarg, "tooth")) {
+		options->markerMode = MARKER_TOOTH;
+	    } else if (0 == strcmp(optarg, "start")) {
+		options->markerMode = MARKER_START;
+	    } else {
+		logMessage(LOG_ERROR, "Unknown marker mode \"%s\".\n", optarg);
+		errCount++;
+	    }
+	    break;
+	case OPT_LONG_VERIFY:
+	    options->flags |= OPT_VERIFY_MASK;
+	    break;
+	case OPT_LONG_APPEND:
+	    options->flags |= OPT_APPEND_MASK;
+	    break;
+	case OPT_LONG_ENVELOPE:
+	    options->envelope = parseEnvelopeName(optarg);
+	    if (options->envelope < 0) {
+		logMessage(LOG_ERROR, "Unknown envelope \"%s\".\n", optarg);
+		options->envelope = ENVELOPE_RECT;
+		errCount++;
+	    }
+	    break;
+	case OPT_LONG_FORMAT:
+	    options->sampleFormat = parseSampleFormatName(optarg);
+	    if (options->sampleFormat < 0) {
+		logMessage(LOG_ERROR, "Unknown sample format \"%s\".\n", optarg);
+		options->sampleFormat = SAMPLE_FORMAT_U8;
+		errCount++;
+	    }
+	    break;
+	case OPT_LONG_CLKSEARCH:
+	    options->searchStep = 0.0;
+	    if ((sscanf(optarg, "%lf:%lf:%lf", &options->searchMinClock, &options->searchMaxClock,
+			&options->searchStep) < 2) || (options->searchMinClock <= 0.0)
+		|| (options->searchMaxClock < options->searchMinClock)
+		|| (options->searchStep < 0.0)) {
+		logMessage(LOG_ERROR, "Clock search range \"%s\" is not <min>:<max>[:<step>].\n", optarg);
+		errCount++;
+	    }
+	    options->flags |= OPT_CLKSEARCH_MASK;
+	    break;
+	case OPT_LONG_CLKGOAL:
+	    options->clockGoal = parseClockGoalName(optarg);
+	    if (options->clockGoal < 0) {
+		logMessage(LOG_ERROR, "Unknown clock search goal \"%s\".\n", optarg);
+		options->clockGoal = CLOCK_GOAL_LENGTH;
+		errCount++;
+	    }
+	    break;
+	case OPT_LONG_CYCLESAMPLES:
+	    options->minCycleSamples = strtod(optarg, NULL);
+	    break;
+	case OPT_LONG_COMPRESS:
+	    if (parseCompressName(optarg, &options->compressKind, &options->compressLevel)) {
+		logMessage(LOG_ERROR, "Unknown or unavailable compression \"%s\".\n", optarg);
+		options->compressKind = COMPRESS_NONE;
+		errCount++;
+	    }
+	    break;
+	case OPT_LONG_SHM:
+	    if (NULL != options->shmName)
+		free(options->shmName);
+	    options->shmName = malloc(strlen(optarg) + 1);
+	    if (NULL == options->shmName)
+		return OPT_RET_ERR;
+	    strcpy(options->shmName, optarg);
+	    break;
+	case OPT_LONG_SHARD:
+	    if ((2 != sscanf(optarg, "%u/%u", &options->shardIndex, &options->shardCount))
+		|| (0 == options->shardIndex) || (options->shardIndex > options->shardCount)
+		|| (options->shardCount > SHARD_MAX)) {
+		logMessage(LOG_ERROR, "Shard \"%s\" is not <i>/<N> with 1 <= i <= N <= %d.\n",
+			   optarg, SHARD_MAX);
+		errCount++;
+	    }
+	    options->flags |= OPT_SHARD_MASK;
+	    options->flags &= ~OPT_MERGE_MASK;
+	    break;
+	case OPT_LONG_MERGE:
+	    options->shardCount = strtoul(optarg, NULL, 0);
+	    if ((0 == options->shardCount) || (options->shardCount > SHARD_MAX)) {
+		logMessage(LOG_ERROR, "Shard count \"%s\" is not between 1 and %d.\n", optarg,
+			   SHARD_MAX);
+		errCount++;
+	    }
+	    options->flags |= OPT_MERGE_MASK;
+	    options->flags &= ~OPT_SHARD_MASK;
+	    break;
+	case OPT_LONG_MULTITONE:
+	    options->multitonePoints = strtoull(optarg, NULL, 0);
+	    if ((options->multitonePoints < MULTITONE_MIN_POINTS)
+		|| (options->multitonePoints > MULTITONE_MAX_POINTS)
+		|| (0 != (options->multitonePoints & (options->multitonePoints - 1)))) {
+		logMessage(LOG_ERROR,
+			   "Multitone record \"%s\" is not a power of two from %d to %lu.\n", optarg,
+			   MULTITONE_MIN_POINTS, MULTITONE_MAX_POINTS);
+		errCount++;
+	    }
+	    options->flags |= OPT_MULTITONE_MASK;
+	    break;
+	case OPT_LONG_PHASES:
+	    options->phaseMode = parsePhaseModeName(optarg);
+	    if (options->phaseMode < 0) {
+		logMessage(LOG_ERROR, "Unknown phase assignment \"%s\".\n", optarg);
+		options->phaseMode = MULTITONE_PHASE_NEWMAN;
+		errCount++;
+	    }
+	    break;
+	case OPT_LONG_AUTOTUNE:
+	    options->flags |= OPT_AUTOTUNE_MASK;
+	    break;
+	case OPT_LONG_PROFILE:
+	    if (NULL != options->profilePath)
+		free(options->profilePath);
+	    options->profilePath = malloc(strlen(optarg) + 1);
+	    if (NULL == options->profilePath)
+		return OPT_RET_ERR;
+	    strcpy(options->profilePath, optarg);
+	    break;
+	case OPT_LONG_CHECKPOINT:
+	    options->checkpointSeconds = strtod(optarg, NULL);
+	    if (!(options->checkpointSeconds >= 0.0)) {
+		logMessage(LOG_ERROR, "Checkpoint interval \"%s\" is not a number of seconds.\n",
+			   optarg);
+		errCount++;
+	    }
+	    options->flags |= (OPT_CHECKPOINT_MASK | OPT_PIPELINE_MASK);
+	    break;
+	case OPT_LONG_RESUME:
+	    options->flags |= (OPT_RESUME_MASK | OPT_PIPELINE_MASK);
+	    break;
 	case '?':
 	    // getopt_long prints an error message
 	    errCount++;
@@ -101,13 +364,19 @@ int parseOptions(
 	    break;
 	}
 
-	if (g_opt_debug)
-	    printf("Found \"%c\" (or equiv.) with argument %s\n", currentOption, optarg);
+	if (currentOption < OPT_LONG_DEVICE)
+	    logMessage(LOG_DEBUG, "Found \"%c\" (or equiv.) with argument %s\n", currentOption,
+		       optarg);
+	else
+	    logMessage(LOG_DEBUG, "Found \"--%s\" with argument %s\n",
+		       long_options[longOptIdx].name, optarg);
 
     }
 
-    if (g_opt_debug)
+    if (LOG_ENABLED(LOG_DEBUG))
 	printOptions(options, "options");
+    // The help and errors below are printed directly, after anything logged so far
+    logFlush();
 
     if (options->flags & OPT_HELPREQ_MASK) {
 	printf("%s\n", helpText);
@@ -132,8 +401,7 @@ int parseOptions(
 		return OPT_RET_ERR;
 	    }
 	    fclose(templateFile);
-	    if (!g_opt_quiet)
-		printf("Template file written to " TEMPLATE_FILENAME ".\n");
+	    logMessage(LOG_INFO, "Template file written to " TEMPLATE_FILENAME ".\n");
 	} else {
 	    perror("Writing template file");
 	    return OPT_RET_ERR;
@@ -147,6 +415,22 @@ int parseOptions(
 	return OPT_RET_ERR;
     }
 
+    if ((options->flags & OPT_FROMCMD_MASK) && (PULSE_SRC_LOG == options->sweepKind)
+	&& ((options->start_f <= 0.0) || (options->stop_f <= 0.0))) {
+	printf("ERROR:\tA log sweep needs positive start and end frequencies.\n");
+	return OPT_RET_ERR;
+    }
+    if ((options->flags & OPT_FROMCMD_MASK) && (PULSE_SRC_STEPPED == options->sweepKind)
+	&& ((0 == options->sweepSteps) || (options->sweepSteps > options->num_f))) {
+	printf("ERROR:\tA stepped sweep needs --steps between 1 and the number of teeth.\n");
+	return OPT_RET_ERR;
+    }
+    if ((options->flags & OPT_SEEDSET_MASK)
+	&& !((options->flags & OPT_FROMCMD_MASK) && (options->flags & OPT_RANDAMP_MASK))) {
+	printf("ERROR:\t--seed only applies to random amplitudes, given with -r.\n");
+	return OPT_RET_ERR;
+    }
+
     return OPT_RET_OK;
 }
 
@@ -158,8 +442,8 @@ void printOptions(
 
     const char         *optName = (NULL != idStr) ? idStr : optionsStr;
 
-    printf("\nPrinting current state of %s\n:", optName);
-    printf("\t%s.flags:          %08x\n", optName, toPrint->flags);
+    logMessage(LOG_DEBUG, "\nPrinting current state of %s\n:", optName);
+    logMessage(LOG_DEBUG, "\t%s.flags:          %08x\n", optName, toPrint->flags);
     printBitSetting(toPrint->flags, OPT_HELPREQ_MASK, "Help Request");
     printBitSetting(toPrint->flags, OPT_TEMPLATE_MASK, "Print Template");
     printBitSetting(toPrint->flags, OPT_FROMCMD_MASK, "From Command");
@@ -168,18 +452,70 @@ void printOptions(
     printBitSetting(toPrint->flags, OPT_NUMSET_MASK, "Number of Frequencies Set");
     printBitSetting(toPrint->flags, OPT_AMPSET_MASK, "Amplitude Set");
     printBitSetting(toPrint->flags, OPT_RANDAMP_MASK, "Random Amplitude");
+    printBitSetting(toPrint->flags, OPT_SEEDSET_MASK, "Seed Set");
+    printBitSetting(toPrint->flags, OPT_VERIFY_MASK, "Verify Spectrum");
+    printBitSetting(toPrint->flags, OPT_APPEND_MASK, "Append");
+    printBitSetting(toPrint->flags, OPT_CLKSEARCH_MASK, "Clock Search");
+    printBitSetting(toPrint->flags, OPT_SHARD_MASK, "Shard");
+    printBitSetting(toPrint->flags, OPT_MERGE_MASK, "Merge Shards");
     printBitSetting(toPrint->flags, OPT_PERIODSET_MASK, "Period Set");
-    printf("\t%s.amplitude:      %g\n", optName, toPrint->amplitude);
-    printf("\t%s.start_f:        %g\n", optName, toPrint->start_f);
-    printf("\t%s.stop_f:         %g\n", optName, toPrint->stop_f);
-    printf("\t%s.num_f:          %d\n", optName, toPrint->num_f);
-    printf("\t%s.clock_freq:     %g\n", optName, toPrint->clock_freq);
-    printf("\t%s.tooth_period:   %g\n", optName, toPrint->tooth_period);
+    printBitSetting(toPrint->flags, OPT_PIPELINE_MASK, "Pipeline");
+    printBitSetting(toPrint->flags, OPT_STATS_MASK, "Statistics");
+    printBitSetting(toPrint->flags, OPT_REALTIME_MASK, "Real-time Buffers");
+    printBitSetting(toPrint->flags, OPT_MULTITONE_MASK, "Multitone");
+    printBitSetting(toPrint->flags, OPT_AUTOTUNE_MASK, "Autotune");
+    printBitSetting(toPrint->flags, OPT_CHECKPOINT_MASK, "Checkpoint");
+    printBitSetting(toPrint->flags, OPT_RESUME_MASK, "Resume");
+    logMessage(LOG_DEBUG, "\t%s.amplitude:      %g\n", optName, toPrint->amplitude);
+    logMessage(LOG_DEBUG, "\t%s.start_f:        %g\n", optName, toPrint->start_f);
+    logMessage(LOG_DEBUG, "\t%s.stop_f:         %g\n", optName, toPrint->stop_f);
+    logMessage(LOG_DEBUG, "\t%s.num_f:          %d\n", optName, toPrint->num_f);
+    logMessage(LOG_DEBUG, "\t%s.clock_freq:     %g\n", optName, toPrint->clock_freq);
+    logMessage(LOG_DEBUG, "\t%s.tooth_period:   %g\n", optName, toPrint->tooth_period);
     if (NULL == toPrint->inputPath) {
-	printf("\t%s.inputPath:      NULL\n", optName);
+	logMessage(LOG_DEBUG, "\t%s.inputPath:      NULL\n", optName);
+    } else {
+	logMessage(LOG_DEBUG, "\t%s.inputPath:      %s\n", optName, toPrint->inputPath);
+    }
+    if (NULL == toPrint->devicePath) {
+	logMessage(LOG_DEBUG, "\t%s.devicePath:     NULL\n", optName);
+    } else {
+	logMessage(LOG_DEBUG, "\t%s.devicePath:     %s\n", optName, toPrint->devicePath);
+    }
+    logMessage(LOG_DEBUG, "\t%s.baudRate:       %ld\n", optName, toPrint->baudRate);
+    logMessage(LOG_DEBUG, "\t%s.flowControl:    %d\n", optName, toPrint->flowControl);
+    logMessage(LOG_DEBUG, "\t%s.genThreads:     %u\n", optName, toPrint->genThreads);
+    logMessage(LOG_DEBUG, "\t%s.ringSlots:      %u\n", optName, toPrint->ringSlots);
+    logMessage(LOG_DEBUG, "\t%s.chunkPoints:    %lu\n", optName, toPrint->chunkPoints);
+    logMessage(LOG_DEBUG, "\t%s.summaryFormat:  %d\n", optName, toPrint->summaryFormat);
+    logMessage(LOG_DEBUG, "\t%s.seed:           %" PRIu64 "\n", optName, toPrint->seed);
+    logMessage(LOG_DEBUG, "\t%s.sweepKind:      %d\n", optName, toPrint->sweepKind);
+    logMessage(LOG_DEBUG, "\t%s.sweepSteps:     %u\n", optName, toPrint->sweepSteps);
+    logMessage(LOG_DEBUG, "\t%s.markerMode:     %d\n", optName, toPrint->markerMode);
+    logMessage(LOG_DEBUG, "\t%s.envelope:       %d\n", optName, toPrint->envelope);
+    logMessage(LOG_DEBUG, "\t%s.sampleFormat:   %d\n", optName, toPrint->sampleFormat);
+    logMessage(LOG_DEBUG, "\t%s.searchMinClock: %g\n", optName, toPrint->searchMinClock);
+    logMessage(LOG_DEBUG, "\t%s.searchMaxClock: %g\n", optName, toPrint->searchMaxClock);
+    logMessage(LOG_DEBUG, "\t%s.searchStep:     %g\n", optName, toPrint->searchStep);
+    logMessage(LOG_DEBUG, "\t%s.clockGoal:      %d\n", optName, toPrint->clockGoal);
+    logMessage(LOG_DEBUG, "\t%s.minCycleSamples: %g\n", optName, toPrint->minCycleSamples);
+    logMessage(LOG_DEBUG, "\t%s.compressKind:   %d\n", optName, toPrint->compressKind);
+    logMessage(LOG_DEBUG, "\t%s.compressLevel:  %d\n", optName, toPrint->compressLevel);
+    if (NULL == toPrint->shmName) {
+	logMessage(LOG_DEBUG, "\t%s.shmName:        NULL\n", optName);
+    } else {
+	logMessage(LOG_DEBUG, "\t%s.shmName:        %s\n", optName, toPrint->shmName);
+    }
+    logMessage(LOG_DEBUG, "\t%s.shardIndex:     %u\n", optName, toPrint->shardIndex);
+    logMessage(LOG_DEBUG, "\t%s.shardCount:     %u\n", optName, toPrint->shardCount);
+    logMessage(LOG_DEBUG, "\t%s.multitonePoints: %" PRIu64 "\n", optName, toPrint->multitonePoints);
+    logMessage(LOG_DEBUG, "\t%s.phaseMode:      %d\n", optName, toPrint->phaseMode);
+    if (NULL == toPrint->profilePath) {
+	logMessage(LOG_DEBUG, "\t%s.profilePath:    NULL\n", optName);
     } else {
-	printf("\t%s.inputPath:      %s\n", optName, toPrint->inputPath);
+	logMessage(LOG_DEBUG, "\t%s.profilePath:    %s\n", optName, toPrint->profilePath);
     }
+    logMessage(LOG_DEBUG, "\t%s.checkpointSeconds: %g\n", optName, toPrint->checkpointSeconds);
     return;
 }
 
@@ -191,7 +527,7 @@ void printBitSetting(
     int                 bitCount = 0;
 
     if (!mask) {
-	printf("\t\tMask is zero.\n");
+	logMessage(LOG_DEBUG, "\t\tMask is zero.\n");
 	return;
     }
 
@@ -199,9 +535,10 @@ void printBitSetting(
 	bitCount++;
 
     if (NULL == title) {
-	printf("\t\tBit %d is %s.\n", bitCount, (mask & flags) ? "set" : "unset");
+	logMessage(LOG_DEBUG, "\t\tBit %d is %s.\n", bitCount, (mask & flags) ? "set" : "unset");
     } else {
-	printf("\t\t\"%s\" (bit %d) is %s.\n", title, bitCount, (mask & flags) ? "set" : "unset");
+	logMessage(LOG_DEBUG, "\t\t\"%s\" (bit %d) is %s.\n", title, bitCount,
+		   (mask & flags) ? "set" : "unset");
     }
     return;
 }
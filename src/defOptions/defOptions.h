@@ -13,8 +13,6 @@
 #include "filenames.h"
 
 #ifndef DEFOPTIONS_INT_H
-extern int          g_opt_debug;	//!< Whether -d/--debug has been set. 0 is unset, 1 is set.
-extern int          g_opt_quiet;	//!< Whether -q/--quiet has been set. 0 is unset, 1 is set.
 extern const char   helpText[];	//!< The help text to display for user-requested help.
 #endif
 
@@ -42,6 +40,18 @@ extern const char   helpText[];	//!< The help text to display for user-requested
 #define OPT_TEMPLATE_MASK	(1u << 0)	//!< Flag for requested template file output. 0 is unset, 1 is set.
 #define OPT_RANDAMP_MASK	(1u << 1)	//!< Flag for using random amplitudes for output. 0 is unset, 1 is set.
 #define OPT_HELPREQ_MASK	(1u << 2)	//!< Flag for user-requested help. 0 is unset, 1 is set.
+#define OPT_PIPELINE_MASK	(1u << 3)	//!< Flag for generating and writing on separate threads. 0 is unset, 1 is set.
+#define OPT_STATS_MASK		(1u << 4)	//!< Flag for printing timing statistics. 0 is unset, 1 is set.
+#define OPT_VERIFY_MASK		(1u << 5)	//!< Flag for checking the spectrum of the generated waveform. 0 is unset, 1 is set.
+#define OPT_APPEND_MASK		(1u << 6)	//!< Flag for adding the pulses to the end of the existing points file. 0 is unset, 1 is set.
+#define OPT_CLKSEARCH_MASK	(1u << 7)	//!< Flag for searching for the best sample clock before generating. 0 is unset, 1 is set.
+#define OPT_SHARD_MASK		(1u << 16)	//!< Flag for generating only one shard of the base train, see #progOptions::shardIndex. 0 is unset, 1 is set.
+#define OPT_MERGE_MASK		(1u << 17)	//!< Flag for writing the points file from #progOptions::shardCount shards. 0 is unset, 1 is set.
+#define OPT_REALTIME_MASK	(1u << 18)	//!< Flag for taking every pipeline buffer from a locked pool. 0 is unset, 1 is set.
+#define OPT_MULTITONE_MASK	(1u << 19)	//!< Flag for playing every pulse at once in a #progOptions::multitonePoints record. 0 is unset, 1 is set.
+#define OPT_AUTOTUNE_MASK	(1u << 20)	//!< Flag for timing the engines and writing the profile, see #progOptions::profilePath. 0 is unset, 1 is set.
+#define OPT_CHECKPOINT_MASK	(1u << 21)	//!< Flag for journaling the points file every #progOptions::checkpointSeconds. 0 is unset, 1 is set.
+#define OPT_RESUME_MASK		(1u << 22)	//!< Flag for finishing the points file from the journal an earlier run left. 0 is unset, 1 is set.
 // Are we setting input from command line bit mask
 #define OPT_FROMCMD_MASK	(1u << 15)	//!< Flag indicating user input frequency specification via command-line options. 0 is unset, 1 is set.
 // Track if we've set all parameters bit masks
@@ -49,11 +59,54 @@ extern const char   helpText[];	//!< The help text to display for user-requested
 #define OPT_STOPSET_MASK	(1u << 9)	//!< Flag indicating user specified a stop frequency, found in #progOptions::stop_f. 0 is unset, 1 is set.
 #define OPT_AMPSET_MASK		(1u << 10)	//!< Flag indicating user specified an amplitude. If #OPT_RANDAMP_MASK is not also set, found in #progOptions::amplitude. 0 is unset, 1 is set.
 #define OPT_PERIODSET_MASK	(1u << 11)	//!< Flag indicating pulse duration is set, found in #progOptions::tooth_period. 0 is unset, 1 is set.
+#define OPT_SEEDSET_MASK	(1u << 13)	//!< Flag indicating the random amplitude seed is set, found in #progOptions::seed. 0 is unset, 1 is set.
 #define OPT_NUMSET_MASK		(1u << 12)	//!< Flag indicating the number of teeth is set, found in #progOptions::num_f. 0 is unset, 1 is set.
 #define OPT_ALLSET_MASK		( OPT_STARTSET_MASK | OPT_STOPSET_MASK | OPT_AMPSET_MASK | OPT_PERIODSET_MASK | OPT_NUMSET_MASK )	//!< Pre-combined set of flags for checking if all needed command line options are set.
 
 /*! @} */
 
+/*!
+ * @defgroup OptLongCodes Long-only option codes
+ * @brief Values getopt_long() returns for options that have no short form.
+ *
+ * Chosen above the range of any character, so they can't collide with a short option.
+ * @{
+ */
+
+#define OPT_LONG_DEVICE		0x100	//!< --device <path>
+#define OPT_LONG_BAUD		0x101	//!< --baud <rate>
+#define OPT_LONG_FLOW		0x102	//!< --flow <none|rtscts|xonxoff>
+#define OPT_LONG_PIPELINE	0x103	//!< --pipeline
+#define OPT_LONG_THREADS	0x104	//!< --threads <count>
+#define OPT_LONG_BUFFERS	0x105	//!< --buffers <count>
+#define OPT_LONG_CHUNK		0x106	//!< --chunk-size <points>
+#define OPT_LONG_STATS		0x107	//!< --stats
+#define OPT_LONG_SUMMARY	0x108	//!< --summary-format <text|csv|bin>
+#define OPT_LONG_SEED		0x109	//!< --seed <n>
+#define OPT_LONG_SWEEP		0x10A	//!< --sweep <linear|log|stepped>
+#define OPT_LONG_STEPS		0x10B	//!< --steps <count>
+#define OPT_LONG_MARKER		0x10C	//!< --marker <none|tooth|start>
+#define OPT_LONG_VERIFY		0x10D	//!< --verify-spectrum
+#define OPT_LONG_ENVELOPE	0x10E	//!< --envelope <rect|gauss|raisedcos>
+#define OPT_LONG_APPEND		0x10F	//!< --append
+#define OPT_LONG_FORMAT		0x110	//!< --sample-format <u8|u12>
+#define OPT_LONG_CLKSEARCH	0x111	//!< --clock-search <min>:<max>[:<step>]
+#define OPT_LONG_CLKGOAL	0x112	//!< --clock-goal <length|error>
+#define OPT_LONG_CYCLESAMPLES	0x113	//!< --min-cycle-samples <n>
+#define OPT_LONG_COMPRESS	0x114	//!< --compress <none|gzip|zstd>[:<level>]
+#define OPT_LONG_SHM		0x115	//!< --shm <name>
+#define OPT_LONG_SHARD		0x116	//!< --shard <i>/<N>
+#define OPT_LONG_MERGE		0x117	//!< --merge <N>
+#define OPT_LONG_REALTIME	0x118	//!< --realtime
+#define OPT_LONG_MULTITONE	0x119	//!< --multitone <points>
+#define OPT_LONG_PHASES		0x11A	//!< --phases <zero|newman|minimize>
+#define OPT_LONG_AUTOTUNE	0x11B	//!< --autotune
+#define OPT_LONG_PROFILE	0x11C	//!< --profile <path|none>
+#define OPT_LONG_CHECKPOINT	0x11D	//!< --checkpoint <seconds>
+#define OPT_LONG_RESUME		0x11E	//!< --resume
+
+/*! @} */
+
 /*! @brief Structure to hold values for command-line options.
  *
  * Expected initialization found in #OPT_INIT_VAL
@@ -70,9 +123,36 @@ typedef struct progOptions {
     double              clock_freq;	//!< The sample output frequency. In MHz.
     double              tooth_period;	//!< The length of each pulse. In ns.
     char               *inputPath;	//!< C-string for a command-line specified frequency specification file path.
+    char               *devicePath;	//!< C-string for the serial device to send the output to, NULL to write the points file instead.
+    long                baudRate;	//!< Baud rate for the serial device.
+    int                 flowControl;	//!< Flow control for the serial device, one of the @ref SerialFlow values.
+    unsigned int        genThreads;	//!< Number of generator threads for --pipeline.
+    unsigned int        ringSlots;	//!< Number of buffers in the --pipeline ring.
+    unsigned long       chunkPoints;	//!< Samples per buffer in the --pipeline ring.
+    int                 summaryFormat;	//!< Machine-readable summary to write as well, one of the @ref SummaryTables values.
+    uint64_t            seed;	//!< Seed for random amplitudes.
+    int                 sweepKind;	//!< How command line frequencies are spaced, one of the @ref PulseSources values.
+    unsigned int        sweepSteps;	//!< Number of frequency steps for a stepped sweep.
+    int                 markerMode;	//!< Marker block to send after the curve, one of the @ref MarkerModes.
+    int                 envelope;	//!< Envelope of command line teeth, one of the @ref Envelopes values.
+    int                 sampleFormat;	//!< How output samples are stored, one of the @ref SampleFormats values.
+    double              searchMinClock;	//!< Lowest sample clock tried by --clock-search. In MHz.
+    double              searchMaxClock;	//!< Highest sample clock tried by --clock-search. In MHz.
+    double              searchStep;	//!< Spacing of the clocks tried by --clock-search, 0 for the default. In MHz.
+    int                 clockGoal;	//!< What --clock-search minimizes, one of the @ref ClockGoals.
+    double              minCycleSamples;	//!< Fewest samples per cycle of the highest frequency --clock-search accepts.
+    int                 compressKind;	//!< How the points file is compressed, one of the @ref CompressKinds.
+    int                 compressLevel;	//!< Compression level for the points file, 0 for the library default.
+    char               *shmName;	//!< C-string naming the shared memory ring to publish to, NULL to write the points file instead.
+    unsigned int        shardIndex;	//!< Which shard --shard generates, from 1 to shardCount.
+    unsigned int        shardCount;	//!< Number of shards the base train is split into, for --shard and --merge.
+    uint64_t            multitonePoints;	//!< Samples in the --multitone record, a power of two.
+    int                 phaseMode;	//!< How --multitone chooses the phases of the tones, one of the @ref PhaseModes.
+    char               *profilePath;	//!< C-string for the engine profile.  NULL reads none, and --autotune writes #PROFILE_FILENAME.  "none" also reads none.
+    double              checkpointSeconds;	//!< Least time between checkpoints of the points file, when #OPT_CHECKPOINT_MASK is set.
 } progOptions_type;
 
-#define OPT_INIT_VAL {0, 0.0, 0.0, 0.0, 0, 1024.0, 0.0, NULL}	//!< Initialization data for a #progOptions instantiation.
+#define OPT_INIT_VAL {0, 0.0, 0.0, 0.0, 0, 1024.0, 0.0, NULL, NULL, 9600, 1, 1, 4, 1ul << 20, 0, 0, 1, 0, 0, 0, 0, 0.0, 0.0, 0.0, 0, 4.0, 0, 0, NULL, 0, 0, 0, 1, NULL, 0.0}	//!< Initialization data for a #progOptions instantiation.
 
 /*! @brief Takes command-line arguments and parses them
  *	
@@ -94,7 +174,7 @@ int                 parseOptions(
     progOptions_type * options
 );
 
-/*! @brief Takes a progOptions structure and prints a formatted version to stdout.
+/*! @brief Takes a progOptions structure and prints a formatted version as debug messages.
  *	
  *  The formatted output includes the values of any numeric option,
  *  as well as the decoded contents of the #progOptions::flags field via calls to #printBitSetting().
@@ -108,7 +188,7 @@ void                printOptions(
     const char *idStr
 );
 
-/*! @brief Takes a bitfield and mask and prints the selected bit's state to stdout.
+/*! @brief Takes a bitfield and mask and prints the selected bit's state as a debug message.
  *	
  *  Prints out the state as 'set' or 'unset', along with an optional title explaining what
  *  has been decoded.
@@ -1,6 +1,6 @@
 
 /*! @file defOptions_int.h
- * @brief Sets up global flags for debug and quiet options
+ * @brief Sets up the help text
  */
 
 #ifndef DEFOPTIONS_INT_H
@@ -8,9 +8,6 @@
 
 #include "filenames.h"
 
-int                 g_opt_debug = 0;	//!< Whether -d/--debug has been set. 0 is unset, 1 is set.
-int                 g_opt_quiet = 0;	//!< Whether -q/--quiet has been set. 0 is unset, 1 is set.
-
 /*!
  * @defgroup HelpText User-requested help message
  * @brief Sets up the text displayed when invoked with -h/--help 
@@ -49,8 +46,88 @@ Options:\n\
   -d | --debug          Output debug information.\n\
   -q | --quiet          Suppress normal output.  Does not suppress debug output\n\
 \n\
-  -i | --input-file     Path to an input file\n\
+  -i | --input-file     Path to an input file, or - to read it from standard\n\
+                        input, generating each tooth as it arrives.  gzip or\n\
+                        zstd compressed input is decompressed as it is read\n\
   -f | --clock-freq     MHz. Sets the target sample clock on the AWG\n\
+  --clock-search <min>:<max>[:<step>]\n\
+                        MHz. Instead of -f, try clocks across this range and\n\
+                        use the best (default step: 4096 clocks across it)\n\
+  --clock-goal <goal>   What --clock-search minimizes: length (default), the\n\
+                        final point count, or error, the RMS tooth duration error\n\
+  --min-cycle-samples <n>  Only search clocks giving at least n samples per cycle\n\
+                        of the highest tooth frequency (default 4)\n\
+  --summary-format <f>  text (default), or also write a csv or bin table\n\
+                        with each tooth's byte offset in the points file\n\
+  --marker <mode>       Also send MARKER:DATA with marker 1 high at the start of\n\
+                        each tooth (tooth), of the train (start), or none (default)\n\
+  --verify-spectrum     FFT each tooth of the result and report its frequency and\n\
+                        amplitude error, per tooth in <output>_spectrum.csv\n\
+  --append              Add the teeth to the end of the existing points file and\n\
+                        text summary, generating only the new teeth\n\
+  --sample-format <f>   u8 (default, one byte per sample) or u12 (two bytes,\n\
+                        big-endian, 12 bits of resolution)\n\
+  --compress <f>[:<level>]  Compress the points file as it is written: gzip\n\
+                        (adds .gz) or zstd (adds .zst), or none (default)\n\
+\n\
+Serial Output:\n\
+  --device <path>       Send the commands straight to this serial port\n\
+                        instead of writing the points file, generating on\n\
+                        --threads worker threads while earlier buffers are\n\
+                        sent\n\
+  --baud <rate>         Baud rate for --device (default 9600)\n\
+  --flow <mode>         none, rtscts (default), or xonxoff\n\
+\n\
+Shared Memory Output:\n\
+  --shm <name>          Publish the commands into the shared memory ring /<name>\n\
+                        as they are generated, instead of writing the points\n\
+                        file.  Waits for a reader, such as awgshmread <name>\n\
+\n\
+Sharded Output:\n\
+  --shard <i>/<N>       Generate only the i-th of N parts of the waveform, into\n\
+                        " OUTPUT_ROOT "_shard<i>of<N>.  Run all N, on any hosts\n\
+                        sharing this directory, with the same spec and options\n\
+  --merge <N>           Write the points file from the N shards, as one process\n\
+                        would have.  Takes the same spec and options as well.\n\
+                        Compression, markers, summaries and checks are done here\n\
+\n\
+Multitone Output:\n\
+  --multitone <pts>     Play every pulse at once, as one record of <pts> samples\n\
+                        (a power of two) to loop.  Tones move to the nearest\n\
+                        multiple of clock / <pts>; durations and envelopes are\n\
+                        ignored.  The tones are listed in " OUTPUT_ROOT "_tones.csv\n\
+  --phases <p>          Tone phases: newman (default), minimize (lower crest\n\
+                        factor, slower), or zero\n\
+\n\
+Pipelined Output:\n\
+  --pipeline            Generate on worker threads while writing the output\n\
+  --threads <count>     Number of generator threads (default 1)\n\
+  --buffers <count>     Number of buffers between generators and writer (default 4)\n\
+  --chunk-size <pts>    Samples per buffer (default 1048576)\n\
+  --stats               Print where the time went, and which engine was used\n\
+  --realtime            Take every buffer from a pool that is faulted in and\n\
+                        locked before streaming starts (raise ulimit -l to fit\n\
+                        it), and report the worst chunk latency.  Implies\n\
+                        --pipeline\n\
+\n\
+Checkpointed Output:\n\
+  --checkpoint <s>      Every <s> seconds, at the end of a buffer, flush the\n\
+                        points file to disk and record how far it got in\n\
+                        " OUTPUT_ROOT "_checkpoint.txt.  Implies --pipeline\n\
+  --resume              Finish the points file an interrupted --checkpoint run\n\
+                        left, with the same spec and options, generating only\n\
+                        what is missing.  Checkpoints every 10 s unless\n\
+                        --checkpoint is given\n\
+\n\
+Engine Profile:\n\
+  --autotune            Time the in-memory and pipelined engines, with a range\n\
+                        of thread counts and chunk sizes, on several shapes of\n\
+                        spec, and save the fastest for each to the profile.\n\
+                        Uses -f and --sample-format, and generates nothing else\n\
+  --profile <path>      The profile to write (default " PROFILE_FILENAME "),\n\
+                        or to read.  When writing the points file without\n\
+                        --pipeline options, the profile's engine for the\n\
+                        spec's shape is used.  No profile is read without it\n\
 \n\
 Command Line Pulse Specification:\n\
   WARNING: " ANY_ALL_TEXT "\
@@ -60,6 +137,12 @@ Command Line Pulse Specification:\n\
   -p | --tooth-period   ns. Time per tooth\n\
   -r | --random-amp     Randomly select amplitude for each tooth from [0.1, 1.0]\n\
   -a | --fixed-amp      Same amplitude for every tooth (range 0 to 1)\n\
+  --seed <n>            Seed for -r, to reproduce an earlier run's amplitudes\n\
+  --sweep <kind>        Tooth frequency spacing: linear (default), log, or stepped\n\
+  --steps <count>       Distinct frequencies in a stepped sweep, each held for an\n\
+                        equal share of the teeth (implies --sweep stepped)\n\
+  --envelope <shape>    Amplitude envelope of each tooth: rect (default), gauss,\n\
+                        or raisedcos.  Spec files give it as a 4th column\n\
 \n\
 \n\
 Generates a file whose content is suitable for streaming directly over a serial\n\
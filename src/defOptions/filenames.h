@@ -10,5 +10,6 @@
 #define TEMPLATE_FILENAME "template.txt"	//!< File to output the frequency specification template to.
 #define INPUT_FILENAME "freqSpec.txt"	//!< File to read for frequency specification input.
 #define OUTPUT_ROOT "awgOutput"	//!< File name stem used
+#define PROFILE_FILENAME "awgProfile.txt"	//!< Engine profile written by --autotune, read by normal runs only when named with --profile.
 
 #endif
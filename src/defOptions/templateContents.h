@@ -13,11 +13,19 @@
   */
 const char          templateStr[] = "# Lines starting with '#' are comments\n\
 # All other lines should be in the following format\n\
-# freq [MHz], duration [ns], amplitude [relative, [0,1] ]\n\
+# freq [MHz], duration [ns], amplitude [relative, [0,1] ][, envelope]\n\
+# freq may be start:stop [MHz] for a chirp, sweeping linearly from one to the other\n\
 # durations are a goal, not a guarantee, will be rounded to nearest 1/2 cycle of freq (including 0!)\n\
 # amplitudes relative scales, where 1 is full-scale.\n\
-# Output is only 8-bit, so effective amplitude resolution is 1/127 ~ 0.008\n\
+# amplitude resolution is 1/127 ~ 0.008 with --sample-format u8 (the default),\n\
+# and 1/2047 ~ 0.0005 with --sample-format u12\n\
+# envelope is optional: rect (the default), gauss, or raisedcos\n\
+# a chirp's duration is rounded to the nearest 1/2 cycle of the mean of start and stop\n\
 #\n\
 # Example line of 111 MHz for 30ns, with 3/4 full scale amplitude\n\
 # 100, 30, 0.75\n\
+# The same tooth with a Gaussian envelope\n\
+# 100, 30, 0.75, gauss\n\
+# A chirp from 100 to 200 MHz over 1000ns, at full scale\n\
+# 100:200, 1000, 1.0\n\
 ";
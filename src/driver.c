@@ -5,22 +5,260 @@
 #include <fcntl.h>
 #include "genBinary/genBinary.h"
 #include "defOptions/defOptions.h"
+#include "serialLink/serialLink.h"
+#include "pipeline/pipeline.h"
+#include "summary/summary.h"
+#include "prng/prng.h"
+#include "spectrum/spectrum.h"
+#include "specStream/specStream.h"
+#include "pointsFile/pointsFile.h"
+#include "shmRing/shmRing.h"
+#include "shard/shard.h"
+#include "multitone/multitone.h"
+#include "clockSearch/clockSearch.h"
+#include "autotune/autotune.h"
+#include "checkpoint/checkpoint.h"
+#include "logging/logging.h"
+
+/* Sends the waveform to the serial device given with --device, and checks the reply. */
+static int sendToDevice(
+    const progOptions_type * options,
+    const freqList_ptr parsedList,
+    const wavePlan_type * plan,
+    const pipelineConfig_type * pipeConfig,
+    pipelineStats_type * pipeStats
+) {
+    wfmpReply_type      reply;
+    char                replyBuf[512];
+    int                 deviceFd = -1;
+    int                 checkStatus = 0;
+
+    deviceFd = openSerialDevice(options->devicePath, options->baudRate, options->flowControl);
+    if (deviceFd < 0)
+	return -1;
+    checkStatus =
+	streamToDevice(deviceFd, parsedList, plan, options->clock_freq, pipeConfig, pipeStats);
+    if (checkStatus) {
+	logMessage(LOG_ERROR, "Problem sending points to \"%s\".\n", options->devicePath);
+	closeSerialDevice(deviceFd);
+	return -1;
+    }
+
+    if (readDeviceReply(deviceFd, replyBuf, sizeof (replyBuf), SERIAL_REPLY_TIMEOUT_MS) < 0) {
+	logMessage(LOG_WARN, "Warning: no reply to WFMP? from \"%s\".\n", options->devicePath);
+    } else if (parseWfmpReply(replyBuf, &reply)) {
+	logMessage(LOG_WARN, "Warning: could not parse WFMP? reply \"%s\".\n", replyBuf);
+    } else {
+	logMessage(LOG_INFO, "AWG reports %" PRIu64 " points, %d byte(s) each, at %g s per point.\n",
+		   reply.nrPt, reply.byteNr, reply.xIncr);
+	if ((WFMP_NRPT_MASK & reply.foundMask) && (reply.nrPt != plan->finalCount)) {
+	    logMessage(LOG_ERROR, "AWG reports %" PRIu64 " points, but %" PRIu64 " were sent.\n",
+		       reply.nrPt, plan->finalCount);
+	    checkStatus = -1;
+	}
+	if ((WFMP_BYTNR_MASK & reply.foundMask)
+	    && ((unsigned int) reply.byteNr != sampleFormatInfo(plan->sampleFormat)->width)) {
+	    logMessage(LOG_ERROR, "AWG reports %d byte(s) per point, but %u were sent.\n",
+		       reply.byteNr, sampleFormatInfo(plan->sampleFormat)->width);
+	    checkStatus = -1;
+	}
+    }
+    closeSerialDevice(deviceFd);
+    return checkStatus;
+}
+
+/* Replaces options->clock_freq with the best clock in the --clock-search range. */
+static int chooseClock(
+    progOptions_type * options,
+    const freqList_ptr parsedList
+) {
+    clockSearch_type    search = CLOCK_SEARCH_INIT_VAL;
+    clockSearchReport_type found;
+
+    search.minClock = options->searchMinClock;
+    search.maxClock = options->searchMaxClock;
+    search.stepClock = options->searchStep;
+    search.goal = options->clockGoal;
+    search.minCycleSamples = options->minCycleSamples;
+    search.sampleFormat = options->sampleFormat;
+    search.threads = (OPT_PIPELINE_MASK & options->flags) ? options->genThreads : 0;
+    if (searchClock(parsedList, &search, &found) || (0 == found.bestCount))
+	return -1;
+    printClockSearchReport(&found);
+    logMessage(LOG_INFO, "Using a %f MHz clock.\n", found.best[0].clockFreq);
+    options->clock_freq = found.best[0].clockFreq;
+    return 0;
+}
+
+/* Records what went to the points file, or to the --shm ring, next to the summary. */
+static int saveManifest(
+    const progOptions_type * options,
+    const char *rootName,
+    outputManifest_type * manifest
+) {
+    const char          fileNameSuf[] = "_points";
+    const char         *compressSuf = compressSuffix(options->compressKind);
+    char               *target = NULL;
+    int                 retVal = 0;
+
+    if (NULL != options->shmName) {
+	target = malloc(strlen(options->shmName) + 2);
+	if (NULL != target)
+	    sprintf(target, "/%s", options->shmName);
+	manifest->targetKey = "shm";
+    } else {
+	target = malloc(strlen(rootName) + strlen(fileNameSuf) + strlen(compressSuf) + 1);
+	if (NULL != target)
+	    sprintf(target, "%s%s%s", rootName, fileNameSuf, compressSuf);
+	manifest->targetKey = "file";
+    }
+    if (NULL == target)
+	return -1;
+    manifest->target = target;
+    manifest->sampleFormat = options->sampleFormat;
+    manifest->clockFreq = options->clock_freq;
+    logMessage(LOG_DEBUG, "CRC32C (%s) of %" PRIu64 " bytes sent: %08" PRIx32 "\n",
+	       crc32cMethod(), manifest->output.bytes, manifest->output.crc);
+    retVal = writeManifest(rootName, manifest);
+    free(target);
+    if (retVal)
+	logMessage(LOG_ERROR, "Problem writing the manifest.\n");
+    return retVal;
+}
+
+/* Adds the pulses to the end of the waveform already saved under rootName. */
+static int appendToExisting(
+    const progOptions_type * options,
+    const freqList_ptr parsedList,
+    const uint64_t *countList,
+    const char *rootName
+) {
+    summaryStream_type *stream = NULL;
+    uint64_t            basePoints = 0;
+    uint64_t            finalCount = 0;
+    unsigned int        i = 0;
+
+    if ((NULL != options->devicePath) || (OPT_PIPELINE_MASK & options->flags)
+	|| (OPT_VERIFY_MASK & options->flags) || (MARKER_NONE != options->markerMode)
+	|| (SUMMARY_TABLE_NONE != options->summaryFormat)
+	|| (COMPRESS_NONE != options->compressKind) || (NULL != options->shmName)) {
+	logMessage(LOG_ERROR, "Appending only updates the points file and the text summary.\n");
+	return -1;
+    }
+    // The summary lists every pulse already in the file, so it gives the base train length
+    if (readSummaryBase(rootName, options->clock_freq, &basePoints)) {
+	logMessage(LOG_ERROR, "Problem reading the existing summary.\n");
+	return -1;
+    }
+#ifdef ON_MINGW_HOST
+    _fmode = _O_BINARY;		     // Turn off line ending conversion.
+#endif
+    if (appendPointsFile(rootName, parsedList, countList, basePoints, options->sampleFormat,
+			 options->clock_freq, &finalCount)) {
+	logMessage(LOG_ERROR, "Problem appending to the points file.\n");
+	return -1;
+    }
+
+    stream = reopenSummaryStream(rootName, options->clock_freq);
+    if (NULL == stream) {
+	logMessage(LOG_ERROR, "Problem writing summary file.\n");
+	return -1;
+    }
+    for (i = 0; i < parsedList->freqCount; i++)
+	appendSummaryPulse(stream, pulseFreq(parsedList, i), pulseStopFreq(parsedList, i),
+			   pulseAmp(parsedList, i), *(countList + i), pulseEnvelope(parsedList, i));
+    if (closeSummaryStream(stream, NULL)) {
+	logMessage(LOG_ERROR, "Problem writing summary file.\n");
+	return -1;
+    }
+    // Hashing the extended file would mean reading all of it again
+    if (discardManifest(rootName)) {
+	logMessage(LOG_ERROR, "Problem removing the manifest, which no longer matches.\n");
+	return -1;
+    }
+    return 0;
+}
+
+/* Plays every pulse at once: writes one multitone record, for the AWG to loop, and its tones. */
+static int playMultitone(
+    const progOptions_type * options,
+    const freqList_ptr parsedList,
+    const char *rootName
+) {
+    multitone_type      tones = MULTITONE_INIT_VAL;
+    outputManifest_type manifest = OUTPUT_MANIFEST_INIT_VAL;
+    unsigned char      *pointsList = NULL;
+    int                 retVal = 0;
+
+    if ((NULL != options->devicePath) || (NULL != options->shmName)
+	|| ((OPT_PIPELINE_MASK | OPT_APPEND_MASK | OPT_VERIFY_MASK | OPT_CLKSEARCH_MASK
+	     | OPT_SHARD_MASK | OPT_MERGE_MASK) & options->flags)
+	|| (MARKER_NONE != options->markerMode)
+	|| (SUMMARY_TABLE_NONE != options->summaryFormat)) {
+	logMessage(LOG_ERROR, "A multitone record is only written to the points file, with its "
+		   "tone table.\n");
+	return -1;
+    }
+    if (planMultitone(parsedList, options->clock_freq, options->multitonePoints,
+		      options->phaseMode, &tones)) {
+	logMessage(LOG_ERROR, "Problem placing the tones.\n");
+	return -1;
+    }
+    pointsList = synthMultitone(&tones, options->sampleFormat);
+    if (NULL == pointsList) {
+	logMessage(LOG_ERROR, "Problem synthesizing the multitone record.\n");
+	freeMultitone(&tones);
+	return -1;
+    }
+    logMessage(LOG_INFO, "Final point count %" PRIu64 "\n", tones.points);
+#ifdef ON_MINGW_HOST
+    _fmode = _O_BINARY;		     // Turn off line ending conversion.
+#endif
+    retVal = writeToFile(rootName, pointsList, NULL, tones.points, options->sampleFormat,
+			 options->clock_freq, options->compressKind, options->compressLevel,
+			 &manifest.output);
+    free(pointsList);
+    if (retVal) {
+	logMessage(LOG_ERROR, "Problem writing points file.\n");
+    } else if (writeToneTable(rootName, &tones)) {
+	logMessage(LOG_ERROR, "Problem writing the tone table.\n");
+	retVal = -1;
+    } else {
+	manifest.finalCount = tones.points;
+	manifest.pulseCount = parsedList->freqCount;
+	digestFreqList(&manifest.spec, parsedList);
+	retVal = saveManifest(options, rootName, &manifest);
+    }
+    freeMultitone(&tones);
+    return retVal;
+}
 
 int main(
     int argc,
     char *argv[]
 ) {
     freqList_ptr        parsedList = NULL;
-    unsigned int       *countList = NULL;
+    uint64_t           *countList = NULL;
     unsigned char      *pointsList = NULL;
+    unsigned char      *markerList = NULL;
     int                 checkStatus = 0;
-    unsigned long       finalCount = 0;
+    uint64_t            finalCount = 0;
     double              clock_period;
     const char          baseName[] = OUTPUT_ROOT;
     const char          tempPath[] = INPUT_FILENAME;
 
     progOptions_type    myOptions = OPT_INIT_VAL;
+    pipelineConfig_type pipeConfig = PIPELINE_INIT_VAL;
+    pipelineStats_type  pipeStats;
+    wavePlan_type       plan = WAVE_PLAN_INIT_VAL;
+    summaryJob_type     summary;
+    outputManifest_type manifest = OUTPUT_MANIFEST_INIT_VAL;
+    tuneChoice_type     engine = TUNE_CHOICE_INIT_VAL;
+    const char         *engineSource = NULL;
+    const char         *profilePath = NULL;
 
+    memset(&summary, 0, sizeof (summaryJob_type));
+    memset(&pipeStats, 0, sizeof (pipelineStats_type));
 
     checkStatus = parseOptions(argc, argv, &myOptions);
     switch (checkStatus) {
@@ -44,62 +282,278 @@ int main(
 
     // stderr is OK, because I said so.
 
-    if (!(OPT_FROMCMD_MASK & myOptions.flags)) {
+    if (OPT_AUTOTUNE_MASK & myOptions.flags) {
+	profilePath = (NULL == myOptions.profilePath) ? PROFILE_FILENAME : myOptions.profilePath;
+	if (0 == strcmp(profilePath, "none")) {
+	    logMessage(LOG_ERROR, "--autotune needs a profile to write.\n");
+	    return -1;
+	}
+	return runAutotune(profilePath, baseName, myOptions.clock_freq,
+			   myOptions.sampleFormat) ? -1 : 0;
+    }
+    if ((NULL != myOptions.devicePath) && (COMPRESS_NONE != myOptions.compressKind)) {
+	logMessage(LOG_ERROR, "Compression only applies to the points file, not to --device.\n");
+	return -1;
+    }
+    if ((NULL != myOptions.shmName)
+	&& ((NULL != myOptions.devicePath) || (COMPRESS_NONE != myOptions.compressKind))) {
+	logMessage(LOG_ERROR, "--shm replaces the points file, and can't go with --device or "
+		   "--compress.\n");
+	return -1;
+    }
+    if (((OPT_CHECKPOINT_MASK | OPT_RESUME_MASK) & myOptions.flags)
+	&& ((NULL != myOptions.devicePath) || (NULL != myOptions.shmName)
+	    || (COMPRESS_NONE != myOptions.compressKind)
+	    || ((OPT_APPEND_MASK | OPT_SHARD_MASK | OPT_MERGE_MASK | OPT_MULTITONE_MASK)
+		& myOptions.flags))) {
+	logMessage(LOG_ERROR, "Checkpoints are only kept for an uncompressed points file.\n");
+	return -1;
+    }
+    if (((OPT_SHARD_MASK | OPT_MERGE_MASK) & myOptions.flags)
+	&& ((NULL != myOptions.devicePath) || (NULL != myOptions.shmName)
+	    || (OPT_APPEND_MASK & myOptions.flags) || (OPT_PIPELINE_MASK & myOptions.flags))) {
+	logMessage(LOG_ERROR, "Shards are only written to, and merged into, the points file.\n");
+	return -1;
+    }
+    if (!(OPT_FROMCMD_MASK & myOptions.flags) && (NULL != myOptions.inputPath)
+	&& (0 == strcmp(myOptions.inputPath, "-"))) {
+	compressStream_type *input = NULL;
+
+	// Generate each pulse as its line arrives; the output only needs the pulses in order
+	if ((NULL != myOptions.devicePath) || (OPT_PIPELINE_MASK & myOptions.flags)
+	    || (OPT_VERIFY_MASK & myOptions.flags) || (MARKER_NONE != myOptions.markerMode)
+	    || (SUMMARY_TABLE_NONE != myOptions.summaryFormat)
+	    || (OPT_APPEND_MASK & myOptions.flags) || (OPT_CLKSEARCH_MASK & myOptions.flags)
+	    || ((OPT_SHARD_MASK | OPT_MERGE_MASK | OPT_MULTITONE_MASK) & myOptions.flags)
+	    || (NULL != myOptions.shmName)) {
+	    logMessage(LOG_ERROR, "Reading from standard input only writes new points and text "
+		       "summary files.\n");
+	    return -1;
+	}
+	logMessage(LOG_INFO, "Attempting to load frequency list from standard input.\n");
+#ifdef ON_MINGW_HOST
+	_fmode = _O_BINARY;	     // Turn off line ending conversion.
+#endif
+	input = openCompressedInput(stdin);
+	if ((NULL == input)
+	    || streamSpecFile(compressStreamFile(input), baseName, myOptions.clock_freq,
+			      myOptions.sampleFormat, myOptions.compressKind,
+			      myOptions.compressLevel, &manifest)) {
+	    logMessage(LOG_ERROR, "Problem generating from standard input.\n");
+	    if (NULL != input)
+		closeCompressStream(input);
+	    return -1;
+	}
+	if (closeCompressStream(input)) {
+	    logMessage(LOG_ERROR, "Problem reading standard input.\n");
+	    return -1;
+	}
+	return saveManifest(&myOptions, baseName, &manifest) ? -1 : 0;
+    } else if (!(OPT_FROMCMD_MASK & myOptions.flags)) {
 	const char         *loadPath =
 	    (NULL == myOptions.inputPath) ? tempPath : myOptions.inputPath;
-	if (!g_opt_quiet)
-	    printf("Attempting to load frequency list from file: \"%s\".\n", loadPath);
+	logMessage(LOG_INFO, "Attempting to load frequency list from file: \"%s\".\n", loadPath);
 	parsedList = readSpecFile(loadPath);
 	if (NULL == parsedList) {
-	    fprintf(stderr, "Problem parsing file at \"%s\".\n", loadPath);
+	    logMessage(LOG_ERROR, "Problem parsing file at \"%s\".\n", loadPath);
 	    return -1;
 	}
     } else {
-	// Loading from frigging cmdline
-	parsedList = blankFreqList();
+	// Loading from frigging cmdline.  The teeth follow from these few numbers,
+	// so they are computed as needed rather than stored.
+	pulseSweep_type     sweep = PULSE_SWEEP_INIT_VAL;
+
+	sweep.kind = myOptions.sweepKind;
+	sweep.toothCount = myOptions.num_f;
+	sweep.startFreq = myOptions.start_f;
+	sweep.stopFreq = myOptions.stop_f;
+	sweep.stepCount = myOptions.sweepSteps;
+	sweep.duration = myOptions.tooth_period;
+	sweep.amplitude = myOptions.amplitude;
+	sweep.envelope = myOptions.envelope;
+	if (OPT_RANDAMP_MASK & myOptions.flags) {
+	    // Random amplitudes, reproducible from the seed
+	    sweep.randAmp = 1;
+	    sweep.seed = (OPT_SEEDSET_MASK & myOptions.flags) ? myOptions.seed : prngDefaultSeed();
+	    logMessage(LOG_INFO, "Random amplitude seed %" PRIu64 "\n", sweep.seed);
+	}
+	parsedList = sweepFreqList(&sweep);
 	if (NULL == parsedList) {
-	    fprintf(stderr, "Problem allocating frequency list\n");
+	    logMessage(LOG_ERROR, "Problem allocating frequency list\n");
 	    return -1;
 	}
-	if (allocSubLists(parsedList, myOptions.num_f)) {
-	    fprintf(stderr, "Problem allocating frequency list\n");
+    }
+    pipeConfig.genThreads = myOptions.genThreads;
+    pipeConfig.slotCount = myOptions.ringSlots;
+    pipeConfig.chunkPoints = myOptions.chunkPoints;
+    pipeConfig.realtime = (OPT_REALTIME_MASK & myOptions.flags) ? 1 : 0;
+
+    if (OPT_MULTITONE_MASK & myOptions.flags)
+	return playMultitone(&myOptions, parsedList, baseName) ? -1 : 0;
+
+    if (OPT_CLKSEARCH_MASK & myOptions.flags) {
+	// Appending has to keep the clock the file was made with
+	if ((OPT_APPEND_MASK & myOptions.flags) || chooseClock(&myOptions, parsedList)) {
+	    logMessage(LOG_ERROR, "Problem searching for a sample clock.\n");
 	    return -1;
 	}
-	setFreqList(parsedList, myOptions.start_f, myOptions.stop_f);
-	setFixedDur(parsedList, myOptions.tooth_period);
-	if (OPT_RANDAMP_MASK & myOptions.flags) {
-	    // Random amplitudes
-	    setRandAmp(parsedList);
-	} else {
-	    setFixedAmp(parsedList, myOptions.amplitude);
-	}
     }
     clock_period = 1000.0 / myOptions.clock_freq;
     countList = pointCounts(parsedList, clock_period);
     if (NULL == countList) {
-	fprintf(stderr, "Problem counting points.\n");
+	logMessage(LOG_ERROR, "Problem counting points.\n");
 	return -1;
     }
+    if (OPT_APPEND_MASK & myOptions.flags)
+	return appendToExisting(&myOptions, parsedList, countList, baseName) ? -1 : 0;
 
-    checkStatus = writeSummaryFile(baseName, parsedList, countList, myOptions.clock_freq);
-    if (checkStatus) {
-	fprintf(stderr, "Problem writing summary file.\n");
+    if (planWaveform(parsedList, countList, clock_period, myOptions.sampleFormat, &plan)) {
+	logMessage(LOG_ERROR, "Problem planning points.\n");
 	return -1;
     }
-
-    pointsList = genPointList(parsedList, countList, clock_period, &finalCount);
-    if (NULL == pointsList) {
-	fprintf(stderr, "Problem generating points.\n");
+    plan.markerMode = myOptions.markerMode;
+    // Every output is a command stream for the AWG, which can't take a block this long
+    if (checkBlockBytes(plan.finalCount, plan.sampleFormat)) {
+	freeWavePlan(&plan);
 	return -1;
     }
+    if (!((OPT_PIPELINE_MASK | OPT_SHARD_MASK | OPT_MERGE_MASK) & myOptions.flags)
+	&& (NULL == myOptions.devicePath) && (NULL == myOptions.shmName)
+	&& (NULL != myOptions.profilePath) && (0 != strcmp(myOptions.profilePath, "none"))
+	&& !loadTuneChoice(myOptions.profilePath, &plan, &engine)) {
+	// No engine was asked for, so the one measured fastest on this shape of spec is used
+	engineSource = myOptions.profilePath;
+	printTuneChoice(&engine, engineSource, specShape(&plan));
+	if (TUNE_ENGINE_PIPELINE == engine.engine) {
+	    myOptions.flags |= OPT_PIPELINE_MASK;
+	    myOptions.genThreads = engine.genThreads;
+	    pipeConfig.genThreads = engine.genThreads;
+	    pipeConfig.slotCount = engine.slotCount;
+	    pipeConfig.chunkPoints = engine.chunkPoints;
+	}
+    } else if (OPT_PIPELINE_MASK & myOptions.flags) {
+	engine.engine = TUNE_ENGINE_PIPELINE;
+	engine.genThreads = pipeConfig.genThreads;
+	engine.slotCount = pipeConfig.slotCount;
+	engine.chunkPoints = pipeConfig.chunkPoints;
+    }
+    if (OPT_SHARD_MASK & myOptions.flags) {
+	// Everything but the samples, compression and checks included, is left to the merge
+	checkStatus = writeShard(baseName, parsedList, &plan, myOptions.clock_freq,
+				 myOptions.shardIndex, myOptions.shardCount);
+	if (checkStatus)
+	    logMessage(LOG_ERROR, "Problem writing the shard.\n");
+	freeWavePlan(&plan);
+	return checkStatus ? -1 : 0;
+    }
+    // The summaries are written on their own thread while the points are generated
+    summary.rootName = baseName;
+    summary.freqList = parsedList;
+    summary.pointCounts = countList;
+    summary.plan = &plan;
+    summary.clockFreq = myOptions.clock_freq;
+    summary.tableFormat = myOptions.summaryFormat;
+    startSummaryJob(&summary);
+
+    if (NULL != myOptions.devicePath) {
+	// Straight to the instrument, streaming while we generate
+	logMessage(LOG_INFO, "Final point count %" PRIu64 "\n", plan.finalCount);
+	checkStatus = sendToDevice(&myOptions, parsedList, &plan, &pipeConfig, &pipeStats);
+    } else if (NULL != myOptions.shmName) {
+	// Straight to the uploader process, which reads each chunk as it is published
+	logMessage(LOG_INFO, "Final point count %" PRIu64 "\n", plan.finalCount);
+	checkStatus = streamToShmRing(myOptions.shmName, parsedList, &plan, myOptions.clock_freq,
+				      (OPT_PIPELINE_MASK & myOptions.flags) ? &pipeConfig : NULL,
+				      &pipeStats, &manifest.output);
+	if (checkStatus)
+	    logMessage(LOG_ERROR, "Problem publishing points to shared memory.\n");
+    } else if (OPT_MERGE_MASK & myOptions.flags) {
+	// Each shard was generated by its own --shard process, only the copies are left to do
+	logMessage(LOG_INFO, "Final point count %" PRIu64 "\n", plan.finalCount);
 #ifdef ON_MINGW_HOST
-    _fmode = _O_BINARY;	     // Turn off line ending conversion.
+	_fmode = _O_BINARY;	     // Turn off line ending conversion.
 #endif
-    checkStatus = writeToFile(baseName, pointsList, finalCount, myOptions.clock_freq);
-    if (checkStatus) {
-	fprintf(stderr, "Problem writing points file.\n");
-	return -1;
+	checkStatus = mergeShards(baseName, parsedList, &plan, myOptions.clock_freq,
+				  myOptions.shardCount, myOptions.compressKind,
+				  myOptions.compressLevel, &manifest.output);
+	if (checkStatus)
+	    logMessage(LOG_ERROR, "Problem merging the shards into the points file.\n");
+    } else if (OPT_PIPELINE_MASK & myOptions.flags) {
+	// Generator threads fill a ring of buffers while this one writes them out
+	logMessage(LOG_INFO, "Final point count %" PRIu64 "\n", plan.finalCount);
+#ifdef ON_MINGW_HOST
+	_fmode = _O_BINARY;	     // Turn off line ending conversion.
+#endif
+	if ((OPT_CHECKPOINT_MASK | OPT_RESUME_MASK) & myOptions.flags) {
+	    // Flushed and journaled as it goes, so an interrupted run can be finished
+	    checkStatus =
+		writeToFileCheckpointed(baseName, parsedList, &plan, myOptions.clock_freq,
+					&pipeConfig, (OPT_CHECKPOINT_MASK & myOptions.flags)
+					? myOptions.checkpointSeconds : CHECKPOINT_DEFAULT_SECONDS,
+					(OPT_RESUME_MASK & myOptions.flags) ? 1 : 0, &pipeStats,
+					&manifest.output);
+	} else {
+	    checkStatus =
+		writeToFilePipelined(baseName, parsedList, &plan, myOptions.clock_freq,
+				     &pipeConfig, myOptions.compressKind,
+				     myOptions.compressLevel, &pipeStats, &manifest.output);
+	}
+	if (checkStatus)
+	    logMessage(LOG_ERROR, "Problem writing points file.\n");
+    } else {
+	pointsList = genPointList(parsedList, countList, clock_period, myOptions.sampleFormat,
+				  myOptions.markerMode, &finalCount, &markerList);
+	if (NULL == pointsList) {
+	    logMessage(LOG_ERROR, "Problem generating points.\n");
+	    finishSummaryJob(&summary);
+	    return -1;
+	}
+#ifdef ON_MINGW_HOST
+	_fmode = _O_BINARY;	     // Turn off line ending conversion.
+#endif
+	checkStatus =
+	    writeToFile(baseName, pointsList, markerList, finalCount, myOptions.sampleFormat,
+			myOptions.clock_freq, myOptions.compressKind, myOptions.compressLevel,
+			&manifest.output);
+	if (checkStatus)
+	    logMessage(LOG_ERROR, "Problem writing points file.\n");
     }
 
-    return 0;
+    if (!checkStatus && (NULL == myOptions.devicePath)) {
+	// The digest of the bytes was taken as they were written
+	manifest.finalCount = plan.finalCount;
+	manifest.pulseCount = parsedList->freqCount;
+	digestFreqList(&manifest.spec, parsedList);
+	checkStatus = saveManifest(&myOptions, baseName, &manifest);
+    }
+
+    if (!checkStatus && (OPT_VERIFY_MASK & myOptions.flags)) {
+	// Uses the samples already in memory if there are any, otherwise regenerates per tooth
+	spectrumReport_type spectrum;
+
+	if (verifySpectrum(baseName, parsedList, &plan, pointsList, myOptions.clock_freq,
+			   (OPT_PIPELINE_MASK & myOptions.flags) ? myOptions.genThreads : 0,
+			   &spectrum)) {
+	    logMessage(LOG_ERROR, "Problem checking the spectrum.\n");
+	    checkStatus = -1;
+	} else {
+	    printSpectrumReport(&spectrum);
+	}
+    }
+
+    if (finishSummaryJob(&summary)) {
+	logMessage(LOG_ERROR, "Problem writing summary file.\n");
+	checkStatus = -1;
+    }
+    // A profile's choice was logged when it was loaded
+    if ((OPT_STATS_MASK & myOptions.flags) && !(OPT_MERGE_MASK & myOptions.flags)
+	&& (NULL == myOptions.devicePath) && (NULL == myOptions.shmName) && (NULL == engineSource))
+	printTuneChoice(&engine, engineSource, specShape(&plan));
+    if (((OPT_STATS_MASK | OPT_REALTIME_MASK) & myOptions.flags)
+	&& ((OPT_PIPELINE_MASK & myOptions.flags) || (NULL != myOptions.devicePath)))
+	printPipelineStats(&pipeStats,
+			   plan.finalCount * sampleFormatInfo(plan.sampleFormat)->width);
+    freeWavePlan(&plan);
+
+    return checkStatus ? -1 : 0;
 }
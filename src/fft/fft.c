@@ -0,0 +1,96 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <math.h>
+#include "fft.h"
+#include "../genBinary/genBinary.h"
+
+int initFftTwiddles(
+    uint64_t length,
+    fftTwiddles_type * tw
+) {
+    uint64_t            k = 0;
+
+    tw->length = length;
+    tw->cosTab = malloc(sizeof (double) * (length / 2));
+    tw->sinTab = malloc(sizeof (double) * (length / 2));
+    if ((NULL == tw->cosTab) || (NULL == tw->sinTab)) {
+	freeFftTwiddles(tw);
+	return -1;
+    }
+    for (k = 0; k < length / 2; k++) {
+	tw->cosTab[k] = cos(TWO_PI * ((double) k) / ((double) length));
+	tw->sinTab[k] = sin(TWO_PI * ((double) k) / ((double) length));
+    }
+    return 0;
+}
+
+void freeFftTwiddles(
+    fftTwiddles_type * tw
+) {
+    const fftTwiddles_type blankTw = FFT_TWIDDLES_INIT_VAL;
+
+    if (NULL != tw->cosTab)
+	free(tw->cosTab);
+    if (NULL != tw->sinTab)
+	free(tw->sinTab);
+    *tw = blankTw;
+    return;
+}
+
+void fftRadix2(
+    double *re,
+    double *im,
+    uint64_t stride,
+    uint64_t n,
+    const fftTwiddles_type * tw,
+    int inverse
+) {
+    const double        sign = inverse ? 1.0 : -1.0;
+    uint64_t            i = 0;
+    uint64_t            j = 0;
+    uint64_t            len = 0;
+
+    for (i = 1; i < n; i++) {
+	uint64_t            bit = n >> 1;
+
+	for (; j & bit; bit >>= 1)
+	    j ^= bit;
+	j ^= bit;
+	if (i < j) {
+	    double              swap = re[i * stride];
+
+	    re[i * stride] = re[j * stride];
+	    re[j * stride] = swap;
+	    swap = im[i * stride];
+	    im[i * stride] = im[j * stride];
+	    im[j * stride] = swap;
+	}
+    }
+
+    // The twiddles for a length len butterfly are every (tw->length / len)th entry
+    for (len = 2; len <= n; len <<= 1) {
+	const uint64_t      half = len >> 1;
+	const uint64_t      twStride = tw->length / len;
+
+	for (i = 0; i < n; i += len) {
+	    uint64_t            k = 0;
+
+	    for (k = 0; k < half; k++) {
+		const double        wr = tw->cosTab[k * twStride];
+		const double        wi = sign * tw->sinTab[k * twStride];
+		double             *aRe = re + (i + k) * stride;
+		double             *aIm = im + (i + k) * stride;
+		double             *bRe = aRe + half * stride;
+		double             *bIm = aIm + half * stride;
+		const double        tr = *bRe * wr - *bIm * wi;
+		const double        ti = *bRe * wi + *bIm * wr;
+
+		*bRe = *aRe - tr;
+		*bIm = *aIm - ti;
+		*aRe += tr;
+		*aIm += ti;
+	    }
+	}
+    }
+    return;
+}
@@ -0,0 +1,68 @@
+
+/*! @file fft.h
+ * @brief The radix-2 FFT shared by the spectrum check and multitone synthesis.
+ *
+ * One twiddle table, made for the longest transform, serves every shorter power-of-two length
+ * by striding through it.  The values can be stored apart (re and im arrays) or interleaved
+ * (re, im, re, im ...); see fftRadix2().
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#include <stdint.h>
+
+/*! @brief exp(2 pi i k / length) for k < length / 2.
+ *
+ * Expected initialization found in #FFT_TWIDDLES_INIT_VAL
+ */
+typedef struct fftTwiddles {
+    uint64_t            length;	//!< Longest transform the table serves, a power of two.
+    double             *cosTab;	//!< cos(2 pi k / length).
+    double             *sinTab;	//!< sin(2 pi k / length).
+} fftTwiddles_type;
+
+#define FFT_TWIDDLES_INIT_VAL {0, NULL, NULL}	//!< Initialization data for a #fftTwiddles instantiation.
+
+/*!	@brief Fills in the twiddles for transforms of up to length values.
+ *
+ * @param[in] length A power of two, at least 2.
+ * @param[out] tw The table.  Free with freeFftTwiddles().
+ * @return 0 on success
+ * @return -1 if it couldn't be allocated.
+ */
+int                 initFftTwiddles(
+    uint64_t length,
+    fftTwiddles_type * tw
+);
+
+/*!	@brief Frees the tables from initFftTwiddles(), leaving tw as #FFT_TWIDDLES_INIT_VAL.
+ *
+ * @param[inout] tw The table to free.
+ */
+void                freeFftTwiddles(
+    fftTwiddles_type * tw
+);
+
+/*!	@brief In-place radix-2 decimation in time FFT.
+ *
+ * Value j is re[j * stride], im[j * stride], so interleaved values are re = z, im = z + 1,
+ * stride 2.
+ *
+ * @param[inout] re Real parts.
+ * @param[inout] im Imaginary parts.
+ * @param[in] stride Spacing of consecutive values in re and im.
+ * @param[in] n Number of values, a power of two no more than tw->length.
+ * @param[in] tw Twiddles from initFftTwiddles().
+ * @param[in] inverse Non-zero for the inverse transform, which is not scaled by 1 / n.
+ */
+void                fftRadix2(
+    double *re,
+    double *im,
+    uint64_t stride,
+    uint64_t n,
+    const fftTwiddles_type * tw,
+    int inverse
+);
+
+#endif
@@ -2,15 +2,18 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <float.h>
 #include <string.h>
 #include "genBinary.h"
 #include <errno.h>
 #include <ctype.h>
 #include <time.h>
-#include "../defOptions/defOptions.h"
+#include "../prng/prng.h"
+#include "../logging/probes.h"
 
 freqList_ptr blankFreqList(
 ) {
+    const pulseSweep_type blankSweep = PULSE_SWEEP_INIT_VAL;
     freqList_ptr        newList = malloc(sizeof (freqList_type));
 
     if (NULL == newList)
@@ -19,12 +22,200 @@ freqList_ptr blankFreqList(
     newList->freqCount = 0;
     newList->actualSize = 0;
     newList->freqList = NULL;
+    newList->stopList = NULL;
     newList->ampList = NULL;
     newList->durList = NULL;
+    newList->envList = NULL;
+    newList->ampSeeded = 0;
+    newList->ampSeed = 0;
+    newList->sourceKind = PULSE_SRC_LIST;
+    newList->sweep = blankSweep;
 
     return newList;
 }
 
+freqList_ptr sweepFreqList(
+    const pulseSweep_type * sweep
+) {
+    freqList_ptr        newList = NULL;
+
+    if ((NULL == sweep) || (0 == sweep->toothCount))
+	return NULL;
+    if ((PULSE_SRC_LINEAR != sweep->kind) && (PULSE_SRC_LOG != sweep->kind)
+	&& (PULSE_SRC_STEPPED != sweep->kind))
+	return NULL;
+    if ((PULSE_SRC_STEPPED == sweep->kind)
+	&& ((0 == sweep->stepCount) || (sweep->stepCount > sweep->toothCount)))
+	return NULL;
+
+    newList = blankFreqList();
+    if (NULL == newList)
+	return NULL;
+
+    newList->freqCount = sweep->toothCount;
+    newList->sourceKind = sweep->kind;
+    newList->sweep = *sweep;
+    newList->ampSeeded = sweep->randAmp;
+    newList->ampSeed = sweep->randAmp ? sweep->seed : 0;
+    return newList;
+}
+
+/* Value i of count evenly spaced from first to last, with the same arithmetic as setFreqList(). */
+static double linearPoint(
+    double first,
+    double last,
+    unsigned int count,
+    unsigned int i
+) {
+    if (i == count - 1)
+	return last;
+    if (0 == i)
+	return first;
+    return first + i * ((last - first) / ((double) (count - 1)));
+}
+
+double pulseFreq(
+    const freqList_type * list,
+    unsigned int i
+) {
+    const pulseSweep_type *sweep = &list->sweep;
+
+    switch (list->sourceKind) {
+    case PULSE_SRC_LINEAR:
+	return linearPoint(sweep->startFreq, sweep->stopFreq, sweep->toothCount, i);
+    case PULSE_SRC_LOG:
+	if (i == sweep->toothCount - 1)
+	    return sweep->stopFreq;
+	return sweep->startFreq * pow(sweep->stopFreq / sweep->startFreq,
+				      ((double) i) / ((double) (sweep->toothCount - 1)));
+    case PULSE_SRC_STEPPED:
+	return linearPoint(sweep->startFreq, sweep->stopFreq, sweep->stepCount,
+			   (unsigned int) ((((unsigned long long) i) * sweep->stepCount)
+					   / sweep->toothCount));
+    default:
+	return *(list->freqList + i);
+    }
+}
+
+double pulseStopFreq(
+    const freqList_type * list,
+    unsigned int i
+) {
+    if ((PULSE_SRC_LIST != list->sourceKind) || (NULL == list->stopList))
+	return pulseFreq(list, i);
+    return *(list->stopList + i);
+}
+
+/* The frequency a pulse is counted at, the mean of a chirp's ends.  Exactly pulseFreq() for
+ * any other pulse. */
+static double countedFreq(
+    const freqList_type * list,
+    unsigned int i
+) {
+    return 0.5 * (pulseFreq(list, i) + pulseStopFreq(list, i));
+}
+
+double pulseAmp(
+    const freqList_type * list,
+    unsigned int i
+) {
+    double              unit = 0.0;
+
+    if (PULSE_SRC_LIST == list->sourceKind)
+	return *(list->ampList + i);
+    if (!list->sweep.randAmp)
+	return list->sweep.amplitude;
+
+    // Same stream position and scaling setRandAmp() uses for pulse i
+    prngFillUnit(prngStreamKey(list->sweep.seed, 0), i, &unit, 1);
+    return 114.0 * unit / 127.0 + 13.0 / 127.0;
+}
+
+double pulseDur(
+    const freqList_type * list,
+    unsigned int i
+) {
+    if (PULSE_SRC_LIST == list->sourceKind)
+	return *(list->durList + i);
+    return list->sweep.duration;
+}
+
+int pulseEnvelope(
+    const freqList_type * list,
+    unsigned int i
+) {
+    if (PULSE_SRC_LIST != list->sourceKind)
+	return list->sweep.envelope;
+    if (NULL == list->envList)
+	return ENVELOPE_RECT;
+    return *(list->envList + i);
+}
+
+int parseEnvelopeName(
+    const char *name
+) {
+    if (0 == strcmp(name, "rect"))
+	return ENVELOPE_RECT;
+    if (0 == strcmp(name, "gauss"))
+	return ENVELOPE_GAUSS;
+    if (0 == strcmp(name, "raisedcos"))
+	return ENVELOPE_RAISEDCOS;
+    return -1;
+}
+
+const char         *envelopeName(
+    int envelope
+) {
+    switch (envelope) {
+    case ENVELOPE_GAUSS:
+	return "gauss";
+    case ENVELOPE_RAISEDCOS:
+	return "raisedcos";
+    default:
+	return "rect";
+    }
+}
+
+/* Sample i of the envelope of a numPts long pulse. */
+static double envelopeValue(
+    int envelope,
+    uint64_t numPts,
+    uint64_t i
+) {
+    const double        center = 0.5 * (((double) numPts) - 1.0);
+    const double        sigma = ((double) numPts) / ENVELOPE_GAUSS_WIDTHS;
+
+    switch (envelope) {
+    case ENVELOPE_GAUSS:
+	return exp(-0.5 * ((i - center) / sigma) * ((i - center) / sigma));
+    case ENVELOPE_RAISEDCOS:
+	return 0.5 - 0.5 * cos(TWO_PI * (i + 0.5) / ((double) numPts));
+    default:
+	return 1.0;
+    }
+}
+
+void fillEnvelope(
+    int envelope,
+    uint64_t numPts,
+    double *window
+) {
+    uint64_t            i = 0;
+
+    for (i = 0; i < numPts; i++)
+	*(window + i) = envelopeValue(envelope, numPts, i);
+    return;
+}
+
+const double       *toothEnvelope(
+    const wavePlan_type * plan,
+    unsigned int tooth
+) {
+    if ((NULL == plan->toothWindow) || (WAVE_PLAN_NO_WINDOW == *(plan->toothWindow + tooth)))
+	return NULL;
+    return plan->windowVals + *(plan->toothWindow + tooth);
+}
+
 void freeFreqList(
     freqList_ptr toFree
 ) {
@@ -32,10 +223,14 @@ void freeFreqList(
 	return;
     if (NULL != toFree->freqList)
 	free(toFree->freqList);
+    if (NULL != toFree->stopList)
+	free(toFree->stopList);
     if (NULL != toFree->ampList)
 	free(toFree->ampList);
     if (NULL != toFree->durList)
 	free(toFree->durList);
+    if (NULL != toFree->envList)
+	free(toFree->envList);
     free(toFree);
     return;
 }
@@ -56,6 +251,11 @@ int allocSubLists(
     if (NULL == toSet->durList)
 	return -1;
 
+    toSet->envList = malloc(sizeof (unsigned char) * nFreqs);
+    if (NULL == toSet->envList)
+	return -1;
+    memset(toSet->envList, ENVELOPE_RECT, nFreqs);
+
     toSet->freqCount = nFreqs;
     toSet->actualSize = nFreqs;
     return 0;
@@ -97,16 +297,19 @@ int setFixedAmp(
 }
 
 int setRandAmp(
-    freqList_ptr toSet
+    freqList_ptr toSet,
+    uint64_t seed
 ) {
     double             *listPtr = toSet->ampList;
     const unsigned int  nFreqs = toSet->freqCount;
     unsigned int        i = 0;
 
-    srand((unsigned) time(NULL));
+    prngFillUnit(prngStreamKey(seed, 0), 0, listPtr, nFreqs);
     for (i = 0; i < nFreqs; i++)
-	listPtr[i] = 114.0 * ((double) rand()) / (127.0 * (double) RAND_MAX) + 13.0 / 127.0;
+	listPtr[i] = 114.0 * listPtr[i] / 127.0 + 13.0 / 127.0;
 
+    toSet->ampSeeded = 1;
+    toSet->ampSeed = seed;
     return 0;
 }
 
@@ -124,147 +327,1070 @@ int setFixedDur(
     return 0;
 }
 
-unsigned int pointsToHalfCycle(
+uint64_t pointsToHalfCycle(
     double targetDuration,
     double pointInterval,
     double frequency
 ) {
     double              cycles = round(targetDuration * frequency * 2.0 * 0.001) / 2.0;
+    double              points = floor(1000.0 * cycles / frequency / pointInterval);
 
-    return (unsigned int) floor(1000.0 * cycles / frequency / pointInterval);
+    // Too long to convert is left for planWaveform() to reject, rather than wrapping round
+    if (!(points > 0.0))
+	return 0;
+    if (points >= 18446744073709551616.0)
+	return UINT64_MAX;
+    return (uint64_t) points;
 }
 
-unsigned int       *pointCounts(
+uint64_t           *pointCounts(
     const freqList_ptr freqList,
     const double pointInterval
 ) {
-    int                 i = 0;
-    unsigned int        totalSets = freqList->freqCount;
-    const double       *freqTable = freqList->freqList;
-    const double       *durTable = freqList->durList;
-    unsigned int       *pointCounts = NULL;
+    unsigned int        i = 0;
+    unsigned int        totalSets = 0;
+    uint64_t           *pointCounts = NULL;
 
     if (NULL == freqList)
 	return NULL;
+    totalSets = freqList->freqCount;
 
-    pointCounts = malloc(((size_t) totalSets) * sizeof (unsigned int));
+    AWG_PROBE1(point_counts_start, totalSets);
+    pointCounts = malloc(((size_t) totalSets) * sizeof (uint64_t));
     if (NULL == pointCounts) {
 	perror("pointCounts allocation");
 	return NULL;
     }
 
     for (i = 0; i < totalSets; i++) {
-	*(pointCounts + i) = pointsToHalfCycle(*(durTable + i), pointInterval, *(freqTable + i));
+	*(pointCounts + i) =
+	    pointsToHalfCycle(pulseDur(freqList, i), pointInterval, countedFreq(freqList, i));
     }
 
+    AWG_PROBE1(point_counts_done, totalSets);
     return pointCounts;
 }
 
-unsigned char      *genPointList(
+/* Sample encodings, matching sampleFormats[] below */
+#define U8_ZERO AWG_ZERO_VAL
+#define U12_ZERO 2047L
+#define STORE_U8(dest, j, code) (*((dest) + (j)) = (unsigned char) (code))
+#define LOAD_U8(src, j) ((long) *((src) + (j)))
+#define STORE_U12(dest, j, code) \
+    (*((dest) + 2 * (j)) = (unsigned char) ((code) >> 8), \
+     *((dest) + 2 * (j) + 1) = (unsigned char) ((code) & 0xFF))
+#define LOAD_U12(src, j) ((((long) *((src) + 2 * (j))) << 8) | ((long) *((src) + 2 * (j) + 1)))
+
+static const sampleFormat_type sampleFormats[SAMPLE_FORMAT_COUNT] = {
+    {"u8", 1, U8_ZERO, 127.0},
+    {"u12", 2, U12_ZERO, 2047.0}
+};
+
+const sampleFormat_type *sampleFormatInfo(
+    int sampleFormat
+) {
+    if ((sampleFormat < 0) || (sampleFormat >= SAMPLE_FORMAT_COUNT))
+	return sampleFormats + SAMPLE_FORMAT_U8;
+    return sampleFormats + sampleFormat;
+}
+
+int parseSampleFormatName(
+    const char *name
+) {
+    int                 i = 0;
+
+    for (i = 0; i < SAMPLE_FORMAT_COUNT; i++) {
+	if (0 == strcmp(name, sampleFormats[i].name))
+	    return i;
+    }
+    return -1;
+}
+
+/* A single output sample of a pulse, before it is offset and quantized.  Planning and
+ * generation both go through here, so the continuity decisions made while planning always
+ * match the generated samples. */
+static double waveValue(
+    double freq,
+    double amp,
+    uint64_t i,
+    double pointInterval
+) {
+    return amp * sin(freq * ((double) i) * pointInterval * TWO_PI * 0.001);
+}
+
+/* Samples in one exact period of a pulse, if its frequency is a rational multiple of the
+ * clock with a denominator of at most TILE_PERIOD_MAX, otherwise 0.
+ *
+ * The smallest such period is the denominator of one of the continued fraction convergents of
+ * the cycles per sample, so only those are tried.  A convergent counts if it is as close as
+ * the rounding in the cycles per sample can explain. */
+static uint64_t samplePeriod(
+    double freq,
+    double pointInterval
+) {
+    const double        cycles = fabs(freq * pointInterval * 0.001);
+    double              rest = cycles;
+    double              num = 1.0;
+    double              den = 0.0;
+    double              prevNum = 0.0;
+    double              prevDen = 1.0;
+    int                 terms = 0;
+
+    if (!isfinite(cycles))
+	return 0;
+    for (terms = 0; terms < 64; terms++) {
+	const double        term = floor(rest);
+	const double        nextNum = term * num + prevNum;
+	const double        nextDen = term * den + prevDen;
+	const double        tolerance = 16.0 * DBL_EPSILON * ((nextNum > 1.0) ? nextNum : 1.0);
+
+	if (nextDen > (double) TILE_PERIOD_MAX)
+	    return 0;
+	if (fabs(cycles * nextDen - nextNum) <= tolerance)
+	    return (uint64_t) nextDen;
+	if (rest == term)
+	    return 0;
+	rest = 1.0 / (rest - term);
+	prevNum = num;
+	prevDen = den;
+	num = nextNum;
+	den = nextDen;
+    }
+    return 0;
+}
+
+/* Where sample i of a pulse falls within its exact period, if it has one.  Every sample's
+ * phase is taken from this, so a period can be copied instead of generated with identical
+ * results, and the long pulses lose nothing to rounding in large phases. */
+static uint64_t periodIndex(
+    double freq,
+    double pointInterval,
+    uint64_t i
+) {
+    const uint64_t      period = samplePeriod(freq, pointInterval);
+
+    return (0 != period) ? i % period : i;
+}
+
+/* Fills dest[filled, total) by repeating dest[0, filled). */
+static void tileBytes(
+    unsigned char *dest,
+    size_t filled,
+    size_t total
+) {
+    while ((filled > 0) && (filled < total)) {
+	const size_t        run = (filled < total - filled) ? filled : total - filled;
+
+	memcpy(dest + filled, dest, run);
+	filled += run;
+    }
+    return;
+}
+
+/* A linear chirp, as its phase in cycles at sample n, rate n + accel n^2.  The step in phase
+ * from one sample to the next turns by exp(4 pi i accel) each sample. */
+typedef struct chirp {
+    double              rate;
+    double              accel;
+    double              turnRe;
+    double              turnIm;
+} chirp_type;
+
+/* A chirp's phase and per-sample step, as unit complex numbers, at the current sample. */
+typedef struct chirpState {
+    double              re;
+    double              im;
+    double              stepRe;
+    double              stepIm;
+} chirpState_type;
+
+/* The chirp from startFreq to stopFreq that covers the half cycles pointsToHalfCycle() rounds
+ * duration to at the mean frequency, so it reaches stopFreq at the same zero crossing a
+ * constant pulse of that length would end on. */
+static chirp_type chirpFor(
+    double startFreq,
+    double stopFreq,
+    double duration,
+    double pointInterval
+) {
+    const double        meanFreq = 0.5 * (startFreq + stopFreq);
+    const double        cycles = round(duration * meanFreq * 2.0 * 0.001) / 2.0;
+    const double        span = 1000.0 * cycles / meanFreq / pointInterval;
+    chirp_type          chirp;
+
+    chirp.rate = startFreq * pointInterval * 0.001;
+    chirp.accel = (span > 0.0) ? (stopFreq - startFreq) * pointInterval * 0.001 / (2.0 * span)
+	: 0.0;
+    chirp.turnRe = cos(2.0 * TWO_PI * chirp.accel);
+    chirp.turnIm = sin(2.0 * TWO_PI * chirp.accel);
+    return chirp;
+}
+
+/* Starts the recurrence exactly at sample n.  Phases are reduced to one cycle before the
+ * trigonometry, so long chirps keep their precision. */
+static void chirpSeed(
+    const chirp_type * chirp,
+    uint64_t n,
+    chirpState_type * state
+) {
+    const double        at = (double) n;
+    double              phase = chirp->rate * at + chirp->accel * at * at;
+    double              step = chirp->rate + chirp->accel * (2.0 * at + 1.0);
+
+    phase -= floor(phase);
+    step -= floor(step);
+    state->re = cos(TWO_PI * phase);
+    state->im = sin(TWO_PI * phase);
+    state->stepRe = cos(TWO_PI * step);
+    state->stepIm = sin(TWO_PI * step);
+    return;
+}
+
+/* Moves the recurrence on one sample, with two complex multiplies. */
+static void chirpAdvance(
+    const chirp_type * chirp,
+    chirpState_type * state
+) {
+    const double        re = state->re * state->stepRe - state->im * state->stepIm;
+    const double        stepRe = state->stepRe * chirp->turnRe - state->stepIm * chirp->turnIm;
+
+    state->im = state->re * state->stepIm + state->im * state->stepRe;
+    state->re = re;
+    state->stepIm = state->stepRe * chirp->turnIm + state->stepIm * chirp->turnRe;
+    state->stepRe = stepRe;
+    return;
+}
+
+/* Stamps out the sample loops for one format.  Each format gets its own copy, with its
+ * encoding inlined, so none of them branch on the format per sample.
+ *
+ * genRun stores samples [first, first + run) of a pulse of amplitude amp (in output steps),
+ * shaped by window if it isn't NULL.  An unshaped pulse with an exact period of fewer samples
+ * than run only has one period generated, which is then copied over the rest.
+ *
+ * genChirp does the same for a chirp.  The recurrence is always started at a multiple of
+ * CHIRP_BLOCK_POINTS, stepping up to first if it isn't one, so every sample comes out the
+ * same however the pulse is split into runs. */
+#define SAMPLE_KERNELS(SFX, WIDTH, ZERO, STORE, LOAD) \
+static void genRun##SFX( \
+    double freq, \
+    double amp, \
+    const double *window, \
+    uint64_t first, \
+    uint64_t run, \
+    double pointInterval, \
+    unsigned char *dest \
+) { \
+    const uint64_t      period = samplePeriod(freq, pointInterval); \
+    uint64_t            phase = (0 != period) ? first % period : first; \
+    uint64_t            j = 0; \
+ \
+    if (NULL == window) { \
+	const uint64_t      direct = ((0 != period) && (run > period)) ? period : run; \
+ \
+	for (j = 0; j < direct; j++) { \
+	    STORE(dest, j, (long) round(waveValue(freq, amp, phase, pointInterval) \
+				      + ((double) (ZERO)))); \
+	    if (++phase == period) \
+		phase = 0; \
+	} \
+	tileBytes(dest, (size_t) direct * (WIDTH), (size_t) run * (WIDTH)); \
+    } else { \
+	for (j = 0; j < run; j++) { \
+	    STORE(dest, j, (long) round(waveValue(freq, amp * *(window + first + j), phase, \
+						pointInterval) + ((double) (ZERO)))); \
+	    if (++phase == period) \
+		phase = 0; \
+	} \
+    } \
+    return; \
+} \
+ \
+static void genChirp##SFX( \
+    const chirp_type * chirp, \
+    double amp, \
+    const double *window, \
+    uint64_t first, \
+    uint64_t run, \
+    unsigned char *dest \
+) { \
+    chirpState_type     state; \
+    uint64_t            n = first - first % CHIRP_BLOCK_POINTS; \
+    uint64_t            j = 0; \
+ \
+    chirpSeed(chirp, n, &state); \
+    for (; n < first; n++) \
+	chirpAdvance(chirp, &state); \
+    for (j = 0; j < run; j++, n++) { \
+	const double        gain = (NULL == window) ? amp : amp * *(window + first + j); \
+ \
+	if (0 == n % CHIRP_BLOCK_POINTS) \
+	    chirpSeed(chirp, n, &state); \
+	STORE(dest, j, (long) round(gain * state.im + ((double) (ZERO)))); \
+	chirpAdvance(chirp, &state); \
+    } \
+    return; \
+} \
+ \
+static void invert##SFX( \
+    const unsigned char *src, \
+    uint64_t count, \
+    unsigned char *dest \
+) { \
+    uint64_t            j = 0; \
+ \
+    for (j = 0; j < count; j++) \
+	STORE(dest, j, (2 * (ZERO)) - LOAD(src, j)); \
+    return; \
+} \
+ \
+static void decode##SFX( \
+    const unsigned char *src, \
+    uint64_t count, \
+    double fullScale, \
+    double *dest \
+) { \
+    uint64_t            j = 0; \
+ \
+    for (j = 0; j < count; j++) \
+	*(dest + j) = ((double) (LOAD(src, j) - (ZERO))) / fullScale; \
+    return; \
+} \
+ \
+static void encode##SFX( \
+    const double *src, \
+    uint64_t count, \
+    double fullScale, \
+    unsigned char *dest \
+) { \
+    uint64_t            j = 0; \
+ \
+    for (j = 0; j < count; j++) { \
+	double              level = *(src + j); \
+ \
+	level = (level > 1.0) ? 1.0 : ((level < -1.0) ? -1.0 : level); \
+	STORE(dest, j, (long) round(level * fullScale + ((double) (ZERO)))); \
+    } \
+    return; \
+}
+
+SAMPLE_KERNELS(U8, 1, U8_ZERO, STORE_U8, LOAD_U8)
+SAMPLE_KERNELS(U12, 2, U12_ZERO, STORE_U12, LOAD_U12)
+
+/* The loops for each format, in @ref SampleFormats order */
+typedef struct sampleKernels {
+    void                (*genRun) (double, double, const double *, uint64_t, uint64_t,
+				   double, unsigned char *);
+    void                (*genChirp) (const chirp_type *, double, const double *, uint64_t,
+				     uint64_t, unsigned char *);
+    void                (*invert) (const unsigned char *, uint64_t, unsigned char *);
+    void                (*decode) (const unsigned char *, uint64_t, double, double *);
+    void                (*encode) (const double *, uint64_t, double, unsigned char *);
+} sampleKernels_type;
+
+static const sampleKernels_type sampleKernels[SAMPLE_FORMAT_COUNT] = {
+    {genRunU8, genChirpU8, invertU8, decodeU8, encodeU8},
+    {genRunU12, genChirpU12, invertU12, decodeU12, encodeU12}
+};
+
+static const sampleKernels_type *kernelsFor(
+    int sampleFormat
+) {
+    if ((sampleFormat < 0) || (sampleFormat >= SAMPLE_FORMAT_COUNT))
+	return sampleKernels + SAMPLE_FORMAT_U8;
+    return sampleKernels + sampleFormat;
+}
+
+/* Whether a sample of the given value, before offset and quantizing, is stored below zero. */
+static int belowZero(
+    int sampleFormat,
+    double value
+) {
+    const double        zero = (double) sampleFormatInfo(sampleFormat)->zeroVal;
+
+    return round(value + zero) < zero;
+}
+
+void invertSamples(
+    int sampleFormat,
+    const unsigned char *src,
+    uint64_t count,
+    unsigned char *dest
+) {
+    kernelsFor(sampleFormat)->invert(src, count, dest);
+    return;
+}
+
+void decodeSamples(
+    int sampleFormat,
+    const unsigned char *src,
+    uint64_t count,
+    double *dest
+) {
+    kernelsFor(sampleFormat)->decode(src, count, sampleFormatInfo(sampleFormat)->fullScale, dest);
+    return;
+}
+
+void encodeSamples(
+    int sampleFormat,
+    const double *src,
+    uint64_t count,
+    unsigned char *dest
+) {
+    kernelsFor(sampleFormat)->encode(src, count, sampleFormatInfo(sampleFormat)->fullScale, dest);
+    return;
+}
+
+/* Open addressing index from (envelope, length) to a table's offset in windowVals */
+typedef struct windowIndex {
+    uint64_t           *keys;	     // length << 8 | envelope, 0 for an empty slot
+    uint64_t           *offsets;
+    uint64_t            mask;	     // Slot count - 1, the count being a power of two
+    uint64_t            used;
+} windowIndex_type;
+
+static uint64_t windowSlot(
+    const windowIndex_type * index,
+    uint64_t key
+) {
+    uint64_t            slot = (uint64_t) ((key * PRNG_GAMMA) >> 32) & index->mask;
+
+    while ((0 != *(index->keys + slot)) && (key != *(index->keys + slot)))
+	slot = (slot + 1) & index->mask;
+    return slot;
+}
+
+/* Doubles the slot count, keeping every entry. */
+static int growWindowIndex(
+    windowIndex_type * index
+) {
+    windowIndex_type    grown;
+    uint64_t            i = 0;
+
+    grown.mask = 2 * index->mask + 1;
+    grown.used = index->used;
+    grown.keys = calloc(grown.mask + 1, sizeof (uint64_t));
+    grown.offsets = malloc(sizeof (uint64_t) * (grown.mask + 1));
+    if ((NULL == grown.keys) || (NULL == grown.offsets)) {
+	if (NULL != grown.keys)
+	    free(grown.keys);
+	if (NULL != grown.offsets)
+	    free(grown.offsets);
+	return -1;
+    }
+    for (i = 0; i <= index->mask; i++) {
+	if (0 != *(index->keys + i)) {
+	    uint64_t            slot = windowSlot(&grown, *(index->keys + i));
+
+	    *(grown.keys + slot) = *(index->keys + i);
+	    *(grown.offsets + slot) = *(index->offsets + i);
+	}
+    }
+    free(index->keys);
+    free(index->offsets);
+    *index = grown;
+    return 0;
+}
+
+/* Points toothWindow at a table for every shaped pulse, making one table per distinct
+ * envelope and length.  Leaves both arrays NULL if no pulse is shaped. */
+static int planEnvelopes(
     const freqList_ptr freqList,
-    const unsigned int *pointCounts,
-    const double pointInterval,
-    unsigned long *finalCount
+    const uint64_t *pointCounts,
+    wavePlan_type * plan
+) {
+    const unsigned int  totalSets = freqList->freqCount;
+    windowIndex_type    index;
+    uint64_t            valsUsed = 0;
+    uint64_t            valsSize = 0;
+    unsigned int        i = 0;
+    int                 retVal = 0;
+
+    for (i = 0; i < totalSets; i++) {
+	if (ENVELOPE_RECT != pulseEnvelope(freqList, i))
+	    break;
+    }
+    if (i == totalSets)
+	return 0;
+
+    plan->toothWindow = malloc(sizeof (uint64_t) * ((size_t) totalSets));
+    index.mask = 63;
+    index.used = 0;
+    index.keys = calloc(index.mask + 1, sizeof (uint64_t));
+    index.offsets = malloc(sizeof (uint64_t) * (index.mask + 1));
+    if ((NULL == plan->toothWindow) || (NULL == index.keys) || (NULL == index.offsets))
+	retVal = -1;
+
+    for (i = 0; (i < totalSets) && !retVal; i++) {
+	const int           envelope = pulseEnvelope(freqList, i);
+	const uint64_t      numPts = *(pointCounts + i);
+	uint64_t            key = (numPts << 8) | ((uint64_t) envelope);
+	uint64_t            slot = 0;
+
+	*(plan->toothWindow + i) = WAVE_PLAN_NO_WINDOW;
+	if ((ENVELOPE_RECT == envelope) || (0 == numPts))
+	    continue;
+
+	slot = windowSlot(&index, key);
+	if (0 == *(index.keys + slot)) {
+	    // First pulse with this envelope and length, make its table
+	    if (valsUsed + numPts > valsSize) {
+		uint64_t            newSize = 2 * valsSize + numPts;
+		double             *newVals = NULL;
+
+		if (newSize <= SIZE_MAX / sizeof (double))
+		    newVals = realloc(plan->windowVals, sizeof (double) * newSize);
+		if (NULL == newVals) {
+		    retVal = -1;
+		    break;
+		}
+		plan->windowVals = newVals;
+		valsSize = newSize;
+	    }
+	    fillEnvelope(envelope, numPts, plan->windowVals + valsUsed);
+	    *(index.keys + slot) = key;
+	    *(index.offsets + slot) = valsUsed;
+	    valsUsed += numPts;
+	    index.used++;
+	}
+	*(plan->toothWindow + i) = *(index.offsets + slot);
+	if ((2 * index.used > index.mask) && growWindowIndex(&index))
+	    retVal = -1;
+    }
+
+    if (NULL != index.keys)
+	free(index.keys);
+    if (NULL != index.offsets)
+	free(index.offsets);
+    if (retVal)
+	perror("planEnvelopes allocation");
+    return retVal;
+}
+
+/* Sign the pulse after pulse i starts with, given the sign pulse i was played with.  Only the
+ * last sample of pulse i is evaluated. */
+static double nextToothFlip(
+    const freqList_ptr freqList,
+    unsigned int i,
+    uint64_t numPts,
+    double lastFlip,
+    double pointInterval,
+    int sampleFormat
+) {
+    const int           envelope = pulseEnvelope(freqList, i);
+    double              amp = pulseAmp(freqList, i) * lastFlip
+	* sampleFormatInfo(sampleFormat)->fullScale;
+
+    if (0 == numPts)
+	return lastFlip;
+    if (ENVELOPE_RECT != envelope)
+	amp *= envelopeValue(envelope, numPts, numPts - 1);
+    if (pulseStopFreq(freqList, i) != pulseFreq(freqList, i)) {
+	// The recurrence is the only way to get the sample exactly as generated
+	const chirp_type    chirp = chirpFor(pulseFreq(freqList, i), pulseStopFreq(freqList, i),
+					 pulseDur(freqList, i), pointInterval);
+	unsigned char       last[SAMPLE_MAX_WIDTH];
+	double              lastVal = 0.0;
+
+	kernelsFor(sampleFormat)->genChirp(&chirp, amp, NULL, numPts - 1, 1, last);
+	decodeSamples(sampleFormat, last, 1, &lastVal);
+	return (lastVal < 0.0) ? 1.0 : -1.0;
+    }
+    return belowZero(sampleFormat,
+		     waveValue(pulseFreq(freqList, i), amp,
+			       periodIndex(pulseFreq(freqList, i), pointInterval, numPts - 1),
+			       pointInterval)) ? 1.0 : -1.0;
+}
+
+/* Doublings needed to make unitPoints a multiple of 32. */
+static int shiftsToMultipleOf32(
+    uint64_t unitPoints
 ) {
     int                 numShifts = 0;
-    int                 i = 0;
-    unsigned long       totalPoints = 0;
-    const double       *freqTable = freqList->freqList;
-    const double       *ampTable = freqList->ampList;
-    unsigned char      *pointVals = NULL;
-    unsigned char      *fillPos = NULL;
+
+    if ((unitPoints % 32) != 0) {
+	numShifts = 1;
+	while ((unitPoints << numShifts) & 0x1F)
+	    numShifts++;
+    }
+    return numShifts;
+}
+
+int finalWaveLength(
+    uint64_t basePoints,
+    int flipCopy,
+    int *numShifts,
+    uint64_t *finalCount
+) {
+    uint64_t            unitPoints = basePoints;
+
+    if (flipCopy) {
+	if (basePoints > MAX_FINAL_POINTS / 2)
+	    return -1;
+	unitPoints *= 2;
+    }
+    *numShifts = shiftsToMultipleOf32(unitPoints);
+    if (unitPoints > (MAX_FINAL_POINTS >> *numShifts))
+	return -1;
+    *finalCount = unitPoints << *numShifts;
+    return 0;
+}
+
+int measureWaveform(
+    const freqList_ptr freqList,
+    const double pointInterval,
+    int sampleFormat,
+    uint64_t *finalCount,
+    double *durError
+) {
+    unsigned int        i = 0;
+    uint64_t            totalPoints = 0;
     double              lastFlip = 1.0;
+    double              errSum = 0.0;
+    int                 numShifts = 0;
+
+    if ((NULL == freqList) || (NULL == finalCount))
+	return -1;
 
-    // Allocate an array big enough for the whole waveform, single-pass
     for (i = 0; i < freqList->freqCount; i++) {
-	totalPoints += *(pointCounts + i);
+	const double        dur = pulseDur(freqList, i);
+	const uint64_t      numPts =
+	    pointsToHalfCycle(dur, pointInterval, countedFreq(freqList, i));
+	const double        diff = ((double) numPts) * pointInterval - dur;
+
+	if (numPts > MAX_FINAL_POINTS - totalPoints)
+	    return -1;
+	lastFlip = nextToothFlip(freqList, i, numPts, lastFlip, pointInterval, sampleFormat);
+	totalPoints += numPts;
+	errSum += diff * diff;
     }
-    if (g_opt_debug)
-	printf("Filled pointCounts\n");
+    if (finalWaveLength(totalPoints, (lastFlip < 0.0), &numShifts, finalCount))
+	return -1;
+    if (NULL != durError)
+	*durError = (0 == freqList->freqCount) ? 0.0 : sqrt(errSum / freqList->freqCount);
+    return 0;
+}
 
-    pointVals = malloc(sizeof (unsigned char) * totalPoints);
-    if (NULL == pointVals)
-	return NULL;
+int planWaveform(
+    const freqList_ptr freqList,
+    const uint64_t *pointCounts,
+    const double pointInterval,
+    int sampleFormat,
+    wavePlan_type * plan
+) {
+    unsigned int        i = 0;
+    unsigned int        totalSets = 0;
+    uint64_t            totalPoints = 0;
+    double              lastFlip = 1.0;
+
+    if ((NULL == freqList) || (NULL == pointCounts) || (NULL == plan))
+	return -1;
 
-    // Generate the points for each pulse in the train
-    fillPos = pointVals;
-    if (g_opt_debug)
-	printf("Alloc pointVals\n");
+    totalSets = freqList->freqCount;
 
-    for (i = 0; i < freqList->freqCount; i++) {
-	fillPos =
-	    genWavePts(*(freqTable + i), *(ampTable + i) * lastFlip * 127.0, *(pointCounts + i),
-		       pointInterval, fillPos);
-	lastFlip = *(fillPos - 1) < AWG_ZERO_VAL ? 1.0 : -1.0;
+    plan->toothStart = malloc(sizeof (uint64_t) * (((size_t) totalSets) + 1));
+    plan->toothSign = malloc(sizeof (signed char) * (((size_t) totalSets) + 1));
+    if ((NULL == plan->toothStart) || (NULL == plan->toothSign)) {
+	perror("planWaveform allocation");
+	freeWavePlan(plan);
+	return -1;
+    }
+    // Walk the pulses, only evaluating the last sample of each to find the next sign
+    for (i = 0; i < totalSets; i++) {
+	if (*(pointCounts + i) > MAX_FINAL_POINTS - totalPoints) {
+	    logMessage(LOG_ERROR, "The waveform is too long to count, at pulse %u.\n", i);
+	    freeWavePlan(plan);
+	    return -1;
+	}
+	*(plan->toothStart + i) = totalPoints;
+	*(plan->toothSign + i) = (lastFlip < 0.0) ? -1 : 1;
+	lastFlip = nextToothFlip(freqList, i, *(pointCounts + i), lastFlip, pointInterval,
+				 sampleFormat);
+	totalPoints += *(pointCounts + i);
+    }
+    *(plan->toothStart + totalSets) = totalPoints;
+    *(plan->toothSign + totalSets) = (lastFlip < 0.0) ? -1 : 1;
+
+    // Same continuity and multiple-of-32 rules genPointList() applies
+    plan->flipCopy = (lastFlip < 0.0);
+    if (finalWaveLength(totalPoints, plan->flipCopy, &plan->numShifts, &plan->finalCount)) {
+	logMessage(LOG_ERROR, "The waveform is too long to count once repeated.\n");
+	freeWavePlan(plan);
+	return -1;
+    }
+    // Envelope tables last, only once the lengths are known to be sane
+    if (planEnvelopes(freqList, pointCounts, plan)) {
+	freeWavePlan(plan);
+	return -1;
     }
-    if (g_opt_debug)
-	printf("Total points after cont. check: %lu\n", totalPoints);
+    plan->toothCount = totalSets;
+    plan->basePoints = totalPoints;
+    plan->pointInterval = pointInterval;
+    plan->sampleFormat = sampleFormat;
+    return 0;
+}
 
-    // Check if the end of the last pulse will be continuous when the waveform repeats
-    // If not, duplicate it, flip it, and attach it to the end.
-    if (g_opt_debug)
-	printf("last flip: %f\n", lastFlip);
-    if (lastFlip < 0.0) {
-	pointVals = realloc(pointVals, sizeof (unsigned char) * totalPoints * 2);
-	if (NULL == pointVals)
-	    return NULL;
+void freeWavePlan(
+    wavePlan_type * plan
+) {
+    const wavePlan_type blankPlan = WAVE_PLAN_INIT_VAL;
 
-	// TODO: WTF is going on here?  How does this do anything that makes sense?
-	for (i = 0; i < totalPoints; i++)
-	    *(pointVals + totalPoints + i) = (-1 * (int) *(pointVals + i)) + (2 * AWG_ZERO_VAL);
-	totalPoints *= 2;
+    if (NULL == plan)
+	return;
+    if (NULL != plan->toothStart)
+	free(plan->toothStart);
+    if (NULL != plan->toothSign)
+	free(plan->toothSign);
+    if (NULL != plan->windowVals)
+	free(plan->windowVals);
+    if (NULL != plan->toothWindow)
+	free(plan->toothWindow);
+    *plan = blankPlan;
+    return;
+}
+
+/* Index of the last pulse starting at or before basePos. */
+static unsigned int toothAt(
+    const wavePlan_type * plan,
+    uint64_t basePos
+) {
+    unsigned int        lo = 0;
+    unsigned int        hi = plan->toothCount;
+
+    while (hi - lo > 1) {
+	unsigned int        mid = lo + (hi - lo) / 2;
+
+	if (*(plan->toothStart + mid) <= basePos)
+	    lo = mid;
+	else
+	    hi = mid;
     }
+    return lo;
+}
 
-    if (g_opt_debug)
-	printf("Total points after cont. check: %lu\n", totalPoints);
+/* The marker point on the first sample of a pulse; every other sample's is 0. */
+static unsigned char toothMarker(
+    const wavePlan_type * plan,
+    unsigned int tooth
+) {
+    if ((MARKER_TOOTH == plan->markerMode)
+	|| ((MARKER_START == plan->markerMode) && (0 == *(plan->toothStart + tooth))))
+	return AWG_MARKER1_VAL;
+    return 0;
+}
 
-    // Duplicate the waveform as often as necessary to make the total length a multiple of 32.
-    if ((totalPoints % 32) != 0) {
-	numShifts = 1;
-	while ((totalPoints << numShifts) & 0x1F) {
-	    if (g_opt_debug)
-		printf("Mod 32: %lu\n", (totalPoints << numShifts) % 32);
-	    numShifts++;
+/* Generates samples [basePos, basePos + count) of the base pulse train.
+ * If markDest is not NULL, the matching marker points are stored in the same pass. */
+static void genBaseRange(
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    uint64_t basePos,
+    uint64_t count,
+    unsigned char *dest,
+    unsigned char *markDest
+) {
+    const sampleFormat_type *format = sampleFormatInfo(plan->sampleFormat);
+    const sampleKernels_type *kernels = kernelsFor(plan->sampleFormat);
+    unsigned int        tooth = 0;
+
+    for (tooth = toothAt(plan, basePos); (count > 0) && (tooth < plan->toothCount); tooth++) {
+	const double        freq = pulseFreq(freqList, tooth);
+	const double        stopFreq = pulseStopFreq(freqList, tooth);
+	const double        amp =
+	    pulseAmp(freqList, tooth) * ((double) *(plan->toothSign + tooth)) * format->fullScale;
+	const double       *window = toothEnvelope(plan, tooth);
+	uint64_t            first = basePos - *(plan->toothStart + tooth);
+	uint64_t            run = *(plan->toothStart + tooth + 1) - basePos;
+
+	if (run > count)
+	    run = count;
+	// The envelope multiply rides along in the same loop as the samples
+	AWG_PROBE3(tooth_start, tooth, first, run);
+	if (stopFreq != freq) {
+	    const chirp_type    chirp = chirpFor(freq, stopFreq, pulseDur(freqList, tooth),
+					     plan->pointInterval);
+
+	    kernels->genChirp(&chirp, amp, window, first, run, dest);
+	} else {
+	    kernels->genRun(freq, amp, window, first, run, plan->pointInterval, dest);
+	}
+	AWG_PROBE3(tooth_done, tooth, first, run);
+	if (NULL != markDest) {
+	    memset(markDest, 0, run);
+	    if ((0 == first) && (run > 0))
+		*markDest = toothMarker(plan, tooth);
+	    markDest += run;
 	}
-	if (g_opt_debug)
-	    printf("Mod 32: %lu\n", (totalPoints << numShifts) % 32);
-	if (g_opt_debug)
-	    printf("Shift count: %d, to %lu\n", numShifts, totalPoints << numShifts);
+	dest += run * format->width;
+	basePos += run;
+	count -= run;
+    }
+    return;
+}
 
-	pointVals = realloc(pointVals, sizeof (unsigned char) * totalPoints * (1 << numShifts));
-	if (NULL == pointVals)
-	    return NULL;
+int genPointRange(
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    uint64_t start,
+    uint64_t count,
+    unsigned char *dest
+) {
+    const uint64_t      basePoints = plan->basePoints;
+    const uint64_t      unitPoints = plan->flipCopy ? 2 * basePoints : basePoints;
+    const unsigned int  width = sampleFormatInfo(plan->sampleFormat)->width;
+
+    if ((start > plan->finalCount) || (count > plan->finalCount - start))
+	return -1;
+
+    while (count > 0) {
+	uint64_t            unitPos = start % unitPoints;
+	int                 inverted = (unitPos >= basePoints);
+	uint64_t            basePos = inverted ? unitPos - basePoints : unitPos;
+	uint64_t            run = basePoints - basePos;
+
+	if (run > count)
+	    run = count;
+	genBaseRange(freqList, plan, basePos, run, dest, NULL);
+	if (inverted)
+	    invertSamples(plan->sampleFormat, dest, run, dest);
+	dest += run * width;
+	start += run;
+	count -= run;
+    }
+    return 0;
+}
 
-	for (i = 0; i < numShifts; i++) {
-	    if (g_opt_debug)
-		printf("Copy level %d\n", i);
-	    memcpy(pointVals + (1 << i) * totalPoints, pointVals,
-		   sizeof (unsigned char) * (1 << i) * totalPoints);
+int copyPointRange(
+    const wavePlan_type * plan,
+    const unsigned char *baseVals,
+    uint64_t start,
+    uint64_t count,
+    unsigned char *dest
+) {
+    const uint64_t      basePoints = plan->basePoints;
+    const uint64_t      unitPoints = plan->flipCopy ? 2 * basePoints : basePoints;
+    const unsigned int  width = sampleFormatInfo(plan->sampleFormat)->width;
+
+    if ((start > plan->finalCount) || (count > plan->finalCount - start))
+	return -1;
+
+    while (count > 0) {
+	uint64_t            unitPos = start % unitPoints;
+	int                 inverted = (unitPos >= basePoints);
+	uint64_t            basePos = inverted ? unitPos - basePoints : unitPos;
+	uint64_t            run = basePoints - basePos;
+
+	if (run > count)
+	    run = count;
+	if (inverted)
+	    invertSamples(plan->sampleFormat, baseVals + basePos * width, run, dest);
+	else
+	    memcpy(dest, baseVals + basePos * width, run * width);
+	dest += run * width;
+	start += run;
+	count -= run;
+    }
+    return 0;
+}
+
+/* Marker points [basePos, basePos + count) of the base pulse train. */
+static void markBaseRange(
+    const wavePlan_type * plan,
+    uint64_t basePos,
+    uint64_t count,
+    unsigned char *dest
+) {
+    unsigned int        tooth = 0;
+
+    memset(dest, 0, count);
+    for (tooth = toothAt(plan, basePos); tooth < plan->toothCount; tooth++) {
+	uint64_t            toothPos = *(plan->toothStart + tooth);
+
+	if (toothPos >= basePos + count)
+	    break;
+	// Zero length pulses share their start with the next one, which wins
+	if ((toothPos >= basePos) && (toothPos < *(plan->toothStart + tooth + 1)))
+	    *(dest + (toothPos - basePos)) = toothMarker(plan, tooth);
+    }
+    return;
+}
+
+int genMarkerRange(
+    const wavePlan_type * plan,
+    uint64_t start,
+    uint64_t count,
+    unsigned char *dest
+) {
+    const uint64_t      basePoints = plan->basePoints;
+    const uint64_t      unitPoints = plan->flipCopy ? 2 * basePoints : basePoints;
+
+    if ((start > plan->finalCount) || (count > plan->finalCount - start))
+	return -1;
+
+    // The inverted copy has its pulses in the same places, so only the position matters
+    while (count > 0) {
+	uint64_t            unitPos = start % unitPoints;
+	uint64_t            basePos = (unitPos >= basePoints) ? unitPos - basePoints : unitPos;
+	uint64_t            run = basePoints - basePos;
+
+	if (run > count)
+	    run = count;
+	markBaseRange(plan, basePos, run, dest);
+	dest += run;
+	start += run;
+	count -= run;
+    }
+    return 0;
+}
+
+unsigned char      *genPointList(
+    const freqList_ptr freqList,
+    const uint64_t *pointCounts,
+    const double pointInterval,
+    int sampleFormat,
+    int markerMode,
+    uint64_t *finalCount,
+    unsigned char **markerList
+) {
+    const unsigned int  width = sampleFormatInfo(sampleFormat)->width;
+    int                 i = 0;
+    uint64_t            totalPoints = 0;
+    uint64_t            copied = 0;
+    unsigned char      *pointVals = NULL;
+    unsigned char      *markVals = NULL;
+    wavePlan_type       plan = WAVE_PLAN_INIT_VAL;
+
+    AWG_PROBE1(gen_list_start, freqList->freqCount);
+    // Work out the whole layout first, so the array is allocated once at its final size
+    if (planWaveform(freqList, pointCounts, pointInterval, sampleFormat, &plan))
+	return NULL;
+    plan.markerMode = markerMode;
+    logMessage(LOG_DEBUG, "Planned %" PRIu64 " base points\n", plan.basePoints);
+
+    // The whole waveform is held in memory here, so it has to fit in the address space
+    if (plan.finalCount > SIZE_MAX / width) {
+	logMessage(LOG_ERROR, "%" PRIu64 " points won't fit in memory, try --pipeline.\n",
+		   plan.finalCount);
+	freeWavePlan(&plan);
+	return NULL;
+    }
+    pointVals = malloc(sizeof (unsigned char) * plan.finalCount * width);
+    if (NULL == pointVals) {
+	freeWavePlan(&plan);
+	return NULL;
+    }
+    if (MARKER_NONE != markerMode) {
+	markVals = malloc(sizeof (unsigned char) * plan.finalCount);
+	if (NULL == markVals) {
+	    free(pointVals);
+	    freeWavePlan(&plan);
+	    return NULL;
 	}
     }
+    logMessage(LOG_DEBUG, "Alloc pointVals\n");
+
+    // Generate the points for each pulse in the train, and their markers alongside
+    totalPoints = plan.basePoints;
+    if ((plan.basePoints > 0) && (plan.toothCount > 0))
+	genBaseRange(freqList, &plan, 0, totalPoints, pointVals, markVals);
+
+    // Check if the end of the last pulse will be continuous when the waveform repeats
+    // If not, duplicate it, flip it, and attach it to the end.
+    logMessage(LOG_DEBUG, "last flip: %f\n", plan.flipCopy ? -1.0 : 1.0);
+    if (plan.flipCopy) {
+	AWG_PROBE1(flip_start, totalPoints);
+	// Mirror each point about zero, so the copy starts where the original ended
+	invertSamples(sampleFormat, pointVals, totalPoints, pointVals + totalPoints * width);
+	// Markers aren't inverted, the pulses start in the same places
+	if (NULL != markVals)
+	    memcpy(markVals + totalPoints, markVals, totalPoints);
+	totalPoints *= 2;
+	AWG_PROBE1(flip_done, totalPoints);
+    }
+
+    logMessage(LOG_DEBUG, "Total points after cont. check: %" PRIu64 "\n", totalPoints);
 
-    *finalCount = (1 << numShifts) * totalPoints;
-    if (!g_opt_quiet)
-	printf("Final point count %lu\n", *finalCount);
+    // Duplicate the waveform as often as necessary to make the total length a multiple of 32.
+    logMessage(LOG_DEBUG, "Shift count: %d, to %" PRIu64 "\n", plan.numShifts, plan.finalCount);
+    for (i = 0, copied = totalPoints; i < plan.numShifts; i++, copied *= 2) {
+	logMessage(LOG_DEBUG, "Copy level %d\n", i);
+	AWG_PROBE2(repeat_start, i, copied);
+	memcpy(pointVals + copied * width, pointVals, sizeof (unsigned char) * copied * width);
+	if (NULL != markVals)
+	    memcpy(markVals + copied, markVals, sizeof (unsigned char) * copied);
+	AWG_PROBE1(repeat_done, 2 * copied);
+    }
+
+    *finalCount = plan.finalCount;
+    if (NULL != markerList)
+	*markerList = markVals;
+    freeWavePlan(&plan);
+    logMessage(LOG_INFO, "Final point count %" PRIu64 "\n", *finalCount);
+    AWG_PROBE1(gen_list_done, *finalCount);
     return pointVals;
 }
 
 unsigned char      *genWavePts(
     double freq,
     double amp,
-    unsigned int numPts,
+    uint64_t numPts,
     double pointInterval,
+    int sampleFormat,
     unsigned char *startPtr
 ) {
-    unsigned int        i = 0;
+    const sampleFormat_type *format = sampleFormatInfo(sampleFormat);
+
+    AWG_PROBE1(wave_pts_start, numPts);
+    kernelsFor(sampleFormat)->genRun(freq, amp * format->fullScale, NULL, 0, numPts,
+				     pointInterval, startPtr);
+    AWG_PROBE1(wave_pts_done, numPts);
+    return (startPtr + ((size_t) numPts) * format->width);
+}
+
+unsigned char      *genShapedWavePts(
+    double freq,
+    double amp,
+    const double *window,
+    uint64_t numPts,
+    double pointInterval,
+    int sampleFormat,
+    unsigned char *startPtr
+) {
+    const sampleFormat_type *format = sampleFormatInfo(sampleFormat);
+
+    AWG_PROBE1(wave_pts_start, numPts);
+    kernelsFor(sampleFormat)->genRun(freq, amp * format->fullScale, window, 0, numPts,
+				     pointInterval, startPtr);
+    AWG_PROBE1(wave_pts_done, numPts);
+    return (startPtr + ((size_t) numPts) * format->width);
+}
+
+unsigned char      *genPulsePts(
+    double startFreq,
+    double stopFreq,
+    double duration,
+    double amp,
+    const double *window,
+    uint64_t numPts,
+    double pointInterval,
+    int sampleFormat,
+    unsigned char *startPtr
+) {
+    const sampleFormat_type *format = sampleFormatInfo(sampleFormat);
 
-    for (i = 0; i < numPts; i++) {
-	double              point =
-	    amp * sin(freq * ((double) i) * pointInterval * TWO_PI * 0.001) +
-	    ((double) AWG_ZERO_VAL);
-	*(startPtr + i) = round(point);
+    if (stopFreq == startFreq)
+	return genShapedWavePts(startFreq, amp, window, numPts, pointInterval, sampleFormat,
+				startPtr);
+
+    AWG_PROBE1(wave_pts_start, numPts);
+    if (numPts > 0) {
+	const chirp_type    chirp = chirpFor(startFreq, stopFreq, duration, pointInterval);
+
+	kernelsFor(sampleFormat)->genChirp(&chirp, amp * format->fullScale, window, 0, numPts,
+					   startPtr);
     }
-    return (startPtr + numPts);
+    AWG_PROBE1(wave_pts_done, numPts);
+    return (startPtr + ((size_t) numPts) * format->width);
 }
 
 ssize_t myGetLine(
@@ -278,23 +1404,23 @@ ssize_t myGetLine(
 
     // Check for null pointers, these are always errors
     if (NULL == bufferPtr) {
-	fprintf(stderr, "In myGetLine: bufferPtr is NULL.\n");
+	logMessage(LOG_ERROR, "In myGetLine: bufferPtr is NULL.\n");
 	return -1;
     }
 
     if (NULL == bufferSize) {
-	fprintf(stderr, "In myGetLine: bufferSize is NULL.\n");
+	logMessage(LOG_ERROR, "In myGetLine: bufferSize is NULL.\n");
 	return -1;
     }
 
     if (NULL == fp) {
-	fprintf(stderr, "In myGetLine: fp is NULL.\n");
+	logMessage(LOG_ERROR, "In myGetLine: fp is NULL.\n");
 	return -1;
     }
     // Allocate a new buffer if NULL ptr and 0 size, otherwise error
     if (NULL == *bufferPtr) {
 	if (0 != *bufferSize) {
-	    fprintf(stderr, "In myGetLine: *bufferPtr is NULL with nonzero *bufferSize.\n");
+	    logMessage(LOG_ERROR, "In myGetLine: *bufferPtr is NULL with nonzero *bufferSize.\n");
 	    return -1;
 	}
 	*bufferPtr = malloc(DEFAULT_BUFF_INC_SIZE);
@@ -310,7 +1436,7 @@ ssize_t myGetLine(
 
     // If the stream is in the error state before we touch it, what are you even doing?
     if (ferror(fp)) {
-	fprintf(stderr, "In myGetLine: fp already in error state.\n");
+	logMessage(LOG_ERROR, "In myGetLine: fp already in error state.\n");
 	return -1;
     }
     // Initial checks are done. Finally.  Time to load in the line.
@@ -362,6 +1488,7 @@ int resizeFreqList(
 ) {
     freqList_ptr        thisOne = *toResize;
     double             *tempPtr = NULL;
+    unsigned char      *envPtr = NULL;
     int                 errsv = 0;
 
     if (NULL == toResize)
@@ -379,6 +1506,16 @@ int resizeFreqList(
     }
     thisOne->freqList = tempPtr;
 
+    tempPtr = realloc(thisOne->stopList, sizeof (double) * newSize);
+    if (NULL == tempPtr) {
+	errsv = errno;
+	freeFreqList(thisOne);
+	*toResize = NULL;
+	errno = errsv;
+	return -1;
+    }
+    thisOne->stopList = tempPtr;
+
     tempPtr = realloc(thisOne->ampList, sizeof (double) * newSize);
     if (NULL == tempPtr) {
 	errsv = errno;
@@ -399,6 +1536,16 @@ int resizeFreqList(
     }
     thisOne->durList = tempPtr;
 
+    envPtr = realloc(thisOne->envList, sizeof (unsigned char) * newSize);
+    if (NULL == envPtr) {
+	errsv = errno;
+	freeFreqList(thisOne);
+	*toResize = NULL;
+	errno = errsv;
+	return -1;
+    }
+    thisOne->envList = envPtr;
+
     thisOne->actualSize = newSize;
     return 0;
 }
@@ -407,16 +1554,20 @@ freqList_ptr readSpecFile(
     const char *inPath
 ) {
     // file io set
+    compressStream_type *specStream = NULL;
     FILE               *specFile = NULL;
     char               *lineBuf = NULL;
     size_t              lineBufSize = 0;
     ssize_t             lineLen = -1;
     unsigned long       lineNum = 0;
     int                 storeFerror = 0;
+    logLimit_type       echoLimit = LOG_LIMIT_INIT_VAL;
+    logLimit_type       errorLimit = LOG_LIMIT_INIT_VAL;
 
     // frequency list set
     freqList_ptr        listPtr = NULL;
 
+    AWG_PROBE1(spec_read_start, inPath);
     // Initial malloc for list.
     listPtr = blankFreqList();
     if (NULL == listPtr)
@@ -429,10 +1580,19 @@ freqList_ptr readSpecFile(
     if ((NULL == specFile) || ferror(specFile)) {
 	int                 errsv = errno;
 
+	if (NULL != specFile)
+	    fclose(specFile);
 	freeFreqList(listPtr);
 	errno = errsv;
 	return NULL;
     }
+    // Compressed files are decompressed on their own thread as we go
+    specStream = openCompressedInput(specFile);
+    if (NULL == specStream) {
+	freeFreqList(listPtr);
+	return NULL;
+    }
+    specFile = compressStreamFile(specStream);
     // Process line-by-line
     // lineBuf allocated here, remember we've got to call free()
     lineLen = myGetLine(&lineBuf, &lineBufSize, specFile);
@@ -440,15 +1600,16 @@ freqList_ptr readSpecFile(
 	int                 parseResult;
 
 	lineNum++;
-	if ((parseResult = parseLine(lineBuf, listPtr))) {
+	if ((parseResult = parseLine(lineBuf, listPtr, &echoLimit))) {
 	    if (GEN_BINARY_ERESIZE == parseResult) {
-		fclose(specFile);
+		closeCompressStream(specStream);
 		free(lineBuf);
 		freeFreqList(listPtr);
 		return NULL;
 	    } else if (GEN_BINARY_EPARSE == parseResult) {
-		fprintf(stderr, "Error parsing file at line %lu, ignoring line:\n  > %s\n", lineNum,
-			lineBuf);
+		logLimited(&errorLimit, LOG_WARN,
+			   "Error parsing file at line %lu, ignoring line:\n  > %s\n", lineNum,
+			   lineBuf);
 	    }
 	}
 	// Get Next Line
@@ -459,40 +1620,48 @@ freqList_ptr readSpecFile(
     storeFerror = (ferror(specFile) && !feof(specFile));
 
     // Close the file, clean up our buffers
-    fclose(specFile);
+    if (closeCompressStream(specStream))
+	storeFerror = 1;
     free(lineBuf);
     lineBuf = NULL;
 
-    if (!g_opt_quiet)
-	printf("Processed %lu lines, found %d frequencies.\n", lineNum, listPtr->freqCount);
+    logLimitEnd(&echoLimit, LOG_INFO, "teeth");
+    logLimitEnd(&errorLimit, LOG_WARN, "lines that could not be parsed");
+    logMessage(LOG_INFO, "Processed %lu lines, found %d frequencies.\n", lineNum,
+	       listPtr->freqCount);
     malloc(128);
     if (0 == listPtr->freqCount) {
-	fprintf(stderr, "However, we need at least one entry.\n");
+	logMessage(LOG_ERROR, "However, we need at least one entry.\n");
 	freeFreqList(listPtr);
 	return NULL;
     }
     // Handle error case (anything other than reading the whole file)
     if (storeFerror) {
-	fprintf(stderr, "However, an file read error occurred at line %lu.\n", lineNum);
+	logMessage(LOG_ERROR, "However, an file read error occurred at line %lu.\n", lineNum);
 	freeFreqList(listPtr);
 	return NULL;
     }
     // Shrink lists to appropriate sizes (nonzero is error)
     if (resizeFreqList(listPtr->freqCount, &listPtr))
 	return NULL;
+    AWG_PROBE2(spec_read_done, lineNum, listPtr->freqCount);
     return listPtr;
 }
 
-int parseLine(
+/* parseLine() without its probes, which it has to fire on every way out. */
+static int parseLineFields(
     char *lineBuf,
-    freqList_ptr destList
+    freqList_ptr destList,
+    logLimit_type * echoLimit
 ) {
     char               *endConv = NULL;
     const unsigned int  curSize = destList->actualSize;
     const unsigned int  curCount = destList->freqCount;
     double             *freqBase = destList->freqList;
+    double             *stopBase = destList->stopList;
     double             *durBase = destList->durList;
     double             *ampBase = destList->ampList;
+    int                 envelope = ENVELOPE_RECT;
 
     // Consume leading whitespace
     while (isspace(*lineBuf))
@@ -508,6 +1677,7 @@ int parseLine(
 	    return GEN_BINARY_ERESIZE;
 	}
 	freqBase = destList->freqList;
+	stopBase = destList->stopList;
 	durBase = destList->durList;
 	ampBase = destList->ampList;
     }
@@ -517,6 +1687,19 @@ int parseLine(
     if (errno)
 	return GEN_BINARY_EPARSE;
     lineBuf = endConv;
+    *(stopBase + curCount) = *(freqBase + curCount);
+
+    // Optional stop frequency, making the pulse a chirp
+    while (isspace(*lineBuf))
+	lineBuf++;
+    if (':' == *lineBuf) {
+	lineBuf++;
+	errno = 0;
+	*(stopBase + curCount) = strtod(lineBuf, &endConv);
+	if (errno || (endConv == lineBuf))
+	    return GEN_BINARY_EPARSE;
+	lineBuf = endConv;
+    }
 
     while (isspace(*lineBuf))
 	lineBuf++;
@@ -542,78 +1725,339 @@ int parseLine(
 
     while (isspace(*lineBuf))
 	lineBuf++;
+
+    // Optional envelope name
+    if (',' == *lineBuf) {
+	char               *nameEnd = NULL;
+	char                endChar;
+
+	lineBuf++;
+	while (isspace(*lineBuf))
+	    lineBuf++;
+	nameEnd = lineBuf;
+	while (isalnum(*nameEnd))
+	    nameEnd++;
+	endChar = *nameEnd;
+	*nameEnd = '\0';
+	envelope = parseEnvelopeName(lineBuf);
+	*nameEnd = endChar;
+	if (envelope < 0)
+	    return GEN_BINARY_EPARSE;
+	lineBuf = nameEnd;
+	while (isspace(*lineBuf))
+	    lineBuf++;
+    }
     if ('\0' != *(lineBuf++))
 	return GEN_BINARY_EPARSE;
-
-    if (!g_opt_quiet)
-	printf("Amp %f, Freq %f, Dur %f\n", *(ampBase + curCount), *(freqBase + curCount),
-	       *(durBase + curCount));
+    *(destList->envList + curCount) = envelope;
+
+    if ((NULL != echoLimit) && LOG_ENABLED(LOG_INFO)) {
+	char                stopText[64] = "";
+
+	if (*(stopBase + curCount) != *(freqBase + curCount))
+	    snprintf(stopText, sizeof (stopText), " to %f", *(stopBase + curCount));
+	if (ENVELOPE_RECT == envelope)
+	    logLimited(echoLimit, LOG_INFO, "Amp %f, Freq %f%s, Dur %f\n", *(ampBase + curCount),
+		       *(freqBase + curCount), stopText, *(durBase + curCount));
+	else
+	    logLimited(echoLimit, LOG_INFO, "Amp %f, Freq %f%s, Dur %f, Envelope %s\n",
+		       *(ampBase + curCount), *(freqBase + curCount), stopText,
+		       *(durBase + curCount), envelopeName(envelope));
+    }
 
     destList->freqCount = curCount + 1;
     return 0;
 }
 
-int writeToFile(
-    const char *rootName,
-    const unsigned char *ptsList,
-    const unsigned long numPtrs,
-    const double clockFreq
+int parseLine(
+    char *lineBuf,
+    freqList_ptr destList,
+    logLimit_type * echoLimit
 ) {
-    FILE               *pointsFile = NULL;
-    char               *fileName = NULL;
-    size_t              fileNameLen;
-    const char          fileNameSuf[] = "_points";
-    unsigned int        numLen = 0;
-    unsigned long       numCpy;
+    int                 result = 0;
 
-    fileNameLen = strlen(rootName) + strlen(fileNameSuf);
+    // destList is freed if it can't grow, so only the result is given at the end
+    AWG_PROBE1(parse_line_start, destList->freqCount);
+    result = parseLineFields(lineBuf, destList, echoLimit);
+    AWG_PROBE1(parse_line_done, result);
+    return result;
+}
 
-    fileName = malloc(fileNameLen + 1);
-    if (NULL == fileName)
+#define BLOCK_TEXT_LEN 32	     // Room for any length field formatBlockLength() makes
+
+/* The "#<n><len>" length field of a block, or -1 if len needs more than 9 digits. */
+static int formatBlockLength(
+    uint64_t len,
+    char *buf
+) {
+    char                digits[24];
+    const int           numLen = snprintf(digits, sizeof (digits), "%" PRIu64, len);
+
+    if (numLen > BLOCK_DIGITS_MAX)
 	return -1;
+    snprintf(buf, BLOCK_TEXT_LEN, "#%d%s", numLen, digits);
+    return 0;
+}
 
-    strcpy(fileName, rootName);
-    strcat(fileName, fileNameSuf);
+int checkBlockBytes(
+    const uint64_t numPts,
+    int sampleFormat
+) {
+    const unsigned int  width = sampleFormatInfo(sampleFormat)->width;
+
+    if (numPts > MAX_BLOCK_BYTES / width) {
+	logMessage(LOG_ERROR, "The curve would be %" PRIu64 " points, more than the %llu bytes "
+		   "one block sent to the AWG can hold.\n", numPts, MAX_BLOCK_BYTES);
+	return -1;
+    }
+    return 0;
+}
 
-    for (numCpy = numPtrs; numCpy != 0; numCpy /= 10)
-	numLen++;
+int formatPointsHeader(
+    char *buf,
+    size_t bufSize,
+    const uint64_t numPts,
+    int sampleFormat
+) {
+    const unsigned int  width = sampleFormatInfo(sampleFormat)->width;
+    char                blockLen[BLOCK_TEXT_LEN];
+    int                 textLen = 0;
 
-    pointsFile = fopen(fileName, "w");
-    free(fileName);
-    if (NULL == pointsFile)
-	return -1;
-    fprintf(pointsFile, "DATA:DESTINATION \"GPIB.WFM\"\n");
-    fprintf(pointsFile, "DATA:WIDTH 1\n");
-    fprintf(pointsFile, "CURVE ");
-    fprintf(pointsFile, "#%d%lu", numLen, numPtrs);
-    fwrite(ptsList, sizeof (unsigned char), numPtrs, pointsFile);
-    fprintf(pointsFile, "\n");
-    fprintf(pointsFile, "CLOCK:FREQUENCY %fMHz\n", clockFreq);
-    fprintf(pointsFile, "WFMP?\n");
-    if (ferror(pointsFile)) {
-	fclose(pointsFile);
+    if (checkBlockBytes(numPts, sampleFormat) || formatBlockLength(numPts * width, blockLen))
+	return -1;
+    textLen = snprintf(buf, bufSize, "DATA:DESTINATION \"GPIB.WFM\"\nDATA:WIDTH %u\nCURVE %s",
+		       width, blockLen);
+    if ((textLen < 0) || (((size_t) textLen) >= bufSize))
+	return -1;
+    return textLen;
+}
+
+int formatMarkerHeader(
+    char *buf,
+    size_t bufSize,
+    const uint64_t numPts
+) {
+    char                blockLen[BLOCK_TEXT_LEN];
+    int                 textLen = 0;
+
+    if (formatBlockLength(numPts, blockLen))
+	return -1;
+    textLen = snprintf(buf, bufSize, "\nMARKER:DATA %s", blockLen);
+    if ((textLen < 0) || (((size_t) textLen) >= bufSize))
+	return -1;
+    return textLen;
+}
+
+int streamMarkerBlock(
+    const wavePlan_type * plan,
+    byteSink_fn sink,
+    void *sinkCtx
+) {
+    char                textBuf[64];
+    unsigned char       markBuf[DEFAULT_CHUNK_POINTS];
+    uint64_t            pos = 0;
+    int                 textLen = 0;
+
+    if (MARKER_NONE == plan->markerMode)
+	return 0;
+
+    textLen = formatMarkerHeader(textBuf, sizeof (textBuf), plan->finalCount);
+    if ((textLen < 0) || sink(sinkCtx, (const unsigned char *) textBuf, textLen))
+	return -1;
+    for (pos = 0; pos < plan->finalCount; pos += DEFAULT_CHUNK_POINTS) {
+	uint64_t            run = plan->finalCount - pos;
+
+	if (run > DEFAULT_CHUNK_POINTS)
+	    run = DEFAULT_CHUNK_POINTS;
+	if (genMarkerRange(plan, pos, run, markBuf) || sink(sinkCtx, markBuf, run))
+	    return -1;
+    }
+    return 0;
+}
+
+int formatPointsTrailer(
+    char *buf,
+    size_t bufSize,
+    const double clockFreq
+) {
+    int                 textLen = 0;
+
+    textLen = snprintf(buf, bufSize, "\nCLOCK:FREQUENCY %fMHz\nWFMP?\n", clockFreq);
+    if ((textLen < 0) || (((size_t) textLen) >= bufSize))
 	return -1;
+    return textLen;
+}
+
+uint64_t pointsCommandBytes(
+    const wavePlan_type * plan,
+    const double clockFreq
+) {
+    char                textBuf[128];
+    const int           headerLen =
+	formatPointsHeader(textBuf, sizeof (textBuf), plan->finalCount, plan->sampleFormat);
+    const int           trailerLen = formatPointsTrailer(textBuf, sizeof (textBuf), clockFreq);
+    const int           markerLen =
+	formatMarkerHeader(textBuf, sizeof (textBuf), plan->finalCount);
+    uint64_t            total = 0;
+
+    if ((headerLen < 0) || (trailerLen < 0) || (markerLen < 0))
+	return 0;
+    // planWaveform() keeps finalCount small enough that this can't overflow
+    total = ((uint64_t) headerLen) + trailerLen
+	+ plan->finalCount * sampleFormatInfo(plan->sampleFormat)->width;
+    if (MARKER_NONE != plan->markerMode)
+	total += markerLen + plan->finalCount;
+    return total;
+}
+
+/* Hands base (or its inverted copy) to the sink, DEFAULT_CHUNK_POINTS at a time. */
+static int sinkBaseChunks(
+    const unsigned char *baseVals,
+    uint64_t basePoints,
+    int sampleFormat,
+    int inverted,
+    unsigned char *scratch,
+    byteSink_fn sink,
+    void *sinkCtx
+) {
+    const unsigned int  width = sampleFormatInfo(sampleFormat)->width;
+    uint64_t            pos = 0;
+
+    for (pos = 0; pos < basePoints; pos += DEFAULT_CHUNK_POINTS) {
+	uint64_t            run = basePoints - pos;
+	const unsigned char *chunk = baseVals + pos * width;
+
+	if (run > DEFAULT_CHUNK_POINTS)
+	    run = DEFAULT_CHUNK_POINTS;
+	if (inverted) {
+	    invertSamples(sampleFormat, chunk, run, scratch);
+	    chunk = scratch;
+	}
+	if (sink(sinkCtx, chunk, run * width))
+	    return -1;
+    }
+    return 0;
+}
+
+/* Generates the base train into baseVals chunk by chunk, sending each as it is finished,
+ * then sends the inverted copy and repetitions from the retained base. */
+static int streamPointChunks(
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    unsigned char *baseVals,
+    unsigned char *scratch,
+    byteSink_fn sink,
+    void *sinkCtx
+) {
+    const unsigned int  width = sampleFormatInfo(plan->sampleFormat)->width;
+    uint64_t            pos = 0;
+    uint64_t            rep = 0;
+
+    for (pos = 0; pos < plan->basePoints; pos += DEFAULT_CHUNK_POINTS) {
+	uint64_t            run = plan->basePoints - pos;
+
+	if (run > DEFAULT_CHUNK_POINTS)
+	    run = DEFAULT_CHUNK_POINTS;
+	if (genPointRange(freqList, plan, pos, run, baseVals + pos * width))
+	    return -1;
+	if (sink(sinkCtx, baseVals + pos * width, run * width))
+	    return -1;
     }
-    fclose(pointsFile);
 
+    for (rep = 0; rep < (((uint64_t) 1) << plan->numShifts); rep++) {
+	if ((rep > 0)
+	    && sinkBaseChunks(baseVals, plan->basePoints, plan->sampleFormat, 0, scratch, sink,
+			      sinkCtx))
+	    return -1;
+	if (plan->flipCopy
+	    && sinkBaseChunks(baseVals, plan->basePoints, plan->sampleFormat, 1, scratch, sink,
+			      sinkCtx))
+	    return -1;
+    }
     return 0;
 }
 
-int writeSummaryFile(
-    const char *rootName,
+int streamPointsCommand(
     const freqList_ptr freqList,
-    const unsigned int *pointCounts,
-    const double clock_freq
+    const wavePlan_type * plan,
+    const double clockFreq,
+    byteSink_fn sink,
+    void *sinkCtx
+) {
+    const unsigned int  width = sampleFormatInfo(plan->sampleFormat)->width;
+    char                textBuf[128];
+    int                 textLen = 0;
+    unsigned char      *baseVals = NULL;
+    unsigned char      *scratch = NULL;
+    int                 retVal = 0;
+
+    textLen = formatPointsHeader(textBuf, sizeof (textBuf), plan->finalCount, plan->sampleFormat);
+    if ((textLen < 0) || sink(sinkCtx, (const unsigned char *) textBuf, textLen))
+	return -1;
+
+    // The base train is kept, so the copies after it don't need to be generated again
+    if (plan->basePoints < SIZE_MAX / width)
+	baseVals = malloc(sizeof (unsigned char) * (plan->basePoints + 1) * width);
+    scratch = malloc(sizeof (unsigned char) * DEFAULT_CHUNK_POINTS * width);
+    if ((NULL == baseVals) || (NULL == scratch)) {
+	perror("streamPointsCommand allocation");
+	retVal = -1;
+    } else {
+	retVal = streamPointChunks(freqList, plan, baseVals, scratch, sink, sinkCtx);
+    }
+    if (NULL != baseVals)
+	free(baseVals);
+    if (NULL != scratch)
+	free(scratch);
+    if (retVal || streamMarkerBlock(plan, sink, sinkCtx))
+	return -1;
+
+    textLen = formatPointsTrailer(textBuf, sizeof (textBuf), clockFreq);
+    if ((textLen < 0) || sink(sinkCtx, (const unsigned char *) textBuf, textLen))
+	return -1;
+    return 0;
+}
+
+#define WRITE_RUN_BYTES (1 << 16)	     // Bytes hashed then written at a time, still in cache
+
+/* Writes len bytes, adding each run to the digest just before it goes out. */
+static void writeDigested(
+    FILE * outFile,
+    const unsigned char *bytes,
+    uint64_t len,
+    outputDigest_type * digest
+) {
+    while (len > 0) {
+	const size_t        run = (len > WRITE_RUN_BYTES) ? WRITE_RUN_BYTES : (size_t) len;
+
+	digestBytes(digest, bytes, run);
+	if (fwrite(bytes, 1, run, outFile) != run)
+	    return;
+	bytes += run;
+	len -= run;
+    }
+    return;
+}
+
+int writeToFile(
+    const char *rootName,
+    const unsigned char *ptsList,
+    const unsigned char *markerList,
+    const uint64_t numPtrs,
+    int sampleFormat,
+    const double clockFreq,
+    int compressKind,
+    int compressLevel,
+    outputDigest_type * digest
 ) {
-    FILE               *sumFile = NULL;
+    compressStream_type *output = NULL;
+    FILE               *pointsFile = NULL;
     char               *fileName = NULL;
     size_t              fileNameLen;
-    const char          fileNameSuf[] = "_desc.txt";
-    int                 i;
-    const unsigned int  entries = freqList->freqCount;
-    const double       *freqTable = freqList->freqList;
-    const double       *ampTable = freqList->ampList;
-    const double        clock_period = 1000.0 / clock_freq;
+    const char          fileNameSuf[] = "_points";
+    char                headerBuf[128];
+    char                trailerBuf[128];
+    char                markerBuf[64];
 
     fileNameLen = strlen(rootName) + strlen(fileNameSuf);
 
@@ -624,22 +2068,33 @@ int writeSummaryFile(
     strcpy(fileName, rootName);
     strcat(fileName, fileNameSuf);
 
-    sumFile = fopen(fileName, "w");
-    if (NULL == sumFile) {
+    if ((formatPointsHeader(headerBuf, sizeof (headerBuf), numPtrs, sampleFormat) < 0)
+	|| (formatPointsTrailer(trailerBuf, sizeof (trailerBuf), clockFreq) < 0)
+	|| (formatMarkerHeader(markerBuf, sizeof (markerBuf), numPtrs) < 0)) {
 	free(fileName);
 	return -1;
     }
 
-    fprintf(sumFile, "Frequency pattern summary for %s:\n", fileName);
-    for (i = 0; i < entries; i++) {
-	fprintf(sumFile, "\t%f amplitude %f MHz for %f ns (%d samples).\n", *(ampTable + i),
-		*(freqTable + i), ((double) (*(pointCounts + i))) * clock_period,
-		*(pointCounts + i));
-    }
-    fprintf(sumFile, "Sample clock @ %f MHz for a period of %f ns.\n", clock_freq, clock_period);
-    fclose(sumFile);
-
+    AWG_PROBE1(write_start, numPtrs);
+    output = openCompressedOutput(fileName, compressKind, compressLevel);
     free(fileName);
-
+    if (NULL == output)
+	return -1;
+    pointsFile = compressStreamFile(output);
+    writeDigested(pointsFile, (const unsigned char *) headerBuf, strlen(headerBuf), digest);
+    writeDigested(pointsFile, ptsList, numPtrs * sampleFormatInfo(sampleFormat)->width, digest);
+    if (NULL != markerList) {
+	writeDigested(pointsFile, (const unsigned char *) markerBuf, strlen(markerBuf), digest);
+	writeDigested(pointsFile, markerList, numPtrs, digest);
+    }
+    writeDigested(pointsFile, (const unsigned char *) trailerBuf, strlen(trailerBuf), digest);
+    if (ferror(pointsFile)) {
+	closeCompressStream(output);
+	return -1;
+    }
+    if (closeCompressStream(output))
+	return -1;
+    AWG_PROBE1(write_done, strlen(headerBuf) + numPtrs * sampleFormatInfo(sampleFormat)->width
+	       + ((NULL != markerList) ? strlen(markerBuf) + numPtrs : 0) + strlen(trailerBuf));
     return 0;
 }
@@ -11,6 +11,11 @@
 #ifndef GENBINARY_H
 #define GENBINARY_H
 
+#include <inttypes.h>
+#include "../logging/logging.h"
+#include "../compressStream/compressStream.h"
+#include "../checksum/checksum.h"
+
 /*! @page AWGInterfaceFormat AWG Data/Communications format
  *  @brief How data is communicated to and from the AWG
  *  @tableofcontents
@@ -26,7 +31,9 @@
  * \#\<Number of decimal digits in the number\>\<The number itself\>
  *
  * All digits are sent as ASCII, not binary.
- * Numbers longer than 9 digits are not representable, nor should they be needed.
+ * Numbers longer than 9 digits are not representable, so no block can be 10^9 bytes or more.
+ * The indefinite form, \#0, is not used: it ends at the first newline, and the curve bytes
+ * can hold newlines of their own.  See checkBlockBytes().
  * @subsection FormatASCIIRepExamples Examples
  * Number | AWG Representation
  * ------ | ------------------
@@ -52,6 +59,9 @@
  * H | L | 2 (10)
  * H | H | 3 (11)
  * 
+ * Marker points follow the same inverted copy and repetitions as the curve, but are not
+ * inverted themselves, so a pulse boundary is marked in every copy.  See @ref MarkerModes.
+ *
  * @subsection MarkerExamples Examples
  * Marker Pattern | Command ([] means send binary representation)
  * -------------- | -------
@@ -64,9 +74,9 @@
  * - Programmer's Manual, page 2-59 (PDF page 85) and following
  * 
  * The command used to transfer data to the AWG is @c CURVe
- * Here we assume the data width has already been set to 1 (byte).
- * In that case, the command format as
- * @code CURVe <Number of points in ASCII Number Format><That many bytes output data, formatted as below>@endcode
+ * The data width is set just before it, to the width of the @ref SampleFormats "sample format".
+ * The command format is then
+ * @code CURVe <Number of bytes in ASCII Number Format><That many bytes output data, formatted as below>@endcode
  * @subsection CurvePoints Output Point Format
  * The generator has 8-bits of output resolution, and to have the ability to output 0 it has slightly asymmetric output ranges.
  * They also chose a data format that has output values linearly increasing with binary values.  As a result, you get:
@@ -74,6 +84,9 @@
  * - 127 onto 0
  * - 255 is 1.0079
  *
+ * That is #SAMPLE_FORMAT_U8.  With #SAMPLE_FORMAT_U12 each point is two bytes, most significant
+ * first, holding a 12-bit value on the same pattern: [0, 4094] maps onto [-1, 1] and 2047 onto 0.
+ *
  * @subsection CurveExamples Examples
  * Curve Pattern | Command ([] means send binary representation)
  * -------------- | -------
@@ -82,16 +95,56 @@
  * @note Actual waveforms are restricted to have lengths that are multiples of 32, but for simplicity these are shorter.
  */
 
-#define AWG_ZERO_VAL 127     //!< The integer value that corresponds to a zero-volt output on the AWG
+#define AWG_ZERO_VAL 127     //!< The integer value that corresponds to a zero-volt output on the AWG, in 8-bit samples
+#define AWG_MARKER1_VAL 0x02	//!< Marker point value with Marker 1 high, see @ref FormatMarkerPoint
+
+/*!
+ * @defgroup SampleFormats Sample formats
+ * @brief How each curve point is encoded, see @ref CurvePoints.
+ * @{
+ */
+#define SAMPLE_FORMAT_U8  0	//!< @c DATA:WIDTH 1, 8-bit offset binary with #AWG_ZERO_VAL as zero.  The default.
+#define SAMPLE_FORMAT_U12 1	//!< @c DATA:WIDTH 2, 12-bit offset binary with 2047 as zero, most significant byte first.
+#define SAMPLE_FORMAT_COUNT 2	//!< Number of sample formats.
+#define SAMPLE_MAX_WIDTH 2	//!< Most bytes any sample format uses per point.
+
+/*! @} */
+
+/*! @brief Describes one of the @ref SampleFormats. */
+typedef struct sampleFormat {
+    const char         *name;	//!< Name used on the command line.
+    unsigned int        width;	//!< Bytes per point, as sent with @c DATA:WIDTH.
+    long                zeroVal;	//!< Value of a zero output.
+    double              fullScale;	//!< Distance from zeroVal of a full scale output.
+} sampleFormat_type;
+
+/*!
+ * @defgroup MarkerModes Marker modes
+ * @brief Which marker pattern, if any, is sent in a @c MARKER:DATA block after the curve.
+ * @{
+ */
+#define MARKER_NONE  0	//!< No marker block.
+#define MARKER_TOOTH 1	//!< Marker 1 high on the first sample of every pulse.
+#define MARKER_START 2	//!< Marker 1 high on the first sample of the base pulse train.
+
+/*! @} */
 
 /*	See (equip. man. 4B-11)
  *	Max clock rate is 1.024 GHz (= 1024 MHz)
  *	Min clock rate is 1 kHz     (= 0.001 MHz)
  */
+#define AWG_MIN_CLOCK 0.001	//!< Slowest sample clock the AWG accepts, in MHz.
+#define AWG_MAX_CLOCK 1024.0	//!< Fastest sample clock the AWG accepts, in MHz.
 
 #define	PI		3.141592653589793	//!< Pi to double precision
 #define	TWO_PI	6.283185307179586	//!< Twice pi to double precision
 #define DEFAULT_FREQ_LIST_SIZE 8	//!< Default frequency list size, tradeoff between minimum memory footprint and overhead for expansion if too small.
+#define DEFAULT_CHUNK_POINTS 4096	//!< Number of output samples generated per chunk when streaming the command bytes.
+#define MAX_FINAL_POINTS (UINT64_MAX >> 4)	//!< Longest final waveform planWaveform() accepts, so its command bytes can still be counted in 64 bits.
+#define BLOCK_DIGITS_MAX 9	//!< Most digits a block length field can have, see @ref FormatASCIINumbers.
+#define MAX_BLOCK_BYTES 999999999ull	//!< Longest block, in bytes, that a length field can describe.
+#define TILE_PERIOD_MAX (1ul << 20)	//!< Longest exact period, in samples, that a pulse is generated once and copied for.  See genWavePts().
+#define CHIRP_BLOCK_POINTS 1024	//!< A chirp's phase is computed exactly at every multiple of this many samples, and carried between by recurrence.  See genPulsePts().
 
 /*!
  * @defgroup GenBinaryRetCodes genBinary subsystem return codes
@@ -103,21 +156,178 @@
 
 /*! @} */
 
+/*!
+ * @defgroup Envelopes Pulse envelopes
+ * @brief Amplitude shaping applied across each pulse.
+ * @{
+ */
+#define ENVELOPE_RECT      0	//!< Constant amplitude, the default.
+#define ENVELOPE_GAUSS     1	//!< Gaussian, with the pulse spanning #ENVELOPE_GAUSS_WIDTHS standard deviations.
+#define ENVELOPE_RAISEDCOS 2	//!< Raised cosine (Hann), zero just outside each end of the pulse.
+#define ENVELOPE_GAUSS_WIDTHS 6.0	//!< Standard deviations of a Gaussian envelope across the pulse.
+
+/*! @} */
+
+/*!
+ * @defgroup PulseSources Pulse sources
+ * @brief Where a #freqList gets the frequency, amplitude, and duration of each pulse from.
+ * @{
+ */
+#define PULSE_SRC_LIST    0	//!< Values are stored per pulse in the freqList arrays.
+#define PULSE_SRC_LINEAR  1	//!< Frequencies evenly spaced from start to stop, exactly as setFreqList() spaces them.
+#define PULSE_SRC_LOG     2	//!< Frequencies in constant ratio from start to stop.
+#define PULSE_SRC_STEPPED 3	//!< Pulses split into stepCount equal runs, each run one frequency, runs evenly spaced from start to stop.
+
+/*! @} */
+
+/*! @brief Describes a pulse train whose values follow from a handful of numbers.
+ *
+ *  Used by sweepFreqList() so a command-line comb never needs per-pulse storage.
+ *
+ *  Expected initialization found in #PULSE_SWEEP_INIT_VAL
+ */
+typedef struct pulseSweep {
+    int                 kind;	//!< One of the @ref PulseSources values, other than #PULSE_SRC_LIST.
+    unsigned int        toothCount;	//!< Number of pulses in the train.
+    double              startFreq;	//!< Frequency of the first pulse, in MHz.
+    double              stopFreq;	//!< Frequency of the last pulse, in MHz.
+    unsigned int        stepCount;	//!< Number of frequency steps, for #PULSE_SRC_STEPPED.
+    double              duration;	//!< Duration of every pulse, in ns.
+    double              amplitude;	//!< Amplitude of every pulse, on [0, 1], unless randAmp is set.
+    int                 randAmp;	//!< Non-zero for the seeded random amplitudes setRandAmp() would give.
+    uint64_t            seed;	//!< Seed for the random amplitudes.
+    int                 envelope;	//!< Envelope of every pulse, one of the @ref Envelopes values.
+} pulseSweep_type;
+
+#define PULSE_SWEEP_INIT_VAL {PULSE_SRC_LINEAR, 0, 0.0, 0.0, 1, 0.0, 0.0, 0, 0, ENVELOPE_RECT}	//!< Initialization data for a #pulseSweep instantiation.
+
 /*! @brief Holds all the information needed to describe a train of frequency pulses.
  *
  *  Stores pointers to arrays containing the frequencies, amplitudes, and durations of each pulse.
  *  The utilized and actual sizes of the arrays are actually stored.
  *  The arrays are in matched order, i.e. the first pulse represented by the 0th element of each array.
+ *
+ *  A list made by sweepFreqList() has no arrays; its values are computed from #freqList::sweep
+ *  when asked for.  Read pulses through pulseFreq(), pulseAmp(), and pulseDur() to handle both.
+ *
+ *  A pulse whose stop frequency differs from its frequency is a chirp, sweeping linearly from
+ *  one to the other.  See pulseStopFreq() and genPulsePts().
  */
 typedef struct freqList {
     unsigned int        freqCount;	//!< The number of frequency pulses actually used in %freqList, ampList, and durList.
     unsigned int        actualSize;	//!< The total number of spaces for values in the arrays %freqList, ampList, and durList.
-    double             *freqList;	//!< Array of frequency values, in MHz.
+    double             *freqList;	//!< Array of frequency values, in MHz.  The start frequency of a chirp.
+    double             *stopList;	//!< Array of frequencies each pulse ends at, in MHz.  NULL if no pulse is a chirp.
     double             *ampList;	//!< Array of relative amplitude values, on interval [0,1]
     double             *durList;	//!< Array of pulse durations, in ns.
+    unsigned char      *envList;	//!< Array of pulse envelopes, @ref Envelopes values.
+    int                 ampSeeded;	//!< Non-zero if ampList was filled by setRandAmp(), with ampSeed.
+    uint64_t            ampSeed;	//!< The seed the random amplitudes came from, valid if ampSeeded is set.
+    int                 sourceKind;	//!< One of the @ref PulseSources values.  #PULSE_SRC_LIST if the arrays hold the values.
+    pulseSweep_type     sweep;	//!< The sweep the values come from, if sourceKind is not #PULSE_SRC_LIST.
 } freqList_type;
 typedef freqList_type *freqList_ptr;	//!< Pointer to a #freqList
 
+/*! @brief Describes the layout of the final waveform before any samples are generated.
+ *
+ *  The final waveform is the base pulse train, optionally followed by an inverted copy of itself,
+ *  with that unit repeated 2^numShifts times so the total is a multiple of 32 samples.
+ *  Knowing where every pulse starts, and which sign it is played with, lets any range of
+ *  output samples be generated on its own.
+ *
+ *  Expected initialization found in #WAVE_PLAN_INIT_VAL
+ */
+typedef struct wavePlan {
+    unsigned int        toothCount;	//!< The number of pulses in the train.
+    uint64_t           *toothStart;	//!< Offset of each pulse's first sample in the base train.  Has toothCount+1 entries, the last being basePoints.
+    signed char        *toothSign;	//!< Sign (+1 or -1) applied to each pulse's amplitude to keep the train continuous.
+    uint64_t            basePoints;	//!< Number of samples in the base pulse train.
+    int                 flipCopy;	//!< Non-zero if an inverted copy of the base train follows it.
+    int                 numShifts;	//!< The (base + inverted copy) unit is repeated (1 << numShifts) times.
+    uint64_t            finalCount;	//!< Total number of samples in the final waveform.
+    double              pointInterval;	//!< The output sample period, in ns.
+    int                 markerMode;	//!< One of the @ref MarkerModes.  Not set by planWaveform().
+    double             *windowVals;	//!< Envelope tables, one per distinct envelope and pulse length.  NULL if every pulse is #ENVELOPE_RECT.
+    uint64_t           *toothWindow;	//!< Offset of each pulse's table in windowVals, #WAVE_PLAN_NO_WINDOW for #ENVELOPE_RECT.  NULL if windowVals is.
+    int                 sampleFormat;	//!< One of the @ref SampleFormats.  Sample buffers hold its width in bytes per sample.
+} wavePlan_type;
+
+#define WAVE_PLAN_INIT_VAL {0, NULL, NULL, 0, 0, 0, 0, 0.0, MARKER_NONE, NULL, NULL, SAMPLE_FORMAT_U8}	//!< Initialization data for a #wavePlan instantiation.
+#define WAVE_PLAN_NO_WINDOW ((uint64_t) -1)	//!< #wavePlan::toothWindow entry of a pulse without an envelope table.
+
+/*! @brief Callback that accepts the next run of bytes in an output stream.
+ *
+ * @param[in] sinkCtx The context pointer handed to the streaming function.
+ * @param[in] bytes The bytes to be consumed.
+ * @param[in] len The number of bytes at bytes.
+ * @return 0 on success
+ * @return -1 on failure, which stops the stream.
+ */
+typedef int         (*byteSink_fn) (void *sinkCtx, const unsigned char *bytes, size_t len);
+
+/*!	@brief Looks up the description of a sample format.
+ *
+ * @param[in] sampleFormat One of the @ref SampleFormats values.
+ * @return The description, or that of #SAMPLE_FORMAT_U8 for unknown values.
+ */
+const sampleFormat_type *sampleFormatInfo(
+    int sampleFormat
+);
+
+/*!	@brief Looks up a sample format by the name used on the command line.
+ *
+ * @param[in] name "u8" or "u12".
+ * @return One of the @ref SampleFormats values
+ * @return -1 if the name is not known.
+ */
+int                 parseSampleFormatName(
+    const char *name
+);
+
+/*!	@brief Mirrors samples about zero, turning a pulse train into its inverted copy.
+ *
+ * @param[in] sampleFormat One of the @ref SampleFormats values.
+ * @param[in] src count samples to invert.
+ * @param[in] count The number of samples.
+ * @param[out] dest Where to put the inverted samples.  May be the same as src.
+ */
+void                invertSamples(
+    int sampleFormat,
+    const unsigned char *src,
+    uint64_t count,
+    unsigned char *dest
+);
+
+/*!	@brief Converts samples to output levels.
+ *
+ * @param[in] sampleFormat One of the @ref SampleFormats values.
+ * @param[in] src count samples.
+ * @param[in] count The number of samples.
+ * @param[out] dest Where to put the levels, relative to full scale, so on about [-1, 1].
+ */
+void                decodeSamples(
+    int sampleFormat,
+    const unsigned char *src,
+    uint64_t count,
+    double *dest
+);
+
+/*!	@brief Converts output levels to samples, the reverse of decodeSamples().
+ *
+ * Levels are rounded to the nearest step, and clipped to full scale.
+ *
+ * @param[in] sampleFormat One of the @ref SampleFormats values.
+ * @param[in] src count levels, relative to full scale.
+ * @param[in] count The number of samples.
+ * @param[out] dest Where to put the samples.
+ */
+void                encodeSamples(
+    int sampleFormat,
+    const double *src,
+    uint64_t count,
+    unsigned char *dest
+);
+
 /*!	@brief Allocates an empty freqList
  *
  * Default values are 0 or NULL, as appropriate.
@@ -140,7 +350,8 @@ void                freeFreqList(
 
 /*!	@brief Allocates new arrays of fixed size for the referenced freqList
  *
- * Allocates all three freqList sub-arrays, and sets both freqCount and actualSize to that length.
+ * Allocates all four freqList sub-arrays, and sets both freqCount and actualSize to that length.
+ * Every envelope starts as #ENVELOPE_RECT.
  *
  * @warning Does not check if there are already arrays referenced, so check the pointers first.
  * If they are non-null, calling this function is a memory leak.
@@ -155,6 +366,118 @@ int                 allocSubLists(
     unsigned int nFreqs
 );
 
+/*!	@brief Allocates a freqList whose pulses are computed from a sweep instead of stored.
+ *
+ * No per-pulse arrays are allocated, so the memory used does not grow with the number of
+ * pulses.  A #PULSE_SRC_LINEAR sweep gives the same values setFreqList(), setFixedDur(), and
+ * setFixedAmp() or setRandAmp() would store.
+ *
+ * @param[in] sweep The sweep to copy into the list.
+ * @return A pointer to the newly allocated freqList
+ * @return NULL pointer on failure, including an unknown sweep kind.
+ */
+freqList_ptr        sweepFreqList(
+    const pulseSweep_type * sweep
+);
+
+/*!	@brief The frequency of one pulse, stored or computed.
+ *
+ * @param[in] list The pulse train.
+ * @param[in] i Index of the pulse, less than #freqList::freqCount.
+ * @return The frequency, in MHz.
+ */
+double              pulseFreq(
+    const freqList_type * list,
+    unsigned int i
+);
+
+/*!	@brief The frequency one pulse ends at, stored or computed.
+ *
+ * @param[in] list The pulse train.
+ * @param[in] i Index of the pulse, less than #freqList::freqCount.
+ * @return The frequency, in MHz.  The same as pulseFreq() unless the pulse is a chirp.
+ */
+double              pulseStopFreq(
+    const freqList_type * list,
+    unsigned int i
+);
+
+/*!	@brief The relative amplitude of one pulse, stored or computed.
+ *
+ * @param[in] list The pulse train.
+ * @param[in] i Index of the pulse, less than #freqList::freqCount.
+ * @return The amplitude, on [0, 1].
+ */
+double              pulseAmp(
+    const freqList_type * list,
+    unsigned int i
+);
+
+/*!	@brief The envelope of one pulse, stored or computed.
+ *
+ * @param[in] list The pulse train.
+ * @param[in] i Index of the pulse, less than #freqList::freqCount.
+ * @return One of the @ref Envelopes values.
+ */
+int                 pulseEnvelope(
+    const freqList_type * list,
+    unsigned int i
+);
+
+/*!	@brief Looks up an envelope by the name used in spec files and on the command line.
+ *
+ * @param[in] name "rect", "gauss", or "raisedcos".
+ * @return One of the @ref Envelopes values
+ * @return -1 if the name is not known.
+ */
+int                 parseEnvelopeName(
+    const char *name
+);
+
+/*!	@brief The name of an envelope, as parseEnvelopeName() accepts it.
+ *
+ * @param[in] envelope One of the @ref Envelopes values.
+ * @return The name, or "rect" for unknown values.
+ */
+const char         *envelopeName(
+    int envelope
+);
+
+/*!	@brief Fills a table with an envelope's gain for each sample of a pulse.
+ *
+ * @param[in] envelope One of the @ref Envelopes values.
+ * @param[in] numPts The number of samples in the pulse.
+ * @param[out] window Where to put the numPts gains, each on [0, 1].
+ */
+void                fillEnvelope(
+    int envelope,
+    uint64_t numPts,
+    double *window
+);
+
+/*!	@brief The envelope table planWaveform() made for a pulse.
+ *
+ * @param[in] plan The plan.
+ * @param[in] tooth Index of the pulse.
+ * @return The pulse's gains, one per sample
+ * @return NULL if the pulse has no envelope (#ENVELOPE_RECT).
+ */
+const double       *toothEnvelope(
+    const wavePlan_type * plan,
+    unsigned int tooth
+);
+
+/*!	@brief The duration of one pulse, stored or computed.
+ *
+ * @param[in] list The pulse train.
+ * @param[in] i Index of the pulse, less than #freqList::freqCount.
+ * @return The duration, in ns.
+ */
+double              pulseDur(
+    const freqList_type * list,
+    unsigned int i
+);
+
 /*!	@brief Sets the #freqList::freqList to frequencies evenly spaced over an interval
  *
  * Uses the freqCount memeber of the referenced freqList for the number of frequencies,
@@ -189,13 +512,16 @@ int                 setFixedAmp(
  * Number of pulses is pulled from toSet's #freqList::freqCount member.
  *
  * Amplitudes are chosen on the interval [0.1, 1.0] (or [13, 127]).
- * Uses rand() and calls srand( time(NULL)) for random number generation.
+ * Pulse i takes position i of the prng.h stream for seed, so the same seed always gives
+ * the same amplitudes.  The seed is recorded in the freqList for the summary.
  *
  * @param[inout] toSet Pointer to the freqList to change.
+ * @param[in] seed The seed for the random amplitudes, e.g. from prngDefaultSeed().
  * @return 0, always
  */
 int                 setRandAmp(
-    freqList_ptr toSet
+    freqList_ptr toSet,
+    uint64_t seed
 );
 
 /*!	@brief Sets the duration of every pulse to the same value.
@@ -218,12 +544,15 @@ int                 setFixedDur(
  * Additionally, the last point will always be before the zero crossing,
  * so the first point of the next pulse will never result in discontinuity.
  *
+ * A linear chirp covers as many cycles as a constant pulse at the mean of its start and stop
+ * frequencies, so it is counted by passing that mean.
+ *
  * @param[in] targetDuration How long we'd like the pulse to last, in ns.
  * @param[in] pointInterval The duration of an individual output sample, in ns.
  * @param[in] frequency The frequency for this pulse, in MHz.
  * @return The number of output samples to complete a half-cycle nearest the targetDuration.
  */
-unsigned int        pointsToHalfCycle(
+uint64_t            pointsToHalfCycle(
     double targetDuration,
     double pointInterval,
     double frequency
@@ -232,14 +561,14 @@ unsigned int        pointsToHalfCycle(
 /*!	@brief Allocates an array holding the number of samples for every pulse.
  *
  * Utilizes information in freqList to allocate an array, the fills it
- * via calls to pointsToHalfCycle().
+ * via calls to pointsToHalfCycle(), at the mean frequency of each chirp.
  *
  * @param[in] freqList A pointer to the the #freqList describing the pulse train.
  * @param[in] pointInterval The output sample period being used, in ns.
  * @return A pointer to the array of points on success
  * @return NULL on failure.
  */
-unsigned int       *pointCounts(
+uint64_t           *pointCounts(
     const freqList_ptr freqList,
     const double pointInterval
 );
@@ -254,44 +583,253 @@ unsigned int       *pointCounts(
  * If this didn't already happen, we duplicate the entire waveform as many times as needed
  * to meet this condition.
  *
- * @warning No check on total length fitting in memory is performed.  However unlikely, if
+ * Marker points, if asked for, are stored in the same pass as the samples and copied along
+ * with them, so they cost one extra byte store per sample.
+ *
+ * The whole waveform must fit in the address space; longer ones fail here and have to be
+ * streamed with streamPointsCommand() or runPipeline() instead.
+ *
+ * @warning No check against the AWG's own waveform memory is performed.  However unlikely, if
  * you exceed the total number of points allowed, I don't know what the AWG will do.
  *
  * @param[in] freqList A pointer to the the freqList describing the pulse train.
  * @param[in] pointCounts An array holding the length of each pulse in output samples.
  * @param[in] pointInterval The output sample period, in ns.
+ * @param[in] sampleFormat One of the @ref SampleFormats, giving the encoding of each point.
+ * @param[in] markerMode One of the @ref MarkerModes.
  * @param[inout] finalCount Pointer to memory to hold the total number of points in the final waveform.
- * @return Pointer to the array holding all of the output waveform's points
+ * @param[out] markerList Set to an array of finalCount marker points, or NULL for #MARKER_NONE.
+ * May be NULL if markerMode is #MARKER_NONE.
+ * @return Pointer to the array holding all of the output waveform's points, finalCount
+ * times the format's width bytes.
  */
 unsigned char      *genPointList(
     const freqList_ptr freqList,
-    const unsigned int *pointCounts,
+    const uint64_t *pointCounts,
     const double pointInterval,
-    unsigned long *finalCount
+    int sampleFormat,
+    int markerMode,
+    uint64_t *finalCount,
+    unsigned char **markerList
+);
+
+/*!	@brief Works out the length of the final waveform from its base pulse train.
+ *
+ * Applies the continuity copy and the multiple-of-32 repetitions, checking that the result
+ * stays within #MAX_FINAL_POINTS.
+ *
+ * @param[in] basePoints Number of samples in the base pulse train.
+ * @param[in] flipCopy Non-zero if an inverted copy follows the base train.
+ * @param[out] numShifts The unit is repeated (1 << numShifts) times.
+ * @param[out] finalCount Total number of samples in the final waveform.
+ * @return 0 on success
+ * @return -1 if the final waveform would be longer than #MAX_FINAL_POINTS.
+ */
+int                 finalWaveLength(
+    uint64_t basePoints,
+    int flipCopy,
+    int *numShifts,
+    uint64_t *finalCount
+);
+
+/*!	@brief Works out only the length of the final waveform at a given sample period.
+ *
+ * Applies the same pulse lengths as pointCounts() and the same continuity and
+ * multiple-of-32 rules as planWaveform(), but allocates nothing and skips the envelope
+ * tables, so many sample clocks can be tried cheaply.
+ *
+ * @param[in] freqList A pointer to the the freqList describing the pulse train.
+ * @param[in] pointInterval The output sample period, in ns.
+ * @param[in] sampleFormat One of the @ref SampleFormats.
+ * @param[out] finalCount Total number of samples in the final waveform.
+ * @param[out] durError If not NULL, the RMS difference between each pulse's actual and
+ * requested duration, in ns.
+ * @return 0 on success
+ * @return -1 on bad arguments, or if the waveform is longer than #MAX_FINAL_POINTS.
+ */
+int                 measureWaveform(
+    const freqList_ptr freqList,
+    const double pointInterval,
+    int sampleFormat,
+    uint64_t *finalCount,
+    double *durError
+);
+
+/*!	@brief Works out the layout of the final waveform without generating it.
+ *
+ * Computes the start of every pulse, the sign each pulse is played with, and the continuity
+ * and length-multiple-of-32 duplication genPointList() would apply.  Only the last sample of
+ * each pulse is evaluated, so this is cheap compared to generating the waveform.
+ *
+ * Shaped pulses get their envelope tables here.  Pulses with the same envelope and length
+ * share one table.
+ *
+ * @param[in] freqList A pointer to the the freqList describing the pulse train.
+ * @param[in] pointCounts An array holding the length of each pulse in output samples.
+ * @param[in] pointInterval The output sample period, in ns.
+ * @param[in] sampleFormat One of the @ref SampleFormats.  The sign of each pulse depends on
+ * how the last sample of the one before it is quantized.
+ * @param[out] plan The plan to fill in.  Release its arrays with freeWavePlan().
+ * @return 0 on success
+ * @return -1 on failure, including a waveform longer than #MAX_FINAL_POINTS.
+ */
+int                 planWaveform(
+    const freqList_ptr freqList,
+    const uint64_t *pointCounts,
+    const double pointInterval,
+    int sampleFormat,
+    wavePlan_type * plan
+);
+
+/*!	@brief Frees the arrays held by a #wavePlan and resets it to #WAVE_PLAN_INIT_VAL.
+ *
+ * @param[inout] plan The plan to release.
+ */
+void                freeWavePlan(
+    wavePlan_type * plan
+);
+
+/*!	@brief Generates an arbitrary range of the final waveform's samples.
+ *
+ * Sample offsets refer to the final waveform, including the inverted copy and repetitions.
+ * The result is identical to the same range of the array returned by genPointList().
+ *
+ * @param[in] freqList A pointer to the the freqList describing the pulse train.
+ * @param[in] plan The plan from planWaveform() for the same freqList.
+ * @param[in] start Offset of the first sample to generate.
+ * @param[in] count Number of samples to generate.
+ * @param[out] dest Where to put the samples, must have room for count of them in plan->sampleFormat.
+ * @return 0 on success
+ * @return -1 if the range runs past the end of the waveform.
+ */
+int                 genPointRange(
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    uint64_t start,
+    uint64_t count,
+    unsigned char *dest
+);
+
+/*!	@brief Fills a range of the final waveform from an already generated base train.
+ *
+ * Like genPointRange(), but samples are copied (or inverted) from baseVals instead of generated.
+ *
+ * @param[in] plan The plan the base train was generated from.
+ * @param[in] baseVals The first plan->basePoints samples of the final waveform.
+ * @param[in] start Offset of the first sample to fill.
+ * @param[in] count Number of samples to fill.
+ * @param[out] dest Where to put the samples, must have room for count of them in plan->sampleFormat.
+ * @return 0 on success
+ * @return -1 if the range runs past the end of the waveform.
+ */
+int                 copyPointRange(
+    const wavePlan_type * plan,
+    const unsigned char *baseVals,
+    uint64_t start,
+    uint64_t count,
+    unsigned char *dest
+);
+
+/*!	@brief Fills an arbitrary range of the final waveform's marker points.
+ *
+ * Uses plan->markerMode and the pulse offsets only, no samples are generated.
+ * The result is identical to the same range of the marker array from genPointList().
+ *
+ * @param[in] plan The plan for the waveform, with markerMode set.
+ * @param[in] start Offset of the first marker point to fill.
+ * @param[in] count Number of marker points to fill.
+ * @param[out] dest Where to put the marker points, must have room for count of them.
+ * @return 0 on success
+ * @return -1 if the range runs past the end of the waveform.
+ */
+int                 genMarkerRange(
+    const wavePlan_type * plan,
+    uint64_t start,
+    uint64_t count,
+    unsigned char *dest
 );
 
 /*!	@brief Generate the output samples for an individual pulse.
  *
- * Fills the next numPts unsigned chars starting at startPtr with
+ * Fills the next numPts samples starting at startPtr with
  * a sin wave with the passed parameters.
  *
- * Uses #AWG_ZERO_VAL to set the offset of the waveform from zero.
+ * The format's zero and full scale set the offset and size of the waveform.
  *
  * @warning No bounds checking for the array is performed internally,
  * because the function doesn't have access to the information it needs to do that.
  *
  * @param[in] freq The frequency of the pulse, in MHz
- * @param[in] amp The amplitude of the pulse, should be in the range [-127.0, 127.0]
+ * @param[in] amp The amplitude of the pulse, relative to full scale, in the range [-1.0, 1.0]
  * @param[in] numPts The number of samples to output
  * @param[in] pointInterval The output sample period, in ns.
+ * @param[in] sampleFormat One of the @ref SampleFormats.
  * @param[in] startPtr The first location to put a point in.
  * @return A pointer to the position in the array \e after the last one it filled.
  */
 unsigned char      *genWavePts(
     double freq,
     double amp,
-    unsigned int numPts,
+    uint64_t numPts,
     double pointInterval,
+    int sampleFormat,
+    unsigned char *startPtr
+);
+
+/*!	@brief Generate the output samples for an individual pulse with an envelope.
+ *
+ * Like genWavePts(), with each sample's amplitude scaled by the matching entry of window.
+ * Gives exactly what genWavePts() does if every entry is 1.0.
+ *
+ * @param[in] freq The frequency of the pulse, in MHz
+ * @param[in] amp The amplitude of the pulse, relative to full scale, in the range [-1.0, 1.0]
+ * @param[in] window numPts envelope gains, e.g. from fillEnvelope().
+ * @param[in] numPts The number of samples to output
+ * @param[in] pointInterval The output sample period, in ns.
+ * @param[in] sampleFormat One of the @ref SampleFormats.
+ * @param[in] startPtr The first location to put a point in.
+ * @return A pointer to the position in the array \e after the last one it filled.
+ */
+unsigned char      *genShapedWavePts(
+    double freq,
+    double amp,
+    const double *window,
+    uint64_t numPts,
+    double pointInterval,
+    int sampleFormat,
+    unsigned char *startPtr
+);
+
+/*!	@brief Generate the output samples for any pulse of a freqList, chirp or not.
+ *
+ * A chirp's phase is quadratic in time, so its frequency sweeps linearly from startFreq at
+ * the first sample to stopFreq at the end of its last half cycle, the zero crossing nearest
+ * duration.  Its phase is computed exactly once every #CHIRP_BLOCK_POINTS samples, and
+ * carried between by a rotation per sample, so there is no trigonometry per sample.
+ *
+ * If startFreq equals stopFreq this gives exactly what genShapedWavePts() gives, or
+ * genWavePts() if window is NULL.
+ *
+ * @param[in] startFreq The frequency the pulse starts at, in MHz
+ * @param[in] stopFreq The frequency the pulse ends at, in MHz
+ * @param[in] duration The duration asked for, in ns.  Only used for a chirp.
+ * @param[in] amp The amplitude of the pulse, relative to full scale, in the range [-1.0, 1.0]
+ * @param[in] window numPts envelope gains, e.g. from fillEnvelope(), or NULL for none.
+ * @param[in] numPts The number of samples to output, from pointsToHalfCycle().
+ * @param[in] pointInterval The output sample period, in ns.
+ * @param[in] sampleFormat One of the @ref SampleFormats.
+ * @param[in] startPtr The first location to put a point in.
+ * @return A pointer to the position in the array \e after the last one it filled.
+ */
+unsigned char      *genPulsePts(
+    double startFreq,
+    double stopFreq,
+    double duration,
+    double amp,
+    const double *window,
+    uint64_t numPts,
+    double pointInterval,
+    int sampleFormat,
     unsigned char *startPtr
 );
 
@@ -316,7 +854,7 @@ ssize_t             myGetLine(
 
 /*!	@brief Resizes all sublists of the pointed-to freqList to the specified length.
  *
- * Specifically freqList has array members %freqList, ampList, and durList.
+ * Specifically freqList has array members %freqList, stopList, ampList, durList, and envList.
  *
  * Possible reasons for returning an error value:
  * - Passing a NULL pointer, or a pointer to a NULL pointer
@@ -335,14 +873,15 @@ int                 resizeFreqList(
 /*!	@brief Parse the file at the passed path for a pulse train specification
  *
  * Reads the file line by line via myGetLine() and parses the contents via parseLine(),
- * attempting to build the pulse train specification.
+ * attempting to build the pulse train specification.  A gzip or zstd compressed file is
+ * decompressed as it is read, see openCompressedInput().
  *
  * @param[in] inPath A string containing the path to the file to read the spec's from.
  * @return A pointer to the freqList from parsing the file
  * @return NULL on failures:
  * - Unable to (re)allocate buffers
  * - No pulses specified in the file
- * - Error reading the file
+ * - Error reading the file, or a compressed file that is corrupt or cut short
  */
 freqList_ptr        readSpecFile(
     const char *inPath
@@ -354,62 +893,173 @@ freqList_ptr        readSpecFile(
  *
  * @param[inout] lineBuf The buffer containing the line to be parsed
  * @param[inout] destList The freqList we'll add any specified new pulse.
+ * @param[inout] echoLimit If not NULL, the new pulse is echoed as an informational message,
+ * within this limit.
  * @return 0 on success
  * @return #GEN_BINARY_ERESIZE if we failed to make room for the new pulse.
  * @return #GEN_BINARY_EPARSE if we couldn't parse the line (likely because it was malformed)
  */
 int                 parseLine(
     char *lineBuf,
-    freqList_ptr destList
+    freqList_ptr destList,
+    logLimit_type * echoLimit
 );
 
 /*!	@brief Writes byte stream suitable for transmission to the AWG to a file.
  *
- * File will be output as "\<rootName\>_points".
+ * File will be output as "\<rootName\>_points", with compressSuffix() added if compressed.
  * E.g. a rootName of "test" would result in a file "test_points"
  *
- * See writeSummaryFile() for human-readable description.
+ * See writeSummaryFile() in summary.h for human-readable description.
  *
  * Commands generated to save the waveform on the AWG as "GPIB.WFM",
  * then set up the correct format for the transfer, send the points,
  * set the correct clock frequency, and ask for confirmation information back.
  *
+ * If markerList is given, a @c MARKER:DATA block with it follows the curve.
+ *
  * @param[in] rootName The base of the filename we're saving to.
  * @param[in] ptsList Pointer to the array of output samples, already stored in AWG format
+ * @param[in] markerList numPtrs marker points, or NULL to send no marker block.
  * @param[in] numPtrs Total number of points in the output waveform
+ * @param[in] sampleFormat The @ref SampleFormats value ptsList is stored in.
  * @param[in] clockFreq The output sample frequency
+ * @param[in] compressKind How to compress the file, one of the @ref CompressKinds.
+ * @param[in] compressLevel Compression level, or #COMPRESS_LEVEL_DEFAULT.
+ * @param[inout] digest If not NULL, every byte written is added to it, before compression.
  * @return 0 on success
  * @return -1 on failure
  */
 int                 writeToFile(
     const char *rootName,
     const unsigned char *ptsList,
-    const unsigned long numPtrs,
-    const double clockFreq
+    const unsigned char *markerList,
+    const uint64_t numPtrs,
+    int sampleFormat,
+    const double clockFreq,
+    int compressKind,
+    int compressLevel,
+    outputDigest_type * digest
 );
 
-/*!	@brief Writes a human-readable text file describing the contents of the generated points file.
+/*!	@brief Checks that a curve of numPts samples fits in one block the AWG can read.
+ *
+ * The curve and marker blocks carry their length in @ref FormatASCIINumbers "ASCII number
+ * format", so neither can reach 10^9 bytes.  The marker block is never longer than the curve.
  *
- * File will be output as "\<rootName\>_desc.txt"
- * E.g. a rootName of "test" would result in a file "test_desc.txt"
+ * @param[in] numPts Total number of points in the output waveform.
+ * @param[in] sampleFormat One of the @ref SampleFormats.
+ * @return 0 if the curve is at most #MAX_BLOCK_BYTES long.
+ * @return -1, with an error logged, if it is longer.
+ */
+int                 checkBlockBytes(
+    const uint64_t numPts,
+    int sampleFormat
+);
+
+/*!	@brief Formats the commands that precede the curve data in the points file.
  *
- * The file contains the frequency, amplitude, duration, and number of samples for each pulse, in order.
- * It also lists the output sample frequency (and period) used.
+ * Sets the destination and data width, and starts the @c CURVE command with the
+ * length in bytes in @ref FormatASCIINumbers "ASCII number format".
  *
- * See writeToFile() for actual contents of points file.
+ * @param[out] buf Buffer for the text, which is NULL terminated.
+ * @param[in] bufSize Size of buf, in bytes.
+ * @param[in] numPts Total number of points in the output waveform.
+ * @param[in] sampleFormat One of the @ref SampleFormats.
+ * @return The number of characters written, not counting the terminating NULL.
+ * @return -1 if buf is too small, or if the curve is longer than #MAX_BLOCK_BYTES, which
+ * checkBlockBytes() reports.
+ */
+int                 formatPointsHeader(
+    char *buf,
+    size_t bufSize,
+    const uint64_t numPts,
+    int sampleFormat
+);
+
+/*!	@brief Formats the start of the @c MARKER:DATA command that follows the curve data.
  *
- * @param[in] rootName The base of the filename we're saving to.
- * @param[in] freqList freqList describing the generated pulse train.
- * @param[in] pointCounts Total number of points for each pulse in the output waveform
- * @param[in] clock_freq The output sample frequency
+ * Ends the @c CURVE command and starts @c MARKER:DATA with the length in
+ * @ref FormatASCIINumbers "ASCII number format".  The marker points follow it.
+ *
+ * @param[out] buf Buffer for the text, which is NULL terminated.
+ * @param[in] bufSize Size of buf, in bytes.
+ * @param[in] numPts Total number of points in the output waveform.
+ * @return The number of characters written, not counting the terminating NULL.
+ * @return -1 if buf is too small, or if numPts is more than #MAX_BLOCK_BYTES.
+ */
+int                 formatMarkerHeader(
+    char *buf,
+    size_t bufSize,
+    const uint64_t numPts
+);
+
+/*!	@brief Sends the @c MARKER:DATA block for plan->markerMode, if there is one.
+ *
+ * Marker points are made #DEFAULT_CHUNK_POINTS at a time with genMarkerRange(), so the
+ * streaming paths never hold the whole block.  Call between the curve data and the trailer.
+ *
+ * @param[in] plan The plan for the waveform, with markerMode set.
+ * @param[in] sink Called with each run of bytes, in order.
+ * @param[in] sinkCtx Passed through to sink.
+ * @return 0 on success, including when there is no marker block.
+ * @return -1 on failure, including the sink reporting failure.
+ */
+int                 streamMarkerBlock(
+    const wavePlan_type * plan,
+    byteSink_fn sink,
+    void *sinkCtx
+);
+
+/*!	@brief Formats the commands that follow the curve data in the points file.
+ *
+ * Ends the @c CURVE command, sets the clock frequency, and asks for the waveform preamble back.
+ *
+ * @param[out] buf Buffer for the text, which is NULL terminated.
+ * @param[in] bufSize Size of buf, in bytes.
+ * @param[in] clockFreq The output sample frequency
+ * @return The number of characters written, not counting the terminating NULL.
+ * @return -1 if buf is too small.
+ */
+int                 formatPointsTrailer(
+    char *buf,
+    size_t bufSize,
+    const double clockFreq
+);
+
+/*!	@brief Counts the bytes streamPointsCommand() sends for a plan.
+ *
+ * @param[in] plan The plan from planWaveform(), with markerMode set.
+ * @param[in] clockFreq The output sample frequency
+ * @return The number of bytes in the points file
+ * @return 0 if the header or trailer can't be formatted.
+ */
+uint64_t            pointsCommandBytes(
+    const wavePlan_type * plan,
+    const double clockFreq
+);
+
+/*!	@brief Streams the same bytes writeToFile() would write, generating them as it goes.
+ *
+ * The base pulse train is generated #DEFAULT_CHUNK_POINTS samples at a time, and each chunk is
+ * handed to the sink as soon as it is ready, so a slow sink starts working on the first chunk
+ * while the rest are still being generated.  The inverted copy and repetitions are then sent
+ * from the retained base train, followed by the marker block, if any.
+ *
+ * @param[in] freqList A pointer to the the freqList describing the pulse train.
+ * @param[in] plan The plan from planWaveform() for the same freqList.
+ * @param[in] clockFreq The output sample frequency
+ * @param[in] sink Called with each run of bytes, in order.
+ * @param[in] sinkCtx Passed through to sink.
  * @return 0 on success
- * @return -1 on failure
+ * @return -1 on failure, including the sink reporting failure.
  */
-int                 writeSummaryFile(
-    const char *rootName,
+int                 streamPointsCommand(
     const freqList_ptr freqList,
-    const unsigned int *pointCounts,
-    const double clock_freq
+    const wavePlan_type * plan,
+    const double clockFreq,
+    byteSink_fn sink,
+    void *sinkCtx
 );
 
 #endif
@@ -0,0 +1,212 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "logging.h"
+
+unsigned int        g_logMask = (1u << LOG_ERROR) | (1u << LOG_WARN) | (1u << LOG_INFO);
+
+/* One thread's pending stdout messages */
+typedef struct logBuffer {
+    size_t              used;
+    char                text[LOG_BUFFER_SIZE];
+} logBuffer_type;
+
+static pthread_key_t bufferKey;
+static pthread_once_t bufferOnce = PTHREAD_ONCE_INIT;
+static int          bufferKeyMade = 0;
+static pthread_mutex_t outputLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Writes len bytes of text to stream, whole, with no other thread's output in between. */
+static void writeOut(
+    FILE * stream,
+    const char *text,
+    size_t len
+) {
+    pthread_mutex_lock(&outputLock);
+    fwrite(text, 1, len, stream);
+    fflush(stream);
+    pthread_mutex_unlock(&outputLock);
+    return;
+}
+
+static void flushBuffer(
+    logBuffer_type * buffer
+) {
+    if ((NULL != buffer) && (buffer->used > 0)) {
+	writeOut(stdout, buffer->text, buffer->used);
+	buffer->used = 0;
+    }
+    return;
+}
+
+/* Runs as each thread with a buffer exits. */
+static void releaseBuffer(
+    void *arg
+) {
+    flushBuffer(arg);
+    free(arg);
+    return;
+}
+
+/* The main thread returns from main() rather than exiting, so its buffer is flushed here. */
+static void flushAtExit(
+) {
+    logFlush();
+    return;
+}
+
+static void makeBufferKey(
+) {
+    if (0 == pthread_key_create(&bufferKey, releaseBuffer)) {
+	bufferKeyMade = 1;
+	atexit(flushAtExit);
+    }
+    return;
+}
+
+/* The calling thread's buffer, made on first use.  NULL if it can't be, in which case
+ * messages are written out straight away. */
+static logBuffer_type *threadBuffer(
+) {
+    logBuffer_type     *buffer = NULL;
+
+    pthread_once(&bufferOnce, makeBufferKey);
+    if (!bufferKeyMade)
+	return NULL;
+    buffer = pthread_getspecific(bufferKey);
+    if (NULL == buffer) {
+	buffer = malloc(sizeof (logBuffer_type));
+	if (NULL == buffer)
+	    return NULL;
+	buffer->used = 0;
+	if (pthread_setspecific(bufferKey, buffer)) {
+	    free(buffer);
+	    return NULL;
+	}
+    }
+    return buffer;
+}
+
+void logSetEnabled(
+    int level,
+    int enabled
+) {
+    if (enabled)
+	g_logMask |= (1u << level);
+    else
+	g_logMask &= ~(1u << level);
+    return;
+}
+
+void logMessageV(
+    int level,
+    const char *format,
+    va_list args
+) {
+    logBuffer_type     *buffer = NULL;
+    char                line[LOG_BUFFER_SIZE];
+    va_list             argsCopy;
+    int                 len = 0;
+
+    if (!LOG_ENABLED(level))
+	return;
+    buffer = threadBuffer();
+
+    if ((LOG_ERROR == level) || (LOG_WARN == level)) {
+	flushBuffer(buffer);
+	va_copy(argsCopy, args);
+	len = vsnprintf(line, sizeof (line), format, argsCopy);
+	va_end(argsCopy);
+	if ((len >= 0) && ((size_t) len < sizeof (line))) {
+	    writeOut(stderr, line, (size_t) len);
+	} else {
+	    pthread_mutex_lock(&outputLock);
+	    vfprintf(stderr, format, args);
+	    pthread_mutex_unlock(&outputLock);
+	}
+	return;
+    }
+
+    if (NULL == buffer) {
+	pthread_mutex_lock(&outputLock);
+	vfprintf(stdout, format, args);
+	pthread_mutex_unlock(&outputLock);
+	return;
+    }
+    // Format straight into the buffer, and only if it doesn't fit make room and try again
+    va_copy(argsCopy, args);
+    len = vsnprintf(buffer->text + buffer->used, LOG_BUFFER_SIZE - buffer->used, format,
+		    argsCopy);
+    va_end(argsCopy);
+    if (len < 0)
+	return;
+    if ((size_t) len < LOG_BUFFER_SIZE - buffer->used) {
+	buffer->used += (size_t) len;
+	return;
+    }
+    flushBuffer(buffer);
+    if ((size_t) len < LOG_BUFFER_SIZE) {
+	vsnprintf(buffer->text, LOG_BUFFER_SIZE, format, args);
+	buffer->used = (size_t) len;
+    } else {
+	pthread_mutex_lock(&outputLock);
+	vfprintf(stdout, format, args);
+	fflush(stdout);
+	pthread_mutex_unlock(&outputLock);
+    }
+    return;
+}
+
+void logMessage(
+    int level,
+    const char *format,
+    ...
+) {
+    va_list             args;
+
+    if (!LOG_ENABLED(level))
+	return;
+    va_start(args, format);
+    logMessageV(level, format, args);
+    va_end(args);
+    return;
+}
+
+void logLimited(
+    logLimit_type * limit,
+    int level,
+    const char *format,
+    ...
+) {
+    va_list             args;
+
+    if (!LOG_ENABLED(level))
+	return;
+    if ((limit->shown >= limit->maxShown) && !LOG_ENABLED(LOG_DEBUG)) {
+	limit->suppressed++;
+	return;
+    }
+    limit->shown++;
+    va_start(args, format);
+    logMessageV(level, format, args);
+    va_end(args);
+    return;
+}
+
+void logLimitEnd(
+    const logLimit_type * limit,
+    int level,
+    const char *what
+) {
+    if (limit->suppressed > 0)
+	logMessage(level, "... and %lu more %s (-d shows them all).\n", limit->suppressed, what);
+    return;
+}
+
+void logFlush(
+) {
+    flushBuffer(threadBuffer());
+    return;
+}
@@ -0,0 +1,125 @@
+
+/*! @file logging.h
+ * @brief Leveled messages for the console, buffered per thread.
+ *
+ * Informational and debug messages go to stdout through a buffer owned by the calling
+ * thread, so generator and worker threads can report without contending on stdout or
+ * interleaving partial lines.  A buffer is written out in one piece when it fills, when
+ * logFlush() is called from its thread, when its thread exits, and at program exit.
+ *
+ * Errors and warnings go to stderr straight away, after the calling thread's pending
+ * stdout messages, so the two stay in order on a terminal.
+ *
+ * Per-pulse messages are rate limited with a #logLimit, so verbose runs over large
+ * specifications stay cheap.
+ */
+
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <stdarg.h>
+
+/*!
+ * @defgroup LogLevels Message levels
+ * @brief Each level can be turned on or off on its own, see logSetEnabled().
+ * @{
+ */
+#define LOG_ERROR 0	//!< Something failed.  To stderr, on by default.
+#define LOG_WARN  1	//!< Something was skipped or adjusted.  To stderr, on by default.
+#define LOG_INFO  2	//!< Normal progress output.  To stdout, on by default, off with -q.
+#define LOG_DEBUG 3	//!< Internal detail.  To stdout, off by default, on with -d.
+
+/*! @} */
+
+#define LOG_BUFFER_SIZE 8192	//!< Bytes of stdout messages each thread holds before writing them out.
+#define LOG_PULSE_LIMIT 20	//!< Per-pulse messages shown by a #LOG_LIMIT_INIT_VAL limit, unless debug messages are on.
+
+extern unsigned int g_logMask;	//!< Bit (1 << level) is set for each enabled level.  Read through #LOG_ENABLED.
+
+#define LOG_ENABLED(level) (0 != (g_logMask & (1u << (level))))	//!< Non-zero if messages at level are shown.  Cheap enough to guard hot-path messages with.
+
+/*! @brief Counts the messages of one kind, so only the first few are shown.
+ *
+ * A limit is only used from one thread at a time.
+ *
+ * Expected initialization found in #LOG_LIMIT_INIT_VAL
+ */
+typedef struct logLimit {
+    unsigned long       maxShown;	//!< Messages shown before the rest are only counted.
+    unsigned long       shown;	//!< Messages shown so far.
+    unsigned long       suppressed;	//!< Messages counted but not shown.
+} logLimit_type;
+
+#define LOG_LIMIT_INIT_VAL {LOG_PULSE_LIMIT, 0, 0}	//!< Initialization data for a #logLimit instantiation.
+
+/*!	@brief Turns the messages of one level on or off.
+ *
+ * Meant to be called while only one thread is running, e.g. when parsing options.
+ *
+ * @param[in] level One of the @ref LogLevels.
+ * @param[in] enabled Non-zero to show the level's messages.
+ */
+void                logSetEnabled(
+    int level,
+    int enabled
+);
+
+/*!	@brief Formats a message at the given level, as printf() would.
+ *
+ * Nothing is formatted if the level is off.  The message should end in a newline unless
+ * it is followed by logFlush(), e.g. for a progress line ending in a carriage return.
+ *
+ * @param[in] level One of the @ref LogLevels.
+ * @param[in] format printf() format string.
+ */
+void                logMessage(
+    int level,
+    const char *format,
+    ...
+);
+
+/*!	@brief Like logMessage(), with the arguments as a va_list.
+ *
+ * @param[in] level One of the @ref LogLevels.
+ * @param[in] format printf() format string.
+ * @param[in] args The format's arguments.
+ */
+void                logMessageV(
+    int level,
+    const char *format,
+    va_list args
+);
+
+/*!	@brief Like logMessage(), but only for the first limit->maxShown calls with this limit.
+ *
+ * Every call is shown while debug messages are on.
+ *
+ * @param[inout] limit Counts the calls.
+ * @param[in] level One of the @ref LogLevels.
+ * @param[in] format printf() format string.
+ */
+void                logLimited(
+    logLimit_type * limit,
+    int level,
+    const char *format,
+    ...
+);
+
+/*!	@brief Says how many messages a limit held back, if any.
+ *
+ * @param[in] limit The limit used with logLimited().
+ * @param[in] level One of the @ref LogLevels.
+ * @param[in] what What the messages were about, e.g. "teeth".
+ */
+void                logLimitEnd(
+    const logLimit_type * limit,
+    int level,
+    const char *what
+);
+
+/*!	@brief Writes out the calling thread's pending stdout messages.
+ */
+void                logFlush(
+);
+
+#endif
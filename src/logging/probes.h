@@ -0,0 +1,47 @@
+
+/*! @file probes.h
+ * @brief Static tracepoints for profiling a live run.
+ *
+ * Where configure finds sys/sdt.h (systemtap-sdt-dev or equivalent), each stage of generation
+ * marks its start and end with a USDT probe of provider "awgcom".  A probe is a single nop
+ * until a tracer attaches, so the default path is not slowed, and perf, bpftrace or systemtap
+ * can time the stages of a running awgcom without rebuilding it, e.g.
+ * @code
+ * bpftrace -e 'usdt:./awgcom:awgcom:tooth_start { @s[tid] = nsecs; }
+ *              usdt:./awgcom:awgcom:tooth_done { @ns = hist(nsecs - @s[tid]); }'
+ * @endcode
+ * Without sys/sdt.h the probes compile to nothing, arguments and all, so nothing may be
+ * computed only to be passed to one.
+ *
+ * @section ProbeList Probes
+ * The @c _done probe of a stage only fires when the stage succeeds.
+ * Probe | Arguments
+ * ----- | ---------
+ * spec_read_start, spec_read_done | path; lines read, pulses found
+ * parse_line_start, parse_line_done | index the pulse would take; parseLine() result
+ * point_counts_start, point_counts_done | pulses
+ * gen_list_start, gen_list_done | pulses; final points
+ * tooth_start, tooth_done | pulse index, first sample within it, samples generated
+ * wave_pts_start, wave_pts_done | samples, from genWavePts(), genShapedWavePts() and genPulsePts()
+ * flip_start, flip_done | base points; points after the inverted copy
+ * repeat_start, repeat_done | doubling step, points before; points after
+ * write_start, write_done | final points; bytes written
+ * chunk_gen_start, chunk_gen_done | chunk index, samples, on the --pipeline generator threads
+ * chunk_write_start, chunk_write_done | chunk index, bytes, on the --pipeline writer
+ */
+
+#ifndef PROBES_H
+#define PROBES_H
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define AWG_PROBE1(name, a) DTRACE_PROBE1(awgcom, name, a)	//!< Fires probe awgcom:name with one argument.
+#define AWG_PROBE2(name, a, b) DTRACE_PROBE2(awgcom, name, a, b)	//!< Fires probe awgcom:name with two arguments.
+#define AWG_PROBE3(name, a, b, c) DTRACE_PROBE3(awgcom, name, a, b, c)	//!< Fires probe awgcom:name with three arguments.
+#else
+#define AWG_PROBE1(name, a) do { } while (0)
+#define AWG_PROBE2(name, a, b) do { } while (0)
+#define AWG_PROBE3(name, a, b, c) do { } while (0)
+#endif
+
+#endif
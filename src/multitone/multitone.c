@@ -0,0 +1,355 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "multitone.h"
+#include "../fft/fft.h"
+#include "../logging/logging.h"
+
+int parsePhaseModeName(
+    const char *name
+) {
+    if (0 == strcmp(name, "zero"))
+	return MULTITONE_PHASE_ZERO;
+    if (0 == strcmp(name, "newman"))
+	return MULTITONE_PHASE_NEWMAN;
+    if (0 == strcmp(name, "minimize"))
+	return MULTITONE_PHASE_MINIMIZE;
+    return -1;
+}
+
+static const char  *phaseModeName(
+    int phaseMode
+) {
+    switch (phaseMode) {
+    case MULTITONE_PHASE_ZERO:
+	return "zero";
+    case MULTITONE_PHASE_MINIMIZE:
+	return "minimized";
+    default:
+	return "Newman";
+    }
+}
+
+/* Bins in ascending order, for qsort() on indexes into it. */
+static const uint64_t *sortBins;
+
+static int compareBins(
+    const void *a,
+    const void *b
+) {
+    const uint64_t      binA = *(sortBins + *((const unsigned int *) a));
+    const uint64_t      binB = *(sortBins + *((const unsigned int *) b));
+
+    return (binA > binB) - (binA < binB);
+}
+
+/* Checks no two tones share a bin, and gives them Newman's phases in order of frequency. */
+static int orderTones(
+    multitone_type * tones
+) {
+    const unsigned int  count = tones->toneCount;
+    unsigned int       *order = malloc(sizeof (unsigned int) * count);
+    unsigned int        r = 0;
+
+    if (NULL == order)
+	return -1;
+    for (r = 0; r < count; r++)
+	*(order + r) = r;
+    sortBins = tones->bin;
+    qsort(order, count, sizeof (unsigned int), compareBins);
+
+    for (r = 0; r < count; r++) {
+	const unsigned int  tone = *(order + r);
+
+	if ((r > 0) && (*(tones->bin + tone) == *(tones->bin + *(order + r - 1)))) {
+	    logMessage(LOG_ERROR, "Tones at %g and %g MHz fall in the same bin, %g MHz wide.\n",
+		       *(tones->reqFreq + *(order + r - 1)), *(tones->reqFreq + tone),
+		       tones->clockFreq / ((double) tones->points));
+	    free(order);
+	    return -1;
+	}
+	// pi r^2 / count, with r^2 reduced first so large counts keep their precision
+	if (MULTITONE_PHASE_ZERO == tones->phaseMode)
+	    *(tones->phase + tone) = 0.0;
+	else
+	    *(tones->phase + tone) = M_PI * ((double) ((((uint64_t) r) * r) % (2ul * count)))
+		/ ((double) count);
+    }
+    free(order);
+    return 0;
+}
+
+int planMultitone(
+    const freqList_ptr freqList,
+    const double clockFreq,
+    uint64_t points,
+    int phaseMode,
+    multitone_type * tones
+) {
+    const multitone_type blankTones = MULTITONE_INIT_VAL;
+    double              binWidth = 0.0;
+    double              maxMove = 0.0;
+    unsigned int        i = 0;
+
+    *tones = blankTones;
+    if ((points < MULTITONE_MIN_POINTS) || (points > MULTITONE_MAX_POINTS)
+	|| (0 != (points & (points - 1))) || (clockFreq <= 0.0) || (0 == freqList->freqCount))
+	return -1;
+    tones->points = points;
+    tones->clockFreq = clockFreq;
+    tones->phaseMode = phaseMode;
+    tones->toneCount = freqList->freqCount;
+    tones->reqFreq = malloc(sizeof (double) * tones->toneCount);
+    tones->bin = malloc(sizeof (uint64_t) * tones->toneCount);
+    tones->amp = malloc(sizeof (double) * tones->toneCount);
+    tones->phase = malloc(sizeof (double) * tones->toneCount);
+    if ((NULL == tones->reqFreq) || (NULL == tones->bin) || (NULL == tones->amp)
+	|| (NULL == tones->phase)) {
+	perror("planMultitone allocation");
+	freeMultitone(tones);
+	return -1;
+    }
+
+    binWidth = clockFreq / ((double) points);
+    for (i = 0; i < tones->toneCount; i++) {
+	const double        freq = pulseFreq(freqList, i);
+	const double        nearest = floor(freq / binWidth + 0.5);
+
+	if (pulseStopFreq(freqList, i) != freq) {
+	    logMessage(LOG_ERROR, "Pulse %u is a chirp, which has no one tone to play.\n", i);
+	    freeMultitone(tones);
+	    return -1;
+	}
+	// DC and Nyquist have no phase to speak of, so neither can hold a tone
+	if ((nearest < 1.0) || (nearest >= (double) (points / 2))) {
+	    logMessage(LOG_ERROR, "Tone at %g MHz is not between %g MHz and the %g MHz Nyquist "
+		       "frequency on the grid.\n", freq, binWidth, 0.5 * clockFreq);
+	    freeMultitone(tones);
+	    return -1;
+	}
+	*(tones->reqFreq + i) = freq;
+	*(tones->bin + i) = (uint64_t) nearest;
+	*(tones->amp + i) = pulseAmp(freqList, i);
+	if (fabs(nearest * binWidth - freq) > maxMove)
+	    maxMove = fabs(nearest * binWidth - freq);
+    }
+    if (orderTones(tones)) {
+	freeMultitone(tones);
+	return -1;
+    }
+    logMessage(LOG_INFO, "%u tones on a %g MHz grid, each moved by at most %g MHz.\n",
+	       tones->toneCount, binWidth, maxMove);
+    return 0;
+}
+
+void freeMultitone(
+    multitone_type * tones
+) {
+    const multitone_type blankTones = MULTITONE_INIT_VAL;
+
+    if (NULL != tones->reqFreq)
+	free(tones->reqFreq);
+    if (NULL != tones->bin)
+	free(tones->bin);
+    if (NULL != tones->amp)
+	free(tones->amp);
+    if (NULL != tones->phase)
+	free(tones->phase);
+    *tones = blankTones;
+    return;
+}
+
+/* Synthesizes the record for the current phases into data, returning its peak magnitude.
+ *
+ * The half-spectrum is packed straight into the m = points / 2 complex values an FFT of half
+ * the length needs, so the inverse comes out as the real samples in order.  A tone of
+ * amplitude a and phase p in bin k is X[k] = a exp(i p) / 2, and adds X[k] (1 + i w^k) to
+ * Z[k] and conj(X[k]) (1 + i conj(w^k)) to Z[m - k], with w = exp(2 pi i / points). */
+static double synthRecord(
+    const multitone_type * tones,
+    double *data,
+    const fftTwiddles_type * tw
+) {
+    const uint64_t      m = tones->points / 2;
+    double              peak = 0.0;
+    uint64_t            n = 0;
+    unsigned int        i = 0;
+
+    memset(data, 0, sizeof (double) * tones->points);
+    for (i = 0; i < tones->toneCount; i++) {
+	const uint64_t      k = *(tones->bin + i);
+	const double        cr = 0.5 * *(tones->amp + i) * cos(*(tones->phase + i));
+	const double        ci = 0.5 * *(tones->amp + i) * sin(*(tones->phase + i));
+	const double        wr = tw->cosTab[k];
+	const double        wi = tw->sinTab[k];
+	const double        cw = cr * wi + ci * wr;
+	const double        rw = cr * wr - ci * wi;
+
+	data[2 * k] += cr - cw;
+	data[2 * k + 1] += ci + rw;
+	data[2 * (m - k)] += cr + cw;
+	data[2 * (m - k) + 1] += rw - ci;
+    }
+    fftRadix2(data, data + 1, 2, m, tw, 1);
+
+    for (n = 0; n < tones->points; n++) {
+	if (fabs(data[n]) > peak)
+	    peak = fabs(data[n]);
+    }
+    return peak;
+}
+
+/* Takes each tone's phase from the spectrum of the (clipped) record in data. */
+static void takePhases(
+    multitone_type * tones,
+    double *data,
+    const fftTwiddles_type * tw
+) {
+    const uint64_t      m = tones->points / 2;
+    unsigned int        i = 0;
+
+    fftRadix2(data, data + 1, 2, m, tw, 0);
+    // X[k] = E - i conj(w^k) D, from the sum E and difference D of Z[k] and conj(Z[m - k])
+    for (i = 0; i < tones->toneCount; i++) {
+	const uint64_t      k = *(tones->bin + i);
+	const double        er = 0.5 * (data[2 * k] + data[2 * (m - k)]);
+	const double        ei = 0.5 * (data[2 * k + 1] - data[2 * (m - k) + 1]);
+	const double        dr = 0.5 * (data[2 * k] - data[2 * (m - k)]);
+	const double        di = 0.5 * (data[2 * k + 1] + data[2 * (m - k) + 1]);
+	const double        wr = tw->cosTab[k];
+	const double        wi = -tw->sinTab[k];
+
+	*(tones->phase + i) = atan2(ei - (wr * dr - wi * di), er + (wr * di + wi * dr));
+    }
+    return;
+}
+
+/* Lowers the peak by clipping the record and keeping only the phases of what is left,
+ * a few passes at a time, until the peak stops improving.  The best phases are kept. */
+static int minimizeCrest(
+    multitone_type * tones,
+    double *data,
+    const fftTwiddles_type * tw
+) {
+    double             *best = malloc(sizeof (double) * tones->toneCount);
+    double              peak = 0.0;
+    double              bestPeak = 0.0;
+    unsigned int        pass = 0;
+    unsigned int        stall = 0;
+
+    if (NULL == best)
+	return -1;
+    peak = synthRecord(tones, data, tw);
+    bestPeak = peak;
+    memcpy(best, tones->phase, sizeof (double) * tones->toneCount);
+
+    for (pass = 0; (pass < MULTITONE_CREST_ITERATIONS) && (stall < MULTITONE_CREST_STALL);
+	 pass++) {
+	const double        clip = MULTITONE_CLIP_LEVEL * peak;
+	uint64_t            n = 0;
+
+	for (n = 0; n < tones->points; n++)
+	    data[n] = (data[n] > clip) ? clip : ((data[n] < -clip) ? -clip : data[n]);
+	takePhases(tones, data, tw);
+	peak = synthRecord(tones, data, tw);
+	if (peak < bestPeak) {
+	    bestPeak = peak;
+	    memcpy(best, tones->phase, sizeof (double) * tones->toneCount);
+	    stall = 0;
+	} else {
+	    stall++;
+	}
+    }
+    memcpy(tones->phase, best, sizeof (double) * tones->toneCount);
+    free(best);
+    logMessage(LOG_DEBUG, "Phases refined over %u passes.\n", pass);
+    return 0;
+}
+
+unsigned char      *synthMultitone(
+    multitone_type * tones,
+    int sampleFormat
+) {
+    double             *data = NULL;
+    fftTwiddles_type    tw = FFT_TWIDDLES_INIT_VAL;
+    unsigned char      *samples = NULL;
+    double              sumSq = 0.0;
+    double              maxAmp = 0.0;
+    double              peak = 0.0;
+    unsigned int        i = 0;
+
+    for (i = 0; i < tones->toneCount; i++) {
+	sumSq += *(tones->amp + i) * *(tones->amp + i);
+	if (fabs(*(tones->amp + i)) > maxAmp)
+	    maxAmp = fabs(*(tones->amp + i));
+    }
+    if (0.0 == maxAmp) {
+	logMessage(LOG_ERROR, "Every tone has zero amplitude.\n");
+	return NULL;
+    }
+
+    data = malloc(sizeof (double) * tones->points);
+    samples = malloc(sampleFormatInfo(sampleFormat)->width * tones->points);
+    // The packing needs exp(2 pi i k / points), so the table is made for the full length
+    if ((NULL == data) || initFftTwiddles(tones->points, &tw) || (NULL == samples)) {
+	perror("synthMultitone allocation");
+	free(samples);
+	samples = NULL;
+    } else {
+	if ((MULTITONE_PHASE_MINIMIZE == tones->phaseMode) && minimizeCrest(tones, data, &tw)) {
+	    free(samples);
+	    samples = NULL;
+	}
+    }
+
+    if (NULL != samples) {
+	uint64_t            n = 0;
+
+	// Every tone has whole cycles in the record, so its RMS is exact
+	peak = synthRecord(tones, data, &tw);
+	tones->crestFactor = peak / sqrt(0.5 * sumSq);
+	logMessage(LOG_INFO, "Crest factor %.3f (%.2f dB) with %s phases.\n", tones->crestFactor,
+		   20.0 * log10(tones->crestFactor), phaseModeName(tones->phaseMode));
+	for (n = 0; n < tones->points; n++)
+	    data[n] *= maxAmp / peak;
+	encodeSamples(sampleFormat, data, tones->points, samples);
+    }
+    if (NULL != data)
+	free(data);
+    freeFftTwiddles(&tw);
+    return samples;
+}
+
+int writeToneTable(
+    const char *rootName,
+    const multitone_type * tones
+) {
+    FILE               *csvFile = NULL;
+    char               *fileName = NULL;
+    const char          fileNameSuf[] = "_tones.csv";
+    const double        binWidth = tones->clockFreq / ((double) tones->points);
+    unsigned int        i = 0;
+
+    fileName = malloc(strlen(rootName) + strlen(fileNameSuf) + 1);
+    if (NULL == fileName)
+	return -1;
+    strcpy(fileName, rootName);
+    strcat(fileName, fileNameSuf);
+    csvFile = fopen(fileName, "w");
+    free(fileName);
+    if (NULL == csvFile)
+	return -1;
+
+    fprintf(csvFile, "index,requested_mhz,actual_mhz,bin,amplitude,phase_rad\n");
+    for (i = 0; i < tones->toneCount; i++)
+	fprintf(csvFile, "%u,%.9g,%.9g,%" PRIu64 ",%.9g,%.9g\n", i, *(tones->reqFreq + i),
+		((double) *(tones->bin + i)) * binWidth, *(tones->bin + i), *(tones->amp + i),
+		*(tones->phase + i));
+    if (ferror(csvFile)) {
+	fclose(csvFile);
+	return -1;
+    }
+    return fclose(csvFile) ? -1 : 0;
+}
@@ -0,0 +1,130 @@
+
+/*! @file multitone.h
+ * @brief Plays every pulse of the spec at once, as one multitone record, instead of in turn.
+ *
+ * Each frequency is moved to the nearest bin of an FFT grid matched to the record, the
+ * sample clock divided by the record length.  Every tone then has a whole number of cycles
+ * in the record, so the AWG can loop it without a seam.  The record is synthesized with one
+ * inverse real FFT, as an FFT of half the length and one pass to unpack it, so the cost does
+ * not depend on the number of tones.
+ *
+ * The durations and envelopes of the pulses play no part.  The amplitudes are relative to
+ * each other; the record is scaled so its peak sits at the largest amplitude times full scale,
+ * then quantized with encodeSamples().
+ *
+ * The peak, and with it how much of the output range the tones get, depends on their phases.
+ * Newman's phases are a good choice for tones spread over the grid, and cost nothing.  The
+ * minimizing assignment starts from those and refines them by clipping the record and taking
+ * the phases back from its spectrum, keeping the best found.  See @ref PhaseModes.
+ */
+
+#ifndef MULTITONE_H
+#define MULTITONE_H
+
+#include <stdint.h>
+#include "../genBinary/genBinary.h"
+
+#define MULTITONE_MIN_POINTS 32	//!< Shortest record, the AWG's length multiple.
+#define MULTITONE_MAX_POINTS (1ul << 24)	//!< Longest record.  Synthesis holds 16 bytes per point.
+#define MULTITONE_CREST_ITERATIONS 200	//!< Most clip and restore passes #MULTITONE_PHASE_MINIMIZE makes.
+#define MULTITONE_CREST_STALL 20	//!< #MULTITONE_PHASE_MINIMIZE stops after this many passes without a lower peak.
+#define MULTITONE_CLIP_LEVEL 0.9	//!< Each pass of #MULTITONE_PHASE_MINIMIZE clips at this fraction of the peak.
+
+/*!
+ * @defgroup PhaseModes Multitone phase assignments
+ * @brief How the phases of the tones are chosen, given with --phases.
+ * @{
+ */
+#define MULTITONE_PHASE_ZERO     0	//!< Every tone starts at zero phase.  The peak is the sum of the amplitudes.
+#define MULTITONE_PHASE_NEWMAN   1	//!< Tone i of n has phase pi i^2 / n.  The default.
+#define MULTITONE_PHASE_MINIMIZE 2	//!< Newman's, refined to lower the crest factor.
+
+/*! @} */
+
+/*! @brief A multitone record, from planMultitone().
+ *
+ * The arrays are in the order of the pulses in the freqList.
+ * Expected initialization found in #MULTITONE_INIT_VAL
+ */
+typedef struct multitone {
+    uint64_t            points;	//!< Samples in the record, a power of two.
+    double              clockFreq;	//!< Sample clock, in MHz.
+    unsigned int        toneCount;	//!< Number of tones.
+    double             *reqFreq;	//!< Each tone's frequency as given, in MHz.
+    uint64_t           *bin;	//!< Each tone's FFT bin, so its frequency is bin * clockFreq / points.
+    double             *amp;	//!< Each tone's relative amplitude.
+    double             *phase;	//!< Each tone's phase, in radians, as a cosine at the first sample.
+    int                 phaseMode;	//!< One of the @ref PhaseModes.
+    double              crestFactor;	//!< Peak over RMS of the record before quantizing, set by synthMultitone().
+} multitone_type;
+
+#define MULTITONE_INIT_VAL {0, 0.0, 0, NULL, NULL, NULL, NULL, MULTITONE_PHASE_NEWMAN, 0.0}	//!< Initialization data for a #multitone instantiation.
+
+/*!	@brief Turns a phase assignment name into its value.
+ *
+ * @param[in] name "zero", "newman" or "minimize".
+ * @return One of the @ref PhaseModes values
+ * @return -1 if the name is not known.
+ */
+int                 parsePhaseModeName(
+    const char *name
+);
+
+/*!	@brief Places the pulses of a freqList on the FFT grid of a record.
+ *
+ * @param[in] freqList The tones to play.
+ * @param[in] clockFreq The output sample frequency, in MHz.
+ * @param[in] points Samples in the record, a power of two from #MULTITONE_MIN_POINTS to
+ * #MULTITONE_MAX_POINTS.
+ * @param[in] phaseMode One of the @ref PhaseModes.
+ * @param[out] tones The record to fill in.  Release its arrays with freeMultitone().
+ * @return 0 on success
+ * @return -1 on failure, including a tone outside (0, Nyquist) on the grid, or two tones in
+ * the same bin.
+ */
+int                 planMultitone(
+    const freqList_ptr freqList,
+    const double clockFreq,
+    uint64_t points,
+    int phaseMode,
+    multitone_type * tones
+);
+
+/*!	@brief Frees the arrays held by a #multitone and resets it to #MULTITONE_INIT_VAL.
+ *
+ * @param[inout] tones The record to release.
+ */
+void                freeMultitone(
+    multitone_type * tones
+);
+
+/*!	@brief Synthesizes and quantizes the record.
+ *
+ * With #MULTITONE_PHASE_MINIMIZE, the phases are refined first, and tones->phase updated.
+ *
+ * @param[inout] tones The record from planMultitone().  Its crestFactor is set.
+ * @param[in] sampleFormat One of the @ref SampleFormats.
+ * @return tones->points samples, to be freed by the caller
+ * @return NULL on failure
+ */
+unsigned char      *synthMultitone(
+    multitone_type * tones,
+    int sampleFormat
+);
+
+/*!	@brief Writes "\<rootName\>_tones.csv", one line per tone.
+ *
+ * Gives the frequency asked for and the one on the grid (MHz), the bin, the amplitude and
+ * the phase (radians) of each tone.
+ *
+ * @param[in] rootName The base of the filename we're saving to.
+ * @param[in] tones The record, after synthMultitone().
+ * @return 0 on success
+ * @return -1 on failure
+ */
+int                 writeToneTable(
+    const char *rootName,
+    const multitone_type * tones
+);
+
+#endif
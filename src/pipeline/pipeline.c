@@ -0,0 +1,571 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <pthread.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#include "pipeline.h"
+#include "../platform/platform.h"
+#include "../logging/logging.h"
+#include "../logging/probes.h"
+
+/* One buffer in the ring */
+typedef struct pipelineSlot {
+    unsigned char      *data;
+    uint64_t            chunk;	     // Which chunk is in data, valid if filled
+    int                 filled;
+} pipelineSlot_type;
+
+/* Everything the generator threads and the writer share.  All fields after lock are
+ * protected by it, the ones before are read-only once the threads start. */
+typedef struct pipelineState {
+    freqList_ptr        freqList;
+    const wavePlan_type *plan;
+    unsigned int        width;	     // Bytes per sample
+    uint64_t            chunkPoints;
+    uint64_t            chunkCount;
+    uint64_t            firstChunk;	     // Chunks before this were sent by an earlier run
+    unsigned int        slotCount;
+    pipelineSlot_type  *slots;
+    unsigned char      *baseVals;	     // Retained base train, NULL if nothing is duplicated
+    uint64_t            baseChunks;	     // Chunks that hold part of the base train
+    unsigned char      *baseDone;	     // Per base chunk, non-zero once copied to baseVals
+    unsigned char      *pool;	     // For realtime, the mapping the buffers above are carved from
+    size_t              poolBytes;
+
+    pthread_mutex_t     lock;
+    pthread_cond_t      slotFreed;
+    pthread_cond_t      slotFilled;
+    pthread_cond_t      baseProgress;
+    uint64_t            nextChunk;	     // Next chunk for a generator to claim
+    uint64_t            chunksWritten;	     // Chunks the writer has finished with
+    uint64_t            baseReady;	     // Base chunks [0, baseReady) are all in baseVals
+    int                 failed;
+    double              genSeconds;
+    double              genWaitSeconds;
+} pipelineState_type;
+
+static void markFailed(
+    pipelineState_type * state
+) {
+    pthread_mutex_lock(&state->lock);
+    state->failed = 1;
+    pthread_cond_broadcast(&state->slotFreed);
+    pthread_cond_broadcast(&state->slotFilled);
+    pthread_cond_broadcast(&state->baseProgress);
+    pthread_mutex_unlock(&state->lock);
+    return;
+}
+
+/* Records that the base train part of chunk is in baseVals, for the copies waiting on it. */
+static void baseChunkDone(
+    pipelineState_type * state,
+    uint64_t chunk
+) {
+    pthread_mutex_lock(&state->lock);
+    *(state->baseDone + chunk) = 1;
+    while ((state->baseReady < state->baseChunks) && *(state->baseDone + state->baseReady))
+	state->baseReady++;
+    pthread_cond_broadcast(&state->baseProgress);
+    pthread_mutex_unlock(&state->lock);
+    return;
+}
+
+/* Generates the base train part of a chunk sent before a resume, for the copies only. */
+static int genSentBase(
+    pipelineState_type * state,
+    uint64_t chunk
+) {
+    const uint64_t      start = chunk * state->chunkPoints;
+    uint64_t            end = start + state->chunkPoints;
+
+    if (end > state->plan->basePoints)
+	end = state->plan->basePoints;
+    if (genPointRange(state->freqList, state->plan, start, end - start,
+		      state->baseVals + start * state->width))
+	return -1;
+    baseChunkDone(state, chunk);
+    return 0;
+}
+
+/* Fills dest with chunk number chunk of the final waveform. */
+static int genChunk(
+    pipelineState_type * state,
+    uint64_t chunk,
+    unsigned char *dest
+) {
+    const wavePlan_type *plan = state->plan;
+    const uint64_t      basePoints = plan->basePoints;
+    uint64_t            start = chunk * state->chunkPoints;
+    uint64_t            end = start + state->chunkPoints;
+
+    if (end > plan->finalCount)
+	end = plan->finalCount;
+
+    if (start < basePoints) {
+	uint64_t            baseEnd = (end < basePoints) ? end : basePoints;
+
+	if (genPointRange(state->freqList, plan, start, baseEnd - start, dest))
+	    return -1;
+	if (NULL != state->baseVals) {
+	    memcpy(state->baseVals + start * state->width, dest,
+		   (baseEnd - start) * state->width);
+	    baseChunkDone(state, chunk);
+	}
+	dest += (baseEnd - start) * state->width;
+	start = baseEnd;
+    }
+
+    if (start < end) {
+	// Past the base train, copy from it once every part of it exists
+	int                 failed = 0;
+
+	pthread_mutex_lock(&state->lock);
+	while (!state->failed && (state->baseReady < state->baseChunks))
+	    pthread_cond_wait(&state->baseProgress, &state->lock);
+	failed = state->failed;
+	pthread_mutex_unlock(&state->lock);
+	if (failed)
+	    return -1;
+	if (copyPointRange(plan, state->baseVals, start, end - start, dest))
+	    return -1;
+    }
+    return 0;
+}
+
+static void        *generatorThread(
+    void *arg
+) {
+    pipelineState_type *state = arg;
+    double              genSeconds = 0.0;
+    double              waitSeconds = 0.0;
+
+    pthread_mutex_lock(&state->lock);
+    while (!state->failed && (state->nextChunk < state->chunkCount)) {
+	uint64_t            chunk = 0;
+	pipelineSlot_type  *slot = NULL;
+	double              startTime = monotonicSeconds();
+
+	// Of the chunks already sent, only the base train is needed, for the copies
+	if ((state->nextChunk < state->firstChunk) && (state->nextChunk >= state->baseChunks))
+	    state->nextChunk = state->firstChunk;
+	if (state->nextChunk >= state->chunkCount)
+	    break;
+	chunk = state->nextChunk++;
+	if (chunk < state->firstChunk) {
+	    pthread_mutex_unlock(&state->lock);
+	    if (genSentBase(state, chunk)) {
+		markFailed(state);
+		pthread_mutex_lock(&state->lock);
+		break;
+	    }
+	    genSeconds += monotonicSeconds() - startTime;
+	    pthread_mutex_lock(&state->lock);
+	    continue;
+	}
+	slot = state->slots + (chunk % state->slotCount);
+
+	// Backpressure: wait for the writer to finish with this slot's previous chunk
+	while (!state->failed && (chunk >= state->chunksWritten + state->slotCount))
+	    pthread_cond_wait(&state->slotFreed, &state->lock);
+	if (state->failed)
+	    break;
+	waitSeconds += monotonicSeconds() - startTime;
+	pthread_mutex_unlock(&state->lock);
+
+	startTime = monotonicSeconds();
+	AWG_PROBE2(chunk_gen_start, chunk, state->chunkPoints);
+	if (genChunk(state, chunk, slot->data)) {
+	    markFailed(state);
+	    pthread_mutex_lock(&state->lock);
+	    break;
+	}
+	AWG_PROBE1(chunk_gen_done, chunk);
+	genSeconds += monotonicSeconds() - startTime;
+
+	pthread_mutex_lock(&state->lock);
+	slot->chunk = chunk;
+	slot->filled = 1;
+	pthread_cond_broadcast(&state->slotFilled);
+    }
+    state->genSeconds += genSeconds;
+    state->genWaitSeconds += waitSeconds;
+    pthread_mutex_unlock(&state->lock);
+    return NULL;
+}
+
+/* Drains the ring into the sink, in chunk order. */
+static int drainRing(
+    pipelineState_type * state,
+    byteSink_fn sink,
+    void *sinkCtx,
+    pipelineStats_type * stats
+) {
+    uint64_t            chunk = 0;
+    int                 failed = 0;
+
+    for (chunk = state->firstChunk; chunk < state->chunkCount; chunk++) {
+	pipelineSlot_type  *slot = state->slots + (chunk % state->slotCount);
+	uint64_t            len = state->plan->finalCount - chunk * state->chunkPoints;
+	const double        waitStart = monotonicSeconds();
+	double              startTime = waitStart;
+	double              doneTime = 0.0;
+
+	if (len > state->chunkPoints)
+	    len = state->chunkPoints;
+
+	pthread_mutex_lock(&state->lock);
+	while (!state->failed && !(slot->filled && (slot->chunk == chunk)))
+	    pthread_cond_wait(&state->slotFilled, &state->lock);
+	failed = state->failed;
+	pthread_mutex_unlock(&state->lock);
+	if (failed)
+	    return -1;
+	stats->writeWaitSeconds += monotonicSeconds() - startTime;
+
+	startTime = monotonicSeconds();
+	AWG_PROBE2(chunk_write_start, chunk, len * state->width);
+	if (sink(sinkCtx, slot->data, len * state->width)) {
+	    markFailed(state);
+	    return -1;
+	}
+	AWG_PROBE1(chunk_write_done, chunk);
+	doneTime = monotonicSeconds();
+	stats->writeSeconds += doneTime - startTime;
+	// What the link sees: the gap from asking for this chunk to having sent it.
+	// The first is mostly start-up, so it is kept apart from the steady state.
+	if (state->firstChunk == chunk) {
+	    stats->firstChunkSeconds = doneTime - waitStart;
+	} else if (doneTime - waitStart > stats->maxChunkSeconds) {
+	    stats->maxChunkSeconds = doneTime - waitStart;
+	    stats->worstChunk = chunk;
+	}
+
+	pthread_mutex_lock(&state->lock);
+	slot->filled = 0;
+	state->chunksWritten = chunk + 1;
+	pthread_cond_broadcast(&state->slotFreed);
+	pthread_mutex_unlock(&state->lock);
+    }
+    stats->chunkCount = state->chunkCount - state->firstChunk;
+    return 0;
+}
+
+/* Starts the generators, drains the ring, and waits for the generators to finish. */
+static int runRing(
+    pipelineState_type * state,
+    unsigned int genThreads,
+    byteSink_fn sink,
+    void *sinkCtx,
+    pipelineStats_type * stats
+) {
+    pthread_t           threads[PIPELINE_MAX_THREADS];
+    unsigned int        started = 0;
+    unsigned int        i = 0;
+    int                 retVal = 0;
+
+    for (started = 0; started < genThreads; started++) {
+	if (pthread_create(threads + started, NULL, generatorThread, state)) {
+	    logMessage(LOG_ERROR, "Problem starting generator thread.\n");
+	    markFailed(state);
+	    break;
+	}
+    }
+    if (0 != started)
+	retVal = drainRing(state, sink, sinkCtx, stats);
+    for (i = 0; i < started; i++)
+	pthread_join(threads[i], NULL);
+
+    stats->genSeconds = state->genSeconds;
+    stats->genWaitSeconds = state->genWaitSeconds;
+    return (state->failed || (started < genThreads)) ? -1 : retVal;
+}
+
+/* Gives each slot, and the base train if anything gets copied from it, its own allocation. */
+static int allocBuffers(
+    pipelineState_type * state
+) {
+    const wavePlan_type *plan = state->plan;
+    unsigned int        i = 0;
+    int                 retVal = 0;
+
+    for (i = 0; i < state->slotCount; i++) {
+	if (state->chunkPoints <= SIZE_MAX / state->width)
+	    state->slots[i].data = malloc(state->chunkPoints * state->width);
+	if (NULL == state->slots[i].data)
+	    retVal = -1;
+    }
+    if (plan->finalCount > plan->basePoints) {
+	// Only the base train is held in memory, however many times it repeats
+	if (plan->basePoints <= SIZE_MAX / state->width)
+	    state->baseVals = malloc(plan->basePoints * state->width);
+	state->baseDone = calloc(state->baseChunks + 1, 1);
+	if ((NULL == state->baseVals) || (NULL == state->baseDone))
+	    retVal = -1;
+    }
+    return retVal;
+}
+
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
+
+/* Carves the same buffers as allocBuffers() from one pool, faulted in and locked up front,
+ * so nothing touches the allocator or takes a page fault once the run starts. */
+static int allocPool(
+    pipelineState_type * state,
+    pipelineStats_type * stats
+) {
+    const wavePlan_type *plan = state->plan;
+    const int           copies = (plan->finalCount > plan->basePoints);
+    size_t              slotBytes = 0;
+    size_t              baseBytes = 0;
+    size_t              doneBytes = 0;
+    unsigned char      *pool = NULL;
+    unsigned int        i = 0;
+
+    // Each part under a quarter of the address space, so the sum can't overflow
+    if ((state->chunkPoints > SIZE_MAX / 4 / state->width / state->slotCount)
+	|| (copies && (plan->basePoints > SIZE_MAX / 4 / state->width)))
+	return -1;
+    slotBytes = state->chunkPoints * state->width;
+    baseBytes = copies ? plan->basePoints * state->width : 0;
+    doneBytes = copies ? state->baseChunks + 1 : 0;
+    state->poolBytes = slotBytes * state->slotCount + baseBytes + doneBytes;
+
+#ifdef HAVE_SYS_MMAN_H
+    pool = mmap(NULL, state->poolBytes, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (MAP_FAILED == pool)
+	return -1;
+    state->pool = pool;
+    if (0 == MAP_POPULATE) {
+	const long          pageBytes = sysconf(_SC_PAGESIZE);
+	size_t              at = 0;
+
+	for (at = 0; at < state->poolBytes; at += (pageBytes > 0) ? pageBytes : 4096)
+	    *(pool + at) = 0;
+    }
+    if (mlock(pool, state->poolBytes))
+	logMessage(LOG_WARN, "Could not lock the %zu byte buffer pool into memory (see ulimit "
+		   "-l), it may be paged out.\n", state->poolBytes);
+    else
+	stats->lockedBytes = state->poolBytes;
+#else
+    // Nothing to lock with, but the pages can still be faulted in now rather than mid-run
+    pool = malloc(state->poolBytes);
+    if (NULL == pool)
+	return -1;
+    state->pool = pool;
+    memset(pool, 0, state->poolBytes);
+    logMessage(LOG_WARN, "Buffers can't be locked into memory on this platform.\n");
+#endif
+
+    for (i = 0; i < state->slotCount; i++)
+	state->slots[i].data = pool + i * slotBytes;
+    if (copies) {
+	state->baseVals = pool + state->slotCount * slotBytes;
+	state->baseDone = state->baseVals + baseBytes;
+    }
+    return 0;
+}
+
+/* Releases what allocBuffers() or allocPool() set up, and the slots. */
+static void freeBuffers(
+    pipelineState_type * state
+) {
+    unsigned int        i = 0;
+
+    if (NULL != state->pool) {
+#ifdef HAVE_SYS_MMAN_H
+	munmap(state->pool, state->poolBytes);
+#else
+	free(state->pool);
+#endif
+    } else {
+	for (i = 0; i < state->slotCount; i++) {
+	    if (NULL != state->slots[i].data)
+		free(state->slots[i].data);
+	}
+	if (NULL != state->baseVals)
+	    free(state->baseVals);
+	if (NULL != state->baseDone)
+	    free(state->baseDone);
+    }
+    free(state->slots);
+    return;
+}
+
+int runPipeline(
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    const pipelineConfig_type * config,
+    byteSink_fn sink,
+    void *sinkCtx,
+    pipelineStats_type * stats
+) {
+    pipelineState_type  state;
+    pipelineStats_type  localStats;
+    char                textBuf[128];
+    int                 textLen = 0;
+    unsigned int        genThreads = config->genThreads;
+    int                 retVal = 0;
+    double              startTime = monotonicSeconds();
+
+    if (NULL == stats)
+	stats = &localStats;
+    memset(stats, 0, sizeof (pipelineStats_type));
+    memset(&state, 0, sizeof (pipelineState_type));
+
+    if (genThreads < 1)
+	genThreads = 1;
+    if (genThreads > PIPELINE_MAX_THREADS)
+	genThreads = PIPELINE_MAX_THREADS;
+
+    state.freqList = freqList;
+    state.plan = plan;
+    state.width = sampleFormatInfo(plan->sampleFormat)->width;
+    state.chunkPoints = (config->chunkPoints > 0) ? config->chunkPoints : PIPELINE_DEFAULT_CHUNK;
+    state.chunkCount = (plan->finalCount + state.chunkPoints - 1) / state.chunkPoints;
+    state.slotCount = (config->slotCount >= 2) ? config->slotCount : 2;
+    state.baseChunks = (plan->basePoints + state.chunkPoints - 1) / state.chunkPoints;
+    state.firstChunk = config->firstChunk;
+    if (state.firstChunk > state.chunkCount)
+	return -1;
+    state.chunksWritten = state.firstChunk;
+
+    // Everything is allocated before the first byte goes out
+    state.slots = calloc(state.slotCount, sizeof (pipelineSlot_type));
+    if (NULL == state.slots) {
+	perror("runPipeline allocation");
+	return -1;
+    }
+    retVal = config->realtime ? allocPool(&state, stats) : allocBuffers(&state);
+    if (retVal)
+	perror("runPipeline allocation");
+
+    // Start from the sent part of the base train only if a copy still has to be made from it
+    state.nextChunk = ((NULL != state.baseVals) && (state.firstChunk < state.chunkCount))
+	? 0 : state.firstChunk;
+    if (!retVal && (0 == state.firstChunk)) {
+	textLen =
+	    formatPointsHeader(textBuf, sizeof (textBuf), plan->finalCount, plan->sampleFormat);
+	if ((textLen < 0) || sink(sinkCtx, (const unsigned char *) textBuf, textLen))
+	    retVal = -1;
+    }
+    if (!retVal) {
+	pthread_mutex_init(&state.lock, NULL);
+	pthread_cond_init(&state.slotFreed, NULL);
+	pthread_cond_init(&state.slotFilled, NULL);
+	pthread_cond_init(&state.baseProgress, NULL);
+	retVal = runRing(&state, genThreads, sink, sinkCtx, stats);
+	pthread_cond_destroy(&state.baseProgress);
+	pthread_cond_destroy(&state.slotFilled);
+	pthread_cond_destroy(&state.slotFreed);
+	pthread_mutex_destroy(&state.lock);
+    }
+
+    freeBuffers(&state);
+    if (retVal || streamMarkerBlock(plan, sink, sinkCtx))
+	return -1;
+
+    textLen = formatPointsTrailer(textBuf, sizeof (textBuf), clockFreq);
+    if ((textLen < 0) || sink(sinkCtx, (const unsigned char *) textBuf, textLen))
+	return -1;
+    stats->wallSeconds = monotonicSeconds() - startTime;
+    return 0;
+}
+
+/* State carried between calls of fileSink() */
+typedef struct fileSink {
+    FILE               *outFile;
+    outputDigest_type  *digest;
+} fileSink_type;
+
+static int fileSink(
+    void *sinkCtx,
+    const unsigned char *bytes,
+    size_t len
+) {
+    fileSink_type      *state = sinkCtx;
+
+    // Hashed on the writer thread as the chunk goes out, while it is still in cache
+    digestBytes(state->digest, bytes, len);
+    if (fwrite(bytes, sizeof (unsigned char), len, state->outFile) != len)
+	return -1;
+    return 0;
+}
+
+int writeToFilePipelined(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    const pipelineConfig_type * config,
+    int compressKind,
+    int compressLevel,
+    pipelineStats_type * stats,
+    outputDigest_type * digest
+) {
+    compressStream_type *output = NULL;
+    FILE               *pointsFile = NULL;
+    fileSink_type       sinkState;
+    char               *fileName = NULL;
+    size_t              fileNameLen;
+    const char          fileNameSuf[] = "_points";
+    int                 retVal = 0;
+
+    fileNameLen = strlen(rootName) + strlen(fileNameSuf);
+
+    fileName = malloc(fileNameLen + 1);
+    if (NULL == fileName)
+	return -1;
+
+    strcpy(fileName, rootName);
+    strcat(fileName, fileNameSuf);
+
+    output = openCompressedOutput(fileName, compressKind, compressLevel);
+    free(fileName);
+    if (NULL == output)
+	return -1;
+    pointsFile = compressStreamFile(output);
+
+    sinkState.outFile = pointsFile;
+    sinkState.digest = digest;
+    retVal = runPipeline(freqList, plan, clockFreq, config, fileSink, &sinkState, stats);
+    if (ferror(pointsFile))
+	retVal = -1;
+    if (closeCompressStream(output))
+	retVal = -1;
+
+    return retVal;
+}
+
+void printPipelineStats(
+    const pipelineStats_type * stats,
+    uint64_t payloadBytes
+) {
+    double              wall = (stats->wallSeconds > 0.0) ? stats->wallSeconds : 1.0e-9;
+
+    logMessage(LOG_INFO, "Pipeline: %" PRIu64 " chunks, %" PRIu64 " bytes in %.3f s (%.1f MB/s)\n",
+	       stats->chunkCount, payloadBytes, stats->wallSeconds,
+	       ((double) payloadBytes) / wall / 1.0e6);
+    logMessage(LOG_INFO, "\tgenerate: %.3f s busy, %.3f s waiting for a free buffer\n",
+	       stats->genSeconds, stats->genWaitSeconds);
+    logMessage(LOG_INFO, "\twrite:    %.3f s busy, %.3f s waiting for a filled buffer\n",
+	       stats->writeSeconds, stats->writeWaitSeconds);
+    logMessage(LOG_INFO, "\tlatency:  %.3f ms to the first chunk, worst %.3f ms after that "
+	       "(chunk %" PRIu64 ")\n", 1000.0 * stats->firstChunkSeconds,
+	       1000.0 * stats->maxChunkSeconds, stats->worstChunk);
+    if (stats->lockedBytes > 0)
+	logMessage(LOG_INFO, "\tlocked:   %" PRIu64 " bytes of buffers\n", stats->lockedBytes);
+    return;
+}
@@ -0,0 +1,134 @@
+
+/*! @file pipeline.h
+ * @brief Overlaps waveform generation with writing the command bytes.
+ *
+ * Generator threads fill a ring of fixed-size buffers with consecutive chunks of the final
+ * waveform while the calling thread drains them, in order, into a #byteSink_fn.
+ * A generator that gets a full ring ahead of the writer waits for a buffer to come free,
+ * so memory use is bounded by the ring no matter how long the waveform is.
+ *
+ * The bytes produced are exactly those of streamPointsCommand(), whatever the thread count.
+ *
+ * @section PipelineRealtime Real-time mode
+ *
+ * With pipelineConfig::realtime set, every buffer of the run, the ring and the retained base
+ * train, is carved from one pool that is mapped, faulted in and locked into memory before the
+ * first byte goes to the sink.  Nothing is allocated from then on, so the writer never waits
+ * on a page fault or the allocator, and only on the generators or the sink itself.  Locking
+ * needs RLIMIT_MEMLOCK (ulimit -l) to cover the pool; if it doesn't, the pool is still
+ * faulted in but may be paged out, and a warning says so.  pipelineStats::maxChunkSeconds
+ * gives the worst case the link has to allow for.
+ *
+ * @section PipelineResume Resuming
+ *
+ * With pipelineConfig::firstChunk set, the header and every chunk before that one are taken
+ * to have been sent by an earlier run with the same chunk size, and the stream picks up from
+ * there.  Copies of the base train are made from the retained base train as usual, so any
+ * part of it that was sent before is generated again, but not sent.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>
+#include "../genBinary/genBinary.h"
+
+#define PIPELINE_DEFAULT_SLOTS 4	//!< Default number of buffers in the ring.
+#define PIPELINE_DEFAULT_CHUNK (1ul << 20)	//!< Default number of samples per buffer.
+#define PIPELINE_MAX_THREADS 64	//!< Upper limit on generator threads.
+
+/*! @brief Settings for runPipeline().
+ *
+ * Expected initialization found in #PIPELINE_INIT_VAL
+ */
+typedef struct pipelineConfig {
+    unsigned int        slotCount;	//!< Number of buffers in the ring, at least 2.
+    uint64_t            chunkPoints;	//!< Number of samples in each buffer.
+    unsigned int        genThreads;	//!< Number of generator threads, at least 1.
+    int                 realtime;	//!< Non-zero to take every buffer from a locked pool, see @ref PipelineRealtime.
+    uint64_t            firstChunk;	//!< First chunk to send, 0 for all of them.  See @ref PipelineResume.
+} pipelineConfig_type;
+
+#define PIPELINE_INIT_VAL {PIPELINE_DEFAULT_SLOTS, PIPELINE_DEFAULT_CHUNK, 1, 0, 0}	//!< Initialization data for a #pipelineConfig instantiation.
+
+/*! @brief Where the time went during runPipeline().
+ *
+ * Busy and wait times of the generators are summed over all generator threads.
+ */
+typedef struct pipelineStats {
+    double              wallSeconds;	//!< Elapsed time for the whole run.
+    double              genSeconds;	//!< Time spent generating samples.
+    double              genWaitSeconds;	//!< Time generators waited for a free buffer (backpressure).
+    double              writeSeconds;	//!< Time spent in the sink.
+    double              writeWaitSeconds;	//!< Time the writer waited for a filled buffer.
+    uint64_t            chunkCount;	//!< Number of buffers passed through the ring, not counting any before pipelineConfig::firstChunk.
+    double              firstChunkSeconds;	//!< Time the writer spent on the first chunk, waiting for it and sending it.
+    double              maxChunkSeconds;	//!< Longest the writer spent on any later chunk, waiting for it and sending it.
+    uint64_t            worstChunk;	//!< Which chunk took maxChunkSeconds.
+    uint64_t            lockedBytes;	//!< Bytes of buffers locked into memory, 0 unless pipelineConfig::realtime.
+} pipelineStats_type;
+
+/*!	@brief Generates the waveform on generator threads while writing it from this one.
+ *
+ * Sends the same bytes as streamPointsCommand().  If the waveform has an inverted copy or
+ * repetitions, the base train is retained so those are copied rather than generated again.
+ *
+ * @param[in] freqList A pointer to the the freqList describing the pulse train.
+ * @param[in] plan The plan from planWaveform() for the same freqList.
+ * @param[in] clockFreq The output sample frequency
+ * @param[in] config Ring and thread settings.
+ * @param[in] sink Called with each run of bytes, in order, always from the calling thread.
+ * @param[in] sinkCtx Passed through to sink.
+ * @param[out] stats If not NULL, filled with timing information.
+ * @return 0 on success
+ * @return -1 on failure, including the sink reporting failure.
+ */
+int                 runPipeline(
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    const pipelineConfig_type * config,
+    byteSink_fn sink,
+    void *sinkCtx,
+    pipelineStats_type * stats
+);
+
+/*!	@brief Writes the points file through runPipeline().
+ *
+ * Produces the same file as generating with genPointList() and calling writeToFile().
+ *
+ * @param[in] rootName The base of the filename we're saving to.
+ * @param[in] freqList A pointer to the the freqList describing the pulse train.
+ * @param[in] plan The plan from planWaveform() for the same freqList.
+ * @param[in] clockFreq The output sample frequency
+ * @param[in] config Ring and thread settings.
+ * @param[in] compressKind How to compress the file, one of the @ref CompressKinds.
+ * @param[in] compressLevel Compression level, or #COMPRESS_LEVEL_DEFAULT.
+ * @param[out] stats If not NULL, filled with timing information.
+ * @param[inout] digest If not NULL, every byte written is added to it, before compression.
+ * @return 0 on success
+ * @return -1 on failure
+ */
+int                 writeToFilePipelined(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    const pipelineConfig_type * config,
+    int compressKind,
+    int compressLevel,
+    pipelineStats_type * stats,
+    outputDigest_type * digest
+);
+
+/*!	@brief Logs the contents of a #pipelineStats at #LOG_INFO, so -q hides them.
+ *
+ * @param[in] stats The statistics to print.
+ * @param[in] payloadBytes Bytes of curve data moved, for throughput figures.
+ */
+void                printPipelineStats(
+    const pipelineStats_type * stats,
+    uint64_t payloadBytes
+);
+
+#endif
@@ -0,0 +1,100 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+#include <pthread.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "platform.h"
+
+double monotonicSeconds(
+) {
+    struct timespec     now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((double) now.tv_sec) + 1.0e-9 * ((double) now.tv_nsec);
+}
+
+unsigned int onlineProcessors(
+) {
+#if defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+    long                online = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (online > 0) ? (unsigned int) online : 1;
+#else
+    return 1;
+#endif
+}
+
+void runWorkers(
+    void *(*worker) (void *),
+    void *arg,
+    unsigned int threads
+) {
+    pthread_t          *workers = (threads > 1) ? malloc(sizeof (pthread_t) * (threads - 1)) : NULL;
+    unsigned int        started = 0;
+    unsigned int        i = 0;
+
+    // Without room for the handles, the calling thread does it all
+    for (started = 0; (NULL != workers) && (started + 1 < threads); started++) {
+	if (pthread_create(&workers[started], NULL, worker, arg))
+	    break;
+    }
+    worker(arg);
+    for (i = 0; i < started; i++)
+	pthread_join(workers[i], NULL);
+    if (NULL != workers)
+	free(workers);
+    return;
+}
+
+int seekTo(
+    FILE * file,
+    uint64_t offset
+) {
+#if defined(HAVE_FSEEKO)
+    return fseeko(file, (off_t) offset, SEEK_SET) ? -1 : 0;
+#elif defined(_WIN32)
+    return _fseeki64(file, (__int64) offset, SEEK_SET) ? -1 : 0;
+#else
+    return fseek(file, (long) offset, SEEK_SET) ? -1 : 0;
+#endif
+}
+
+int filePosition(
+    FILE * file,
+    uint64_t *offset
+) {
+#if defined(HAVE_FSEEKO)
+    off_t               here = ftello(file);
+#elif defined(_WIN32)
+    __int64             here = _ftelli64(file);
+#else
+    long                here = ftell(file);
+#endif
+
+    if (here < 0)
+	return -1;
+    *offset = (uint64_t) here;
+    return 0;
+}
+
+int fileLength(
+    FILE * file,
+    uint64_t *len
+) {
+    uint64_t            here = 0;
+    int                 failed = filePosition(file, &here);
+
+#if defined(HAVE_FSEEKO)
+    failed = failed || fseeko(file, 0, SEEK_END);
+#elif defined(_WIN32)
+    failed = failed || _fseeki64(file, 0, SEEK_END);
+#else
+    failed = failed || fseek(file, 0, SEEK_END);
+#endif
+    failed = failed || filePosition(file, len) || seekTo(file, here);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,83 @@
+
+/*! @file platform.h
+ * @brief Timing, processor count, worker threads and large file offsets, shared by the modules
+ * that need them.
+ */
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*!	@brief Seconds on the monotonic clock, for timing intervals.
+ *
+ * @return Seconds since an arbitrary start.
+ */
+double              monotonicSeconds(
+);
+
+/*!	@brief The number of processors online.
+ *
+ * @return At least 1, and 1 where the count isn't available.
+ */
+unsigned int        onlineProcessors(
+);
+
+/*!	@brief Runs worker(arg) on threads threads to completion, the calling thread being one.
+ *
+ * If some threads can't be started, the work is shared among those that were, so the worker
+ * must claim its work from arg until there is none left.
+ *
+ * @param[in] worker The thread function.  Its return value is ignored.
+ * @param[inout] arg Passed to every worker.
+ * @param[in] threads Number of workers, 0 counting as 1.
+ */
+void                runWorkers(
+    void *(*worker) (void *),
+    void *arg,
+    unsigned int threads
+);
+
+/*!	@brief Seeks to a byte offset from the start of a file, past 2 GiB as well.
+ *
+ * Uses fseeko() where there is one, _fseeki64() on Windows, and fseek() otherwise, where
+ * long may be only 32 bits.
+ *
+ * @param[in] file The file to move in.
+ * @param[in] offset Byte offset from the start of the file.
+ * @return 0 on success
+ * @return -1 on failure.
+ */
+int                 seekTo(
+    FILE * file,
+    uint64_t offset
+);
+
+/*!	@brief The byte offset of the current position in a file, past 2 GiB as well.
+ *
+ * @param[in] file The file to look at.
+ * @param[out] offset Byte offset from the start of the file.
+ * @return 0 on success
+ * @return -1 on failure.
+ */
+int                 filePosition(
+    FILE * file,
+    uint64_t *offset
+);
+
+/*!	@brief The length of a file in bytes, past 2 GiB as well.
+ *
+ * The file is left at the position it had.
+ *
+ * @param[in] file The file to measure.
+ * @param[out] len Length of the file, in bytes.
+ * @return 0 on success
+ * @return -1 on failure.
+ */
+int                 fileLength(
+    FILE * file,
+    uint64_t *len
+);
+
+#endif
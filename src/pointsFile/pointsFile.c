@@ -0,0 +1,398 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "pointsFile.h"
+#include "../platform/platform.h"
+#include "../logging/logging.h"
+
+/* The commands that can follow the curve */
+static const char   markerText[] = "\nMARKER:DATA ";
+static const char   clockText[] = "\nCLOCK:FREQUENCY ";
+
+/* Reads a "#<n><len>" block length, returning the characters used, or -1. */
+static int parseBlockLength(
+    const char *text,
+    uint64_t *len
+) {
+    int                 numLen = 0;
+    int                 i = 0;
+
+    *len = 0;
+    if (('#' != *text) || (*(text + 1) < '1') || (*(text + 1) > '9'))
+	return -1;
+    numLen = *(text + 1) - '0';
+    for (i = 0; i < numLen; i++) {
+	char                digit = *(text + 2 + i);
+
+	if ((digit < '0') || (digit > '9'))
+	    return -1;
+	*len = (*len * 10) + (uint64_t) (digit - '0');
+    }
+    return 2 + numLen;
+}
+
+/* Reads up to POINTS_FILE_HEADER_MAX - 1 bytes at offset into buf, NULL terminated. */
+static int readTextAt(
+    FILE * pointsFile,
+    uint64_t offset,
+    char *buf
+) {
+    size_t              got = 0;
+
+    if (seekTo(pointsFile, offset))
+	return -1;
+    got = fread(buf, 1, POINTS_FILE_HEADER_MAX - 1, pointsFile);
+    *(buf + got) = '\0';
+    return ferror(pointsFile) ? -1 : 0;
+}
+
+int readPointsFileInfo(
+    FILE * pointsFile,
+    pointsFileInfo_type * info
+) {
+    const char          widthText[] = "DATA:WIDTH ";
+    const char          curveText[] = "\nCURVE ";
+    char                textBuf[POINTS_FILE_HEADER_MAX];
+    const char         *pos = NULL;
+    char               *widthEnd = NULL;
+    uint64_t            width = 0;
+    uint64_t            curveBytes = 0;
+    uint64_t            tailOffset = 0;
+    int                 used = 0;
+
+    if (readTextAt(pointsFile, 0, textBuf))
+	return -1;
+    pos = strstr(textBuf, widthText);
+    if ((0 != strncmp(textBuf, "DATA:DESTINATION ", 17)) || (NULL == pos)) {
+	logMessage(LOG_ERROR, "Not a points file.\n");
+	return -1;
+    }
+    width = strtoul(pos + sizeof (widthText) - 1, &widthEnd, 10);
+    // Any width that isn't one of ours is as good as a missing one
+    for (info->sampleFormat = 0; info->sampleFormat < SAMPLE_FORMAT_COUNT; info->sampleFormat++) {
+	if (sampleFormatInfo(info->sampleFormat)->width == width)
+	    break;
+    }
+    if ((SAMPLE_FORMAT_COUNT == info->sampleFormat)
+	|| (0 != strncmp(widthEnd, curveText, sizeof (curveText) - 1))) {
+	logMessage(LOG_ERROR, "Not a points file with a known sample width.\n");
+	return -1;
+    }
+    pos = widthEnd + sizeof (curveText) - 1;
+    used = parseBlockLength(pos, &curveBytes);
+    if (used >= 0)
+	info->curveOffset = (uint64_t) (pos - textBuf) + (uint64_t) used;
+    if ((used < 0) || (0 != curveBytes % width)) {
+	logMessage(LOG_ERROR, "Could not read the length of the curve.\n");
+	return -1;
+    }
+    info->curveCount = curveBytes / width;
+
+    // What follows the curve: maybe a marker block, then the clock
+    tailOffset = info->curveOffset + curveBytes;
+    if (readTextAt(pointsFile, tailOffset, textBuf))
+	return -1;
+    info->hasMarkers = (0 == strncmp(textBuf, markerText, sizeof (markerText) - 1));
+    if (info->hasMarkers) {
+	uint64_t            markerCount = 0;
+
+	used = parseBlockLength(textBuf + sizeof (markerText) - 1, &markerCount);
+	if (used < 0) {
+	    logMessage(LOG_ERROR, "Could not read the length of the markers.\n");
+	    return -1;
+	}
+	tailOffset += sizeof (markerText) - 1 + (uint64_t) used + markerCount;
+	if (readTextAt(pointsFile, tailOffset, textBuf))
+	    return -1;
+    }
+    if ((0 != strncmp(textBuf, clockText, sizeof (clockText) - 1))
+	|| (1 != sscanf(textBuf + sizeof (clockText) - 1, "%lf", &info->clockFreq))) {
+	logMessage(LOG_ERROR, "Could not find the clock frequency after the curve.\n");
+	return -1;
+    }
+    return 0;
+}
+
+/* Copies len bytes within the file from one offset to another, mirrored about the zero level
+ * of sampleFormat if inverted is set.  The ranges may overlap. */
+static int copyFileRange(
+    FILE * pointsFile,
+    uint64_t from,
+    uint64_t to,
+    uint64_t len,
+    int sampleFormat,
+    int inverted,
+    unsigned char *copyBuf
+) {
+    const uint64_t      width = sampleFormatInfo(sampleFormat)->width;
+    uint64_t            done = 0;
+
+    // Moving towards the end starts from the end, so nothing is overwritten before it's read
+    while (done < len) {
+	uint64_t            run = len - done;
+	uint64_t            at = 0;
+
+	if (run > POINTS_FILE_COPY_CHUNK)
+	    run = POINTS_FILE_COPY_CHUNK;
+	at = (to > from) ? len - done - run : done;
+	if (seekTo(pointsFile, from + at)
+	    || (fread(copyBuf, 1, run, pointsFile) != run))
+	    return -1;
+	// Chunks are a whole number of samples, as is len
+	if (inverted)
+	    invertSamples(sampleFormat, copyBuf, run / width, copyBuf);
+	if (seekTo(pointsFile, to + at)
+	    || (fwrite(copyBuf, 1, run, pointsFile) != run))
+	    return -1;
+	done += run;
+    }
+    return 0;
+}
+
+/* Generates the new pulses into newVals, carrying the sign on from *lastFlip and leaving it
+ * set for after the last one.  The plan is only used for its envelope tables. */
+static void genAppendedPulses(
+    const freqList_ptr freqList,
+    const uint64_t *pointCounts,
+    const wavePlan_type * plan,
+    unsigned char *newVals,
+    double *lastFlip
+) {
+    const unsigned int  width = sampleFormatInfo(plan->sampleFormat)->width;
+    unsigned int        i = 0;
+    unsigned char      *pos = newVals;
+
+    for (i = 0; i < freqList->freqCount; i++) {
+	const uint64_t      numPts = *(pointCounts + i);
+	const double       *window = toothEnvelope(plan, i);
+	double              amp = pulseAmp(freqList, i) * *lastFlip;
+	double              lastVal = 0.0;
+
+	if (0 == numPts)
+	    continue;
+	pos = genPulsePts(pulseFreq(freqList, i), pulseStopFreq(freqList, i), pulseDur(freqList, i),
+			  amp, window, numPts, plan->pointInterval, plan->sampleFormat, pos);
+	decodeSamples(plan->sampleFormat, pos - width, 1, &lastVal);
+	*lastFlip = (lastVal < 0.0) ? 1.0 : -1.0;
+    }
+    return;
+}
+
+/* Checks the existing file against what the caller believes it holds. */
+static int checkAppendable(
+    const pointsFileInfo_type * info,
+    uint64_t basePoints,
+    int sampleFormat,
+    const double clockFreq
+) {
+    char                fileClock[64];
+    char                wantClock[64];
+    uint64_t            reps = 0;
+
+    if (info->hasMarkers) {
+	logMessage(LOG_ERROR, "Can't append to a waveform with markers.\n");
+	return -1;
+    }
+    if (info->sampleFormat != sampleFormat) {
+	logMessage(LOG_ERROR, "The points file holds %s samples, not %s.\n",
+		   sampleFormatInfo(info->sampleFormat)->name, sampleFormatInfo(sampleFormat)->name);
+	return -1;
+    }
+    snprintf(fileClock, sizeof (fileClock), "%f", info->clockFreq);
+    snprintf(wantClock, sizeof (wantClock), "%f", clockFreq);
+    if (0 != strcmp(fileClock, wantClock)) {
+	logMessage(LOG_ERROR, "The points file uses a %s MHz clock, not %s MHz.\n", fileClock,
+		   wantClock);
+	return -1;
+    }
+    // The curve must be the base train, maybe its inverted copy, then whole repeats
+    if ((0 == basePoints) || (0 != info->curveCount % basePoints)) {
+	logMessage(LOG_ERROR, "The points file doesn't match its summary.\n");
+	return -1;
+    }
+    reps = info->curveCount / basePoints;
+    if (0 != (reps & (reps - 1))) {
+	logMessage(LOG_ERROR, "The points file doesn't match its summary.\n");
+	return -1;
+    }
+    return 0;
+}
+
+/* Where everything goes in the extended curve */
+typedef struct appendLayout {
+    uint64_t            oldBase;	     // Base train samples already in the file
+    uint64_t            newBase;	     // Base train samples once extended
+    int                 flipCopy;
+    int                 numShifts;
+    uint64_t            finalCount;
+} appendLayout_type;
+
+/* Same continuity and multiple-of-32 rules as planWaveform(), for the extended train. */
+static int layoutAppend(
+    appendLayout_type * layout,
+    uint64_t oldBase,
+    uint64_t addedPoints,
+    double lastFlip
+) {
+    layout->oldBase = oldBase;
+    layout->newBase = oldBase + addedPoints;
+    layout->flipCopy = (lastFlip < 0.0);
+    if ((addedPoints > MAX_FINAL_POINTS - oldBase)
+	|| finalWaveLength(layout->newBase, layout->flipCopy, &layout->numShifts,
+			   &layout->finalCount)) {
+	logMessage(LOG_ERROR, "The extended waveform is too long to count.\n");
+	return -1;
+    }
+    return 0;
+}
+
+/* Lays the extended waveform out in the open file, around the existing base train. */
+static int rewritePoints(
+    FILE * pointsFile,
+    const pointsFileInfo_type * info,
+    const appendLayout_type * layout,
+    const unsigned char *newVals,
+    const double clockFreq,
+    unsigned char *copyBuf
+) {
+    const int           format = info->sampleFormat;
+    const uint64_t      width = sampleFormatInfo(format)->width;
+    const uint64_t      newBytes = (layout->newBase - layout->oldBase) * width;
+    char                textBuf[128];
+    int                 textLen = 0;
+    uint64_t            curveOffset = 0;
+    uint64_t            unitBytes = layout->newBase * width;
+    uint64_t            endOffset = 0;
+    int                 i = 0;
+
+    textLen = formatPointsHeader(textBuf, sizeof (textBuf), layout->finalCount, format);
+    if (textLen < 0)
+	return -1;
+    curveOffset = (uint64_t) textLen;
+    // The existing pulses only move if the length field changed size
+    if ((curveOffset != info->curveOffset)
+	&& copyFileRange(pointsFile, info->curveOffset, curveOffset, layout->oldBase * width,
+			 format, 0, copyBuf))
+	return -1;
+    if (seekTo(pointsFile, 0)
+	|| (fwrite(textBuf, 1, textLen, pointsFile) != (size_t) textLen))
+	return -1;
+    if (seekTo(pointsFile, curveOffset + layout->oldBase * width)
+	|| (fwrite(newVals, 1, newBytes, pointsFile) != newBytes))
+	return -1;
+
+    // Same inverted copy and repeats as genPointList(), copied from the file itself
+    if (layout->flipCopy) {
+	if (copyFileRange(pointsFile, curveOffset, curveOffset + unitBytes, unitBytes, format, 1,
+			  copyBuf))
+	    return -1;
+	unitBytes *= 2;
+    }
+    for (i = 0; i < layout->numShifts; i++, unitBytes *= 2) {
+	if (copyFileRange(pointsFile, curveOffset, curveOffset + unitBytes, unitBytes, format, 0,
+			  copyBuf))
+	    return -1;
+    }
+
+    textLen = formatPointsTrailer(textBuf, sizeof (textBuf), clockFreq);
+    endOffset = curveOffset + layout->finalCount * width;
+    if ((textLen < 0) || seekTo(pointsFile, endOffset)
+	|| (fwrite(textBuf, 1, textLen, pointsFile) != (size_t) textLen))
+	return -1;
+    if (fflush(pointsFile))
+	return -1;
+#ifdef HAVE_UNISTD_H
+    // Drop whatever is left of the old copies and trailer past the new end
+    if (ftruncate(fileno(pointsFile), (off_t) (endOffset + textLen)))
+	return -1;
+#endif
+    return 0;
+}
+
+int appendPointsFile(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const uint64_t *pointCounts,
+    uint64_t basePoints,
+    int sampleFormat,
+    const double clockFreq,
+    uint64_t *finalCount
+) {
+    FILE               *pointsFile = NULL;
+    char               *fileName = NULL;
+    const char          fileNameSuf[] = "_points";
+    pointsFileInfo_type info = POINTS_FILE_INFO_INIT_VAL;
+    wavePlan_type       plan = WAVE_PLAN_INIT_VAL;
+    appendLayout_type   layout;
+    unsigned char      *newVals = NULL;
+    unsigned char      *copyBuf = NULL;
+    const unsigned int  width = sampleFormatInfo(sampleFormat)->width;
+    unsigned char       lastPt[SAMPLE_MAX_WIDTH];
+    double              lastVal = 0.0;
+    double              lastFlip = 1.0;
+    int                 retVal = 0;
+
+    if ((NULL == freqList) || (NULL == pointCounts))
+	return -1;
+    fileName = malloc(strlen(rootName) + strlen(fileNameSuf) + 1);
+    if (NULL == fileName)
+	return -1;
+    strcpy(fileName, rootName);
+    strcat(fileName, fileNameSuf);
+    pointsFile = fopen(fileName, "r+");
+    if (NULL == pointsFile) {
+	logMessage(LOG_ERROR, "Could not open \"%s\" to append to.\n", fileName);
+	free(fileName);
+	return -1;
+    }
+    free(fileName);
+
+    if (readPointsFileInfo(pointsFile, &info)
+	|| checkAppendable(&info, basePoints, sampleFormat, clockFreq)
+	|| seekTo(pointsFile, info.curveOffset + (basePoints - 1) * width)
+	|| (fread(lastPt, 1, width, pointsFile) != width)) {
+	fclose(pointsFile);
+	return -1;
+    }
+    // The new pulses start with the sign the existing train hands on
+    decodeSamples(sampleFormat, lastPt, 1, &lastVal);
+    lastFlip = (lastVal < 0.0) ? 1.0 : -1.0;
+
+    // Planning the new pulses on their own gives their lengths and envelope tables
+    if (planWaveform(freqList, pointCounts, 1000.0 / clockFreq, sampleFormat, &plan)) {
+	fclose(pointsFile);
+	return -1;
+    }
+    if (plan.basePoints < SIZE_MAX / width)
+	newVals = malloc((plan.basePoints + 1) * width);
+    copyBuf = malloc(POINTS_FILE_COPY_CHUNK);
+    if ((NULL == newVals) || (NULL == copyBuf)) {
+	perror("appendPointsFile allocation");
+	retVal = -1;
+    } else {
+	genAppendedPulses(freqList, pointCounts, &plan, newVals, &lastFlip);
+	retVal = layoutAppend(&layout, basePoints, plan.basePoints, lastFlip);
+	if (!retVal) {
+	    retVal = rewritePoints(pointsFile, &info, &layout, newVals, clockFreq, copyBuf);
+	    *finalCount = layout.finalCount;
+	}
+    }
+
+    if (ferror(pointsFile))
+	retVal = -1;
+    if (fclose(pointsFile))
+	retVal = -1;
+    if (NULL != newVals)
+	free(newVals);
+    if (NULL != copyBuf)
+	free(copyBuf);
+    freeWavePlan(&plan);
+    if (!retVal)
+	logMessage(LOG_INFO, "Final point count %" PRIu64 "\n", *finalCount);
+    return retVal;
+}
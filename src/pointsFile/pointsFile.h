@@ -0,0 +1,80 @@
+
+/*! @file pointsFile.h
+ * @brief Reads back, and extends in place, a points file written by writeToFile().
+ *
+ * A points file is the header from formatPointsHeader() ("DATA:DESTINATION", "DATA:WIDTH",
+ * then "CURVE #<n><len>"), the curve bytes, an optional "MARKER:DATA" block, and the
+ * trailer from formatPointsTrailer().
+ *
+ * The curve is the base train followed by its inverted copy (if needed for continuity) and
+ * the repeats that make it a multiple of 32 long.  Appending pulses only generates the new
+ * ones.  The base train already in the file is kept where it is (moved only if the header
+ * changes length), and the copies after it are redone from the file itself.
+ */
+
+#ifndef POINTSFILE_H
+#define POINTSFILE_H
+
+#include <stdio.h>
+#include "../genBinary/genBinary.h"
+
+#define POINTS_FILE_COPY_CHUNK (1 << 16)	//!< Bytes moved within the points file at a time.
+#define POINTS_FILE_HEADER_MAX 128	//!< Longest header or trailer looked at when reading a points file.
+
+/*! @brief Layout of an existing points file, from readPointsFileInfo().
+ *
+ * Expected initialization found in #POINTS_FILE_INFO_INIT_VAL
+ */
+typedef struct pointsFileInfo {
+    uint64_t            curveOffset;	//!< Byte offset of the first curve sample.
+    uint64_t            curveCount;	//!< Number of curve samples.
+    int                 sampleFormat;	//!< How the samples are stored, from DATA:WIDTH.
+    int                 hasMarkers;	//!< Non-zero if a MARKER:DATA block follows the curve.
+    double              clockFreq;	//!< Sample clock from the trailer, in MHz.
+} pointsFileInfo_type;
+
+#define POINTS_FILE_INFO_INIT_VAL {0, 0, SAMPLE_FORMAT_U8, 0, 0.0}	//!< Initialization data for a #pointsFileInfo instantiation.
+
+/*!	@brief Reads the header and trailer of a points file.
+ *
+ * Only the DATA:WIDTH of one of the sample formats is understood.
+ *
+ * @param[in] pointsFile The open points file.  Its position is left undefined.
+ * @param[out] info The layout found.
+ * @return 0 on success
+ * @return -1 if the file is not laid out as writeToFile() writes it.
+ */
+int                 readPointsFileInfo(
+    FILE * pointsFile,
+    pointsFileInfo_type * info
+);
+
+/*!	@brief Adds pulses to the end of the base train of an existing "\<rootName\>_points".
+ *
+ * The new pulses carry on the sign alternation from the last sample of the existing base
+ * train, exactly as if the whole train had been generated in one go.  The inverted copy,
+ * repeats, header, and trailer are then redone for the new length.
+ *
+ * The summaries are not touched; see readSummaryBase() for finding basePoints.
+ *
+ * @param[in] rootName The base of the filename the waveform was saved to.
+ * @param[in] freqList The pulses to add.
+ * @param[in] pointCounts An array holding the length of each new pulse in output samples.
+ * @param[in] basePoints Samples in the base train already in the file.
+ * @param[in] sampleFormat How samples are stored, one of the @ref SampleFormats values.  Must match the file's.
+ * @param[in] clockFreq The output sample frequency, in MHz.  Must match the file's.
+ * @param[out] finalCount Total number of points in the extended waveform.
+ * @return 0 on success
+ * @return -1 on failure.  The file is only changed once all checks have passed.
+ */
+int                 appendPointsFile(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const uint64_t *pointCounts,
+    uint64_t basePoints,
+    int sampleFormat,
+    const double clockFreq,
+    uint64_t *finalCount
+);
+
+#endif
@@ -0,0 +1,65 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <time.h>
+#include <sys/types.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "prng.h"
+
+/* SplitMix64's output mixer, a bijection on 64 bits with good avalanche */
+static inline uint64_t mix64(
+    uint64_t z
+) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+uint64_t prngStreamKey(
+    uint64_t seed,
+    uint64_t streamId
+) {
+    return mix64(mix64(seed) + (streamId + 1) * 0xD1B54A32D192ED03ull);
+}
+
+uint64_t prngAt(
+    uint64_t key,
+    uint64_t index
+) {
+    return mix64(key + (index + 1) * PRNG_GAMMA);
+}
+
+void prngFillUnit(
+    uint64_t key,
+    uint64_t firstIndex,
+    double *dest,
+    size_t count
+) {
+    size_t              i = 0;
+
+    // Top 53 bits scaled onto [0, 1); each element stands alone, so this loop vectorizes
+    for (i = 0; i < count; i++)
+	dest[i] = ((double) (mix64(key + (firstIndex + i + 1) * PRNG_GAMMA) >> 11))
+	    * (1.0 / 9007199254740992.0);
+    return;
+}
+
+uint64_t prngDefaultSeed(
+) {
+    uint64_t            entropy = (uint64_t) time(NULL);
+
+#ifdef CLOCK_REALTIME
+    {
+	struct timespec     now;
+
+	if (0 == clock_gettime(CLOCK_REALTIME, &now))
+	    entropy = mix64(entropy ^ (uint64_t) now.tv_nsec);
+    }
+#endif
+#ifdef HAVE_UNISTD_H
+    entropy = mix64(entropy + ((uint64_t) getpid()) * PRNG_GAMMA);
+#endif
+    entropy = mix64(entropy ^ (uint64_t) clock());
+    return entropy;
+}
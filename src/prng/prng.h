@@ -0,0 +1,73 @@
+
+/*! @file prng.h
+ * @brief Seedable, counter-based pseudo-random numbers.
+ *
+ * Every value is a pure function of a 64-bit seed and its index in the sequence: the index
+ * is spread over the 64-bit space with the golden-ratio increment of SplitMix64 and passed
+ * through its output mixer.  There is no hidden state, so
+ * - the same seed always reproduces the same sequence,
+ * - any thread can produce any part of the sequence, and N threads filling disjoint index
+ *   ranges give exactly what one thread would, and
+ * - a fill loop has no dependency between elements, so it vectorizes.
+ *
+ * Separate streams come from separate keys, see prngStreamKey().
+ */
+
+#ifndef PRNG_H
+#define PRNG_H
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#define PRNG_GAMMA 0x9E3779B97F4A7C15ull	//!< Golden-ratio increment between successive counters.
+
+/*!	@brief Turns a user seed into the key for stream number streamId.
+ *
+ * Keys for neighbouring seeds or stream numbers are unrelated, so seeds 1, 2, 3, ... and
+ * per-thread streams 0, 1, 2, ... are all independent of each other.
+ *
+ * @param[in] seed The user-visible seed.
+ * @param[in] streamId Which stream of that seed, 0 for the main one.
+ * @return The key to pass to the other functions.
+ */
+uint64_t            prngStreamKey(
+    uint64_t seed,
+    uint64_t streamId
+);
+
+/*!	@brief The value at position index of the stream with the given key.
+ *
+ * @param[in] key A key from prngStreamKey().
+ * @param[in] index Position in the stream.
+ * @return 64 uniformly distributed bits.
+ */
+uint64_t            prngAt(
+    uint64_t key,
+    uint64_t index
+);
+
+/*!	@brief Fills dest with uniform doubles on [0, 1) from positions [firstIndex, firstIndex + count).
+ *
+ * @param[in] key A key from prngStreamKey().
+ * @param[in] firstIndex Position in the stream of dest[0].
+ * @param[out] dest Where to put the values.
+ * @param[in] count Number of values to produce.
+ */
+void                prngFillUnit(
+    uint64_t key,
+    uint64_t firstIndex,
+    double *dest,
+    size_t count
+);
+
+/*!	@brief Picks a seed for runs where none was given.
+ *
+ * Mixes the time down to the nanosecond with the process id, so runs started in the same
+ * second still differ.  Record the result to reproduce the run.
+ *
+ * @return A seed.
+ */
+uint64_t            prngDefaultSeed(
+);
+
+#endif
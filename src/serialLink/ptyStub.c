@@ -0,0 +1,198 @@
+/* Stand-in for the AWG, for testing --device: records what arrives on a pseudo-terminal and
+ * answers WFMP? the way the instrument would. */
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+#define STUB_LINE_MAX 256	     // Longest command line kept, longer ones are cut short
+
+/* Where the stub is in the command stream */
+typedef enum stubMode {
+    STUB_TEXT,			     // Reading a command line
+    STUB_BLOCK_COUNT,		     // Just after '#', the count of length digits is next
+    STUB_BLOCK_LENGTH,		     // Reading the length digits
+    STUB_BLOCK_DATA		     // Skipping the block's bytes
+} stubMode_type;
+
+typedef struct ptyStub {
+    stubMode_type       mode;
+    char                line[STUB_LINE_MAX];
+    size_t              lineLen;
+    unsigned int        digitsLeft;
+    unsigned long long  blockLen;
+    unsigned long long  blockLeft;
+    unsigned int        width;	     // From DATA:WIDTH
+    unsigned long long  curveBytes;	     // Length of the CURVE block
+    double              clockMHz;	     // From CLOCK:FREQUENCY
+} ptyStub_type;
+
+/* Acts on one complete command line.  Returns 1 once WFMP? has been answered. */
+static int stubCommand(
+    ptyStub_type * stub,
+    int masterFd
+) {
+    char                reply[STUB_LINE_MAX];
+    int                 replyLen = 0;
+
+    stub->line[stub->lineLen] = '\0';
+    if (0 == strncasecmp(stub->line, "DATA:WIDTH ", 11)) {
+	stub->width = (unsigned int) strtoul(stub->line + 11, NULL, 10);
+    } else if (0 == strncasecmp(stub->line, "CLOCK:FREQUENCY ", 16)) {
+	stub->clockMHz = strtod(stub->line + 16, NULL);
+    } else if ((0 == strcasecmp(stub->line, "WFMP?"))
+	       || (0 == strcasecmp(stub->line, "WFMPRE?"))) {
+	const unsigned int  width = (0 == stub->width) ? 1 : stub->width;
+
+	replyLen = snprintf(reply, sizeof (reply),
+			    ":WFMPRE:BYT_NR %u;BIT_NR %u;ENCDG BIN;NR_PT %llu;XINCR %g\r\n",
+			    width, 8 * width, stub->curveBytes / width,
+			    (stub->clockMHz > 0.0) ? 1.0e-6 / stub->clockMHz : 0.0);
+	if (write(masterFd, reply, (size_t) replyLen) != replyLen) {
+	    perror("Sending reply");
+	    return -1;
+	}
+	fprintf(stderr, "Answered WFMP?: %.*s\n", replyLen - 2, reply);
+	return 1;
+    }
+    return 0;
+}
+
+/* Follows the command stream a byte at a time.  Returns 1 once WFMP? has been answered. */
+static int stubByte(
+    ptyStub_type * stub,
+    int masterFd,
+    unsigned char byte
+) {
+    switch (stub->mode) {
+    case STUB_TEXT:
+	if ('#' == byte) {
+	    stub->mode = STUB_BLOCK_COUNT;
+	} else if ('\n' == byte) {
+	    int                 done = (stub->lineLen > 0) ? stubCommand(stub, masterFd) : 0;
+
+	    stub->lineLen = 0;
+	    return done;
+	} else if (('\r' != byte) && (stub->lineLen + 1 < STUB_LINE_MAX)) {
+	    stub->line[stub->lineLen++] = (char) byte;
+	}
+	break;
+    case STUB_BLOCK_COUNT:
+	if ((byte < '1') || (byte > '9')) {
+	    fprintf(stderr, "Only definite-length blocks are understood, not #%c.\n", byte);
+	    return -1;
+	}
+	stub->digitsLeft = byte - '0';
+	stub->blockLen = 0;
+	stub->mode = STUB_BLOCK_LENGTH;
+	break;
+    case STUB_BLOCK_LENGTH:
+	stub->blockLen = 10 * stub->blockLen + (byte - '0');
+	if (0 == --stub->digitsLeft) {
+	    stub->line[stub->lineLen] = '\0';
+	    if (0 == strncasecmp(stub->line, "CURVE", 5))
+		stub->curveBytes = stub->blockLen;
+	    stub->blockLeft = stub->blockLen;
+	    stub->lineLen = 0;
+	    stub->mode = (0 == stub->blockLeft) ? STUB_TEXT : STUB_BLOCK_DATA;
+	}
+	break;
+    case STUB_BLOCK_DATA:
+	if (0 == --stub->blockLeft)
+	    stub->mode = STUB_TEXT;
+	break;
+    }
+    return 0;
+}
+
+int main(
+    int argc,
+    char *argv[]
+) {
+    ptyStub_type        stub;
+    struct termios      tty;
+    FILE               *outFile = NULL;
+    unsigned char       buf[4096];
+    unsigned long long  received = 0;
+    int                 masterFd = -1;
+    int                 slaveFd = -1;
+    int                 done = 0;
+
+    if ((argc > 2) || ((2 == argc) && (0 == strcmp(argv[1], "-h")))) {
+	fprintf(stderr, "Usage:  awgptystub [<output file>]\n\n"
+		"Prints the path of a new pseudo-terminal, then records everything written to\n"
+		"it by awgcom --device <path>, as the AWG would receive it, to the file.\n"
+		"Answers WFMP? with the width and point count of the curve, and exits.\n");
+	return (2 == argc) ? 0 : -1;
+    }
+    memset(&stub, 0, sizeof (ptyStub_type));
+    stub.mode = STUB_TEXT;
+
+    masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((masterFd < 0) || grantpt(masterFd) || unlockpt(masterFd)
+	|| (NULL == ptsname(masterFd))) {
+	perror("Opening a pseudo-terminal");
+	return -1;
+    }
+    // Holding the other end open keeps reads from failing before and after awgcom has it
+    slaveFd = open(ptsname(masterFd), O_RDWR | O_NOCTTY);
+    if ((slaveFd < 0) || tcgetattr(slaveFd, &tty)) {
+	perror(ptsname(masterFd));
+	close(masterFd);
+	return -1;
+    }
+    cfmakeraw(&tty);
+    tcsetattr(slaveFd, TCSANOW, &tty);
+    if (2 == argc) {
+	outFile = fopen(argv[1], "wb");
+	if (NULL == outFile) {
+	    perror("Opening output file");
+	    close(slaveFd);
+	    close(masterFd);
+	    return -1;
+	}
+    }
+    printf("%s\n", ptsname(masterFd));
+    fflush(stdout);
+
+    while (!done) {
+	ssize_t             got = read(masterFd, buf, sizeof (buf));
+	ssize_t             i = 0;
+
+	if (got < 0) {
+	    if (EINTR == errno)
+		continue;
+	    perror("Reading from pseudo-terminal");
+	    done = -1;
+	    break;
+	}
+	if (0 == got) {
+	    fprintf(stderr, "The pseudo-terminal closed before WFMP? arrived.\n");
+	    done = -1;
+	    break;
+	}
+	if ((NULL != outFile) && (fwrite(buf, 1, (size_t) got, outFile) != (size_t) got)) {
+	    perror("Writing output");
+	    done = -1;
+	}
+	received += (unsigned long long) got;
+	for (i = 0; (i < got) && !done; i++)
+	    done = stubByte(&stub, masterFd, buf[i]);
+    }
+    // Give awgcom the chance to read the reply before this end goes away
+    tcdrain(masterFd);
+    sleep(1);
+    if ((NULL != outFile) && fclose(outFile))
+	done = -1;
+    close(slaveFd);
+    close(masterFd);
+    fprintf(stderr, "Received %llu bytes.\n", received);
+    return (done < 0) ? -1 : 0;
+}
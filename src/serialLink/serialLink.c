@@ -0,0 +1,384 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#ifdef HAVE_STRINGS_H
+#include <strings.h>
+#endif
+#include "serialLink.h"
+#include "../platform/platform.h"
+#include "../logging/logging.h"
+#ifdef HAVE_TERMIOS_H
+#include <termios.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+#define PROGRESS_INTERVAL 0.25	     // Seconds between progress updates
+
+/* State carried between calls of deviceSink() */
+typedef struct deviceSink {
+    int                 fd;
+    unsigned long long  sent;
+    unsigned long long  total;
+    double              startTime;
+    double              lastReport;
+} deviceSink_type;
+
+#ifdef HAVE_TERMIOS_H
+
+static int baudToSpeed(
+    long baud,
+    speed_t * speed
+) {
+    static const struct {
+	long                baud;
+	speed_t             speed;
+    } speedTable[] = {
+	{300, B300}, {600, B600}, {1200, B1200}, {2400, B2400}, {4800, B4800},
+	{9600, B9600}, {19200, B19200}, {38400, B38400},
+#ifdef B57600
+	{57600, B57600},
+#endif
+#ifdef B115200
+	{115200, B115200},
+#endif
+#ifdef B230400
+	{230400, B230400},
+#endif
+    };
+    size_t              i = 0;
+
+    for (i = 0; i < sizeof (speedTable) / sizeof (speedTable[0]); i++) {
+	if (speedTable[i].baud == baud) {
+	    *speed = speedTable[i].speed;
+	    return 0;
+	}
+    }
+    return -1;
+}
+
+int openSerialDevice(
+    const char *path,
+    long baud,
+    int flow
+) {
+    int                 fd = -1;
+    struct termios      tty;
+    speed_t             speed;
+
+    if (baudToSpeed(baud, &speed)) {
+	logMessage(LOG_ERROR, "Unsupported baud rate %ld.\n", baud);
+	return -1;
+    }
+
+    fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+	perror(path);
+	return -1;
+    }
+    if (!isatty(fd) || tcgetattr(fd, &tty)) {
+	logMessage(LOG_ERROR, "\"%s\" is not a serial device.\n", path);
+	close(fd);
+	return -1;
+    }
+    // Raw 8N1, no translation of any bytes in either direction
+    tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF);
+    tty.c_oflag &= ~OPOST;
+    tty.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+    tty.c_cflag &= ~(CSIZE | PARENB | CSTOPB);
+    tty.c_cflag |= (CS8 | CREAD | CLOCAL);
+#ifdef CRTSCTS
+    tty.c_cflag &= ~CRTSCTS;
+#endif
+    tty.c_cc[VMIN] = 1;
+    tty.c_cc[VTIME] = 0;
+
+    switch (flow) {
+    case SERIAL_FLOW_NONE:
+	break;
+    case SERIAL_FLOW_RTSCTS:
+#ifdef CRTSCTS
+	tty.c_cflag |= CRTSCTS;
+#else
+	logMessage(LOG_ERROR, "Hardware flow control is not available on this platform.\n");
+	close(fd);
+	return -1;
+#endif
+	break;
+    case SERIAL_FLOW_XONXOFF:
+	logMessage(LOG_WARN, "curve bytes 0x11 and 0x13 will look like XON/XOFF.\n");
+	tty.c_iflag |= (IXON | IXOFF);
+	break;
+    default:
+	logMessage(LOG_ERROR, "Unknown flow control setting %d.\n", flow);
+	close(fd);
+	return -1;
+    }
+
+    if (cfsetispeed(&tty, speed) || cfsetospeed(&tty, speed)
+	|| tcsetattr(fd, TCSANOW, &tty)) {
+	perror("Configuring serial device");
+	close(fd);
+	return -1;
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+int closeSerialDevice(
+    int fd
+) {
+    int                 retVal = 0;
+
+    if (tcdrain(fd))
+	retVal = -1;
+    if (close(fd))
+	retVal = -1;
+    return retVal;
+}
+
+static int deviceSink(
+    void *sinkCtx,
+    const unsigned char *bytes,
+    size_t len
+) {
+    deviceSink_type    *state = sinkCtx;
+
+    while (len > 0) {
+	ssize_t             wrote = write(state->fd, bytes, len);
+
+	if (wrote < 0) {
+	    if (EINTR == errno)
+		continue;
+	    perror("Writing to serial device");
+	    return -1;
+	}
+	bytes += wrote;
+	len -= (size_t) wrote;
+	state->sent += (unsigned long long) wrote;
+    }
+
+    if (LOG_ENABLED(LOG_INFO)) {
+	double              now = monotonicSeconds();
+
+	if ((now - state->lastReport) >= PROGRESS_INTERVAL) {
+	    double              elapsed = now - state->startTime;
+
+	    logMessage(LOG_INFO, "\rSent %llu of %llu bytes (%5.1f%%), %.2f kB/s ", state->sent,
+		       state->total, 100.0 * ((double) state->sent) / ((double) state->total),
+		       (elapsed > 0.0) ? ((double) state->sent) / elapsed / 1000.0 : 0.0);
+	    logFlush();
+	    state->lastReport = now;
+	}
+    }
+    return 0;
+}
+
+int streamToDevice(
+    int fd,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    const pipelineConfig_type * pipeConfig,
+    pipelineStats_type * stats
+) {
+    const pipelineConfig_type defaultConfig = PIPELINE_INIT_VAL;
+    deviceSink_type     state;
+    double              elapsed = 0.0;
+
+    state.fd = fd;
+    state.sent = 0;
+    state.total = pointsCommandBytes(plan, clockFreq);
+    if (0 == state.total)
+	return -1;
+    state.startTime = monotonicSeconds();
+    state.lastReport = state.startTime;
+
+    // Generated on worker threads, so the UART never waits on a chunk being made
+    if (runPipeline(freqList, plan, clockFreq, (NULL != pipeConfig) ? pipeConfig : &defaultConfig,
+		    deviceSink, &state, stats)) {
+	logMessage(LOG_INFO, "\n");
+	return -1;
+    }
+    // Bytes are only really sent once the output queue has drained
+    if (tcdrain(fd)) {
+	perror("Draining serial device");
+	return -1;
+    }
+    elapsed = monotonicSeconds() - state.startTime;
+    logMessage(LOG_INFO, "\rSent %llu bytes in %.2f s, %.2f kB/s%20s\n", state.sent, elapsed,
+	       (elapsed > 0.0) ? ((double) state.sent) / elapsed / 1000.0 : 0.0, "");
+    return 0;
+}
+
+int readDeviceReply(
+    int fd,
+    char *buf,
+    size_t bufSize,
+    int timeoutMs
+) {
+    double              deadline = monotonicSeconds() + 0.001 * timeoutMs;
+    size_t              readCount = 0;
+
+    if ((NULL == buf) || (0 == bufSize))
+	return -1;
+
+    while (readCount + 1 < bufSize) {
+	struct pollfd       waitFd;
+	int                 remaining = (int) (1000.0 * (deadline - monotonicSeconds()));
+	char                thisChar;
+	ssize_t             got;
+
+	if (remaining <= 0)
+	    break;
+	waitFd.fd = fd;
+	waitFd.events = POLLIN;
+	waitFd.revents = 0;
+	if (poll(&waitFd, 1, remaining) <= 0)
+	    continue;
+
+	got = read(fd, &thisChar, 1);
+	if (got < 0) {
+	    if (EINTR == errno)
+		continue;
+	    perror("Reading from serial device");
+	    return -1;
+	}
+	if (0 == got)
+	    break;
+	if ('\n' == thisChar) {
+	    if (readCount > 0)
+		break;
+	    continue;
+	}
+	if ('\r' != thisChar)
+	    buf[readCount++] = thisChar;
+    }
+    buf[readCount] = '\0';
+    return (readCount > 0) ? (int) readCount : -1;
+}
+
+#else
+
+int openSerialDevice(
+    const char *path,
+    long baud,
+    int flow
+) {
+    logMessage(LOG_ERROR, "Serial devices are not supported on this platform.\n");
+    return -1;
+}
+
+int closeSerialDevice(
+    int fd
+) {
+    return -1;
+}
+
+int streamToDevice(
+    int fd,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    const pipelineConfig_type * pipeConfig,
+    pipelineStats_type * stats
+) {
+    return -1;
+}
+
+int readDeviceReply(
+    int fd,
+    char *buf,
+    size_t bufSize,
+    int timeoutMs
+) {
+    return -1;
+}
+
+#endif
+
+int parseWfmpReply(
+    const char *reply,
+    wfmpReply_type * parsed
+) {
+    const char         *itemStart = reply;
+
+    if ((NULL == reply) || (NULL == parsed))
+	return -1;
+    memset(parsed, 0, sizeof (wfmpReply_type));
+
+    // Items are ';' separated, each "<header> <value>", header possibly with ":WFMPRE:" ahead of it
+    while ('\0' != *itemStart) {
+	const char         *itemEnd = strchr(itemStart, ';');
+	const char         *keyStart = itemStart;
+	const char         *keyEnd = NULL;
+	const char         *value = NULL;
+	size_t              keyLen = 0;
+	const char         *scan = NULL;
+
+	if (NULL == itemEnd)
+	    itemEnd = itemStart + strlen(itemStart);
+
+	while ((keyStart < itemEnd) && isspace((unsigned char) *keyStart))
+	    keyStart++;
+	keyEnd = keyStart;
+	while ((keyEnd < itemEnd) && !isspace((unsigned char) *keyEnd))
+	    keyEnd++;
+	for (scan = keyStart; scan < keyEnd; scan++) {
+	    if (':' == *scan)
+		keyStart = scan + 1;
+	}
+	keyLen = (size_t) (keyEnd - keyStart);
+	value = keyEnd;
+	while ((value < itemEnd) && isspace((unsigned char) *value))
+	    value++;
+
+#define KEY_IS(name) ((keyLen == strlen(name)) && (0 == strncasecmp(keyStart, name, keyLen)))
+	if (value < itemEnd) {
+	    if (KEY_IS("BYT_NR")) {
+		parsed->byteNr = (int) strtol(value, NULL, 10);
+		parsed->foundMask |= WFMP_BYTNR_MASK;
+	    } else if (KEY_IS("BIT_NR")) {
+		parsed->bitNr = (int) strtol(value, NULL, 10);
+		parsed->foundMask |= WFMP_BITNR_MASK;
+	    } else if (KEY_IS("ENCDG")) {
+		size_t              valLen = (size_t) (itemEnd - value);
+
+		if (valLen >= sizeof (parsed->encoding))
+		    valLen = sizeof (parsed->encoding) - 1;
+		memcpy(parsed->encoding, value, valLen);
+		parsed->encoding[valLen] = '\0';
+		parsed->foundMask |= WFMP_ENCDG_MASK;
+	    } else if (KEY_IS("NR_PT")) {
+		parsed->nrPt = strtoull(value, NULL, 10);
+		parsed->foundMask |= WFMP_NRPT_MASK;
+	    } else if (KEY_IS("XINCR")) {
+		parsed->xIncr = strtod(value, NULL);
+		parsed->foundMask |= WFMP_XINCR_MASK;
+	    } else if (KEY_IS("XZERO")) {
+		parsed->xZero = strtod(value, NULL);
+		parsed->foundMask |= WFMP_XZERO_MASK;
+	    } else if (KEY_IS("YMULT")) {
+		parsed->yMult = strtod(value, NULL);
+		parsed->foundMask |= WFMP_YMULT_MASK;
+	    } else if (KEY_IS("YOFF")) {
+		parsed->yOff = strtod(value, NULL);
+		parsed->foundMask |= WFMP_YOFF_MASK;
+	    } else if (KEY_IS("YZERO")) {
+		parsed->yZero = strtod(value, NULL);
+		parsed->foundMask |= WFMP_YZERO_MASK;
+	    }
+	}
+#undef KEY_IS
+
+	itemStart = ('\0' == *itemEnd) ? itemEnd : itemEnd + 1;
+    }
+
+    return (0 != parsed->foundMask) ? 0 : -1;
+}
@@ -0,0 +1,156 @@
+
+/*! @file serialLink.h
+ * @brief Sends the AWG command stream straight to a serial port.
+ *
+ * Configures a tty for the AWG's RS-232 port, streams the command bytes to it from the
+ * pipeline's writer while its generator threads make the later chunks, and reads back the
+ * reply to the @c WFMP? query.
+ * Any tty will do, including the slave side of a pseudo-terminal standing in for the instrument.
+ * awgptystub is one: it prints the path of a new pseudo-terminal, records what awgcom sends to
+ * it, and answers @c WFMP? with the width and point count of the curve it received.
+ * @code
+ * awgptystub received.bin > pty.txt &
+ * awgcom --device "$(cat pty.txt)"
+ * @endcode
+ *
+ * See the Programmer's Manual (@ref DeviceDocs) for the RS-232 settings and the @c WFMPre? reply.
+ */
+
+#ifndef SERIALLINK_H
+#define SERIALLINK_H
+
+#include <stddef.h>
+#include "../genBinary/genBinary.h"
+#include "../pipeline/pipeline.h"
+
+/*!
+ * @defgroup SerialFlow Serial flow control settings
+ * @brief Values accepted for the flow control of the serial link.
+ * @{
+ */
+#define SERIAL_FLOW_NONE	0	//!< No flow control.
+#define SERIAL_FLOW_RTSCTS	1	//!< Hardware (RTS/CTS) flow control.  The AWG calls this "hard" flagging.
+#define SERIAL_FLOW_XONXOFF	2	//!< Software (XON/XOFF) flow control.  Unsafe with binary curve data.
+
+/*! @} */
+
+#define SERIAL_DEFAULT_BAUD 9600	//!< Baud rate used when none is given.
+#define SERIAL_DEFAULT_FLOW SERIAL_FLOW_RTSCTS	//!< Flow control used when none is given.
+#define SERIAL_REPLY_TIMEOUT_MS 5000	//!< How long to wait for the reply to @c WFMP?, in ms.
+
+/*! @brief The fields of a @c WFMPre? reply we understand.
+ *
+ * Only fields found in the reply are meaningful, see #wfmpReply::foundMask.
+ */
+typedef struct wfmpReply {
+    unsigned int        foundMask;	//!< Bits set for each field found, see @ref WfmpFields.
+    int                 byteNr;	//!< BYT_NR, bytes per point.
+    int                 bitNr;	//!< BIT_NR, bits per point.
+    char                encoding[8];	//!< ENCDG, "BIN" or "ASC".
+    uint64_t            nrPt;	//!< NR_PT, number of points in the waveform.
+    double              xIncr;	//!< XINCR, sample period in s.
+    double              xZero;	//!< XZERO, time of the first point in s.
+    double              yMult;	//!< YMULT, volts per output count.
+    double              yOff;	//!< YOFF, offset in output counts.
+    double              yZero;	//!< YZERO, offset in volts.
+} wfmpReply_type;
+
+/*!
+ * @defgroup WfmpFields WFMPre reply field bits
+ * @brief Bits of #wfmpReply::foundMask
+ * @{
+ */
+#define WFMP_BYTNR_MASK		(1u << 0)	//!< #wfmpReply::byteNr was found.
+#define WFMP_BITNR_MASK		(1u << 1)	//!< #wfmpReply::bitNr was found.
+#define WFMP_ENCDG_MASK		(1u << 2)	//!< #wfmpReply::encoding was found.
+#define WFMP_NRPT_MASK		(1u << 3)	//!< #wfmpReply::nrPt was found.
+#define WFMP_XINCR_MASK		(1u << 4)	//!< #wfmpReply::xIncr was found.
+#define WFMP_XZERO_MASK		(1u << 5)	//!< #wfmpReply::xZero was found.
+#define WFMP_YMULT_MASK		(1u << 6)	//!< #wfmpReply::yMult was found.
+#define WFMP_YOFF_MASK		(1u << 7)	//!< #wfmpReply::yOff was found.
+#define WFMP_YZERO_MASK		(1u << 8)	//!< #wfmpReply::yZero was found.
+
+/*! @} */
+
+/*!	@brief Opens and configures a serial device for talking to the AWG.
+ *
+ * The port is set to raw 8N1 at the given baud rate and flow control.
+ *
+ * @param[in] path Path to the tty, e.g. "/dev/ttyS0".
+ * @param[in] baud The baud rate.  Must be one of the standard rates.
+ * @param[in] flow One of the @ref SerialFlow values.
+ * @return An open file descriptor on success
+ * @return -1 on failure, with a message printed to stderr.
+ */
+int                 openSerialDevice(
+    const char *path,
+    long baud,
+    int flow
+);
+
+/*!	@brief Waits for queued output to be sent, then closes the device.
+ *
+ * @param[in] fd File descriptor from openSerialDevice().
+ * @return 0 on success
+ * @return -1 on failure.
+ */
+int                 closeSerialDevice(
+    int fd
+);
+
+/*!	@brief Generates the waveform and streams the command bytes to an open device.
+ *
+ * Uses runPipeline(), so the first chunks are on the wire while later ones are generated.
+ * Unless --quiet is set, progress and throughput are printed as the transfer runs.
+ *
+ * @param[in] fd File descriptor from openSerialDevice().
+ * @param[in] freqList A pointer to the the freqList describing the pulse train.
+ * @param[in] plan The plan from planWaveform() for the same freqList.
+ * @param[in] clockFreq The output sample frequency
+ * @param[in] pipeConfig Ring and thread settings for runPipeline(), NULL for #PIPELINE_INIT_VAL.
+ * @param[out] stats If not NULL, filled with timing information.
+ * @return 0 on success
+ * @return -1 on failure.
+ */
+int                 streamToDevice(
+    int fd,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    const pipelineConfig_type * pipeConfig,
+    pipelineStats_type * stats
+);
+
+/*!	@brief Reads one line of reply from the device.
+ *
+ * @param[in] fd File descriptor from openSerialDevice().
+ * @param[out] buf Buffer for the reply, which is NULL terminated without the line ending.
+ * @param[in] bufSize Size of buf, in bytes.
+ * @param[in] timeoutMs How long to wait for the whole line, in ms.
+ * @return The number of characters read
+ * @return -1 on error or if nothing arrived before the timeout.
+ */
+int                 readDeviceReply(
+    int fd,
+    char *buf,
+    size_t bufSize,
+    int timeoutMs
+);
+
+/*!	@brief Parses the reply to a @c WFMP? query.
+ *
+ * Expects the reply with headers on, e.g.
+ * @code :WFMPRE:BYT_NR 1;BIT_NR 8;ENCDG BIN;NR_PT 1024;XINCR 9.765E-10@endcode
+ * Fields may be in any order, unknown fields are ignored.
+ *
+ * @param[in] reply The reply text.
+ * @param[out] parsed Where to store the fields found.
+ * @return 0 if at least one field was found
+ * @return -1 otherwise.
+ */
+int                 parseWfmpReply(
+    const char *reply,
+    wfmpReply_type * parsed
+);
+
+#endif
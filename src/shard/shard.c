@@ -0,0 +1,417 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "shard.h"
+#include "../summary/summary.h"
+#include "../compressStream/compressStream.h"
+#include "../platform/platform.h"
+#include "../logging/logging.h"
+
+/* Offset in the base train where shard index (from 0) starts; see shardRange(). */
+static uint64_t shardBoundary(
+    const wavePlan_type * plan,
+    unsigned int index,
+    unsigned int shardCount
+) {
+    const uint64_t      share = plan->basePoints / shardCount;
+    uint64_t            target = 0;
+    uint64_t            toothFirst = 0;
+    uint64_t            toothEnd = 0;
+    unsigned int        lo = 0;
+    unsigned int        hi = plan->toothCount;
+
+    if ((0 == index) || (0 == plan->toothCount))
+	return 0;
+    if (index >= shardCount)
+	return plan->basePoints;
+    // Split so basePoints * index can't overflow
+    target = share * index + (plan->basePoints % shardCount) * index / shardCount;
+
+    while (hi - lo > 1) {
+	unsigned int        mid = lo + (hi - lo) / 2;
+
+	if (*(plan->toothStart + mid) <= target)
+	    lo = mid;
+	else
+	    hi = mid;
+    }
+    toothFirst = *(plan->toothStart + lo);
+    toothEnd = *(plan->toothStart + lo + 1);
+    // A pulse longer than a share is split, any other goes whole to one side
+    if (toothEnd - toothFirst > share)
+	return target;
+    return (target - toothFirst <= toothEnd - target) ? toothFirst : toothEnd;
+}
+
+int shardRange(
+    const wavePlan_type * plan,
+    unsigned int index,
+    unsigned int shardCount,
+    uint64_t *first,
+    uint64_t *count
+) {
+    uint64_t            end = 0;
+
+    if ((0 == shardCount) || (shardCount > SHARD_MAX) || (0 == index) || (index > shardCount))
+	return -1;
+    *first = shardBoundary(plan, index - 1, shardCount);
+    end = shardBoundary(plan, index, shardCount);
+    *count = end - *first;
+    return 0;
+}
+
+/* "<rootName>_shard<index>of<shardCount><suffix>", to be freed by the caller, or NULL. */
+static char *shardFileName(
+    const char *rootName,
+    unsigned int index,
+    unsigned int shardCount,
+    const char *suffix
+) {
+    const char          fileNameSuf[] = "_shard";
+    char               *fileName = NULL;
+    size_t              fileNameLen;
+
+    // Two numbers of at most 10 digits, and "of"
+    fileNameLen = strlen(rootName) + strlen(fileNameSuf) + 22 + strlen(suffix);
+    fileName = malloc(fileNameLen + 1);
+    if (NULL == fileName)
+	return NULL;
+    snprintf(fileName, fileNameLen + 1, "%s%s%uof%u%s", rootName, fileNameSuf, index,
+	     shardCount, suffix);
+    return fileName;
+}
+
+/* The first line of a shard file, see @ref ShardFile, or -1 if it won't fit. */
+static int formatShardHeader(
+    char *buf,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    uint32_t specCrc,
+    unsigned int index,
+    unsigned int shardCount,
+    uint64_t first,
+    uint64_t count
+) {
+    int                 textLen = 0;
+
+    textLen = snprintf(buf, SHARD_HEADER_MAX, "AWGSHARD %d %u/%u %" PRIu64 " %" PRIu64 " %d %"
+		       PRIu64 " %08" PRIx32 " %.17g\n", SHARD_VERSION, index, shardCount, first,
+		       count, plan->sampleFormat, plan->basePoints, specCrc, clockFreq);
+    if ((textLen < 0) || (textLen >= SHARD_HEADER_MAX))
+	return -1;
+    return textLen;
+}
+
+/* Generates the samples [first, first + count) of the base train into shardFile. */
+static int genShardSamples(
+    FILE * shardFile,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    uint64_t first,
+    uint64_t count
+) {
+    const unsigned int  width = sampleFormatInfo(plan->sampleFormat)->width;
+    unsigned char      *chunk = NULL;
+    uint64_t            pos = 0;
+    int                 retVal = 0;
+
+    chunk = malloc(sizeof (unsigned char) * SHARD_CHUNK_POINTS * width);
+    if (NULL == chunk) {
+	perror("writeShard allocation");
+	return -1;
+    }
+    for (pos = 0; (pos < count) && !retVal; pos += SHARD_CHUNK_POINTS) {
+	uint64_t            run = count - pos;
+
+	if (run > SHARD_CHUNK_POINTS)
+	    run = SHARD_CHUNK_POINTS;
+	if (genPointRange(freqList, plan, first + pos, run, chunk)
+	    || (fwrite(chunk, width, run, shardFile) != run))
+	    retVal = -1;
+    }
+    free(chunk);
+    return retVal;
+}
+
+int writeShard(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    unsigned int index,
+    unsigned int shardCount
+) {
+    outputDigest_type   spec = OUTPUT_DIGEST_INIT_VAL;
+    char                headerBuf[SHARD_HEADER_MAX];
+    char               *fileName = NULL;
+    char               *tempName = NULL;
+    FILE               *shardFile = NULL;
+    uint64_t            first = 0;
+    uint64_t            count = 0;
+    int                 retVal = 0;
+
+    digestFreqList(&spec, freqList);
+    if (shardRange(plan, index, shardCount, &first, &count)
+	|| (formatShardHeader(headerBuf, plan, clockFreq, spec.crc, index, shardCount, first,
+			      count) < 0))
+	return -1;
+    logMessage(LOG_INFO, "Shard %u of %u: samples %" PRIu64 " to %" PRIu64 " of %" PRIu64
+	       ".\n", index, shardCount, first, first + count, plan->basePoints);
+
+    fileName = shardFileName(rootName, index, shardCount, "");
+    tempName = shardFileName(rootName, index, shardCount, ".part");
+    if ((NULL == fileName) || (NULL == tempName)) {
+	retVal = -1;
+    } else if (NULL == (shardFile = fopen(tempName, "wb"))) {
+	perror("Opening shard file");
+	retVal = -1;
+    } else {
+	if ((fputs(headerBuf, shardFile) < 0)
+	    || genShardSamples(shardFile, freqList, plan, first, count) || ferror(shardFile))
+	    retVal = -1;
+	if (fclose(shardFile))
+	    retVal = -1;
+	// Only a complete shard gets the name the merge looks for
+	if (!retVal) {
+	    remove(fileName);	     // rename() won't replace a file everywhere
+	    if (rename(tempName, fileName)) {
+		perror("Renaming shard file");
+		retVal = -1;
+	    }
+	}
+	if (retVal)
+	    remove(tempName);
+    }
+    if (NULL != fileName)
+	free(fileName);
+    if (NULL != tempName)
+	free(tempName);
+    return retVal;
+}
+
+/* The number of bytes from the current position to the end of the file, or -1. */
+static int bytesLeft(
+    FILE * shardFile,
+    uint64_t *len
+) {
+    uint64_t            here = 0;
+    uint64_t            end = 0;
+
+    if (filePosition(shardFile, &here) || fileLength(shardFile, &end) || (end < here))
+	return -1;
+    *len = end - here;
+    return 0;
+}
+
+/* Opens a shard and checks its first line is expectHeader and that its samples follow in
+ * full.  Leaves it positioned at the first sample. */
+static FILE *openShard(
+    const char *rootName,
+    unsigned int index,
+    unsigned int shardCount,
+    const char *expectHeader,
+    uint64_t expectBytes
+) {
+    char                headerBuf[SHARD_HEADER_MAX + 1];
+    char               *fileName = NULL;
+    FILE               *shardFile = NULL;
+    uint64_t            len = 0;
+
+    fileName = shardFileName(rootName, index, shardCount, "");
+    if (NULL == fileName)
+	return NULL;
+    shardFile = fopen(fileName, "rb");
+    if (NULL == shardFile) {
+	logMessage(LOG_ERROR, "Shard \"%s\" is missing.\n", fileName);
+    } else if ((NULL == fgets(headerBuf, sizeof (headerBuf), shardFile))
+	       || (0 != strcmp(headerBuf, expectHeader))) {
+	logMessage(LOG_ERROR, "Shard \"%s\" was not made from the same spec and options.\n",
+		   fileName);
+	fclose(shardFile);
+	shardFile = NULL;
+    } else if (bytesLeft(shardFile, &len) || (len != expectBytes)) {
+	logMessage(LOG_ERROR, "Shard \"%s\" is incomplete.\n", fileName);
+	fclose(shardFile);
+	shardFile = NULL;
+    }
+    free(fileName);
+    return shardFile;
+}
+
+/* State carried between calls of mergeSink() */
+typedef struct mergeSink {
+    FILE               *outFile;
+    outputDigest_type  *digest;
+} mergeSink_type;
+
+static int mergeSink(
+    void *sinkCtx,
+    const unsigned char *bytes,
+    size_t len
+) {
+    mergeSink_type     *state = sinkCtx;
+
+    digestBytes(state->digest, bytes, len);
+    if (fwrite(bytes, sizeof (unsigned char), len, state->outFile) != len)
+	return -1;
+    return 0;
+}
+
+/* Sends the whole base train from the shards, inverted if asked, through chunk. */
+static int sinkShards(
+    const char *rootName,
+    const wavePlan_type * plan,
+    unsigned int shardCount,
+    char (*headers)[SHARD_HEADER_MAX],
+    int inverted,
+    unsigned char *chunk,
+    mergeSink_type * sinkState
+) {
+    const unsigned int  width = sampleFormatInfo(plan->sampleFormat)->width;
+    unsigned int        i = 0;
+
+    for (i = 1; i <= shardCount; i++) {
+	uint64_t            first = 0;
+	uint64_t            count = 0;
+	uint64_t            pos = 0;
+	FILE               *shardFile = NULL;
+	int                 retVal = 0;
+
+	shardRange(plan, i, shardCount, &first, &count);
+	shardFile = openShard(rootName, i, shardCount, *(headers + i - 1), count * width);
+	if (NULL == shardFile)
+	    return -1;
+	for (pos = 0; (pos < count) && !retVal; pos += SHARD_CHUNK_POINTS) {
+	    uint64_t            run = count - pos;
+
+	    if (run > SHARD_CHUNK_POINTS)
+		run = SHARD_CHUNK_POINTS;
+	    if (fread(chunk, width, run, shardFile) != run) {
+		retVal = -1;
+		break;
+	    }
+	    if (inverted)
+		invertSamples(plan->sampleFormat, chunk, run, chunk);
+	    retVal = mergeSink(sinkState, chunk, run * width);
+	}
+	fclose(shardFile);
+	if (retVal)
+	    return -1;
+    }
+    return 0;
+}
+
+/* Sends the curve: the base train, then the inverted copy and repetitions, as
+ * streamPointsCommand() orders them. */
+static int sinkCurve(
+    const char *rootName,
+    const wavePlan_type * plan,
+    unsigned int shardCount,
+    char (*headers)[SHARD_HEADER_MAX],
+    mergeSink_type * sinkState
+) {
+    const unsigned int  width = sampleFormatInfo(plan->sampleFormat)->width;
+    unsigned char      *chunk = NULL;
+    uint64_t            rep = 0;
+    int                 retVal = 0;
+
+    chunk = malloc(sizeof (unsigned char) * SHARD_CHUNK_POINTS * width);
+    if (NULL == chunk) {
+	perror("mergeShards allocation");
+	return -1;
+    }
+    for (rep = 0; (rep < (((uint64_t) 1) << plan->numShifts)) && !retVal; rep++) {
+	retVal = sinkShards(rootName, plan, shardCount, headers, 0, chunk, sinkState);
+	if (!retVal && plan->flipCopy)
+	    retVal = sinkShards(rootName, plan, shardCount, headers, 1, chunk, sinkState);
+    }
+    free(chunk);
+    return retVal;
+}
+
+int mergeShards(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    unsigned int shardCount,
+    int compressKind,
+    int compressLevel,
+    outputDigest_type * digest
+) {
+    const unsigned int  width = sampleFormatInfo(plan->sampleFormat)->width;
+    outputDigest_type   spec = OUTPUT_DIGEST_INIT_VAL;
+    compressStream_type *output = NULL;
+    mergeSink_type      sinkState;
+    char                (*headers)[SHARD_HEADER_MAX] = NULL;
+    char               *fileName = NULL;
+    size_t              fileNameLen;
+    const char          fileNameSuf[] = "_points";
+    char                textBuf[128];
+    int                 textLen = 0;
+    unsigned int        i = 0;
+    int                 retVal = 0;
+
+    if ((0 == shardCount) || (shardCount > SHARD_MAX))
+	return -1;
+    headers = malloc(sizeof (*headers) * shardCount);
+    if (NULL == headers)
+	return -1;
+
+    // Every shard is checked before the points file is touched
+    digestFreqList(&spec, freqList);
+    for (i = 1; (i <= shardCount) && !retVal; i++) {
+	uint64_t            first = 0;
+	uint64_t            count = 0;
+	FILE               *shardFile = NULL;
+
+	if (shardRange(plan, i, shardCount, &first, &count)
+	    || (formatShardHeader(*(headers + i - 1), plan, clockFreq, spec.crc, i, shardCount,
+				  first, count) < 0)
+	    || (NULL == (shardFile =
+			 openShard(rootName, i, shardCount, *(headers + i - 1), count * width))))
+	    retVal = -1;
+	else
+	    fclose(shardFile);
+    }
+    if (retVal) {
+	free(headers);
+	return -1;
+    }
+
+    fileNameLen = strlen(rootName) + strlen(fileNameSuf);
+    fileName = malloc(fileNameLen + 1);
+    if (NULL == fileName) {
+	free(headers);
+	return -1;
+    }
+    strcpy(fileName, rootName);
+    strcat(fileName, fileNameSuf);
+    output = openCompressedOutput(fileName, compressKind, compressLevel);
+    free(fileName);
+    if (NULL == output) {
+	free(headers);
+	return -1;
+    }
+    sinkState.outFile = compressStreamFile(output);
+    sinkState.digest = digest;
+
+    textLen = formatPointsHeader(textBuf, sizeof (textBuf), plan->finalCount, plan->sampleFormat);
+    if ((textLen < 0) || mergeSink(&sinkState, (const unsigned char *) textBuf, textLen)
+	|| sinkCurve(rootName, plan, shardCount, headers, &sinkState)
+	|| streamMarkerBlock(plan, mergeSink, &sinkState))
+	retVal = -1;
+    if (!retVal) {
+	textLen = formatPointsTrailer(textBuf, sizeof (textBuf), clockFreq);
+	if ((textLen < 0) || mergeSink(&sinkState, (const unsigned char *) textBuf, textLen))
+	    retVal = -1;
+    }
+    if (ferror(sinkState.outFile))
+	retVal = -1;
+    if (closeCompressStream(output))
+	retVal = -1;
+    free(headers);
+    return retVal;
+}
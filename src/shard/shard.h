@@ -0,0 +1,120 @@
+
+/*! @file shard.h
+ * @brief Splits generation of one waveform across independent processes, and joins the parts.
+ *
+ * With --shard i/N, a process generates only the i-th of N ranges of the base pulse train
+ * and saves it as "<root>_shard<i>of<N>".  The N processes share nothing but the spec (and
+ * the directory the shards go to), so they can run on one machine or on several hosts with a
+ * shared filesystem.  --merge N then writes the points file from the shards: the header,
+ * the base train, the inverted copy and repetitions read back from the shards, the marker
+ * block and the trailer.  The result is byte for byte the file a single process writes.
+ *
+ * The ranges come from the planned pulse offsets, see shardRange().  Every process works out
+ * the same plan from the same options, so nothing has to be passed between them.
+ *
+ * @section ShardFile Shard file layout
+ *
+ * One line of text, then the samples of the range exactly as they appear in the curve.
+ * @code
+ * AWGSHARD 1 <i>/<N> <first> <count> <format> <base> <spec> <clock>
+ * @endcode
+ * Field | Meaning
+ * ----- | -------
+ * 1 | Layout version, #SHARD_VERSION
+ * <i>/<N> | Shard number, from 1, and the number of shards
+ * <first> <count> | Offset in the base train of the first sample, and the number of samples
+ * <format> | The @ref SampleFormats value the samples are stored in
+ * <base> | Samples in the whole base train
+ * <spec> | CRC32C of the pulse list, from digestFreqList(), as 8 hex digits
+ * <clock> | Sample clock in MHz, printed with %.17g so it reads back exactly
+ *
+ * The merge checks every field against its own plan, and that the file holds exactly
+ * <count> samples, before writing anything.  A shard is written under a temporary name and
+ * renamed when it is complete, so a shard file that exists is never partial.
+ */
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdint.h>
+#include "../genBinary/genBinary.h"
+#include "../checksum/checksum.h"
+
+#define SHARD_VERSION 1	//!< Layout version in the first line of a shard file.
+#define SHARD_MAX 4096	//!< Most shards a waveform can be split into.
+#define SHARD_CHUNK_POINTS (1ul << 20)	//!< Samples generated, or copied by the merge, at a time.
+#define SHARD_HEADER_MAX 160	//!< Longest first line of a shard file, including the newline.
+
+/*!	@brief Works out which samples of the base train shard index of shardCount covers.
+ *
+ * The base train is split into shardCount runs of as nearly equal length as the pulses
+ * allow.  Each boundary falls on the pulse start nearest to its share, so every pulse is
+ * generated whole by one process, unless a single pulse is longer than a share.  Then the
+ * boundary is left inside that pulse.  Some shards may be empty.
+ *
+ * @param[in] plan The plan from planWaveform().
+ * @param[in] index The shard, from 1 to shardCount.
+ * @param[in] shardCount The number of shards, from 1 to #SHARD_MAX.
+ * @param[out] first Offset in the base train of the shard's first sample.
+ * @param[out] count Number of samples in the shard.
+ * @return 0 on success
+ * @return -1 if index or shardCount is out of range.
+ */
+int                 shardRange(
+    const wavePlan_type * plan,
+    unsigned int index,
+    unsigned int shardCount,
+    uint64_t *first,
+    uint64_t *count
+);
+
+/*!	@brief Generates one shard of the base train into "\<rootName\>_shard\<index\>of\<shardCount\>".
+ *
+ * See @ref ShardFile for the layout.
+ *
+ * @param[in] rootName The base of the filename we're saving to.
+ * @param[in] freqList A pointer to the the freqList describing the pulse train.
+ * @param[in] plan The plan from planWaveform() for the same freqList.
+ * @param[in] clockFreq The output sample frequency, in MHz.
+ * @param[in] index The shard to generate, from 1 to shardCount.
+ * @param[in] shardCount The number of shards, from 1 to #SHARD_MAX.
+ * @return 0 on success
+ * @return -1 on failure, in which case no shard file is left behind.
+ */
+int                 writeShard(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    unsigned int index,
+    unsigned int shardCount
+);
+
+/*!	@brief Writes the points file from the shardCount shards saved under rootName.
+ *
+ * Produces the same file as generating with genPointList() and calling writeToFile().
+ * The shards are left in place.
+ *
+ * @param[in] rootName The base of the filename the shards were saved to, and the points file is.
+ * @param[in] freqList A pointer to the the freqList describing the pulse train.
+ * @param[in] plan The plan from planWaveform() for the same freqList, with markerMode set.
+ * @param[in] clockFreq The output sample frequency, in MHz.
+ * @param[in] shardCount The number of shards the base train was split into.
+ * @param[in] compressKind How to compress the file, one of the @ref CompressKinds.
+ * @param[in] compressLevel Compression level, or #COMPRESS_LEVEL_DEFAULT.
+ * @param[inout] digest If not NULL, every byte written is added to it, before compression.
+ * @return 0 on success
+ * @return -1 on failure, including a missing shard or one that doesn't match the plan.
+ */
+int                 mergeShards(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    unsigned int shardCount,
+    int compressKind,
+    int compressLevel,
+    outputDigest_type * digest
+);
+
+#endif
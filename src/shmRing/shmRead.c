@@ -0,0 +1,63 @@
+/* Reference consumer for --shm: copies a shared memory ring to a file or to stdout. */
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include "shmRing.h"
+
+int main(
+    int argc,
+    char *argv[]
+) {
+    shmRing_type       *ring = NULL;
+    FILE               *outFile = stdout;
+    const unsigned char *bytes = NULL;
+    size_t              len = 0;
+    unsigned long long  copied = 0;
+    int                 failed = 0;
+
+    if ((argc < 2) || (argc > 3) || (0 == strcmp(argv[1], "-h"))) {
+	fprintf(stderr, "Usage:  awgshmread <name> [<output file>]\n\n"
+		"Copies the command bytes published by awgcom --shm <name> to the file,\n"
+		"or to standard output, as they arrive.\n");
+	return (argc < 2) ? -1 : 0;
+    }
+#ifdef SIGPIPE
+    // A closed pipe downstream is reported, so the producer hears we stopped
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    if (3 == argc) {
+	outFile = fopen(argv[2], "wb");
+	if (NULL == outFile) {
+	    perror("Opening output file");
+	    return -1;
+	}
+    }
+
+    ring = attachShmRing(argv[1], SHM_RING_ATTACH_MS);
+    if (NULL == ring) {
+	fprintf(stderr, "No shared memory ring \"/%s\" appeared.\n", argv[1]);
+	if (stdout != outFile)
+	    fclose(outFile);
+	return -1;
+    }
+    // Straight from the ring to the output, one contiguous run at a time
+    while (!(failed = shmRingPeek(ring, &bytes, &len)) && (len > 0)) {
+	if (fwrite(bytes, 1, len, outFile) != len) {
+	    perror("Writing output");
+	    failed = 1;
+	    break;
+	}
+	shmRingRelease(ring, len);
+	copied += len;
+    }
+    if (fflush(outFile) || ((stdout != outFile) && fclose(outFile)))
+	failed = 1;
+    detachShmRing(ring, failed);
+    if (failed) {
+	fprintf(stderr, "Stopped after %llu bytes.\n", copied);
+	return -1;
+    }
+    return 0;
+}
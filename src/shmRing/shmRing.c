@@ -0,0 +1,411 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+#if defined(HAVE_LINUX_FUTEX_H) && defined(HAVE_SYS_SYSCALL_H)
+#define SHM_RING_WITH_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#include "shmRing.h"
+
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
+
+/* The layout is shared with other programs, so it must not drift */
+typedef char        shmRingHeaderSize_check[(sizeof (shmRingHeader_type) ==
+					     SHM_RING_HEADER_BYTES) ? 1 : -1];
+
+struct shmRing {
+    shmRingHeader_type *header;
+    unsigned char      *data;
+    size_t              mapBytes;
+    char               *name;	     // With the leading '/'
+    int                 producer;
+};
+
+#ifdef HAVE_SYS_MMAN_H
+static uint64_t loadAcquire(
+    const uint64_t * pos
+) {
+    return __atomic_load_n(pos, __ATOMIC_ACQUIRE);
+}
+
+static uint32_t loadState(
+    const shmRingHeader_type * header
+) {
+    return __atomic_load_n(&header->state, __ATOMIC_ACQUIRE);
+}
+
+/* Non-zero once the consumer has gone, whether or not it said so. */
+static int readerGone(
+    const shmRingHeader_type * header
+) {
+    const uint32_t      pid = __atomic_load_n(&header->readerPid, __ATOMIC_ACQUIRE);
+
+    if (SHM_RING_ABANDONED == loadState(header))
+	return 1;
+    return (0 != pid) && kill((pid_t) pid, 0) && (ESRCH == errno);
+}
+
+/* Wakes whoever waits on seq, after a change the other side should see. */
+static void bumpAndWake(
+    uint32_t * seq
+) {
+    __atomic_add_fetch(seq, 1, __ATOMIC_RELEASE);
+#ifdef SHM_RING_WITH_FUTEX
+    syscall(SYS_futex, seq, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+    return;
+}
+
+/* Waits for seq to move on from seen, for at most SHM_RING_WAIT_MS. */
+static void waitForChange(
+    uint32_t * seq,
+    uint32_t seen
+) {
+#ifdef SHM_RING_WITH_FUTEX
+    struct timespec     timeout = { 0, SHM_RING_WAIT_MS * 1000000L };
+
+    // Shared between processes, so not FUTEX_PRIVATE_FLAG
+    syscall(SYS_futex, seq, FUTEX_WAIT, seen, &timeout, NULL, 0);
+#else
+    struct timespec     nap = { 0, 1000000L };
+
+    if (__atomic_load_n(seq, __ATOMIC_ACQUIRE) == seen)
+	nanosleep(&nap, NULL);
+#endif
+    return;
+}
+
+/* Builds "/<name>" for shm_open(). */
+static char        *objectName(
+    const char *name
+) {
+    char               *objName = malloc(strlen(name) + 2);
+
+    if (NULL != objName) {
+	objName[0] = '/';
+	strcpy(objName + 1, name);
+    }
+    return objName;
+}
+
+static void freeRing(
+    shmRing_type * ring
+) {
+    if (NULL != ring->header)
+	munmap(ring->header, ring->mapBytes);
+    if (NULL != ring->name)
+	free(ring->name);
+    free(ring);
+    return;
+}
+
+shmRing_type       *createShmRing(
+    const char *name,
+    uint64_t capacity,
+    uint64_t totalBytes,
+    int lockPages
+) {
+    shmRing_type       *ring = calloc(1, sizeof (shmRing_type));
+    void               *map = NULL;
+    int                 fd = -1;
+
+    if (NULL == ring)
+	return NULL;
+    ring->producer = 1;
+    ring->name = objectName(name);
+    ring->mapBytes = SHM_RING_HEADER_BYTES + capacity;
+    if ((NULL == ring->name) || (0 == capacity)) {
+	freeRing(ring);
+	return NULL;
+    }
+
+    shm_unlink(ring->name);
+    fd = shm_open(ring->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+	perror("Creating shared memory ring");
+	freeRing(ring);
+	return NULL;
+    }
+    if (ftruncate(fd, (off_t) ring->mapBytes)) {
+	perror("Sizing shared memory ring");
+	close(fd);
+	shm_unlink(ring->name);
+	freeRing(ring);
+	return NULL;
+    }
+    map = mmap(NULL, ring->mapBytes, PROT_READ | PROT_WRITE,
+	       MAP_SHARED | (lockPages ? MAP_POPULATE : 0), fd, 0);
+    close(fd);
+    if (MAP_FAILED == map) {
+	perror("Mapping shared memory ring");
+	shm_unlink(ring->name);
+	freeRing(ring);
+	return NULL;
+    }
+    if (lockPages && mlock(map, ring->mapBytes))
+	perror("Locking shared memory ring, it may be paged out");   // Only slower, carry on
+    ring->header = map;
+    ring->data = ((unsigned char *) map) + SHM_RING_HEADER_BYTES;
+
+    // The object starts zeroed, so only the fixed fields need setting.  Magic goes last.
+    ring->header->version = SHM_RING_VERSION;
+    ring->header->headerBytes = SHM_RING_HEADER_BYTES;
+    ring->header->capacity = capacity;
+    ring->header->totalBytes = totalBytes;
+    ring->header->state = SHM_RING_RUNNING;
+    __atomic_store_n(&ring->header->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+    return ring;
+}
+
+int shmRingWrite(
+    shmRing_type * ring,
+    const unsigned char *bytes,
+    size_t len
+) {
+    shmRingHeader_type *header = ring->header;
+    const uint64_t      capacity = header->capacity;
+    uint64_t            writePos = header->writePos;
+
+    while (len > 0) {
+	uint64_t            space = 0;
+	size_t              offset = 0;
+	size_t              run = 0;
+
+	for (;;) {
+	    const uint32_t      seen = __atomic_load_n(&header->readSeq, __ATOMIC_ACQUIRE);
+
+	    space = capacity - (writePos - loadAcquire(&header->readPos));
+	    if (space > 0)
+		break;
+	    if (readerGone(header))
+		return -1;
+	    waitForChange(&header->readSeq, seen);
+	}
+
+	// Up to the end of the ring at most, the rest goes round on the next pass
+	offset = (size_t) (writePos % capacity);
+	run = (size_t) space;
+	if (run > len)
+	    run = len;
+	if (run > capacity - offset)
+	    run = (size_t) (capacity - offset);
+	memcpy(ring->data + offset, bytes, run);
+	bytes += run;
+	len -= run;
+	writePos += run;
+	__atomic_store_n(&header->writePos, writePos, __ATOMIC_RELEASE);
+	bumpAndWake(&header->writeSeq);
+    }
+    return 0;
+}
+
+int finishShmRing(
+    shmRing_type * ring,
+    int failed
+) {
+    shmRingHeader_type *header = ring->header;
+    int                 retVal = failed ? -1 : 0;
+
+    __atomic_store_n(&header->state, failed ? SHM_RING_FAILED : SHM_RING_DONE,
+		     __ATOMIC_RELEASE);
+    bumpAndWake(&header->writeSeq);
+    // The name has to stay until the consumer has everything, or it may never find the ring
+    while (!failed && (loadAcquire(&header->readPos) != header->writePos)) {
+	const uint32_t      seen = __atomic_load_n(&header->readSeq, __ATOMIC_ACQUIRE);
+
+	if (loadAcquire(&header->readPos) == header->writePos)
+	    break;
+	if (readerGone(header)) {
+	    retVal = -1;
+	    break;
+	}
+	waitForChange(&header->readSeq, seen);
+    }
+    shm_unlink(ring->name);
+    freeRing(ring);
+    return retVal;
+}
+
+shmRing_type       *attachShmRing(
+    const char *name,
+    int timeoutMs
+) {
+    shmRing_type       *ring = calloc(1, sizeof (shmRing_type));
+    const struct timespec nap = { 0, 10000000L };
+    int                 waited = 0;
+    int                 fd = -1;
+    struct stat         info;
+    void               *map = NULL;
+
+    if (NULL == ring)
+	return NULL;
+    ring->name = objectName(name);
+    if (NULL == ring->name) {
+	freeRing(ring);
+	return NULL;
+    }
+
+    // Wait for the producer to create the object and finish its header
+    for (;;) {
+	fd = shm_open(ring->name, O_RDWR, 0);
+	if ((fd >= 0) && !fstat(fd, &info) && (info.st_size >= SHM_RING_HEADER_BYTES)) {
+	    map = mmap(NULL, (size_t) info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	    if (MAP_FAILED == map) {
+		map = NULL;
+	    } else if (SHM_RING_MAGIC ==
+		       __atomic_load_n(&((shmRingHeader_type *) map)->magic, __ATOMIC_ACQUIRE)) {
+		break;
+	    } else {
+		munmap(map, (size_t) info.st_size);
+		map = NULL;
+	    }
+	}
+	if (fd >= 0)
+	    close(fd);
+	fd = -1;
+	if (waited >= timeoutMs) {
+	    freeRing(ring);
+	    return NULL;
+	}
+	nanosleep(&nap, NULL);
+	waited += 10;
+    }
+    close(fd);
+    ring->header = map;
+    ring->mapBytes = (size_t) info.st_size;
+    ring->data = ((unsigned char *) map) + ring->header->headerBytes;
+    if ((SHM_RING_VERSION != ring->header->version)
+	|| (ring->header->headerBytes + ring->header->capacity > ring->mapBytes)) {
+	freeRing(ring);
+	return NULL;
+    }
+    __atomic_store_n(&ring->header->readerPid, (uint32_t) getpid(), __ATOMIC_RELEASE);
+    return ring;
+}
+
+int shmRingPeek(
+    shmRing_type * ring,
+    const unsigned char **bytes,
+    size_t *len
+) {
+    shmRingHeader_type *header = ring->header;
+    const uint64_t      capacity = header->capacity;
+    const uint64_t      readPos = header->readPos;
+    uint64_t            available = 0;
+    size_t              offset = (size_t) (readPos % capacity);
+
+    for (;;) {
+	const uint32_t      seen = __atomic_load_n(&header->writeSeq, __ATOMIC_ACQUIRE);
+	const uint32_t      state = loadState(header);
+
+	// The state is read before the position, so DONE means nothing more can follow
+	available = loadAcquire(&header->writePos) - readPos;
+	if (available > 0)
+	    break;
+	if (SHM_RING_DONE == state) {
+	    *bytes = ring->data + offset;
+	    *len = 0;
+	    return 0;
+	}
+	if (SHM_RING_RUNNING != state)
+	    return -1;
+	waitForChange(&header->writeSeq, seen);
+    }
+    if (available > capacity - offset)
+	available = capacity - offset;
+    *bytes = ring->data + offset;
+    *len = (size_t) available;
+    return 0;
+}
+
+void shmRingRelease(
+    shmRing_type * ring,
+    size_t len
+) {
+    __atomic_store_n(&ring->header->readPos, ring->header->readPos + len, __ATOMIC_RELEASE);
+    bumpAndWake(&ring->header->readSeq);
+    return;
+}
+
+void detachShmRing(
+    shmRing_type * ring,
+    int abandon
+) {
+    if (abandon) {
+	__atomic_store_n(&ring->header->state, SHM_RING_ABANDONED, __ATOMIC_RELEASE);
+	bumpAndWake(&ring->header->readSeq);
+    }
+    freeRing(ring);
+    return;
+}
+#else
+// No POSIX shared memory on this platform, e.g. Windows
+
+shmRing_type       *createShmRing(
+    const char *name,
+    uint64_t capacity,
+    uint64_t totalBytes,
+    int lockPages
+) {
+    return NULL;
+}
+
+int shmRingWrite(
+    shmRing_type * ring,
+    const unsigned char *bytes,
+    size_t len
+) {
+    return -1;
+}
+
+int finishShmRing(
+    shmRing_type * ring,
+    int failed
+) {
+    return -1;
+}
+
+shmRing_type       *attachShmRing(
+    const char *name,
+    int timeoutMs
+) {
+    return NULL;
+}
+
+int shmRingPeek(
+    shmRing_type * ring,
+    const unsigned char **bytes,
+    size_t *len
+) {
+    return -1;
+}
+
+void shmRingRelease(
+    shmRing_type * ring,
+    size_t len
+) {
+    return;
+}
+
+void detachShmRing(
+    shmRing_type * ring,
+    int abandon
+) {
+    return;
+}
+#endif
@@ -0,0 +1,207 @@
+
+/*! @file shmRing.h
+ * @brief Hands the AWG command bytes to another process through a POSIX shared-memory ring.
+ *
+ * With --shm, the bytes that would go into the points file are published into a ring buffer
+ * in the shared memory object "/<name>" as they are generated, so an uploader process can
+ * send each chunk on as soon as it exists, with no file in between.  awgshmread is a small
+ * reference consumer that copies the ring to a file or to stdout.
+ *
+ * @section ShmRingLayout Shared memory layout
+ *
+ * The object is a #shmRingHeader of #SHM_RING_HEADER_BYTES, followed by shmRingHeader::capacity
+ * bytes of data.  All fields are native endian, as both ends run on the same machine.
+ * Byte n of the stream is stored at data offset n % capacity.
+ *
+ * - The producer fills in every field, then stores shmRingHeader::magic last, so a consumer
+ *   that finds the magic sees a complete header.
+ * - The producer publishes bytes by advancing shmRingHeader::writePos (release), then
+ *   incrementing shmRingHeader::writeSeq and waking any futex waiters on it.
+ * - The consumer frees space by advancing shmRingHeader::readPos (release), then
+ *   incrementing shmRingHeader::readSeq and waking any futex waiters on it.
+ * - Each side waits on the other's sequence word with a shared (not private) futex,
+ *   timing out every #SHM_RING_WAIT_MS to check shmRingHeader::state in case of a missed wake.
+ *   Where futexes are not available, the wait is a short sleep instead.
+ * - The producer sets shmRingHeader::state to #SHM_RING_DONE after the last byte, or to
+ *   #SHM_RING_FAILED, and wakes the consumer.  A consumer that gives up sets
+ *   #SHM_RING_ABANDONED.  One that exits without doing so is noticed through
+ *   shmRingHeader::readerPid.
+ * - The producer waits for the consumer to read everything before it removes the name.
+ *   A consumer already attached keeps its mapping after that.
+ */
+
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../genBinary/genBinary.h"
+#include "../pipeline/pipeline.h"
+
+#define SHM_RING_MAGIC 0x474E5257u	//!< "WRNG" in a little-endian dump, in shmRingHeader::magic.
+#define SHM_RING_VERSION 1	//!< Layout version in shmRingHeader::version.
+#define SHM_RING_HEADER_BYTES 256	//!< Size of #shmRingHeader, where the data starts.
+#define SHM_RING_DEFAULT_BYTES (16ul << 20)	//!< Data bytes in a ring made by --shm.
+#define SHM_RING_WAIT_MS 100	//!< Longest single wait before the state is checked again.
+#define SHM_RING_ATTACH_MS 10000	//!< How long attachShmRing() waits for the producer by default.
+
+/*!
+ * @defgroup ShmRingStates Ring states
+ * @brief Values of shmRingHeader::state.
+ * @{
+ */
+#define SHM_RING_RUNNING   0	//!< The producer is still publishing.
+#define SHM_RING_DONE      1	//!< Every byte has been published.
+#define SHM_RING_FAILED    2	//!< The producer stopped early; what was published is incomplete.
+#define SHM_RING_ABANDONED 3	//!< The consumer stopped reading.
+
+/*! @} */
+
+/*! @brief The start of the shared memory object.  See @ref ShmRingLayout.
+ *
+ * The producer's and the consumer's fields are on separate cache lines.
+ */
+typedef struct shmRingHeader {
+    uint32_t            magic;	//!< #SHM_RING_MAGIC once the header is complete.
+    uint32_t            version;	//!< #SHM_RING_VERSION.
+    uint64_t            headerBytes;	//!< Offset of the data from the start of the object.
+    uint64_t            capacity;	//!< Bytes of data in the ring.
+    uint64_t            totalBytes;	//!< Bytes the producer will publish in all, or 0 if not known.
+    uint32_t            state;	//!< One of the @ref ShmRingStates.
+    uint8_t             pad0[28];
+    uint64_t            writePos;	//!< Bytes published so far.  Written by the producer only.
+    uint32_t            writeSeq;	//!< Futex word, incremented after writePos moves.
+    uint8_t             pad1[52];
+    uint64_t            readPos;	//!< Bytes consumed so far.  Written by the consumer only.
+    uint32_t            readSeq;	//!< Futex word, incremented after readPos moves.
+    uint32_t            readerPid;	//!< Process ID of the consumer once attached, so the producer can tell if it died.
+    uint8_t             pad2[112];
+} shmRingHeader_type;
+
+/*! @brief An open ring, at either end.
+ *
+ * The contents are private to shmRing.c.
+ */
+typedef struct shmRing shmRing_type;
+
+/*!	@brief Creates the ring as its producer.
+ *
+ * Any stale object of the same name, e.g. from a run that was killed, is replaced.
+ *
+ * @param[in] name Name of the shared memory object, without the leading '/'.
+ * @param[in] capacity Bytes of data in the ring.
+ * @param[in] totalBytes Bytes that will be published in all, or 0 if not known.
+ * @param[in] lockPages Non-zero to fault the whole mapping in (MAP_POPULATE) and lock it
+ * into memory now, so publishing never waits on a page fault.  See @ref PipelineRealtime.
+ * @return The ring
+ * @return NULL on failure, or where shared memory is not supported.
+ */
+shmRing_type       *createShmRing(
+    const char *name,
+    uint64_t capacity,
+    uint64_t totalBytes,
+    int lockPages
+);
+
+/*!	@brief Publishes bytes, waiting for the consumer to make room as needed.
+ *
+ * @param[inout] ring The ring from createShmRing().
+ * @param[in] bytes What to publish.
+ * @param[in] len Number of bytes.
+ * @return 0 on success
+ * @return -1 if the consumer abandoned the ring.
+ */
+int                 shmRingWrite(
+    shmRing_type * ring,
+    const unsigned char *bytes,
+    size_t len
+);
+
+/*!	@brief Marks the end of the stream, waits for it to be read, and removes the ring.
+ *
+ * @param[in] ring The ring from createShmRing().
+ * @param[in] failed Non-zero to mark the stream #SHM_RING_FAILED instead of #SHM_RING_DONE.
+ * @return 0 on success
+ * @return -1 if the consumer abandoned the ring or failed is set.
+ */
+int                 finishShmRing(
+    shmRing_type * ring,
+    int failed
+);
+
+/*!	@brief Attaches to a ring as its consumer.
+ *
+ * @param[in] name Name of the shared memory object, without the leading '/'.
+ * @param[in] timeoutMs How long to wait for the producer to create the ring.
+ * @return The ring
+ * @return NULL if it did not appear, or its header does not match this version.
+ */
+shmRing_type       *attachShmRing(
+    const char *name,
+    int timeoutMs
+);
+
+/*!	@brief Waits for published bytes, and points at them where they are in the ring.
+ *
+ * Nothing is copied.  The bytes stay valid until released with shmRingRelease().
+ * At the wrap-around only the part up to the end of the ring is given.
+ *
+ * @param[inout] ring The ring from attachShmRing().
+ * @param[out] bytes Set to the first unread byte.
+ * @param[out] len Set to the number of contiguous unread bytes, 0 at the end of the stream.
+ * @return 0 on success
+ * @return -1 if the producer failed.
+ */
+int                 shmRingPeek(
+    shmRing_type * ring,
+    const unsigned char **bytes,
+    size_t *len
+);
+
+/*!	@brief Gives len bytes from shmRingPeek() back to the producer.
+ *
+ * @param[inout] ring The ring from attachShmRing().
+ * @param[in] len Bytes consumed, at most the length shmRingPeek() gave.
+ */
+void                shmRingRelease(
+    shmRing_type * ring,
+    size_t len
+);
+
+/*!	@brief Generates the waveform and publishes the command bytes into a new ring.
+ *
+ * Uses streamPointsCommand(), or runPipeline() if pipeConfig is given.  The ring holds
+ * #SHM_RING_DEFAULT_BYTES, or the whole stream if that is smaller, and returns once the
+ * consumer has read everything.
+ *
+ * @param[in] name Name of the shared memory object, without the leading '/'.
+ * @param[in] freqList A pointer to the the freqList describing the pulse train.
+ * @param[in] plan The plan from planWaveform() for the same freqList.
+ * @param[in] clockFreq The output sample frequency
+ * @param[in] pipeConfig Ring and thread settings for runPipeline(), NULL to generate on this thread.
+ * @param[out] stats If pipeConfig is given and this is not NULL, filled with timing information.
+ * @param[inout] digest If not NULL, every byte published is added to it.
+ * @return 0 on success
+ * @return -1 on failure, including the consumer abandoning the ring.
+ */
+int                 streamToShmRing(
+    const char *name,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    const pipelineConfig_type * pipeConfig,
+    pipelineStats_type * stats,
+    outputDigest_type * digest
+);
+
+/*!	@brief Detaches the consumer from a ring.
+ *
+ * @param[in] ring The ring from attachShmRing().
+ * @param[in] abandon Non-zero if the stream was not read to the end, so the producer stops.
+ */
+void                detachShmRing(
+    shmRing_type * ring,
+    int abandon
+);
+
+#endif
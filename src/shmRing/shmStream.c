@@ -0,0 +1,63 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include "shmRing.h"
+#include "../logging/logging.h"
+
+/* State carried between calls of ringSink() */
+typedef struct ringSink {
+    shmRing_type       *ring;
+    outputDigest_type  *digest;
+} ringSink_type;
+
+static int ringSink(
+    void *sinkCtx,
+    const unsigned char *bytes,
+    size_t len
+) {
+    ringSink_type      *state = sinkCtx;
+
+    digestBytes(state->digest, bytes, len);
+    return shmRingWrite(state->ring, bytes, len);
+}
+
+int streamToShmRing(
+    const char *name,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const double clockFreq,
+    const pipelineConfig_type * pipeConfig,
+    pipelineStats_type * stats,
+    outputDigest_type * digest
+) {
+    const uint64_t      total = pointsCommandBytes(plan, clockFreq);
+    shmRing_type       *ring = NULL;
+    ringSink_type       sinkState;
+    int                 streamStatus = 0;
+
+    if (0 == total)
+	return -1;
+    ring = createShmRing(name, (total < SHM_RING_DEFAULT_BYTES) ? total : SHM_RING_DEFAULT_BYTES,
+			 total, (NULL != pipeConfig) && pipeConfig->realtime);
+    if (NULL == ring) {
+	logMessage(LOG_ERROR, "Problem creating shared memory ring \"/%s\".\n", name);
+	return -1;
+    }
+    logMessage(LOG_INFO, "Publishing %" PRIu64 " bytes to shared memory ring \"/%s\".\n", total,
+	       name);
+    logFlush();
+
+    sinkState.ring = ring;
+    sinkState.digest = digest;
+    if (NULL != pipeConfig)
+	streamStatus =
+	    runPipeline(freqList, plan, clockFreq, pipeConfig, ringSink, &sinkState, stats);
+    else
+	streamStatus = streamPointsCommand(freqList, plan, clockFreq, ringSink, &sinkState);
+    if (finishShmRing(ring, streamStatus)) {
+	if (!streamStatus)
+	    logMessage(LOG_ERROR, "The consumer of \"/%s\" stopped reading.\n", name);
+	return -1;
+    }
+    return 0;
+}
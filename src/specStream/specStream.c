@@ -0,0 +1,304 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include "specStream.h"
+#include "../logging/logging.h"
+#include "../summary/summary.h"
+
+/* Where the base train goes while the input is still being read */
+typedef struct specSpool {
+    FILE               *spool;
+    unsigned char      *ptsBuf;	     // Samples of the current pulse
+    size_t              ptsBufSize;	     // Bytes
+    int                 sampleFormat;
+    unsigned int        width;	     // Bytes per sample
+    uint64_t            basePoints;	     // Samples spooled so far
+    unsigned int        pulseCount;
+    double              lastFlip;	     // Sign the next pulse starts with, as in planWaveform()
+    double              pointInterval;
+    summaryStream_type *summary;
+    double             *window;	     // Envelope table, reused while pulses keep its shape
+    int                 windowEnvelope;
+    uint64_t            windowPts;
+    outputDigest_type   specDigest;	     // Of every pulse spooled so far
+} specSpool_type;
+
+/* Makes state->window the table for a pulse of numPts samples, keeping it if it already is. */
+static int spoolWindow(
+    specSpool_type * state,
+    int envelope,
+    uint64_t numPts
+) {
+    double             *newWindow = NULL;
+
+    if ((NULL != state->window) && (envelope == state->windowEnvelope)
+	&& (numPts == state->windowPts))
+	return 0;
+    if (numPts < SIZE_MAX / sizeof (double))
+	newWindow = realloc(state->window, sizeof (double) * (numPts + 1));
+    if (NULL == newWindow) {
+	perror("spoolWindow allocation");
+	return -1;
+    }
+    state->window = newWindow;
+    state->windowEnvelope = envelope;
+    state->windowPts = numPts;
+    fillEnvelope(envelope, numPts, state->window);
+    return 0;
+}
+
+/* Generates one pulse onto the end of the spool. */
+static int spoolPulse(
+    specSpool_type * state,
+    double freq,
+    double stopFreq,
+    double amp,
+    double dur,
+    int envelope
+) {
+    const uint64_t      numPts =
+	pointsToHalfCycle(dur, state->pointInterval, 0.5 * (freq + stopFreq));
+    const size_t        numBytes = ((size_t) numPts) * state->width;
+
+    // One pulse is held in memory at a time, and the train has to stay countable
+    if ((numPts > MAX_FINAL_POINTS - state->basePoints) || (numPts > SIZE_MAX / state->width)) {
+	logMessage(LOG_ERROR, "The waveform is too long to count, at pulse %u.\n",
+		   state->pulseCount);
+	return -1;
+    }
+    if (numBytes > state->ptsBufSize) {
+	unsigned char      *newBuf = realloc(state->ptsBuf, numBytes);
+
+	if (NULL == newBuf) {
+	    perror("spoolPulse allocation");
+	    return -1;
+	}
+	state->ptsBuf = newBuf;
+	state->ptsBufSize = numBytes;
+    }
+
+    if ((ENVELOPE_RECT != envelope) && spoolWindow(state, envelope, numPts))
+	return -1;
+    genPulsePts(freq, stopFreq, dur, amp * state->lastFlip,
+		(ENVELOPE_RECT == envelope) ? NULL : state->window, numPts, state->pointInterval,
+		state->sampleFormat, state->ptsBuf);
+    if (0 != numPts) {
+	double              lastVal = 0.0;
+
+	decodeSamples(state->sampleFormat, state->ptsBuf + numBytes - state->width, 1, &lastVal);
+	state->lastFlip = (lastVal < 0.0) ? 1.0 : -1.0;
+	if (fwrite(state->ptsBuf, 1, numBytes, state->spool) != numBytes)
+	    return -1;
+    }
+    appendSummaryPulse(state->summary, freq, stopFreq, amp, numPts, envelope);
+    digestPulse(&state->specDigest, freq, stopFreq, dur, amp, envelope);
+    state->basePoints += numPts;
+    state->pulseCount++;
+    return 0;
+}
+
+/* Parses and generates every line of inFile, the same way readSpecFile() parses them. */
+static int spoolSpecLines(
+    specSpool_type * state,
+    FILE * inFile
+) {
+    char               *lineBuf = NULL;
+    size_t              lineBufSize = 0;
+    unsigned long       lineNum = 0;
+    freqList_ptr        lineList = NULL;
+    logLimit_type       echoLimit = LOG_LIMIT_INIT_VAL;
+    logLimit_type       errorLimit = LOG_LIMIT_INIT_VAL;
+    int                 retVal = 0;
+
+    // Holds just the pulse from the current line
+    lineList = blankFreqList();
+    if ((NULL == lineList) || resizeFreqList(DEFAULT_FREQ_LIST_SIZE, &lineList)) {
+	// resizeFreqList() leaves lineList NULL if it freed it, and freeFreqList() takes NULL
+	freeFreqList(lineList);
+	return -1;
+    }
+
+    while (!retVal && (myGetLine(&lineBuf, &lineBufSize, inFile) >= 1)) {
+	int                 parseResult;
+
+	lineNum++;
+	lineList->freqCount = 0;
+	parseResult = parseLine(lineBuf, lineList, &echoLimit);
+	if (GEN_BINARY_ERESIZE == parseResult) {
+	    retVal = -1;
+	} else if (GEN_BINARY_EPARSE == parseResult) {
+	    logLimited(&errorLimit, LOG_WARN,
+		       "Error parsing file at line %lu, ignoring line:\n  > %s\n", lineNum,
+		       lineBuf);
+	} else if (1 == lineList->freqCount) {
+	    retVal = spoolPulse(state, *lineList->freqList, *lineList->stopList,
+				*lineList->ampList, *lineList->durList, *lineList->envList);
+	}
+    }
+    if (NULL != lineBuf)
+	free(lineBuf);
+    freeFreqList(lineList);
+    if (retVal)
+	return -1;
+
+    logLimitEnd(&echoLimit, LOG_INFO, "teeth");
+    logLimitEnd(&errorLimit, LOG_WARN, "lines that could not be parsed");
+    logMessage(LOG_INFO, "Processed %lu lines, found %d frequencies.\n", lineNum,
+	       state->pulseCount);
+    if (0 == state->pulseCount) {
+	logMessage(LOG_ERROR, "However, we need at least one entry.\n");
+	return -1;
+    }
+    if (ferror(inFile) && !feof(inFile)) {
+	logMessage(LOG_ERROR, "However, an file read error occurred at line %lu.\n", lineNum);
+	return -1;
+    }
+    return 0;
+}
+
+/* Copies the whole spool to outFile, mirrored about the zero level if inverted is set. */
+static int copySpool(
+    FILE * spool,
+    FILE * outFile,
+    int sampleFormat,
+    int inverted,
+    unsigned char *copyBuf,
+    outputDigest_type * digest
+) {
+    const size_t        width = sampleFormatInfo(sampleFormat)->width;
+    size_t              got = 0;
+
+    // The chunk is a whole number of samples, so none is split between reads
+    rewind(spool);
+    while ((got = fread(copyBuf, 1, SPEC_STREAM_COPY_CHUNK, spool)) > 0) {
+	if (inverted)
+	    invertSamples(sampleFormat, copyBuf, got / width, copyBuf);
+	digestBytes(digest, copyBuf, got);
+	if (fwrite(copyBuf, 1, got, outFile) != got)
+	    return -1;
+    }
+    return ferror(spool) ? -1 : 0;
+}
+
+/* Writes the points file from the finished spool, with the same duplication as genPointList(). */
+static int writeSpooledPoints(
+    const char *rootName,
+    specSpool_type * state,
+    const double clockFreq,
+    int compressKind,
+    int compressLevel,
+    outputManifest_type * manifest
+) {
+    const int           flipCopy = (state->lastFlip < 0.0);
+    uint64_t           *finalCount = &manifest->finalCount;
+    outputDigest_type  *digest = &manifest->output;
+    uint64_t            rep = 0;
+    int                 numShifts = 0;
+    compressStream_type *output = NULL;
+    FILE               *pointsFile = NULL;
+    char               *fileName = NULL;
+    const char          fileNameSuf[] = "_points";
+    char                textBuf[128];
+    unsigned char      *copyBuf = NULL;
+    int                 retVal = 0;
+
+    if (finalWaveLength(state->basePoints, flipCopy, &numShifts, finalCount)) {
+	logMessage(LOG_ERROR, "The waveform is too long to count once repeated.\n");
+	return -1;
+    }
+    logMessage(LOG_INFO, "Final point count %" PRIu64 "\n", *finalCount);
+
+    copyBuf = malloc(SPEC_STREAM_COPY_CHUNK);
+    fileName = malloc(strlen(rootName) + strlen(fileNameSuf) + 1);
+    if ((NULL == copyBuf) || (NULL == fileName)) {
+	if (NULL != copyBuf)
+	    free(copyBuf);
+	if (NULL != fileName)
+	    free(fileName);
+	return -1;
+    }
+    strcpy(fileName, rootName);
+    strcat(fileName, fileNameSuf);
+    output = openCompressedOutput(fileName, compressKind, compressLevel);
+    free(fileName);
+    if (NULL == output) {
+	free(copyBuf);
+	return -1;
+    }
+    pointsFile = compressStreamFile(output);
+
+    if (formatPointsHeader(textBuf, sizeof (textBuf), *finalCount, state->sampleFormat) < 0) {
+	retVal = -1;
+    } else {
+	digestBytes(digest, textBuf, strlen(textBuf));
+	fprintf(pointsFile, "%s", textBuf);
+    }
+    for (rep = 0; !retVal && (rep < (((uint64_t) 1) << numShifts)); rep++) {
+	retVal = copySpool(state->spool, pointsFile, state->sampleFormat, 0, copyBuf, digest);
+	if (!retVal && flipCopy)
+	    retVal = copySpool(state->spool, pointsFile, state->sampleFormat, 1, copyBuf, digest);
+    }
+    if (!retVal && (formatPointsTrailer(textBuf, sizeof (textBuf), clockFreq) >= 0)) {
+	digestBytes(digest, textBuf, strlen(textBuf));
+	fprintf(pointsFile, "%s", textBuf);
+    } else {
+	retVal = -1;
+    }
+
+    if (ferror(pointsFile))
+	retVal = -1;
+    if (closeCompressStream(output))
+	retVal = -1;
+    free(copyBuf);
+    return retVal;
+}
+
+int streamSpecFile(
+    FILE * inFile,
+    const char *rootName,
+    const double clockFreq,
+    int sampleFormat,
+    int compressKind,
+    int compressLevel,
+    outputManifest_type * manifest
+) {
+    specSpool_type      state;
+    int                 retVal = 0;
+
+    memset(&state, 0, sizeof (specSpool_type));
+    state.lastFlip = 1.0;
+    state.sampleFormat = sampleFormat;
+    state.width = sampleFormatInfo(sampleFormat)->width;
+    state.pointInterval = 1000.0 / clockFreq;
+
+    state.spool = tmpfile();
+    if (NULL == state.spool) {
+	perror("Opening spool file");
+	return -1;
+    }
+    state.summary = openSummaryStream(rootName, clockFreq);
+    if (NULL == state.summary) {
+	fclose(state.spool);
+	return -1;
+    }
+
+    retVal = spoolSpecLines(&state, inFile);
+    if (!retVal && fflush(state.spool))
+	retVal = -1;
+    if (!retVal)
+	retVal = writeSpooledPoints(rootName, &state, clockFreq, compressKind, compressLevel,
+				    manifest);
+    manifest->pulseCount = state.pulseCount;
+    manifest->spec = state.specDigest;
+
+    if (closeSummaryStream(state.summary, NULL))
+	retVal = -1;
+    fclose(state.spool);
+    if (NULL != state.ptsBuf)
+	free(state.ptsBuf);
+    if (NULL != state.window)
+	free(state.window);
+    return retVal;
+}
@@ -0,0 +1,50 @@
+
+/*! @file specStream.h
+ * @brief Generates the waveform while the pulse specification is still arriving.
+ *
+ * readSpecFile() needs the whole specification before anything can be generated.
+ * When it comes down a pipe instead, each pulse is parsed, sized with pointsToHalfCycle()
+ * and generated with genWavePts() as its line arrives, and the samples are appended to a
+ * temporary spool file.  Only one pulse is held in memory at a time.
+ *
+ * The points file starts with the total length, which is only known once the input ends,
+ * so the spool is copied out (with the inverted copy and repetitions) at that point.
+ */
+
+#ifndef SPECSTREAM_H
+#define SPECSTREAM_H
+
+#include <stdio.h>
+#include "../genBinary/genBinary.h"
+#include "../summary/summary.h"
+
+#define SPEC_STREAM_COPY_CHUNK (1 << 16)	//!< Bytes copied from the spool to the points file at a time.
+
+/*!	@brief Reads a pulse train specification from inFile, generating as it goes.
+ *
+ * The input format is the same as for readSpecFile().  Writes the same "\<rootName\>_points"
+ * and "\<rootName\>_desc.txt" files that reading the whole specification first would.
+ *
+ * @param[in] inFile An open stream with the specification, e.g. stdin.
+ * @param[in] rootName The base of the filenames we're saving to.
+ * @param[in] clockFreq The output sample frequency, in MHz.
+ * @param[in] sampleFormat How samples are stored, one of the @ref SampleFormats values.
+ * @param[in] compressKind How to compress the points file, one of the @ref CompressKinds.
+ * @param[in] compressLevel Compression level, or #COMPRESS_LEVEL_DEFAULT.
+ * @param[inout] manifest Gets the total number of points in the final waveform, the number
+ * of pulses, and the digests of the pulse list and of the points file's bytes.  The rest is
+ * left for the caller.
+ * @return 0 on success
+ * @return -1 on failure, including a specification without any pulses.
+ */
+int                 streamSpecFile(
+    FILE * inFile,
+    const char *rootName,
+    const double clockFreq,
+    int sampleFormat,
+    int compressKind,
+    int compressLevel,
+    outputManifest_type * manifest
+);
+
+#endif
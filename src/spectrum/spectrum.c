@@ -0,0 +1,301 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "spectrum.h"
+#include "../fft/fft.h"
+#include "../platform/platform.h"
+#include "../logging/logging.h"
+
+/* What the workers share.  Fields before lock are read-only once they start. */
+typedef struct spectrumState {
+    freqList_ptr        freqList;
+    const wavePlan_type *plan;
+    const unsigned char *baseVals;
+    double              clockFreq;
+    fftTwiddles_type    tw;	     // For SPECTRUM_MAX_FFT, shorter FFTs stride through it
+    double             *measFreq;	     // Per pulse results, written by whichever worker checks it
+    double             *measAmp;
+
+    pthread_mutex_t     lock;
+    unsigned int        nextTooth;	     // Next pulse for a worker to claim
+    int                 failed;
+} spectrumState_type;
+
+/* Number of samples of a pulse that get checked, 0 if it is too short, or a chirp, which has
+ * no one frequency to find. */
+static uint64_t checkedLength(
+    const freqList_type * freqList,
+    const wavePlan_type * plan,
+    unsigned int tooth
+) {
+    uint64_t            len = *(plan->toothStart + tooth + 1) - *(plan->toothStart + tooth);
+
+    if ((len < 4) || (pulseStopFreq(freqList, tooth) != pulseFreq(freqList, tooth)))
+	return 0;
+    if (len > SPECTRUM_MAX_FFT / SPECTRUM_PAD_FACTOR)
+	len = SPECTRUM_MAX_FFT / SPECTRUM_PAD_FACTOR;
+    return len;
+}
+
+/* FFT size used for a pulse of len checked samples. */
+static unsigned int fftLength(
+    uint64_t len
+) {
+    unsigned int        n = 2;
+
+    while (n < len * SPECTRUM_PAD_FACTOR)
+	n <<= 1;
+    return n;
+}
+
+/* Measures one pulse.  re and im have room for SPECTRUM_MAX_FFT values, bytes for the
+ * pulse's checked samples. */
+static int checkTooth(
+    spectrumState_type * state,
+    unsigned int tooth,
+    double *re,
+    double *im,
+    unsigned char *bytes
+) {
+    const wavePlan_type *plan = state->plan;
+    const uint64_t      start = *(plan->toothStart + tooth);
+    const uint64_t      len = checkedLength(state->freqList, plan, tooth);
+    const unsigned char *samples = NULL;
+    unsigned int        n = 0;
+    unsigned int        k = 0;
+    unsigned int        peak = 1;
+    double              peakPower = -1.0;
+    double              windowSum = 0.0;
+    double              envelopeSum = 0.0;
+    const double       *envelope = toothEnvelope(plan, tooth);
+    double              la, lb, lc, offset = 0.0;
+    uint64_t            j = 0;
+
+    if (0 == len) {
+	*(state->measFreq + tooth) = NAN;
+	*(state->measAmp + tooth) = NAN;
+	return 0;
+    }
+    if (NULL != state->baseVals) {
+	samples = state->baseVals + start * sampleFormatInfo(plan->sampleFormat)->width;
+    } else {
+	if (genPointRange(state->freqList, plan, start, len, bytes))
+	    return -1;
+	samples = bytes;
+    }
+
+    // Hann window over the samples relative to full scale, then zero padding
+    n = fftLength(len);
+    decodeSamples(plan->sampleFormat, samples, len, re);
+    for (j = 0; j < len; j++) {
+	double              w = 0.5 - 0.5 * cos(TWO_PI * ((double) j) / ((double) (len - 1)));
+
+	re[j] *= w;
+	im[j] = 0.0;
+	windowSum += w;
+	envelopeSum += (NULL == envelope) ? w : w * envelope[j];
+    }
+    memset(re + len, 0, sizeof (double) * (n - len));
+    memset(im + len, 0, sizeof (double) * (n - len));
+    fftRadix2(re, im, 1, n, &state->tw, 0);
+
+    // Largest positive frequency bin, skipping DC
+    for (k = 1; k < n / 2; k++) {
+	double              power = re[k] * re[k] + im[k] * im[k];
+
+	if (power > peakPower) {
+	    peakPower = power;
+	    peak = k;
+	}
+    }
+
+    // Parabola through the log magnitudes either side places the peak between bins
+    la = 0.5 * log(re[peak - 1] * re[peak - 1] + im[peak - 1] * im[peak - 1] + 1.0e-300);
+    lb = 0.5 * log(peakPower + 1.0e-300);
+    lc = 0.5 * log(re[peak + 1] * re[peak + 1] + im[peak + 1] * im[peak + 1] + 1.0e-300);
+    if ((la - 2.0 * lb + lc) < 0.0)
+	offset = 0.5 * (la - lc) / (la - 2.0 * lb + lc);
+
+    *(state->measFreq + tooth) = (((double) peak) + offset) * state->clockFreq / ((double) n);
+    // A shaped pulse is reported by its peak amplitude, undoing the envelope's average gain
+    *(state->measAmp + tooth) =
+	2.0 * exp(lb - 0.25 * (la - lc) * offset) / windowSum;
+    if (envelopeSum > 0.0)
+	*(state->measAmp + tooth) *= windowSum / envelopeSum;
+    return 0;
+}
+
+static void        *spectrumWorker(
+    void *arg
+) {
+    spectrumState_type *state = arg;
+    const unsigned int  toothCount = state->plan->toothCount;
+    double             *re = malloc(sizeof (double) * SPECTRUM_MAX_FFT);
+    double             *im = malloc(sizeof (double) * SPECTRUM_MAX_FFT);
+    unsigned char      *bytes =
+	malloc((SPECTRUM_MAX_FFT / SPECTRUM_PAD_FACTOR) * sampleFormatInfo(state->plan->sampleFormat)->width);
+    int                 failed = ((NULL == re) || (NULL == im) || (NULL == bytes));
+
+    while (!failed) {
+	unsigned int        first = 0;
+	unsigned int        last = 0;
+	unsigned int        tooth = 0;
+
+	pthread_mutex_lock(&state->lock);
+	first = state->nextTooth;
+	last = (toothCount - first > SPECTRUM_BATCH) ? first + SPECTRUM_BATCH : toothCount;
+	state->nextTooth = last;
+	failed = state->failed;
+	pthread_mutex_unlock(&state->lock);
+	if (first >= last)
+	    break;
+
+	for (tooth = first; (tooth < last) && !failed; tooth++)
+	    failed = checkTooth(state, tooth, re, im, bytes);
+    }
+
+    if (failed) {
+	pthread_mutex_lock(&state->lock);
+	state->failed = 1;
+	pthread_mutex_unlock(&state->lock);
+    }
+    if (NULL != re)
+	free(re);
+    if (NULL != im)
+	free(im);
+    if (NULL != bytes)
+	free(bytes);
+    return NULL;
+}
+
+/* One line per pulse, and the overall figures into report. */
+static int writeSpectrumCsv(
+    const char *rootName,
+    const spectrumState_type * state,
+    spectrumReport_type * report
+) {
+    FILE               *csvFile = NULL;
+    char               *fileName = NULL;
+    const char          fileNameSuf[] = "_spectrum.csv";
+    double              sumSqFreq = 0.0;
+    double              sumSqAmp = 0.0;
+    unsigned int        i = 0;
+
+    fileName = malloc(strlen(rootName) + strlen(fileNameSuf) + 1);
+    if (NULL == fileName)
+	return -1;
+    strcpy(fileName, rootName);
+    strcat(fileName, fileNameSuf);
+    csvFile = fopen(fileName, "w");
+    free(fileName);
+    if (NULL == csvFile)
+	return -1;
+
+    fprintf(csvFile, "index,expected_mhz,measured_mhz,freq_error_mhz,expected_amp,"
+	    "measured_amp,amp_error,bin_mhz\n");
+    for (i = 0; i < state->plan->toothCount; i++) {
+	const double        freq = pulseFreq(state->freqList, i);
+	const double        amp = pulseAmp(state->freqList, i);
+	const uint64_t      len = checkedLength(state->freqList, state->plan, i);
+	double              freqError = 0.0;
+	double              ampError = 0.0;
+
+	if (0 == len) {
+	    fprintf(csvFile, "%u,%.9g,,,%.9g,,,\n", i, freq, amp);
+	    continue;
+	}
+	freqError = *(state->measFreq + i) - freq;
+	ampError = *(state->measAmp + i) - amp;
+	fprintf(csvFile, "%u,%.9g,%.9g,%.3g,%.9g,%.9g,%.3g,%.6g\n", i, freq,
+		*(state->measFreq + i), freqError, amp, *(state->measAmp + i), ampError,
+		state->clockFreq / ((double) fftLength(len)));
+
+	sumSqFreq += freqError * freqError;
+	sumSqAmp += ampError * ampError;
+	if (fabs(freqError) > report->maxFreqError) {
+	    report->maxFreqError = fabs(freqError);
+	    report->maxFreqTooth = i;
+	}
+	if (fabs(ampError) > report->maxAmpError) {
+	    report->maxAmpError = fabs(ampError);
+	    report->maxAmpTooth = i;
+	}
+	report->checkedTeeth++;
+    }
+    if (report->checkedTeeth > 0) {
+	report->rmsFreqError = sqrt(sumSqFreq / report->checkedTeeth);
+	report->rmsAmpError = sqrt(sumSqAmp / report->checkedTeeth);
+    }
+
+    if (ferror(csvFile)) {
+	fclose(csvFile);
+	return -1;
+    }
+    return fclose(csvFile) ? -1 : 0;
+}
+
+int verifySpectrum(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const unsigned char *baseVals,
+    const double clockFreq,
+    unsigned int threads,
+    spectrumReport_type * report
+) {
+    spectrumState_type  state;
+    const double        startTime = monotonicSeconds();
+    int                 retVal = 0;
+
+    memset(report, 0, sizeof (spectrumReport_type));
+    memset(&state, 0, sizeof (spectrumState_type));
+    state.freqList = freqList;
+    state.plan = plan;
+    state.baseVals = baseVals;
+    state.clockFreq = clockFreq;
+
+    if (0 == threads)
+	threads = onlineProcessors();
+    if (threads > SPECTRUM_MAX_THREADS)
+	threads = SPECTRUM_MAX_THREADS;
+    if (threads > plan->toothCount / SPECTRUM_BATCH + 1)
+	threads = plan->toothCount / SPECTRUM_BATCH + 1;
+
+    state.measFreq = malloc(sizeof (double) * (((size_t) plan->toothCount) + 1));
+    state.measAmp = malloc(sizeof (double) * (((size_t) plan->toothCount) + 1));
+    if (initFftTwiddles(SPECTRUM_MAX_FFT, &state.tw) || (NULL == state.measFreq)
+	|| (NULL == state.measAmp)) {
+	perror("verifySpectrum allocation");
+	retVal = -1;
+    } else {
+	pthread_mutex_init(&state.lock, NULL);
+	runWorkers(spectrumWorker, &state, threads);
+	retVal = state.failed ? -1 : 0;
+	pthread_mutex_destroy(&state.lock);
+	if (!retVal)
+	    retVal = writeSpectrumCsv(rootName, &state, report);
+    }
+
+    freeFftTwiddles(&state.tw);
+    if (NULL != state.measFreq)
+	free(state.measFreq);
+    if (NULL != state.measAmp)
+	free(state.measAmp);
+    report->seconds = monotonicSeconds() - startTime;
+    return retVal;
+}
+
+void printSpectrumReport(
+    const spectrumReport_type * report
+) {
+    logMessage(LOG_INFO, "Spectrum check: %u teeth in %.3f s\n", report->checkedTeeth,
+	       report->seconds);
+    logMessage(LOG_INFO, "\tfrequency error: max %.3g MHz (tooth %u), rms %.3g MHz\n",
+	       report->maxFreqError, report->maxFreqTooth, report->rmsFreqError);
+    logMessage(LOG_INFO, "\tamplitude error: max %.3g (tooth %u), rms %.3g\n",
+	       report->maxAmpError, report->maxAmpTooth, report->rmsAmpError);
+    return;
+}
@@ -0,0 +1,76 @@
+
+/*! @file spectrum.h
+ * @brief Checks the spectral content of the generated waveform against the pulse train.
+ *
+ * Each pulse of the base train is windowed (Hann), zero padded, and run through a radix-2
+ * FFT.  The largest peak is located to a fraction of a bin by fitting a parabola to the
+ * log magnitudes around it, giving the measured frequency and amplitude of that pulse.
+ * The amplitude of a shaped pulse is corrected for the average gain of its envelope.
+ *
+ * Pulses are handed out to worker threads in batches.  Each worker holds one FFT-sized
+ * scratch buffer, so memory use does not depend on the length of the waveform.
+ */
+
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include "../genBinary/genBinary.h"
+
+#define SPECTRUM_MAX_FFT (1u << 16)	//!< Largest FFT used.  Longer pulses are checked on their first SPECTRUM_MAX_FFT / SPECTRUM_PAD_FACTOR samples.
+#define SPECTRUM_PAD_FACTOR 4	//!< Each pulse is zero padded to at least this many times its length, for finer bins.
+#define SPECTRUM_BATCH 64	//!< Pulses claimed by a worker thread at a time.
+#define SPECTRUM_MAX_THREADS 64	//!< Upper limit on worker threads.
+
+/*! @brief Summary of a verifySpectrum() run.
+ *
+ * Errors are measured minus expected.  Pulses with fewer than 4 samples, and chirps, are not
+ * checked.
+ */
+typedef struct spectrumReport {
+    unsigned int        checkedTeeth;	//!< Number of pulses checked.
+    double              maxFreqError;	//!< Largest frequency error magnitude, in MHz.
+    unsigned int        maxFreqTooth;	//!< Index of the pulse with the largest frequency error.
+    double              rmsFreqError;	//!< RMS frequency error, in MHz.
+    double              maxAmpError;	//!< Largest relative amplitude error magnitude.
+    unsigned int        maxAmpTooth;	//!< Index of the pulse with the largest amplitude error.
+    double              rmsAmpError;	//!< RMS relative amplitude error.
+    double              seconds;	//!< Time taken.
+} spectrumReport_type;
+
+/*!	@brief Measures the frequency and amplitude of every pulse and compares them to the spec.
+ *
+ * Writes one line per pulse to "\<rootName\>_spectrum.csv", with the expected and measured
+ * frequency (MHz) and amplitude, and the FFT bin width used for that pulse.
+ *
+ * Samples come from baseVals if given, otherwise each pulse is generated on its own with
+ * genPointRange() into the worker's scratch buffer.
+ *
+ * @param[in] rootName The base of the filename we're saving to.
+ * @param[in] freqList A pointer to the the freqList describing the pulse train.
+ * @param[in] plan The plan from planWaveform() for the same freqList.
+ * @param[in] baseVals The first plan->basePoints samples of the final waveform, in plan->sampleFormat, or NULL.
+ * @param[in] clockFreq The output sample frequency, in MHz.
+ * @param[in] threads Number of worker threads, or 0 for one per online processor.
+ * @param[out] report Filled with the overall results.
+ * @return 0 on success
+ * @return -1 on failure
+ */
+int                 verifySpectrum(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const wavePlan_type * plan,
+    const unsigned char *baseVals,
+    const double clockFreq,
+    unsigned int threads,
+    spectrumReport_type * report
+);
+
+/*!	@brief Prints the contents of a #spectrumReport as informational messages.
+ *
+ * @param[in] report The results to print.
+ */
+void                printSpectrumReport(
+    const spectrumReport_type * report
+);
+
+#endif
@@ -0,0 +1,826 @@
+#include "../../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <sys/types.h>
+#include "summary.h"
+#include "../defOptions/defOptions.h"
+
+#define SUMMARY_LINE_MAX (4 * SUMMARY_NUM_LEN + 128)	// Longest line written: 4 numbers plus text
+
+/* Output buffer shared by the summary writers */
+typedef struct summaryBuf {
+    FILE               *outFile;
+    char               *text;
+    size_t              used;
+    int                 failed;
+} summaryBuf_type;
+
+int formatUnsigned(
+    uint64_t value,
+    char *buf
+) {
+    char                digits[24];
+    int                 numLen = 0;
+    int                 i = 0;
+
+    do {
+	digits[numLen++] = (char) ('0' + (value % 10));
+	value /= 10;
+    } while (0 != value);
+
+    for (i = 0; i < numLen; i++)
+	buf[i] = digits[numLen - 1 - i];
+    return numLen;
+}
+
+int formatFixed6(
+    double value,
+    char *buf
+) {
+    double              absVal = fabs(value);
+    double              scaled = 0.0;
+    double              scaledErr = 0.0;
+    double              whole = 0.0;
+    double              frac = 0.0;
+    uint64_t            rounded = 0;
+    uint64_t            fracDigits = 0;
+    int                 textLen = 0;
+    int                 i = 0;
+
+    // 4e9 keeps the scaled value well inside the exactly representable integers
+    if (!isfinite(value) || (absVal >= 4.0e9))
+	return snprintf(buf, SUMMARY_NUM_LEN, "%f", value);
+
+    // scaled + scaledErr is exactly absVal * 1e6, so this rounds the way printf() does
+    scaled = absVal * 1.0e6;
+    scaledErr = fma(absVal, 1.0e6, -scaled);
+    whole = floor(scaled);
+    frac = scaled - whole;
+    rounded = (uint64_t) whole;
+    if ((frac > 0.5) || ((0.5 == frac) && ((scaledErr > 0.0) || ((0.0 == scaledErr)
+								    && (rounded & 1)))))
+	rounded++;
+
+    if (signbit(value))
+	buf[textLen++] = '-';
+    textLen += formatUnsigned(rounded / 1000000, buf + textLen);
+    buf[textLen++] = '.';
+    fracDigits = rounded % 1000000;
+    for (i = 5; i >= 0; i--) {
+	buf[textLen + i] = (char) ('0' + (fracDigits % 10));
+	fracDigits /= 10;
+    }
+    return textLen + 6;
+}
+
+/* Writes digits as a decimal with places digits after the point. */
+static int placeDecimal(
+    uint64_t digitsVal,
+    int places,
+    char *buf
+) {
+    char                digits[24];
+    int                 numLen = formatUnsigned(digitsVal, digits);
+    int                 textLen = 0;
+    int                 i = 0;
+
+    if (0 == places) {
+	memcpy(buf, digits, numLen);
+	return numLen;
+    }
+    if (numLen <= places) {
+	buf[textLen++] = '0';
+	buf[textLen++] = '.';
+	for (i = numLen; i < places; i++)
+	    buf[textLen++] = '0';
+	memcpy(buf + textLen, digits, numLen);
+	return textLen + numLen;
+    }
+    memcpy(buf, digits, numLen - places);
+    textLen = numLen - places;
+    buf[textLen++] = '.';
+    memcpy(buf + textLen, digits + numLen - places, places);
+    return textLen + places;
+}
+
+#ifdef __SIZEOF_INT128__
+/* Exact shortest digits for positive, normal-range values, -1 if out of range.
+ *
+ * Every decimal strictly inside half an ulp of the value (or on the edge, for an even
+ * mantissa) reads back as the value.  Trying 0, 1, 2, ... places after the point, the first
+ * count that fits a decimal in that interval is the shortest, and of those we take the closest.
+ * The interval edges are exact fractions over a power of two, so 128-bit integers suffice. */
+static int shortestExact(
+    double absVal,
+    char *buf
+) {
+    uint64_t            bits = 0;
+    uint64_t            mantissa = 0;
+    int                 binExp = 0;
+    int                 shift = 0;
+    unsigned __int128   lower, upper, middle, pow10 = 1, mask;
+    int                 inclusive = 0;
+    int                 places = 0;
+
+    memcpy(&bits, &absVal, sizeof (bits));
+    if (0 == (bits >> 52))
+	return -1;		     // Subnormal
+    mantissa = (bits & ((1ull << 52) - 1)) | (1ull << 52);
+    binExp = (int) (bits >> 52) - 1075;
+
+    // Value is middle * 2^-shift, with the rounding interval's edges the same way
+    middle = ((unsigned __int128) mantissa) << 2;
+    upper = middle + 2;
+    lower = ((mantissa == (1ull << 52)) && (binExp > -1074)) ? middle - 1 : middle - 2;
+    inclusive = (0 == (mantissa & 1));
+    shift = 2 - binExp;
+    if ((shift <= 0) || (shift > 127))
+	return -1;
+    mask = (((unsigned __int128) 1) << shift) - 1;
+
+    for (places = 0; places <= 21; places++, pow10 *= 10) {
+	unsigned __int128   loScaled = lower * pow10;
+	unsigned __int128   hiScaled = upper * pow10;
+	unsigned __int128   loDigits = (loScaled + mask) >> shift;
+	unsigned __int128   hiDigits = hiScaled >> shift;
+	unsigned __int128   nearest;
+
+	if (!inclusive && (0 == (loScaled & mask)))
+	    loDigits++;
+	if (!inclusive && (0 == (hiScaled & mask)))
+	    hiDigits--;
+	if (loDigits > hiDigits)
+	    continue;
+
+	nearest = ((middle * pow10) + (mask >> 1) + 1) >> shift;
+	if (nearest < loDigits)
+	    nearest = loDigits;
+	if (nearest > hiDigits)
+	    nearest = hiDigits;
+	if (nearest >= (((unsigned __int128) 1) << 64))
+	    return -1;
+	return placeDecimal((uint64_t) nearest, places, buf);
+    }
+    return -1;
+}
+#endif
+
+int formatShortest(
+    double value,
+    char *buf
+) {
+    double              absVal = fabs(value);
+    int                 textLen = 0;
+    int                 precision = 0;
+
+    if (!isfinite(value))
+	return snprintf(buf, SUMMARY_NUM_LEN, "%g", value);
+
+    if (signbit(value))
+	buf[textLen++] = '-';
+    if (0.0 == absVal) {
+	buf[textLen++] = '0';
+	return textLen;
+    }
+#ifdef __SIZEOF_INT128__
+    {
+	int                 exactLen = shortestExact(absVal, buf + textLen);
+
+	if (exactLen > 0)
+	    return textLen + exactLen;
+    }
+#endif
+    // Very large or very small values take the slow road
+    for (precision = 1; precision < 17; precision++) {
+	char                trial[SUMMARY_NUM_LEN];
+
+	snprintf(trial, sizeof (trial), "%.*g", precision, absVal);
+	if (strtod(trial, NULL) == absVal)
+	    break;
+    }
+    return textLen + snprintf(buf + textLen, SUMMARY_NUM_LEN - textLen, "%.*g", precision, absVal);
+}
+
+static int flushSummaryBuf(
+    summaryBuf_type * sumBuf
+) {
+    if (sumBuf->used > 0) {
+	if (fwrite(sumBuf->text, 1, sumBuf->used, sumBuf->outFile) != sumBuf->used)
+	    sumBuf->failed = 1;
+	sumBuf->used = 0;
+    }
+    return sumBuf->failed ? -1 : 0;
+}
+
+/* Makes sure a full line fits, returning where to put it. */
+static char        *reserveLine(
+    summaryBuf_type * sumBuf
+) {
+    if (sumBuf->used + SUMMARY_LINE_MAX > SUMMARY_BUF_SIZE)
+	flushSummaryBuf(sumBuf);
+    return sumBuf->text + sumBuf->used;
+}
+
+static void appendText(
+    char **pos,
+    const char *text,
+    size_t len
+) {
+    memcpy(*pos, text, len);
+    *pos += len;
+    return;
+}
+
+#define APPEND_LITERAL(pos, lit) appendText(&(pos), lit, sizeof (lit) - 1)
+
+/* Opens "<rootName><suffix>" and sets up the buffer for it. */
+static int openSummaryBuf(
+    summaryBuf_type * sumBuf,
+    const char *rootName,
+    const char *fileNameSuf,
+    const char *mode,
+    char **fileNameOut
+) {
+    char               *fileName = NULL;
+
+    sumBuf->outFile = NULL;
+    sumBuf->used = 0;
+    sumBuf->failed = 0;
+    sumBuf->text = malloc(SUMMARY_BUF_SIZE);
+    if (NULL == sumBuf->text)
+	return -1;
+
+    fileName = malloc(strlen(rootName) + strlen(fileNameSuf) + 1);
+    if (NULL == fileName) {
+	free(sumBuf->text);
+	return -1;
+    }
+    strcpy(fileName, rootName);
+    strcat(fileName, fileNameSuf);
+
+    sumBuf->outFile = fopen(fileName, mode);
+    if (NULL == sumBuf->outFile) {
+	free(fileName);
+	free(sumBuf->text);
+	return -1;
+    }
+    if (NULL != fileNameOut)
+	*fileNameOut = fileName;
+    else
+	free(fileName);
+    return 0;
+}
+
+static int closeSummaryBuf(
+    summaryBuf_type * sumBuf
+) {
+    int                 retVal = flushSummaryBuf(sumBuf);
+
+    if (ferror(sumBuf->outFile))
+	retVal = -1;
+    if (fclose(sumBuf->outFile))
+	retVal = -1;
+    free(sumBuf->text);
+    return retVal;
+}
+
+struct summaryStream {
+    summaryBuf_type     sumBuf;
+    double              clockFreq;
+    double              clockPeriod;
+};
+
+summaryStream_type *openSummaryStream(
+    const char *rootName,
+    const double clock_freq
+) {
+    summaryStream_type *stream = malloc(sizeof (summaryStream_type));
+    char               *fileName = NULL;
+
+    if (NULL == stream)
+	return NULL;
+    if (openSummaryBuf(&stream->sumBuf, rootName, "_desc.txt", "w", &fileName)) {
+	free(stream);
+	return NULL;
+    }
+    stream->clockFreq = clock_freq;
+    stream->clockPeriod = 1000.0 / clock_freq;
+
+    fprintf(stream->sumBuf.outFile, "Frequency pattern summary for %s:\n", fileName);
+    free(fileName);
+    return stream;
+}
+
+void appendSummaryPulse(
+    summaryStream_type * stream,
+    double freq,
+    double stopFreq,
+    double amp,
+    uint64_t pointCount,
+    int envelope
+) {
+    char               *pos = reserveLine(&stream->sumBuf);
+    char               *lineStart = pos;
+
+    // Same text as "\t%f amplitude %f[ to %f] MHz for %f ns (%d samples).\n", built up in bulk
+    APPEND_LITERAL(pos, "\t");
+    pos += formatFixed6(amp, pos);
+    APPEND_LITERAL(pos, " amplitude ");
+    pos += formatFixed6(freq, pos);
+    if (stopFreq != freq) {
+	APPEND_LITERAL(pos, " to ");
+	pos += formatFixed6(stopFreq, pos);
+    }
+    APPEND_LITERAL(pos, " MHz for ");
+    pos += formatFixed6(((double) pointCount) * stream->clockPeriod, pos);
+    APPEND_LITERAL(pos, " ns (");
+    pos += formatUnsigned(pointCount, pos);
+    if (ENVELOPE_RECT == envelope) {
+	APPEND_LITERAL(pos, " samples).\n");
+    } else {
+	const char         *name = envelopeName(envelope);
+
+	APPEND_LITERAL(pos, " samples, ");
+	appendText(&pos, name, strlen(name));
+	APPEND_LITERAL(pos, " envelope).\n");
+    }
+    stream->sumBuf.used += (size_t) (pos - lineStart);
+    return;
+}
+
+int closeSummaryStream(
+    summaryStream_type * stream,
+    const freqList_type * freqList
+) {
+    int                 retVal = 0;
+
+    flushSummaryBuf(&stream->sumBuf);
+    fprintf(stream->sumBuf.outFile, "Sample clock @ %f MHz for a period of %f ns.\n",
+	    stream->clockFreq, stream->clockPeriod);
+    if ((NULL != freqList) && freqList->ampSeeded)
+	fprintf(stream->sumBuf.outFile, "Random amplitudes from seed %" PRIu64 ".\n",
+		freqList->ampSeed);
+
+    retVal = closeSummaryBuf(&stream->sumBuf);
+    free(stream);
+    return retVal;
+}
+
+/* Opens "<rootName>_desc.txt" for reading. */
+static FILE        *openSummaryText(
+    const char *rootName
+) {
+    const char          fileNameSuf[] = "_desc.txt";
+    char               *fileName = malloc(strlen(rootName) + strlen(fileNameSuf) + 1);
+    FILE               *inFile = NULL;
+
+    if (NULL == fileName)
+	return NULL;
+    strcpy(fileName, rootName);
+    strcat(fileName, fileNameSuf);
+    inFile = fopen(fileName, "r");
+    if (NULL == inFile)
+	logMessage(LOG_ERROR, "Could not open \"%s\".\n", fileName);
+    free(fileName);
+    return inFile;
+}
+
+/* Adds up the samples of every pulse line of a text summary.  *keepLen is set to the length
+ * of the text before the "Sample clock" line, which must be there and give clock_freq. */
+static int scanSummaryText(
+    FILE * inFile,
+    const double clock_freq,
+    uint64_t *basePoints,
+    long *keepLen
+) {
+    char               *lineBuf = NULL;
+    size_t              lineBufSize = 0;
+    char                wantClock[SUMMARY_NUM_LEN + 1];
+    long                lineStart = 0;
+    int                 foundClock = 0;
+    int                 retVal = 0;
+
+    *basePoints = 0;
+    snprintf(wantClock, sizeof (wantClock), "%f", clock_freq);
+    while (!foundClock && !retVal && (myGetLine(&lineBuf, &lineBufSize, inFile) >= 1)) {
+	const char          clockText[] = "Sample clock @ ";
+	const char         *samples = strstr(lineBuf, " ns (");
+
+	if (0 == strncmp(lineBuf, clockText, sizeof (clockText) - 1)) {
+	    const char         *clockEnd = strchr(lineBuf + sizeof (clockText) - 1, ' ');
+	    size_t              clockLen = (NULL == clockEnd) ? 0 :
+		(size_t) (clockEnd - lineBuf) - (sizeof (clockText) - 1);
+
+	    foundClock = 1;
+	    if ((clockLen != strlen(wantClock))
+		|| strncmp(lineBuf + sizeof (clockText) - 1, wantClock, clockLen)) {
+		logMessage(LOG_ERROR, "The existing waveform uses a different clock, not %s MHz.\n",
+			   wantClock);
+		retVal = -1;
+	    }
+	} else {
+	    if (('\t' == *lineBuf) && (NULL != samples))
+		*basePoints += strtoull(samples + 5, NULL, 10);
+	    lineStart = ftell(inFile);
+	}
+    }
+    if (NULL != lineBuf)
+	free(lineBuf);
+    if (!foundClock && !retVal) {
+	logMessage(LOG_ERROR, "The existing summary is incomplete.\n");
+	retVal = -1;
+    }
+    *keepLen = lineStart;
+    return retVal;
+}
+
+int readSummaryBase(
+    const char *rootName,
+    const double clock_freq,
+    uint64_t *basePoints
+) {
+    FILE               *inFile = openSummaryText(rootName);
+    long                keepLen = 0;
+    int                 retVal = 0;
+
+    if (NULL == inFile)
+	return -1;
+    retVal = scanSummaryText(inFile, clock_freq, basePoints, &keepLen);
+    fclose(inFile);
+    return retVal;
+}
+
+summaryStream_type *reopenSummaryStream(
+    const char *rootName,
+    const double clock_freq
+) {
+    summaryStream_type *stream = NULL;
+    FILE               *inFile = openSummaryText(rootName);
+    uint64_t            basePoints = 0;
+    long                keepLen = 0;
+    char               *keptText = NULL;
+
+    if (NULL == inFile)
+	return NULL;
+    // Everything up to the clock line stays, and the new pulses follow it
+    if (scanSummaryText(inFile, clock_freq, &basePoints, &keepLen) || (keepLen <= 0)) {
+	fclose(inFile);
+	return NULL;
+    }
+    keptText = malloc((size_t) keepLen);
+    stream = malloc(sizeof (summaryStream_type));
+    if ((NULL == keptText) || (NULL == stream) || fseek(inFile, 0, SEEK_SET)
+	|| (fread(keptText, 1, (size_t) keepLen, inFile) != (size_t) keepLen)) {
+	fclose(inFile);
+	if (NULL != keptText)
+	    free(keptText);
+	if (NULL != stream)
+	    free(stream);
+	return NULL;
+    }
+    fclose(inFile);
+
+    if (openSummaryBuf(&stream->sumBuf, rootName, "_desc.txt", "w", NULL)) {
+	free(keptText);
+	free(stream);
+	return NULL;
+    }
+    stream->clockFreq = clock_freq;
+    stream->clockPeriod = 1000.0 / clock_freq;
+    if (fwrite(keptText, 1, (size_t) keepLen, stream->sumBuf.outFile) != (size_t) keepLen)
+	stream->sumBuf.failed = 1;
+    free(keptText);
+    return stream;
+}
+
+int writeSummaryFile(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const uint64_t *pointCounts,
+    const double clock_freq
+) {
+    summaryStream_type *stream = NULL;
+    unsigned int        i;
+
+    stream = openSummaryStream(rootName, clock_freq);
+    if (NULL == stream)
+	return -1;
+    for (i = 0; i < freqList->freqCount; i++)
+	appendSummaryPulse(stream, pulseFreq(freqList, i), pulseStopFreq(freqList, i),
+			   pulseAmp(freqList, i),
+			   *(pointCounts + i), pulseEnvelope(freqList, i));
+    return closeSummaryStream(stream, freqList);
+}
+
+static int writeSummaryCsv(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const uint64_t *pointCounts,
+    const wavePlan_type * plan,
+    const double clock_period,
+    const uint64_t curveOffset
+) {
+    summaryBuf_type     sumBuf;
+    unsigned int        i;
+    char               *pos = NULL;
+    const uint64_t      width = sampleFormatInfo(plan->sampleFormat)->width;
+
+    if (openSummaryBuf(&sumBuf, rootName, "_desc.csv", "w", NULL))
+	return -1;
+
+    pos = reserveLine(&sumBuf);
+    APPEND_LITERAL(pos, "index,frequency_mhz,amplitude,duration_ns,samples,byte_offset,envelope,"
+		   "stop_frequency_mhz\n");
+    sumBuf.used = (size_t) (pos - sumBuf.text);
+
+    for (i = 0; i < freqList->freqCount; i++) {
+	char               *lineStart = reserveLine(&sumBuf);
+	const char         *name = NULL;
+
+	pos = lineStart;
+	pos += formatUnsigned(i, pos);
+	APPEND_LITERAL(pos, ",");
+	pos += formatShortest(pulseFreq(freqList, i), pos);
+	APPEND_LITERAL(pos, ",");
+	pos += formatShortest(pulseAmp(freqList, i), pos);
+	APPEND_LITERAL(pos, ",");
+	pos += formatShortest(((double) (*(pointCounts + i))) * clock_period, pos);
+	APPEND_LITERAL(pos, ",");
+	pos += formatUnsigned(*(pointCounts + i), pos);
+	APPEND_LITERAL(pos, ",");
+	pos += formatUnsigned(curveOffset + *(plan->toothStart + i) * width, pos);
+	APPEND_LITERAL(pos, ",");
+	name = envelopeName(pulseEnvelope(freqList, i));
+	appendText(&pos, name, strlen(name));
+	APPEND_LITERAL(pos, ",");
+	pos += formatShortest(pulseStopFreq(freqList, i), pos);
+	APPEND_LITERAL(pos, "\n");
+	sumBuf.used += (size_t) (pos - lineStart);
+    }
+
+    return closeSummaryBuf(&sumBuf);
+}
+
+static void storeLE32(
+    unsigned char *dest,
+    uint32_t value
+) {
+    int                 i = 0;
+
+    for (i = 0; i < 4; i++)
+	dest[i] = (unsigned char) (value >> (8 * i));
+    return;
+}
+
+static void storeLE64(
+    unsigned char *dest,
+    uint64_t value
+) {
+    int                 i = 0;
+
+    for (i = 0; i < 8; i++)
+	dest[i] = (unsigned char) (value >> (8 * i));
+    return;
+}
+
+static void storeLEDouble(
+    unsigned char *dest,
+    double value
+) {
+    uint64_t            bits;
+
+    memcpy(&bits, &value, sizeof (bits));
+    storeLE64(dest, bits);
+    return;
+}
+
+/* Column ids for writeSummaryBin() */
+#define COLUMN_FREQ	0
+#define COLUMN_AMP	1
+#define COLUMN_DUR	2
+#define COLUMN_SAMPLES	3
+#define COLUMN_OFFSET	4
+#define COLUMN_ENVELOPE	5
+#define COLUMN_STOP	6
+#define COLUMN_COUNT	7
+
+static int writeSummaryBin(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const uint64_t *pointCounts,
+    const wavePlan_type * plan,
+    const double clock_freq,
+    const uint64_t curveOffset
+) {
+    summaryBuf_type     sumBuf;
+    unsigned char      *pos = NULL;
+    unsigned int        i;
+    int                 column = 0;
+    const double        clock_period = 1000.0 / clock_freq;
+    const uint64_t      width = sampleFormatInfo(plan->sampleFormat)->width;
+
+    if (openSummaryBuf(&sumBuf, rootName, "_desc.bin", "wb", NULL))
+	return -1;
+
+    pos = (unsigned char *) reserveLine(&sumBuf);
+    memset(pos, 0, 8);
+    memcpy(pos, SUMMARY_BIN_MAGIC, sizeof (SUMMARY_BIN_MAGIC));
+    storeLE32(pos + 8, SUMMARY_BIN_VERSION);
+    storeLE32(pos + 12, freqList->freqCount);
+    storeLEDouble(pos + 16, clock_freq);
+    storeLE64(pos + 24, plan->finalCount);
+    storeLE64(pos + 32, curveOffset);
+    storeLE64(pos + 40, freqList->ampSeed);
+    storeLE32(pos + 48, freqList->ampSeeded ? SUMMARY_BIN_SEEDED : 0);
+    storeLE32(pos + 52, (uint32_t) plan->sampleFormat);
+    sumBuf.used = 56;
+
+    for (column = 0; column < COLUMN_COUNT; column++) {
+	for (i = 0; i < freqList->freqCount; i++) {
+	    pos = (unsigned char *) reserveLine(&sumBuf);
+	    switch (column) {
+	    case COLUMN_FREQ:
+		storeLEDouble(pos, pulseFreq(freqList, i));
+		sumBuf.used += 8;
+		break;
+	    case COLUMN_AMP:
+		storeLEDouble(pos, pulseAmp(freqList, i));
+		sumBuf.used += 8;
+		break;
+	    case COLUMN_DUR:
+		storeLEDouble(pos, ((double) (*(pointCounts + i))) * clock_period);
+		sumBuf.used += 8;
+		break;
+	    case COLUMN_SAMPLES:
+		storeLE64(pos, *(pointCounts + i));
+		sumBuf.used += 8;
+		break;
+	    case COLUMN_ENVELOPE:
+		*pos = (unsigned char) pulseEnvelope(freqList, i);
+		sumBuf.used += 1;
+		break;
+	    case COLUMN_STOP:
+		storeLEDouble(pos, pulseStopFreq(freqList, i));
+		sumBuf.used += 8;
+		break;
+	    default:
+		storeLE64(pos, curveOffset + *(plan->toothStart + i) * width);
+		sumBuf.used += 8;
+		break;
+	    }
+	}
+    }
+
+    return closeSummaryBuf(&sumBuf);
+}
+
+int writeSummaryTable(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const uint64_t *pointCounts,
+    const wavePlan_type * plan,
+    const double clock_freq,
+    int tableFormat
+) {
+    char                headerBuf[128];
+    int                 curveOffset = 0;
+
+    if (SUMMARY_TABLE_NONE == tableFormat)
+	return 0;
+    if (NULL == plan)
+	return -1;
+
+    // Samples start right after the CURVE command's header
+    curveOffset = formatPointsHeader(headerBuf, sizeof (headerBuf), plan->finalCount,
+				     plan->sampleFormat);
+    if (curveOffset < 0)
+	return -1;
+
+    if (SUMMARY_TABLE_CSV == tableFormat)
+	return writeSummaryCsv(rootName, freqList, pointCounts, plan, 1000.0 / clock_freq,
+			       curveOffset);
+    if (SUMMARY_TABLE_BIN == tableFormat)
+	return writeSummaryBin(rootName, freqList, pointCounts, plan, clock_freq, curveOffset);
+    return -1;
+}
+
+void digestPulse(
+    outputDigest_type * digest,
+    double freq,
+    double stopFreq,
+    double dur,
+    double amp,
+    int envelope
+) {
+    unsigned char       fields[33];
+    size_t              used = 25;
+
+    storeLEDouble(fields, freq);
+    storeLEDouble(fields + 8, dur);
+    storeLEDouble(fields + 16, amp);
+    fields[24] = (unsigned char) envelope;
+    if (stopFreq != freq) {
+	storeLEDouble(fields + 25, stopFreq);
+	used += 8;
+    }
+    digestBytes(digest, fields, used);
+    return;
+}
+
+void digestFreqList(
+    outputDigest_type * digest,
+    const freqList_type * freqList
+) {
+    unsigned int        i;
+
+    for (i = 0; i < freqList->freqCount; i++)
+	digestPulse(digest, pulseFreq(freqList, i), pulseStopFreq(freqList, i),
+		    pulseDur(freqList, i), pulseAmp(freqList, i), pulseEnvelope(freqList, i));
+    return;
+}
+
+int writeManifest(
+    const char *rootName,
+    const outputManifest_type * manifest
+) {
+    summaryBuf_type     sumBuf;
+
+    if (openSummaryBuf(&sumBuf, rootName, "_manifest.txt", "w", NULL))
+	return -1;
+    fprintf(sumBuf.outFile, "# Command bytes as sent, before any compression\n");
+    fprintf(sumBuf.outFile, "%s %s\n", manifest->targetKey, manifest->target);
+    fprintf(sumBuf.outFile, "bytes %" PRIu64 "\n", manifest->output.bytes);
+    fprintf(sumBuf.outFile, "crc32c %08" PRIx32 "\n", manifest->output.crc);
+    fprintf(sumBuf.outFile, "points %" PRIu64 "\n", manifest->finalCount);
+    fprintf(sumBuf.outFile, "sample_format %s\n", sampleFormatInfo(manifest->sampleFormat)->name);
+    fprintf(sumBuf.outFile, "clock_mhz %f\n", manifest->clockFreq);
+    fprintf(sumBuf.outFile, "pulses %u\n", manifest->pulseCount);
+    fprintf(sumBuf.outFile, "spec_crc32c %08" PRIx32 "\n", manifest->spec.crc);
+    return closeSummaryBuf(&sumBuf);
+}
+
+int discardManifest(
+    const char *rootName
+) {
+    const char          fileNameSuf[] = "_manifest.txt";
+    char               *fileName = malloc(strlen(rootName) + strlen(fileNameSuf) + 1);
+    FILE               *oldFile = NULL;
+    int                 retVal = 0;
+
+    if (NULL == fileName)
+	return -1;
+    strcpy(fileName, rootName);
+    strcat(fileName, fileNameSuf);
+    // Only a manifest that is there and can't be removed is a problem
+    oldFile = fopen(fileName, "r");
+    if (NULL != oldFile) {
+	fclose(oldFile);
+	retVal = remove(fileName) ? -1 : 0;
+    }
+    free(fileName);
+    return retVal;
+}
+
+static int runSummaryJob(
+    summaryJob_type * job
+) {
+    if (writeSummaryFile(job->rootName, job->freqList, job->pointCounts, job->clockFreq))
+	return -1;
+    return writeSummaryTable(job->rootName, job->freqList, job->pointCounts, job->plan,
+			     job->clockFreq, job->tableFormat);
+}
+
+static void        *summaryThread(
+    void *arg
+) {
+    summaryJob_type    *job = arg;
+
+    job->result = runSummaryJob(job);
+    return NULL;
+}
+
+void startSummaryJob(
+    summaryJob_type * job
+) {
+    job->threaded = 0;
+    job->result = 0;
+    if (0 == pthread_create(&job->thread, NULL, summaryThread, job)) {
+	job->threaded = 1;
+    } else {
+	// No thread to be had, just do it now
+	job->result = runSummaryJob(job);
+    }
+    return;
+}
+
+int finishSummaryJob(
+    summaryJob_type * job
+) {
+    if (job->threaded) {
+	pthread_join(job->thread, NULL);
+	job->threaded = 0;
+    }
+    return job->result;
+}
@@ -0,0 +1,373 @@
+
+/*! @file summary.h
+ * @brief Writes the descriptions of a generated pulse train that go alongside the points file.
+ *
+ * The human-readable "_desc.txt" is always written.  A machine-readable table, either CSV or
+ * columnar binary, can be written as well, giving every pulse's parameters together with the
+ * byte offset of its first sample in the points file.
+ *
+ * Formatting is done into large buffers with dedicated number formatters rather than one
+ * fprintf() per value, and the whole job can run on its own thread while the waveform is generated.
+ */
+
+#ifndef SUMMARY_H
+#define SUMMARY_H
+
+#include <stddef.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include "../genBinary/genBinary.h"
+#include "../checksum/checksum.h"
+
+/*! @page SummaryTableFormat Machine-readable summary formats
+ *  @brief Layout of the files written with --summary-format
+ *
+ * @section SummaryCsv CSV ("\<rootName\>_desc.csv")
+ * One header line, then one line per pulse:
+ * @code index,frequency_mhz,amplitude,duration_ns,samples,byte_offset,envelope,stop_frequency_mhz @endcode
+ * Floating point values are written with the fewest digits that read back to the identical double.
+ * @c byte_offset is the offset of the pulse's first sample from the start of the points file.
+ * @c envelope is the name from envelopeName().
+ * @c stop_frequency_mhz is the frequency a chirp ends at, and the frequency again for any other
+ * pulse.
+ *
+ * @section SummaryBin Binary ("\<rootName\>_desc.bin")
+ * All values little-endian.  A fixed header, followed by one column after another:
+ * Offset | Type | Content
+ * ------ | ---- | -------
+ * 0 | char[8] | Magic, "AWGSUM1" and a NULL
+ * 8 | uint32 | Format version, currently 5
+ * 12 | uint32 | Number of pulses, N
+ * 16 | double | Sample clock, in MHz
+ * 24 | uint64 | Total points in the final waveform
+ * 32 | uint64 | Byte offset of the first curve sample in the points file
+ * 40 | uint64 | Seed of the random amplitudes, if bit 0 of the flags is set
+ * 48 | uint32 | Flags, see #SUMMARY_BIN_SEEDED
+ * 52 | uint32 | Sample format of the curve, #SAMPLE_FORMAT_U8 or #SAMPLE_FORMAT_U12
+ * 56 | double[N] | Frequency of each pulse, in MHz
+ * 56 + 8N | double[N] | Amplitude of each pulse, relative
+ * 56 + 16N | double[N] | Actual duration of each pulse, in ns
+ * 56 + 24N | uint64[N] | Samples in each pulse
+ * 56 + 32N | uint64[N] | Byte offset of each pulse's first sample in the points file
+ * 56 + 40N | uint8[N] | Envelope of each pulse, see @ref Envelopes
+ * 56 + 41N | double[N] | Frequency each pulse ends at, in MHz, which differs only for a chirp
+ *
+ * @section SummaryManifest Manifest ("\<rootName\>_manifest.txt")
+ * Written by writeManifest() once the command bytes are out, so an uploader can check what it
+ * sends without reading the points file a second time.  A comment line starting with '#',
+ * then one "\<key\> \<value\>" line each of:
+ * Key | Value
+ * --- | -----
+ * file or shm | The points file name, or the shared memory ring "/\<name\>" the bytes went to
+ * bytes | Number of command bytes, before any compression
+ * crc32c | CRC32C of those bytes, as 8 hex digits
+ * points | Total points in the final waveform
+ * sample_format | Name of the sample format, from sampleFormatInfo()
+ * clock_mhz | Sample clock, in MHz
+ * pulses | Number of pulses in the train
+ * spec_crc32c | CRC32C of the pulse list, see digestPulse(), as 8 hex digits
+ *
+ * Appending to a waveform removes its manifest, as the bytes no longer match it.
+ */
+
+/*!
+ * @defgroup SummaryTables Machine-readable summary selection
+ * @brief Values for the machine-readable summary written by writeSummaryTable()
+ * @{
+ */
+#define SUMMARY_TABLE_NONE	0	//!< Only the human-readable summary.
+#define SUMMARY_TABLE_CSV	1	//!< Also write "\<rootName\>_desc.csv".
+#define SUMMARY_TABLE_BIN	2	//!< Also write "\<rootName\>_desc.bin".
+
+/*! @} */
+
+#define SUMMARY_BIN_MAGIC "AWGSUM1"	//!< Magic string at the start of a binary summary.
+#define SUMMARY_BIN_VERSION 5	//!< Version of the binary summary layout.
+#define SUMMARY_BIN_SEEDED (1u << 0)	//!< Binary summary flag: amplitudes are random, from the recorded seed.
+#define SUMMARY_BUF_SIZE (1 << 16)	//!< Bytes of formatted text collected before each write.
+#define SUMMARY_NUM_LEN 320	//!< Buffer size that fits any number from the formatters below, "%f" of -DBL_MAX (317 characters) included.
+
+/*! @brief Everything needed to write the summaries, so they can be written on another thread.
+ *
+ * Clear it with memset() before filling it in, as pthread_t has no portable initializer.
+ * That leaves tableFormat at #SUMMARY_TABLE_NONE.
+ */
+typedef struct summaryJob {
+    const char         *rootName;	//!< The base of the filenames we're saving to.
+    freqList_ptr        freqList;	//!< freqList describing the generated pulse train.
+    const uint64_t     *pointCounts;	//!< Total number of points for each pulse.
+    const wavePlan_type *plan;	//!< Plan of the waveform, for byte offsets.  Only needed for a table.
+    double              clockFreq;	//!< The output sample frequency, in MHz.
+    int                 tableFormat;	//!< One of the @ref SummaryTables values.
+    int                 result;	//!< 0 once written successfully, -1 on failure.
+    int                 threaded;	//!< Non-zero while a thread is working on the job.
+    pthread_t           thread;	//!< Thread working on the job, valid if threaded is set.
+} summaryJob_type;
+
+/*! @brief What writeManifest() records about the bytes sent.
+ *
+ * Expected initialization found in #OUTPUT_MANIFEST_INIT_VAL
+ */
+typedef struct outputManifest {
+    const char         *targetKey;	//!< "file" or "shm".
+    const char         *target;	//!< Where the bytes went.  See @ref SummaryManifest.
+    uint64_t            finalCount;	//!< Total points in the final waveform.
+    int                 sampleFormat;	//!< One of the @ref SampleFormats.
+    double              clockFreq;	//!< The output sample frequency, in MHz.
+    unsigned int        pulseCount;	//!< Number of pulses in the train.
+    outputDigest_type   spec;	//!< Digest of the pulse list, from digestPulse().
+    outputDigest_type   output;	//!< Digest of the command bytes, before compression.
+} outputManifest_type;
+
+#define OUTPUT_MANIFEST_INIT_VAL {"file", NULL, 0, SAMPLE_FORMAT_U8, 0.0, 0, OUTPUT_DIGEST_INIT_VAL, OUTPUT_DIGEST_INIT_VAL}	//!< Initialization data for an #outputManifest instantiation.
+
+/*!	@brief Writes a human-readable text file describing the contents of the generated points file.
+ *
+ * File will be output as "\<rootName\>_desc.txt"
+ * E.g. a rootName of "test" would result in a file "test_desc.txt"
+ *
+ * The file contains the frequency, amplitude, duration, and number of samples for each pulse, in order,
+ * and the envelope of any shaped pulse.
+ * It also lists the output sample frequency (and period) used, and the seed if the
+ * amplitudes are random.
+ *
+ * See writeToFile() for actual contents of points file.
+ *
+ * @param[in] rootName The base of the filename we're saving to.
+ * @param[in] freqList freqList describing the generated pulse train.
+ * @param[in] pointCounts Total number of points for each pulse in the output waveform
+ * @param[in] clock_freq The output sample frequency
+ * @return 0 on success
+ * @return -1 on failure
+ */
+int                 writeSummaryFile(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const uint64_t *pointCounts,
+    const double clock_freq
+);
+
+/*! @brief A text summary written one pulse at a time, see openSummaryStream().
+ *
+ * The contents are private to summary.c.
+ */
+typedef struct summaryStream summaryStream_type;
+
+/*!	@brief Starts a text summary for pulses that are not known in advance.
+ *
+ * Produces the same "\<rootName\>_desc.txt" as writeSummaryFile(), a line at a time as each
+ * pulse is added with appendSummaryPulse().  Finish with closeSummaryStream().
+ *
+ * @param[in] rootName The base of the filename we're saving to.
+ * @param[in] clock_freq The output sample frequency
+ * @return The new stream
+ * @return NULL on failure.
+ */
+summaryStream_type *openSummaryStream(
+    const char *rootName,
+    const double clock_freq
+);
+
+/*!	@brief Adds the line for the next pulse to a text summary.
+ *
+ * A chirp is given as the frequencies it sweeps between.
+ *
+ * @param[inout] stream The stream from openSummaryStream().
+ * @param[in] freq The frequency of the pulse, in MHz.
+ * @param[in] stopFreq The frequency the pulse ends at, in MHz, the same as freq unless it is a
+ * chirp.
+ * @param[in] amp The relative amplitude of the pulse.
+ * @param[in] pointCount Number of samples in the pulse.
+ * @param[in] envelope The pulse's envelope, one of the @ref Envelopes values.
+ */
+void                appendSummaryPulse(
+    summaryStream_type * stream,
+    double freq,
+    double stopFreq,
+    double amp,
+    uint64_t pointCount,
+    int envelope
+);
+
+/*!	@brief Finishes and frees a text summary.
+ *
+ * @param[in] stream The stream from openSummaryStream().
+ * @param[in] freqList If not NULL, its random amplitude seed (if any) is recorded.
+ * @return 0 on success
+ * @return -1 on failure, including any failed write while appending.
+ */
+int                 closeSummaryStream(
+    summaryStream_type * stream,
+    const freqList_type * freqList
+);
+
+/*!	@brief Finds the length of an existing waveform from its text summary.
+ *
+ * Adds up the samples of every pulse listed in "\<rootName\>_desc.txt", which is the
+ * number of samples in the base train at the start of the matching points file.
+ *
+ * @param[in] rootName The base of the filename the waveform was saved to.
+ * @param[in] clock_freq The output sample frequency, which must match the one in the summary.
+ * @param[out] basePoints Total samples of the listed pulses.
+ * @return 0 on success
+ * @return -1 if the file can't be read, is incomplete, or lists another clock.
+ */
+int                 readSummaryBase(
+    const char *rootName,
+    const double clock_freq,
+    uint64_t *basePoints
+);
+
+/*!	@brief Continues an existing text summary, for pulses appended to its waveform.
+ *
+ * The pulse lines already in "\<rootName\>_desc.txt" are kept, and the stream carries on
+ * after them as if they had been added with appendSummaryPulse().  Any random amplitude
+ * seed line is dropped, as it no longer describes the whole train.
+ *
+ * @param[in] rootName The base of the filename the waveform was saved to.
+ * @param[in] clock_freq The output sample frequency, which must match the one in the summary.
+ * @return The stream, to finish with closeSummaryStream()
+ * @return NULL on failure, in which case the file is unchanged.
+ */
+summaryStream_type *reopenSummaryStream(
+    const char *rootName,
+    const double clock_freq
+);
+
+/*!	@brief Writes the machine-readable summary.
+ *
+ * See @ref SummaryTableFormat for the layouts.
+ *
+ * @param[in] rootName The base of the filename we're saving to.
+ * @param[in] freqList freqList describing the generated pulse train.
+ * @param[in] pointCounts Total number of points for each pulse in the output waveform
+ * @param[in] plan The plan from planWaveform() for the same freqList.
+ * @param[in] clock_freq The output sample frequency
+ * @param[in] tableFormat One of the @ref SummaryTables values.
+ * @return 0 on success, including when tableFormat is #SUMMARY_TABLE_NONE
+ * @return -1 on failure
+ */
+int                 writeSummaryTable(
+    const char *rootName,
+    const freqList_ptr freqList,
+    const uint64_t *pointCounts,
+    const wavePlan_type * plan,
+    const double clock_freq,
+    int tableFormat
+);
+
+/*!	@brief Starts writing the summaries described by job on a background thread.
+ *
+ * If no thread can be started the summaries are written before returning.
+ * Either way, finishSummaryJob() must be called to collect the result.
+ * Nothing job points to may change until then.
+ *
+ * @param[inout] job The summaries to write.
+ */
+void                startSummaryJob(
+    summaryJob_type * job
+);
+
+/*!	@brief Waits for a job from startSummaryJob() to finish.
+ *
+ * @param[inout] job The job passed to startSummaryJob().
+ * @return 0 if all summaries were written
+ * @return -1 on failure
+ */
+int                 finishSummaryJob(
+    summaryJob_type * job
+);
+
+/*!	@brief Adds one pulse of the specification to a digest.
+ *
+ * The frequency, duration and amplitude as asked for, each as a little-endian double,
+ * then the envelope as one byte, so the same pulse list gives the same digest however it
+ * was written down.  A chirp adds its stop frequency as one more double, so any other
+ * pulse digests as it always has.
+ *
+ * @param[inout] digest The digest to extend.
+ * @param[in] freq The frequency of the pulse, in MHz.
+ * @param[in] stopFreq The frequency the pulse ends at, in MHz.
+ * @param[in] dur The duration asked for, in ns.
+ * @param[in] amp The relative amplitude of the pulse.
+ * @param[in] envelope The pulse's envelope, one of the @ref Envelopes values.
+ */
+void                digestPulse(
+    outputDigest_type * digest,
+    double freq,
+    double stopFreq,
+    double dur,
+    double amp,
+    int envelope
+);
+
+/*!	@brief Adds every pulse of a train to a digest, with digestPulse().
+ *
+ * @param[inout] digest The digest to extend.
+ * @param[in] freqList The pulse train.
+ */
+void                digestFreqList(
+    outputDigest_type * digest,
+    const freqList_type * freqList
+);
+
+/*!	@brief Writes "\<rootName\>_manifest.txt".
+ *
+ * See @ref SummaryManifest for the contents.
+ *
+ * @param[in] rootName The base of the filename we're saving to.
+ * @param[in] manifest What to record.
+ * @return 0 on success
+ * @return -1 on failure
+ */
+int                 writeManifest(
+    const char *rootName,
+    const outputManifest_type * manifest
+);
+
+/*!	@brief Removes "\<rootName\>_manifest.txt", once it no longer describes the points file.
+ *
+ * @param[in] rootName The base of the filename the waveform was saved to.
+ * @return 0 if there is no manifest any more
+ * @return -1 if it could not be removed.
+ */
+int                 discardManifest(
+    const char *rootName
+);
+
+/*!	@brief Formats a double exactly as printf("%f") would.
+ *
+ * Much faster than printf() for the magnitudes seen in a summary, falling back to it otherwise.
+ *
+ * @param[in] value The number to format.
+ * @param[out] buf Where to put the text, at least #SUMMARY_NUM_LEN bytes.  Not NULL terminated.
+ * @return The number of characters written.
+ */
+int                 formatFixed6(
+    double value,
+    char *buf
+);
+
+/*!	@brief Formats a double with the fewest significant digits that read back as the same value.
+ *
+ * @param[in] value The number to format.
+ * @param[out] buf Where to put the text, at least #SUMMARY_NUM_LEN bytes.  Not NULL terminated.
+ * @return The number of characters written.
+ */
+int                 formatShortest(
+    double value,
+    char *buf
+);
+
+/*!	@brief Formats an unsigned integer in decimal.
+ *
+ * @param[in] value The number to format.
+ * @param[out] buf Where to put the text, at least #SUMMARY_NUM_LEN bytes.  Not NULL terminated.
+ * @return The number of characters written.
+ */
+int                 formatUnsigned(
+    uint64_t value,
+    char *buf
+);
+
+#endif
@@ -0,0 +1,122 @@
+/* CRC32C known values, and the hardware or table path against a bit-at-a-time reference. */
+#include "../config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include "../src/checksum/checksum.h"
+
+#define REF_BUF_LEN 40000	     // Long enough for several passes of the hardware's three lanes
+
+/* One bit at a time, straight from the reflected Castagnoli polynomial. */
+static uint32_t refCrc32c(
+    const unsigned char *bytes,
+    size_t len
+) {
+    uint32_t            crc = 0xFFFFFFFFu;
+    size_t              i = 0;
+    int                 bit = 0;
+
+    for (i = 0; i < len; i++) {
+	crc ^= bytes[i];
+	for (bit = 0; bit < 8; bit++)
+	    crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78u : 0);
+    }
+    return ~crc;
+}
+
+START_TEST(test_check_value)
+{
+    ck_assert_uint_eq(crc32cUpdate(0, "123456789", 9), 0xE3069283u);
+    ck_assert_uint_eq(crc32cUpdate(0, "", 0), 0);
+}
+END_TEST
+
+/* The iSCSI test patterns of RFC 3720, B.4 */
+START_TEST(test_rfc3720)
+{
+    unsigned char       buf[32];
+    int                 i = 0;
+
+    memset(buf, 0x00, sizeof (buf));
+    ck_assert_uint_eq(crc32cUpdate(0, buf, sizeof (buf)), 0x8A9136AAu);
+    memset(buf, 0xFF, sizeof (buf));
+    ck_assert_uint_eq(crc32cUpdate(0, buf, sizeof (buf)), 0x62A8AB43u);
+    for (i = 0; i < 32; i++)
+	buf[i] = (unsigned char) i;
+    ck_assert_uint_eq(crc32cUpdate(0, buf, sizeof (buf)), 0x46DD794Eu);
+    for (i = 0; i < 32; i++)
+	buf[i] = (unsigned char) (31 - i);
+    ck_assert_uint_eq(crc32cUpdate(0, buf, sizeof (buf)), 0x113FDB5Cu);
+}
+END_TEST
+
+START_TEST(test_against_reference)
+{
+    // Either side of the 8-byte words and of one and two passes of 3 lanes of 4096 bytes
+    const size_t        lengths[] = { 0, 1, 7, 8, 9, 63, 64, 65, 1031, 12287, 12288, 12289,
+	24575, 24576, 24583, REF_BUF_LEN
+    };
+    unsigned char      *buf = malloc(REF_BUF_LEN + 8);
+    uint32_t            seed = 12345;
+    size_t              offset = 0;
+    size_t              i = 0;
+
+    ck_assert_ptr_ne(buf, NULL);
+    for (i = 0; i < REF_BUF_LEN + 8; i++) {
+	seed = seed * 1103515245u + 12345u;
+	buf[i] = (unsigned char) (seed >> 16);
+    }
+    // Every start alignment
+    for (offset = 0; offset < 8; offset++) {
+	for (i = 0; i < sizeof (lengths) / sizeof (lengths[0]); i++)
+	    ck_assert_msg(crc32cUpdate(0, buf + offset, lengths[i])
+			  == refCrc32c(buf + offset, lengths[i]),
+			  "%s CRC differs at offset %u, length %u", crc32cMethod(),
+			  (unsigned int) offset, (unsigned int) lengths[i]);
+    }
+    free(buf);
+}
+END_TEST
+
+START_TEST(test_continued)
+{
+    const char          text[] = "The quick brown fox jumps over the lazy dog";
+    const size_t        len = sizeof (text) - 1;
+    const uint32_t      whole = crc32cUpdate(0, text, len);
+    outputDigest_type   digest = OUTPUT_DIGEST_INIT_VAL;
+    size_t              split = 0;
+
+    for (split = 0; split <= len; split++)
+	ck_assert_uint_eq(crc32cUpdate(crc32cUpdate(0, text, split), text + split, len - split),
+			  whole);
+    digestBytes(&digest, text, 10);
+    digestBytes(&digest, text + 10, len - 10);
+    digestBytes(NULL, text, len);
+    ck_assert_uint_eq(digest.crc, whole);
+    ck_assert_uint_eq(digest.bytes, len);
+}
+END_TEST
+
+static Suite       *checksumSuite(
+) {
+    Suite              *suite = suite_create("checksum");
+    TCase              *core = tcase_create("crc32c");
+
+    tcase_add_test(core, test_check_value);
+    tcase_add_test(core, test_rfc3720);
+    tcase_add_test(core, test_against_reference);
+    tcase_add_test(core, test_continued);
+    suite_add_tcase(suite, core);
+    return suite;
+}
+
+int main(
+) {
+    SRunner            *runner = srunner_create(checksumSuite());
+    int                 failed = 0;
+
+    srunner_run_all(runner, CK_NORMAL);
+    failed = srunner_ntests_failed(runner);
+    srunner_free(runner);
+    return (0 == failed) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
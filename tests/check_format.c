@@ -0,0 +1,224 @@
+/* The summary's number formatters against printf() and strtod(). */
+#include "../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <check.h>
+#include "../src/summary/summary.h"
+
+#define RANDOM_VALUES 20000	     // Random doubles tried per formatter
+
+static const double edgeValues[] = {
+    0.0, 1.0, 0.5, 0.1, 0.25, 1.0e-6, 4.9e-7, 5.0e-7, 5.1e-7, 1.5e-6, 2.5e-6, 0.0000015,
+    0.9999995, 0.99999949999, 1.0000005, 123.4567895, 999999.9999995, 1023.999999,
+    3999999999.999999, 4.0e9, 4.0e9 + 0.5, 1.0e15, 1.0e35, DBL_MAX, DBL_MIN, 5.0e-324,
+    1.0e-320, 2.2250738585072009e-308, 9007199254740993.0, 0.30000000000000004
+};
+
+/* The formatter's text as a C string. */
+static void formatText(
+    int (*format) (double, char *),
+    double value,
+    char *text
+) {
+    int                 len = format(value, text);
+
+    ck_assert_int_gt(len, 0);
+    ck_assert_int_lt(len, SUMMARY_NUM_LEN);
+    text[len] = '\0';
+    return;
+}
+
+static void checkFixed6(
+    double value
+) {
+    char                text[SUMMARY_NUM_LEN + 1];
+    char                expected[SUMMARY_NUM_LEN + 1];
+
+    formatText(formatFixed6, value, text);
+    snprintf(expected, sizeof (expected), "%f", value);
+    ck_assert_msg(0 == strcmp(text, expected), "formatFixed6(%.17g) gave \"%s\", not \"%s\"",
+		  value, text, expected);
+    return;
+}
+
+/* Significant digits in a decimal or %g string, leading and trailing zeros not counted. */
+static int significantDigits(
+    const char *text
+) {
+    const char         *end = text + strcspn(text, "eE");
+    int                 first = -1;
+    int                 last = -1;
+    int                 count = 0;
+    const char         *pos = NULL;
+
+    for (pos = text; pos < end; pos++) {
+	if ((*pos < '0') || (*pos > '9'))
+	    continue;
+	if ((first < 0) && ('0' != *pos))
+	    first = count;
+	if ('0' != *pos)
+	    last = count;
+	count++;
+    }
+    return (first < 0) ? 1 : last - first + 1;
+}
+
+static void checkShortest(
+    double value
+) {
+    char                text[SUMMARY_NUM_LEN + 1];
+    char                trial[SUMMARY_NUM_LEN + 1];
+    int                 precision = 0;
+
+    formatText(formatShortest, value, text);
+    ck_assert_msg(strtod(text, NULL) == value, "formatShortest(%.17g) gave \"%s\", which reads "
+		  "back differently", value, text);
+    ck_assert_msg(!signbit(value) == ('-' != text[0]), "formatShortest(%.17g) gave \"%s\"",
+		  value, text);
+    // The fewest %g digits that read back, as printf() finds them
+    for (precision = 1; precision < 17; precision++) {
+	snprintf(trial, sizeof (trial), "%.*g", precision, value);
+	if (strtod(trial, NULL) == value)
+	    break;
+    }
+    ck_assert_msg(significantDigits(text) <= precision,
+		  "formatShortest(%.17g) gave \"%s\", longer than \"%s\"", value, text, trial);
+    return;
+}
+
+/* Spread over the magnitudes a summary sees, and then any bit pattern at all. */
+static double randomValue(
+    uint64_t *state,
+    int anyBits
+) {
+    uint64_t            bits = 0;
+    double              value = 0.0;
+
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    bits = *state;
+    if (anyBits) {
+	memcpy(&value, &bits, sizeof (value));
+	return value;
+    }
+    value = ldexp((double) (bits >> 11), -53) * pow(10.0, (double) ((bits & 0x1F) % 19) - 8.0);
+    return (bits & 0x20) ? -value : value;
+}
+
+START_TEST(test_fixed6_edges)
+{
+    size_t              i = 0;
+
+    for (i = 0; i < sizeof (edgeValues) / sizeof (edgeValues[0]); i++) {
+	checkFixed6(edgeValues[i]);
+	checkFixed6(-edgeValues[i]);
+    }
+    checkFixed6(NAN);
+    checkFixed6(INFINITY);
+    checkFixed6(-INFINITY);
+}
+END_TEST
+
+START_TEST(test_fixed6_random)
+{
+    uint64_t            state = 0x9E3779B97F4A7C15ull;
+    int                 i = 0;
+
+    for (i = 0; i < RANDOM_VALUES; i++)
+	checkFixed6(randomValue(&state, 0));
+    // Near halfway, where printf() rounds on the exact binary value
+    for (i = 0; i < RANDOM_VALUES; i++)
+	checkFixed6((i + 0.5) * 1.0e-6);
+    // Odd multiples of 1/128 are exactly halfway, and printf() rounds those to even
+    for (i = 0; i < RANDOM_VALUES; i++)
+	checkFixed6((2 * i + 1) / 128.0);
+}
+END_TEST
+
+START_TEST(test_shortest_edges)
+{
+    char                text[SUMMARY_NUM_LEN + 1];
+    size_t              i = 0;
+
+    for (i = 0; i < sizeof (edgeValues) / sizeof (edgeValues[0]); i++) {
+	checkShortest(edgeValues[i]);
+	checkShortest(-edgeValues[i]);
+    }
+    formatText(formatShortest, 0.1, text);
+    ck_assert_str_eq(text, "0.1");
+    formatText(formatShortest, 100.0, text);
+    ck_assert_str_eq(text, "100");
+    formatText(formatShortest, 1.5e-7, text);
+    ck_assert_str_eq(text, "0.00000015");
+    formatText(formatShortest, -2.5, text);
+    ck_assert_str_eq(text, "-2.5");
+    formatText(formatShortest, -0.0, text);
+    ck_assert_str_eq(text, "-0");
+    formatText(formatShortest, INFINITY, text);
+    ck_assert_str_eq(text, "inf");
+}
+END_TEST
+
+START_TEST(test_shortest_random)
+{
+    uint64_t            state = 0xD1B54A32D192ED03ull;
+    int                 i = 0;
+
+    for (i = 0; i < RANDOM_VALUES; i++)
+	checkShortest(randomValue(&state, 0));
+    for (i = 0; i < RANDOM_VALUES; i++) {
+	double              value = randomValue(&state, 1);
+
+	if (isfinite(value))
+	    checkShortest(value);
+    }
+}
+END_TEST
+
+START_TEST(test_unsigned)
+{
+    const uint64_t      values[] = { 0, 9, 10, 4294967296ull, UINT64_MAX };
+    char                text[SUMMARY_NUM_LEN + 1];
+    char                expected[32];
+    size_t              i = 0;
+
+    for (i = 0; i < sizeof (values) / sizeof (values[0]); i++) {
+	text[formatUnsigned(values[i], text)] = '\0';
+	snprintf(expected, sizeof (expected), "%" PRIu64, values[i]);
+	ck_assert_str_eq(text, expected);
+    }
+}
+END_TEST
+
+static Suite       *formatSuite(
+) {
+    Suite              *suite = suite_create("format");
+    TCase              *fixed = tcase_create("fixed6");
+    TCase              *shortest = tcase_create("shortest");
+
+    tcase_add_test(fixed, test_fixed6_edges);
+    tcase_add_test(fixed, test_fixed6_random);
+    tcase_add_test(fixed, test_unsigned);
+    tcase_set_timeout(fixed, 60);
+    suite_add_tcase(suite, fixed);
+    tcase_add_test(shortest, test_shortest_edges);
+    tcase_add_test(shortest, test_shortest_random);
+    tcase_set_timeout(shortest, 60);
+    suite_add_tcase(suite, shortest);
+    return suite;
+}
+
+int main(
+) {
+    SRunner            *runner = srunner_create(formatSuite());
+    int                 failed = 0;
+
+    srunner_run_all(runner, CK_NORMAL);
+    failed = srunner_ntests_failed(runner);
+    srunner_free(runner);
+    return (0 == failed) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
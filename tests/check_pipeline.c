@@ -0,0 +1,158 @@
+/* The pipelined points file against the one made whole in memory, byte for byte. */
+#include "../config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include "../src/genBinary/genBinary.h"
+#include "../src/pipeline/pipeline.h"
+#include "../src/compressStream/compressStream.h"
+#include "../src/logging/logging.h"
+
+#define TEST_CLOCK_MHZ 1000.0	     // Sample clock the waveforms are made at
+
+/* A train of the given shape, short enough to make quickly. */
+typedef struct trainCase {
+    int                 kind;
+    unsigned int        toothCount;
+    double              duration;
+    int                 envelope;
+    int                 sampleFormat;
+    int                 markerMode;
+} trainCase_type;
+
+static const trainCase_type trainCases[] = {
+    {PULSE_SRC_LINEAR, 20, 1000.0, ENVELOPE_RECT, SAMPLE_FORMAT_U8, MARKER_NONE},
+    {PULSE_SRC_LINEAR, 7, 333.3, ENVELOPE_RECT, SAMPLE_FORMAT_U8, MARKER_TOOTH},
+    {PULSE_SRC_LOG, 50, 41.7, ENVELOPE_GAUSS, SAMPLE_FORMAT_U12, MARKER_START},
+    {PULSE_SRC_LINEAR, 3, 20000.0, ENVELOPE_RAISEDCOS, SAMPLE_FORMAT_U12, MARKER_TOOTH}
+};
+
+/* Thread, buffer and chunk settings to try against each train */
+static const pipelineConfig_type pipeConfigs[] = {
+    PIPELINE_INIT_VAL,
+    {2, 4096, 3, 0, 0},
+    {5, 1000, 4, 0, 0}
+};
+
+/* Reads "<rootName>_points" whole, or NULL. */
+static unsigned char *readPoints(
+    const char *rootName,
+    size_t *len
+) {
+    char                fileName[64];
+    unsigned char      *contents = NULL;
+    FILE               *inFile = NULL;
+    long                size = 0;
+
+    snprintf(fileName, sizeof (fileName), "%s_points", rootName);
+    inFile = fopen(fileName, "rb");
+    if (NULL == inFile)
+	return NULL;
+    if (!fseek(inFile, 0, SEEK_END) && ((size = ftell(inFile)) > 0)
+	&& !fseek(inFile, 0, SEEK_SET) && (NULL != (contents = malloc((size_t) size)))
+	&& (fread(contents, 1, (size_t) size, inFile) != (size_t) size)) {
+	free(contents);
+	contents = NULL;
+    }
+    fclose(inFile);
+    remove(fileName);
+    *len = (size_t) size;
+    return contents;
+}
+
+START_TEST(test_pipeline_matches_memory)
+{
+    const trainCase_type *train = &trainCases[_i];
+    const double        pointInterval = 1000.0 / TEST_CLOCK_MHZ;
+    pulseSweep_type     sweep = PULSE_SWEEP_INIT_VAL;
+    wavePlan_type       plan = WAVE_PLAN_INIT_VAL;
+    outputDigest_type   memDigest = OUTPUT_DIGEST_INIT_VAL;
+    freqList_ptr        freqList = NULL;
+    uint64_t           *counts = NULL;
+    unsigned char      *points = NULL;
+    unsigned char      *markers = NULL;
+    unsigned char      *memFile = NULL;
+    uint64_t            finalCount = 0;
+    size_t              memLen = 0;
+    size_t              i = 0;
+
+    logSetEnabled(LOG_INFO, 0);
+    sweep.kind = train->kind;
+    sweep.toothCount = train->toothCount;
+    sweep.startFreq = 10.0;
+    sweep.stopFreq = 300.0;
+    sweep.duration = train->duration;
+    sweep.amplitude = 0.8;
+    sweep.envelope = train->envelope;
+    freqList = sweepFreqList(&sweep);
+    ck_assert_ptr_ne(freqList, NULL);
+    counts = pointCounts(freqList, pointInterval);
+    ck_assert_ptr_ne(counts, NULL);
+
+    // The in-memory engine
+    points = genPointList(freqList, counts, pointInterval, train->sampleFormat,
+			  train->markerMode, &finalCount, &markers);
+    ck_assert_ptr_ne(points, NULL);
+    ck_assert_int_eq(writeToFile("check_memory", points, markers, finalCount,
+				 train->sampleFormat, TEST_CLOCK_MHZ, COMPRESS_NONE, 0,
+				 &memDigest), 0);
+    memFile = readPoints("check_memory", &memLen);
+    ck_assert_ptr_ne(memFile, NULL);
+    ck_assert_uint_eq(memDigest.bytes, memLen);
+
+    ck_assert_int_eq(planWaveform(freqList, counts, pointInterval, train->sampleFormat, &plan),
+		     0);
+    plan.markerMode = train->markerMode;
+    ck_assert_uint_eq(plan.finalCount, finalCount);
+    ck_assert_uint_eq(pointsCommandBytes(&plan, TEST_CLOCK_MHZ), memLen);
+
+    for (i = 0; i < sizeof (pipeConfigs) / sizeof (pipeConfigs[0]); i++) {
+	outputDigest_type   pipeDigest = OUTPUT_DIGEST_INIT_VAL;
+	unsigned char      *pipeFile = NULL;
+	size_t              pipeLen = 0;
+
+	ck_assert_int_eq(writeToFilePipelined("check_pipeline", freqList, &plan, TEST_CLOCK_MHZ,
+					      &pipeConfigs[i], COMPRESS_NONE, 0, NULL,
+					      &pipeDigest), 0);
+	pipeFile = readPoints("check_pipeline", &pipeLen);
+	ck_assert_ptr_ne(pipeFile, NULL);
+	ck_assert_uint_eq(pipeLen, memLen);
+	ck_assert_msg(0 == memcmp(pipeFile, memFile, memLen),
+		      "Train %d differs with pipeline settings %u", _i, (unsigned int) i);
+	ck_assert_uint_eq(pipeDigest.crc, memDigest.crc);
+	free(pipeFile);
+    }
+
+    free(memFile);
+    free(points);
+    if (NULL != markers)
+	free(markers);
+    free(counts);
+    freeWavePlan(&plan);
+    freeFreqList(freqList);
+}
+END_TEST
+
+static Suite       *pipelineSuite(
+) {
+    Suite              *suite = suite_create("pipeline");
+    TCase              *match = tcase_create("matches memory");
+
+    tcase_add_loop_test(match, test_pipeline_matches_memory, 0,
+			sizeof (trainCases) / sizeof (trainCases[0]));
+    tcase_set_timeout(match, 60);
+    suite_add_tcase(suite, match);
+    return suite;
+}
+
+int main(
+) {
+    SRunner            *runner = srunner_create(pipelineSuite());
+    int                 failed = 0;
+
+    srunner_run_all(runner, CK_NORMAL);
+    failed = srunner_ntests_failed(runner);
+    srunner_free(runner);
+    return (0 == failed) ? EXIT_SUCCESS : EXIT_FAILURE;
+}